@@ -0,0 +1,253 @@
+// Copyright (c) 2014, Alexey Ivanov
+
+// Latency check of RPC round trip in both modes of plugin network I/O(see AIMPControlPlugin::startServerIOThreads):
+//  - timer-polled: server io_service and player handlers are polled by AIMP tick timer only(io_threads_count = 0);
+//  - pooled: network I/O threads run server io_service, player thread is woken up by each handler posted to it.
+// Request is modelled as in Http::Connection: I/O thread posts handling to player thread, which calls fake AIMP manager
+// and posts reply back to connection strand. Win32 message-only window of ControlPlugin::PlayerThreadDispatcher
+// is replaced by condition variable here, the rest(player io_service kept busy by work object, poll() on wake up and tick) is the same.
+// Exit code is non zero if handler posted after poll() of empty queue is lost, or pooled mode p99 is not below tick interval.
+
+#include <boost/asio.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <future>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+typedef std::chrono::steady_clock Clock;
+
+const std::chrono::milliseconds kTICK_TIMER_ELAPSE(100); // the same as in control_plugin.cpp.
+const std::chrono::microseconds kSDK_CALL_DURATION(50);
+
+//! Stand-in of AIMPManager: getter of player state which takes some time in player thread.
+class FakeAIMPManager
+{
+public:
+    FakeAIMPManager() : volume_(50), calls_count_(0) {}
+
+    int getVolume()
+    {
+        const Clock::time_point end = Clock::now() + kSDK_CALL_DURATION;
+        while (Clock::now() < end) {
+        }
+        ++calls_count_;
+        return volume_;
+    }
+
+    unsigned int calls_count() const
+        { return calls_count_; }
+
+private:
+    int volume_;
+    unsigned int calls_count_;
+};
+
+//! PlayerThreadDispatcher with condition variable instead of message-only window.
+class PlayerThreadDispatcher
+{
+public:
+    explicit PlayerThreadDispatcher(boost::asio::io_service& io_service)
+        :
+        io_service_(io_service),
+        io_service_work_(io_service),
+        wake_up_pending_(false)
+    {}
+
+    template <typename Handler>
+    void post(Handler handler)
+    {
+        io_service_.post(handler);
+        wakeUp();
+    }
+
+    void poll()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            wake_up_pending_ = false;
+        }
+        io_service_.poll();
+    }
+
+    //! Waits for wake up or deadline, it is message loop of player thread.
+    void waitForWakeUp(Clock::time_point deadline)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        wake_up_.wait_until(lock, deadline, [this] { return wake_up_pending_; });
+    }
+
+private:
+
+    void wakeUp()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        wake_up_pending_ = true;
+        wake_up_.notify_one();
+    }
+
+    boost::asio::io_service& io_service_;
+    boost::asio::io_service::work io_service_work_;
+    std::mutex mutex_;
+    std::condition_variable wake_up_;
+    bool wake_up_pending_;
+};
+
+class Plugin
+{
+public:
+    explicit Plugin(unsigned int io_threads_count)
+        :
+        dispatcher_(player_io_service_),
+        strand_(server_io_service_),
+        stopped_(false)
+    {
+        if (io_threads_count != 0) {
+            server_io_service_work_.reset( new boost::asio::io_service::work(server_io_service_) );
+            for (unsigned int i = 0; i != io_threads_count; ++i) {
+                io_threads_.emplace_back([this] { server_io_service_.run(); });
+            }
+        }
+        player_thread_ = std::thread([this, io_threads_count] { runPlayerThread(io_threads_count == 0); });
+    }
+
+    ~Plugin()
+    {
+        stopped_ = true;
+        dispatcher_.post([] {}); // wake up player thread.
+        player_thread_.join();
+        server_io_service_work_.reset();
+        server_io_service_.stop();
+        for (auto& thread : io_threads_) {
+            thread.join();
+        }
+    }
+
+    //! Returns volume as client gets it from RPC response.
+    int handleRequest()
+    {
+        std::promise<int> response;
+        // request is received and parsed in I/O thread.
+        server_io_service_.post([this, &response] {
+            dispatcher_.post([this, &response] {
+                const int volume = aimp_manager_.getVolume();
+                strand_.post([&response, volume] { response.set_value(volume); }); // reply is written by connection.
+            });
+        });
+        return response.get_future().get();
+    }
+
+    unsigned int aimp_calls_count() const
+        { return aimp_manager_.calls_count(); }
+
+private:
+
+    void runPlayerThread(bool poll_server_io_service)
+    {
+        Clock::time_point next_tick = Clock::now() + kTICK_TIMER_ELAPSE;
+        while (!stopped_) {
+            if (poll_server_io_service) {
+                std::this_thread::sleep_until(next_tick); // wake ups are useless if handlers are posted by tick only.
+            } else {
+                dispatcher_.waitForWakeUp(next_tick);
+            }
+            if (Clock::now() >= next_tick) {
+                next_tick += kTICK_TIMER_ELAPSE;
+                if (poll_server_io_service) {
+                    server_io_service_.poll();
+                    server_io_service_.reset(); // acceptor of real server always has pending operation.
+                }
+            }
+            dispatcher_.poll();
+        }
+    }
+
+    boost::asio::io_service server_io_service_;
+    std::unique_ptr<boost::asio::io_service::work> server_io_service_work_;
+    std::vector<std::thread> io_threads_;
+    boost::asio::io_service player_io_service_;
+    PlayerThreadDispatcher dispatcher_;
+    boost::asio::io_service::strand strand_;
+    FakeAIMPManager aimp_manager_; // used only in player thread.
+    std::atomic<bool> stopped_;
+    std::thread player_thread_;
+};
+
+struct Latency
+{
+    double p50,
+           p99,
+           max;
+};
+
+//! Returns round trip time percentiles in milliseconds. Requests are sent one by one with random pauses up to max_pause.
+Latency measure(Plugin& plugin, unsigned int requests_count, std::chrono::microseconds max_pause, std::mt19937& random)
+{
+    std::vector<double> times;
+    std::uniform_int_distribution<long long> pause(0, max_pause.count());
+    for (unsigned int i = 0; i != requests_count; ++i) {
+        std::this_thread::sleep_for( std::chrono::microseconds( pause(random) ) ); // requests do not come in phase with tick timer.
+        const Clock::time_point start = Clock::now();
+        plugin.handleRequest();
+        times.push_back( std::chrono::duration<double, std::milli>(Clock::now() - start).count() );
+    }
+    std::sort( times.begin(), times.end() );
+    const Latency latency = { times[times.size() / 2], times[times.size() * 99 / 100], times.back() };
+    return latency;
+}
+
+//! Handler posted after poll() found nothing to do must be executed by next poll().
+bool checkPollOfEmptyQueue()
+{
+    boost::asio::io_service io_service;
+    PlayerThreadDispatcher dispatcher(io_service);
+    dispatcher.poll();
+    bool executed = false;
+    dispatcher.post([&executed] { executed = true; });
+    dispatcher.poll();
+    if (!executed) {
+        printf("FAILED: handler posted after poll of empty queue is not executed\n");
+    }
+    return executed;
+}
+
+} // namespace
+
+int main()
+{
+    unsigned int checks_count = 0,
+                 failures_count = 0;
+
+    ++checks_count;
+    failures_count += checkPollOfEmptyQueue() ? 0 : 1;
+
+    std::mt19937 random(2014);
+    const struct { const char* name; unsigned int io_threads_count, requests_count; std::chrono::microseconds max_pause; } modes[] = {
+        { "timer-polled", 0, 30, kTICK_TIMER_ELAPSE },
+        { "pooled, 1 I/O thread", 1, 2000, std::chrono::microseconds(500) },
+        { "pooled, 2 I/O threads", 2, 2000, std::chrono::microseconds(500) }
+    };
+    for (auto& mode : modes) {
+        Plugin plugin(mode.io_threads_count);
+        const Latency latency = measure(plugin, mode.requests_count, mode.max_pause, random);
+        ++checks_count;
+        bool failed = plugin.aimp_calls_count() != mode.requests_count;
+        if (mode.io_threads_count != 0) {
+            failed = failed || latency.p99 >= std::chrono::duration<double, std::milli>(kTICK_TIMER_ELAPSE).count();
+        }
+        failures_count += failed ? 1 : 0;
+        printf("%s%s, %u requests: p50 %.3f ms, p99 %.3f ms, max %.3f ms\n",
+               failed ? "FAILED: " : "", mode.name, mode.requests_count, latency.p50, latency.p99, latency.max);
+    }
+
+    printf("%u of %u checks failed\n", failures_count, checks_count);
+    return failures_count == 0 ? 0 : 1;
+}
@@ -0,0 +1,262 @@
+// Copyright (c) 2014, Alexey Ivanov
+
+// Round trip check of Utilities::GzipEncoder.
+// Data of different kinds is compressed with each level in both formats, passed to encoder by portions of different sizes,
+// then it is decoded by Utilities::decodeDeflate(and by zlib if available) and compared with original.
+// Gzip header and trailer(crc32 and size) are checked too. Exit code is non zero if any check fails.
+
+#include "utils/gzip_encoder.h"
+#include "utils/deflate_decoder.h"
+#include <boost/crc.hpp>
+#include <boost/cstdint.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifdef CHECK_WITH_ZLIB
+#   include <zlib.h>
+#endif
+
+namespace
+{
+
+using Utilities::GzipEncoder;
+
+struct Sample
+{
+    const char* name;
+    std::string data;
+};
+
+//! Linear congruential generator: samples are the same on each run and platform.
+class Random
+{
+public:
+    explicit Random(boost::uint32_t seed) : state_(seed) {}
+
+    boost::uint32_t next()
+        { state_ = state_ * 1103515245u + 12345u; return state_ >> 8; }
+
+    boost::uint32_t next(boost::uint32_t bound)
+        { return next() % bound; }
+
+private:
+    boost::uint32_t state_;
+};
+
+std::vector<Sample> makeSamples()
+{
+    std::vector<Sample> samples;
+    Random random(2014);
+
+    Sample empty = { "empty", std::string() };
+    samples.push_back(empty);
+
+    Sample one_byte = { "one byte", std::string(1, 'x') };
+    samples.push_back(one_byte);
+
+    Sample same_bytes = { "100Kb of the same byte", std::string(100 * 1024, 'a') };
+    samples.push_back(same_bytes);
+
+    Sample random_bytes = { "200Kb of random bytes", std::string() };
+    for (size_t i = 0; i != 200 * 1024; ++i) {
+        random_bytes.data.push_back( static_cast<char>( random.next(256) ) );
+    }
+    samples.push_back(random_bytes);
+
+    Sample all_bytes = { "cycle of all byte values", std::string() };
+    for (size_t i = 0; i != 70000; ++i) {
+        all_bytes.data.push_back( static_cast<char>(i & 0xFF) );
+    }
+    samples.push_back(all_bytes);
+
+    // response of GetPlaylistEntries: typical input of RPC responses compression.
+    Sample json = { "500Kb of JSON-RPC response", "{\"id\":1,\"jsonrpc\":\"2.0\",\"result\":{\"count_of_found_entries\":5000,\"entries\":[" };
+    const char* const artists[] = { "Artist One", "The Second Band", "Third", "Somebody Else" };
+    for (int i = 0; json.data.size() < 500 * 1024; ++i) {
+        char entry[256];
+        sprintf(entry, "%s{\"album\":\"Album %u\",\"artist\":\"%s\",\"duration\":%u,\"id\":%d,\"title\":\"Track title %u\"}",
+                i == 0 ? "" : ",", random.next(50), artists[random.next(4)], 100000 + random.next(300000), i, random.next(100000));
+        json.data += entry;
+    }
+    json.data += "]}}";
+    samples.push_back(json);
+
+    // random data with copies at distances around window size checks matches at window boundary.
+    Sample far_matches = { "matches at distances up to 32Kb", std::string() };
+    for (size_t i = 0; i != 40000; ++i) {
+        far_matches.data.push_back( static_cast<char>( random.next(256) ) );
+    }
+    const size_t distances[] = { 1, 2, 3, 258, 4096, 32767, 32768, 32769 };
+    for (size_t i = 0; far_matches.data.size() < 300 * 1024; ++i) {
+        const size_t distance = distances[i % (sizeof(distances) / sizeof(distances[0]))];
+        const size_t length = 3 + random.next(300);
+        for (size_t k = 0; k != length; ++k) {
+            far_matches.data.push_back( far_matches.data[far_matches.data.size() - distance] );
+        }
+        far_matches.data.push_back( static_cast<char>( random.next(256) ) ); // break match.
+    }
+    samples.push_back(far_matches);
+
+    return samples;
+}
+
+//! Returns compressed data, input is passed to encoder by portions of random size not greater than max_portion.
+std::string encode(const std::string& data, int level, GzipEncoder::Format format, size_t max_portion, Random& random)
+{
+    std::string out;
+    GzipEncoder encoder(level, &out, format);
+    for (size_t pos = 0; pos < data.size(); ) {
+        const size_t portion = std::min( data.size() - pos, 1 + static_cast<size_t>( random.next( static_cast<boost::uint32_t>(max_portion) ) ) );
+        encoder.write(data.data() + pos, portion);
+        pos += portion;
+    }
+    encoder.finish();
+    return out;
+}
+
+boost::uint32_t readLittleEndian32(const std::string& data, size_t pos)
+{
+    return   boost::uint32_t( static_cast<unsigned char>(data[pos]) )
+           | boost::uint32_t( static_cast<unsigned char>(data[pos + 1]) ) << 8
+           | boost::uint32_t( static_cast<unsigned char>(data[pos + 2]) ) << 16
+           | boost::uint32_t( static_cast<unsigned char>(data[pos + 3]) ) << 24;
+}
+
+//! Returns raw deflate data of gzip member after checking its header and trailer.
+std::string checkGzipFraming(const std::string& compressed, const std::string& original) // throws std::runtime_error
+{
+    const size_t kHEADER_SIZE = 10,
+                 kTRAILER_SIZE = 8;
+    if (compressed.size() < kHEADER_SIZE + kTRAILER_SIZE) {
+        throw std::runtime_error("gzip data is shorter than header and trailer");
+    }
+    if (compressed[0] != '\x1F' || compressed[1] != '\x8B' || compressed[2] != 8 || compressed[3] != 0) {
+        throw std::runtime_error("invalid gzip header");
+    }
+
+    boost::crc_32_type crc;
+    crc.process_bytes( original.data(), original.size() );
+    const size_t trailer_pos = compressed.size() - kTRAILER_SIZE;
+    if ( readLittleEndian32(compressed, trailer_pos) != crc.checksum() ) {
+        throw std::runtime_error("crc32 in gzip trailer does not match");
+    }
+    if ( readLittleEndian32(compressed, trailer_pos + 4) != static_cast<boost::uint32_t>( original.size() ) ) {
+        throw std::runtime_error("size in gzip trailer does not match");
+    }
+    return compressed.substr(kHEADER_SIZE, trailer_pos - kHEADER_SIZE);
+}
+
+#ifdef CHECK_WITH_ZLIB
+std::string inflateWithZlib(const std::string& compressed, GzipEncoder::Format format, size_t max_size) // throws std::runtime_error
+{
+    std::string input = compressed;
+    if (format == GzipEncoder::DEFLATE_MESSAGE) {
+        input.append("\x00\x00\xFF\xFF", 4); // tail of sync flush which is removed from WebSocket message(RFC 7692).
+    }
+
+    z_stream stream = z_stream();
+    if ( inflateInit2(&stream, format == GzipEncoder::GZIP ? 16 + MAX_WBITS : -MAX_WBITS) != Z_OK ) {
+        throw std::runtime_error("inflateInit2 failed");
+    }
+    std::string out(max_size + 1, '\0');
+    stream.next_in = reinterpret_cast<Bytef*>(&input[0]);
+    stream.avail_in = static_cast<uInt>( input.size() );
+    stream.next_out = reinterpret_cast<Bytef*>(&out[0]);
+    stream.avail_out = static_cast<uInt>( out.size() );
+    const int result = inflate(&stream, Z_SYNC_FLUSH);
+    const size_t out_size = out.size() - stream.avail_out;
+    inflateEnd(&stream);
+
+    if ( result != (format == GzipEncoder::GZIP ? Z_STREAM_END : Z_OK) && !(result == Z_BUF_ERROR && out_size == 0) ) {
+        throw std::runtime_error("zlib inflate failed");
+    }
+    out.resize(out_size);
+    return out;
+}
+#endif
+
+//! Returns false and prints reason if round trip fails.
+bool checkRoundTrip(const Sample& sample, int level, GzipEncoder::Format format, size_t max_portion, Random& random, size_t* compressed_size)
+{
+    const char* const format_name = format == GzipEncoder::GZIP ? "gzip" : "deflate message";
+    try {
+        const std::string compressed = encode(sample.data, level, format, max_portion, random);
+        *compressed_size = compressed.size();
+
+        const std::string deflate_data = format == GzipEncoder::GZIP ? checkGzipFraming(compressed, sample.data)
+                                                                     : compressed;
+        std::string decoded;
+        Utilities::decodeDeflate(deflate_data.data(), deflate_data.size(), sample.data.size(), &decoded);
+        if (decoded != sample.data) {
+            throw std::runtime_error("data decoded by decodeDeflate differs from original");
+        }
+
+#ifdef CHECK_WITH_ZLIB
+        if (inflateWithZlib(compressed, format, sample.data.size()) != sample.data) {
+            throw std::runtime_error("data decoded by zlib differs from original");
+        }
+#endif
+        return true;
+    } catch (std::exception& e) {
+        printf("FAILED: %s, level %d, %s, portions up to %u bytes: %s\n", sample.name, level, format_name, static_cast<unsigned int>(max_portion), e.what());
+        return false;
+    }
+}
+
+} // namespace
+
+int main()
+{
+    const std::vector<Sample> samples = makeSamples();
+    const size_t max_portions[] = { 1, 1000, 100 * 1024, 1024 * 1024 };
+    const GzipEncoder::Format formats[] = { GzipEncoder::GZIP, GzipEncoder::DEFLATE_MESSAGE };
+    Random random(1);
+
+#ifdef CHECK_WITH_ZLIB
+    printf("Decoders: decodeDeflate, zlib %s\n", zlibVersion());
+#else
+    printf("Decoders: decodeDeflate\n");
+#endif
+
+    unsigned int checks_count = 0,
+                 failures_count = 0;
+    for (auto& sample : samples) {
+        printf("%s(%u bytes), compressed size by level 1..9:", sample.name, static_cast<unsigned int>( sample.data.size() ) );
+        for (int level = 1; level <= 9; ++level) {
+            for (auto format : formats) {
+                for (auto max_portion : max_portions) {
+                    if (max_portion == 1 && sample.data.size() > 100 * 1024) {
+                        continue; // byte by byte writing of large sample only slows check down.
+                    }
+                    size_t compressed_size = 0;
+                    ++checks_count;
+                    if ( !checkRoundTrip(sample, level, format, max_portion, random, &compressed_size) ) {
+                        ++failures_count;
+                    }
+                    if (format == GzipEncoder::GZIP && max_portion == 1024 * 1024) {
+                        printf(" %u", static_cast<unsigned int>(compressed_size) );
+                    }
+                }
+            }
+        }
+        printf("\n");
+    }
+
+    // speed of default RPC compression level on typical response.
+    const Sample& json = samples[5];
+    const int kRUNS = 20;
+    const clock_t start = clock();
+    size_t compressed_size = 0;
+    for (int i = 0; i != kRUNS; ++i) {
+        compressed_size += encode(json.data, 6, GzipEncoder::GZIP, json.data.size(), random).size();
+    }
+    const double seconds = double(clock() - start) / CLOCKS_PER_SEC;
+    printf("%s, level 6: %.2f ms per response, %.1f Mb/s\n", json.name, seconds * 1000 / kRUNS, json.data.size() * kRUNS / seconds / (1024 * 1024));
+
+    printf("%u of %u round trips failed\n", failures_count, checks_count);
+    return failures_count == 0 ? 0 : 1;
+}
@@ -0,0 +1,293 @@
+// Copyright (c) 2014, Alexey Ivanov
+
+// Correctness and speed check of Http::request_parser on requests which web client sends:
+// RPC calls, static files with validators, track download with range, album cover, track upload.
+// Requests are parsed whole, by random portions(as they come from network) and pipelined on one persistent
+// connection where Request object and parser are reused like Http::Connection does.
+// Requests exceeding parser limits must be rejected. Speed is reported as requests/s and allocations per request,
+// allocations are counted by replaced global operator new. Exit code is non zero if any check fails.
+
+#include "stdafx.h"
+#include "http_server/request_parser.h"
+#include "http_server/request.h"
+#include <boost/cstdint.hpp>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <new>
+#include <string>
+#include <vector>
+
+namespace
+{
+unsigned long long allocations_count = 0;
+}
+
+void* operator new(std::size_t size)
+{
+    ++allocations_count;
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+namespace
+{
+
+using namespace Http;
+
+//! Linear congruential generator: portions are the same on each run and platform.
+class Random
+{
+public:
+    explicit Random(boost::uint32_t seed) : state_(seed) {}
+
+    boost::uint32_t next(boost::uint32_t bound)
+        { state_ = state_ * 1103515245u + 12345u; return (state_ >> 8) % bound; }
+
+private:
+    boost::uint32_t state_;
+};
+
+struct Sample
+{
+    const char* name;
+    std::string text;
+    const char* method;
+    const char* uri;
+    KnownHeader header_id; // header which value is checked.
+    const char* header_value;
+    std::string content;
+};
+
+const char* const kCOMMON_HEADERS = "Host: 192.168.1.2:3333\r\n"
+                                    "User-Agent: Mozilla/5.0 (Linux; Android 4.4.2; Nexus 5 Build/KOT49H) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/34.0.1847.114 Mobile Safari/537.36\r\n"
+                                    "Accept-Encoding: gzip,deflate,sdch\r\n"
+                                    "Accept-Language: ru-RU,ru;q=0.8,en-US;q=0.6,en;q=0.4\r\n"
+                                    "Cookie: session=9f86d081884c7d659a2feaa0c55ad015a3bf4f1b2b0b822cd15d6c15b0f00a08\r\n"
+                                    "Connection: keep-alive\r\n";
+
+std::vector<Sample> makeSamples()
+{
+    std::vector<Sample> samples;
+
+    const std::string rpc_content = "{\"jsonrpc\":\"2.0\",\"method\":\"GetPlaylistEntries\",\"params\":{\"playlist_id\":123,"
+                                    "\"fields\":[\"id\",\"title\",\"artist\",\"album\",\"duration\"],\"start_index\":0,\"entries_count\":50},\"id\":17}";
+    Sample rpc = { "RPC call", "", "POST", "/RPC_JSON", HEADER_CONTENT_TYPE, "application/json", rpc_content };
+    rpc.text = std::string("POST /RPC_JSON HTTP/1.1\r\n") + kCOMMON_HEADERS
+               + "Content-Length: " + std::to_string( rpc_content.size() ) + "\r\n"
+               + "Accept: application/json, text/javascript, */*; q=0.01\r\n"
+               + "Origin: http://192.168.1.2:3333\r\n"
+               + "X-Requested-With: XMLHttpRequest\r\n"
+               + "Content-Type: application/json\r\n"
+               + "Referer: http://192.168.1.2:3333/index.htm\r\n"
+               + "\r\n" + rpc_content;
+    samples.push_back(rpc);
+
+    Sample file = { "static file", "", "GET", "/css/images/ui-icons_222222_256x240.png", HEADER_IF_NONE_MATCH, "\"5f3a-1396e2a4c80\"", "" };
+    file.text = std::string("GET /css/images/ui-icons_222222_256x240.png HTTP/1.1\r\n") + kCOMMON_HEADERS
+                + "Accept: image/webp,*/*;q=0.8\r\n"
+                + "Referer: http://192.168.1.2:3333/css/jquery-ui.css\r\n"
+                + "If-None-Match: \"5f3a-1396e2a4c80\"\r\n"
+                + "If-Modified-Since: Sat, 17 May 2014 10:20:30 GMT\r\n"
+                + "\r\n";
+    samples.push_back(file);
+
+    Sample download = { "track download", "", "GET", "/downloadTrack/playlist_id/123/track_id/4567", HEADER_RANGE, "bytes=1048576-", "" };
+    download.text = std::string("GET /downloadTrack/playlist_id/123/track_id/4567 HTTP/1.1\r\n") + kCOMMON_HEADERS
+                    + "Accept: */*\r\n"
+                    + "Range: bytes=1048576-\r\n"
+                    + "If-Range: \"3a5b2c-1396e2a4c80\"\r\n"
+                    + "\r\n";
+    samples.push_back(download);
+
+    Sample cover = { "album cover", "", "GET", "/cover/123/4567/300x300", HEADER_AUTHORIZATION, "", "" };
+    const char* const authorization = "Digest username=\"user\", realm=\"AIMP Control plugin\", nonce=\"MTQwMDMyMzYyMjo5ZjM3\", uri=\"/cover/123/4567/300x300\", "
+                                      "response=\"6629fae49393a05397450978507c4ef1\", qop=auth, nc=00000001, cnonce=\"0a4f113b\"";
+    cover.header_value = authorization;
+    cover.text = std::string("GET /cover/123/4567/300x300 HTTP/1.1\r\n") + kCOMMON_HEADERS
+                 + "Accept: image/webp,*/*;q=0.8\r\n"
+                 + "Authorization: " + authorization + "\r\n"
+                 + "\r\n";
+    samples.push_back(cover);
+
+    // multipart content is received as usual content since no parser factory is installed.
+    std::string upload_content = "------WebKitFormBoundaryePkpFF7tjBAqx29L\r\n"
+                                 "Content-Disposition: form-data; name=\"file\"; filename=\"track.mp3\"\r\n"
+                                 "Content-Type: audio/mpeg\r\n\r\n";
+    upload_content += std::string(4000, 'A');
+    upload_content += "\r\n------WebKitFormBoundaryePkpFF7tjBAqx29L--\r\n";
+    Sample upload = { "track upload", "", "POST", "/uploadTrack/playlist_id/123", HEADER_CONTENT_LENGTH, "", upload_content };
+    static std::string upload_length; // sample keeps pointer to it.
+    upload_length = std::to_string( upload_content.size() );
+    upload.header_value = upload_length.c_str();
+    upload.text = std::string("POST /uploadTrack/playlist_id/123 HTTP/1.1\r\n") + kCOMMON_HEADERS
+                  + "Content-Length: " + upload_length + "\r\n"
+                  + "Content-Type: application/octet-stream\r\n"
+                  + "\r\n" + upload_content;
+    samples.push_back(upload);
+
+    return samples;
+}
+
+bool isTrue(boost::tribool value)
+    { return value ? true : false; }
+
+bool isFalse(boost::tribool value)
+    { return !value ? true : false; }
+
+bool requestMatches(const Request& req, const Sample& sample)
+{
+    const std::string* header_value = nullptr;
+    return    req.method == sample.method
+           && req.uri == sample.uri
+           && req.http_version_major == 1 && req.http_version_minor == 1
+           && get_header_value(req, sample.header_id, header_value) && *header_value == sample.header_value
+           && req.content == sample.content;
+}
+
+//! Parses text by portions of random size up to max_portion. Returns parse result and count of unconsumed chars.
+boost::tribool parseByPortions(request_parser& parser, Request& req, const std::string& text, size_t max_portion, Random& random, size_t* unconsumed)
+{
+    boost::tribool result = boost::indeterminate;
+    const char* begin = text.data();
+    const char* const end = begin + text.size();
+    while (begin != end && boost::indeterminate(result)) {
+        const char* const portion_end = begin + std::min<size_t>( end - begin, 1 + random.next( static_cast<boost::uint32_t>(max_portion) ) );
+        const char* consumed;
+        boost::tie(result, consumed) = parser.parse(req, begin, portion_end);
+        if (consumed != portion_end && boost::indeterminate(result)) {
+            return false; // parser must consume whole portion while request is incomplete.
+        }
+        begin = consumed;
+    }
+    *unconsumed = end - begin;
+    return result;
+}
+
+struct Counters
+{
+    unsigned int checks,
+                 failures;
+};
+
+void report(Counters* counters, bool ok, const std::string& description)
+{
+    ++counters->checks;
+    if (!ok) {
+        ++counters->failures;
+        printf("FAILED: %s\n", description.c_str());
+    }
+}
+
+void checkSamples(const std::vector<Sample>& samples, Random& random, Counters* counters)
+{
+    const size_t max_portions[] = { 1, 7, 100, 1500, 1 << 20 };
+    for (auto& sample : samples) {
+        for (auto max_portion : max_portions) {
+            request_parser parser;
+            Request req;
+            size_t unconsumed = 0;
+            const boost::tribool result = parseByPortions(parser, req, sample.text, max_portion, random, &unconsumed);
+            report(counters, isTrue(result) && unconsumed == 0 && requestMatches(req, sample),
+                   std::string(sample.name) + " parsed by portions up to " + std::to_string(max_portion) + " bytes");
+        }
+    }
+
+    { // pipelined requests on persistent connection: parser is reset and request is reused, headers of previous request must not leak.
+        std::string pipeline;
+        for (int i = 0; i != 3; ++i) {
+            for (auto& sample : samples) {
+                pipeline += sample.text;
+            }
+        }
+        request_parser parser;
+        Request req;
+        const char* begin = pipeline.data();
+        const char* const end = begin + pipeline.size();
+        bool ok = true;
+        for (size_t i = 0; ok && i != samples.size() * 3; ++i) {
+            parser.reset();
+            boost::tribool result;
+            boost::tie(result, begin) = parser.parse(req, begin, end);
+            const std::string* range = nullptr;
+            ok =    isTrue(result) && requestMatches( req, samples[i % samples.size()] )
+                 && ( samples[i % samples.size()].header_id == HEADER_RANGE || !get_header_value(req, HEADER_RANGE, range) );
+        }
+        report(counters, ok && begin == end, "pipelined requests");
+    }
+}
+
+void checkLimits(Counters* counters)
+{
+    const struct { const char* name; std::string text; } bad_requests[] = {
+        { "too long method", std::string(request_parser::kMAX_METHOD_LENGTH + 1, 'G') + " / HTTP/1.1\r\n\r\n" },
+        { "too long uri", "GET /" + std::string(request_parser::kMAX_URI_LENGTH, 'a') + " HTTP/1.1\r\n\r\n" },
+        { "too long header", "GET / HTTP/1.1\r\nCookie: " + std::string(request_parser::kMAX_HEADER_LENGTH, 'a') + "\r\n\r\n" },
+        { "too many headers", "GET / HTTP/1.1\r\n" + [] { std::string headers; for (size_t i = 0; i <= request_parser::kMAX_HEADERS_COUNT; ++i) headers += "X-Header: value\r\n"; return headers; }() + "\r\n" },
+        { "too large content", "POST /RPC_JSON HTTP/1.1\r\nContent-Length: " + std::to_string(request_parser::kMAX_CONTENT_LENGTH + 1) + "\r\n\r\n{" },
+        { "invalid content length", "POST /RPC_JSON HTTP/1.1\r\nContent-Length: 12a\r\n\r\n" },
+        { "invalid version", "GET / HTTP/x.1\r\n\r\n" },
+        { "control char in header name", "GET / HTTP/1.1\r\nHo\x01st: a\r\n\r\n" }
+    };
+    for (auto& bad : bad_requests) {
+        request_parser parser;
+        Request req;
+        boost::tribool result;
+        boost::tie(result, boost::tuples::ignore) = parser.parse( req, bad.text.data(), bad.text.data() + bad.text.size() );
+        report(counters, isFalse(result), std::string("rejection of ") + bad.name);
+    }
+}
+
+//! Prints parsing speed of sample, request object is reused(persistent connection) or created for each request.
+void measure(const Sample& sample, bool reuse_request)
+{
+    request_parser parser;
+    Request reused_request;
+    unsigned int runs = 0;
+    const unsigned long long start_allocations = allocations_count;
+    const clock_t start = clock();
+    clock_t elapsed;
+    do {
+        for (int i = 0; i != 100; ++i, ++runs) {
+            parser.reset();
+            if (reuse_request) {
+                parser.parse( reused_request, sample.text.data(), sample.text.data() + sample.text.size() );
+            } else {
+                Request req;
+                parser.parse( req, sample.text.data(), sample.text.data() + sample.text.size() );
+            }
+        }
+        elapsed = clock() - start;
+    } while (elapsed < CLOCKS_PER_SEC / 10);
+    const double seconds = double(elapsed) / CLOCKS_PER_SEC;
+    printf("%s(%u bytes), %s: %.0f requests/s, %.1f allocations per request\n",
+           sample.name, static_cast<unsigned int>( sample.text.size() ), reuse_request ? "reused request" : "new request",
+           runs / seconds, double(allocations_count - start_allocations) / runs);
+}
+
+} // namespace
+
+int main()
+{
+    Counters counters = { 0, 0 };
+    Random random(2014);
+
+    const std::vector<Sample> samples = makeSamples();
+    checkSamples(samples, random, &counters);
+    checkLimits(&counters);
+
+    for (auto& sample : samples) {
+        measure(sample, true);
+        measure(sample, false);
+    }
+
+    printf("%u of %u checks failed\n", counters.failures, counters.checks);
+    return counters.failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,296 @@
+// Copyright (c) 2014, Alexey Ivanov
+
+// Accuracy and speed check of ImageUtils::downscaleArea.
+// Synthetic images(gradient, noise, checkerboard) of 24 and 32 bits per pixel are downscaled with different ratios,
+// including power-of-two reductions which use box sums, and compared with area averaging computed in double precision.
+// Fixed point arithmetic of scaler may differ from reference by rounding only, so max allowed error is 1.
+// If FreeImage is available, its bicubic rescaling(which album covers used before) is timed on the same images.
+// Exit code is non zero if any check fails.
+
+#include "utils/image_scaler.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifdef CHECK_WITH_FREEIMAGE
+#   include <FreeImage.h>
+#endif
+
+namespace
+{
+
+struct Image
+{
+    unsigned int width,
+                 height,
+                 pitch,
+                 bytes_per_pixel;
+    std::vector<unsigned char> pixels;
+
+    Image(unsigned int width, unsigned int height, unsigned int bytes_per_pixel)
+        :
+        width(width),
+        height(height),
+        pitch( (width * bytes_per_pixel + 3) & ~3u ), // rows are aligned to 4 bytes like in FreeImage bitmaps.
+        bytes_per_pixel(bytes_per_pixel),
+        pixels(pitch * height)
+    {}
+
+    unsigned char* row(unsigned int y)
+        { return &pixels[y * pitch]; }
+
+    const unsigned char* row(unsigned int y) const
+        { return &pixels[y * pitch]; }
+};
+
+enum Pattern { GRADIENT, NOISE, CHECKERBOARD };
+
+const char* patternName(Pattern pattern)
+{
+    switch (pattern) {
+    case GRADIENT:
+        return "gradient";
+    case NOISE:
+        return "noise";
+    default:
+        return "checkerboard";
+    }
+}
+
+Image makeImage(Pattern pattern, unsigned int width, unsigned int height, unsigned int bytes_per_pixel)
+{
+    Image image(width, height, bytes_per_pixel);
+    unsigned int random = 2014;
+    for (unsigned int y = 0; y != height; ++y) {
+        unsigned char* pixel = image.row(y);
+        for (unsigned int x = 0; x != width; ++x) {
+            for (unsigned int c = 0; c != bytes_per_pixel; ++c, ++pixel) {
+                switch (pattern) {
+                case GRADIENT:
+                    *pixel = static_cast<unsigned char>( (x * 255 / width + y * 255 / height + c * 64) / 2 );
+                    break;
+                case NOISE:
+                    random = random * 1103515245u + 12345u;
+                    *pixel = static_cast<unsigned char>(random >> 16);
+                    break;
+                case CHECKERBOARD: // the worst case for area filter: every source pixel differs from its neighbours.
+                    *pixel = ( (x ^ y) & 1 ) ? 255 : 0;
+                    break;
+                }
+            }
+        }
+    }
+    return image;
+}
+
+//! Area averaging in double precision: each destination pixel is average of source pixels weighted by area they cover.
+Image downscaleReference(const Image& source, unsigned int width, unsigned int height)
+{
+    const unsigned int channels = source.bytes_per_pixel;
+    Image result(width, height, channels);
+    const double scale_x = double(source.width) / width,
+                 scale_y = double(source.height) / height;
+
+    std::vector<double> sums(channels);
+    for (unsigned int y = 0; y != height; ++y) {
+        const double top = y * scale_y,
+                     bottom = (y + 1) * scale_y;
+        for (unsigned int x = 0; x != width; ++x) {
+            const double left = x * scale_x,
+                         right = (x + 1) * scale_x;
+            std::fill(sums.begin(), sums.end(), 0.0);
+
+            for ( unsigned int sy = static_cast<unsigned int>(top); sy < bottom && sy < source.height; ++sy ) {
+                const double weight_y = std::min<double>(sy + 1, bottom) - std::max<double>(sy, top);
+                for ( unsigned int sx = static_cast<unsigned int>(left); sx < right && sx < source.width; ++sx ) {
+                    const double weight = weight_y * ( std::min<double>(sx + 1, right) - std::max<double>(sx, left) );
+                    const unsigned char* pixel = source.row(sy) + sx * channels;
+                    for (unsigned int c = 0; c != channels; ++c) {
+                        sums[c] += weight * pixel[c];
+                    }
+                }
+            }
+
+            unsigned char* pixel = result.row(y) + x * channels;
+            for (unsigned int c = 0; c != channels; ++c) {
+                pixel[c] = static_cast<unsigned char>( std::floor(sums[c] / (scale_x * scale_y) + 0.5) );
+            }
+        }
+    }
+    return result;
+}
+
+Image downscale(const Image& source, unsigned int width, unsigned int height)
+{
+    Image result(width, height, source.bytes_per_pixel);
+    ImageUtils::downscaleArea(source.pixels.data(), source.width, source.height, source.pitch,
+                              result.pixels.data(), width, height, result.pitch,
+                              source.bytes_per_pixel);
+    return result;
+}
+
+struct Difference
+{
+    int max;
+    double mean;
+};
+
+Difference compare(const Image& image, const Image& reference)
+{
+    Difference difference = { 0, 0 };
+    const unsigned int row_length = image.width * image.bytes_per_pixel;
+    for (unsigned int y = 0; y != image.height; ++y) {
+        for (unsigned int i = 0; i != row_length; ++i) {
+            const int error = std::abs( int(image.row(y)[i]) - int(reference.row(y)[i]) );
+            difference.max = std::max(difference.max, error);
+            difference.mean += error;
+        }
+    }
+    difference.mean /= double(row_length) * image.height;
+    return difference;
+}
+
+//! Returns average time of one call in milliseconds.
+template <typename Function>
+double measure(Function function)
+{
+    unsigned int runs = 0;
+    const clock_t start = clock();
+    clock_t elapsed;
+    do {
+        function();
+        ++runs;
+        elapsed = clock() - start;
+    } while (elapsed < CLOCKS_PER_SEC / 10 && runs < 1000);
+    return double(elapsed) * 1000 / CLOCKS_PER_SEC / runs;
+}
+
+#ifdef CHECK_WITH_FREEIMAGE
+//! Returns time of FreeImage_Rescale with bicubic filter and its max difference from reference.
+double measureFreeImage(const Image& source, const Image& reference, int* max_difference)
+{
+    FIBITMAP* bitmap = FreeImage_Allocate(source.width, source.height, source.bytes_per_pixel * 8);
+    const unsigned int row_length = source.width * source.bytes_per_pixel;
+    for (unsigned int y = 0; y != source.height; ++y) {
+        std::copy( source.row(y), source.row(y) + row_length, FreeImage_GetScanLine(bitmap, y) );
+    }
+
+    FIBITMAP* result = nullptr;
+    const double ms = measure([&] {
+        if (result) {
+            FreeImage_Unload(result);
+        }
+        result = FreeImage_Rescale(bitmap, reference.width, reference.height, FILTER_BICUBIC);
+    });
+
+    Image rescaled(reference.width, reference.height, reference.bytes_per_pixel);
+    for (unsigned int y = 0; y != reference.height; ++y) {
+        const BYTE* line = FreeImage_GetScanLine(result, y);
+        std::copy(line, line + reference.width * reference.bytes_per_pixel, rescaled.row(y));
+    }
+    *max_difference = compare(rescaled, reference).max;
+
+    FreeImage_Unload(result);
+    FreeImage_Unload(bitmap);
+    return ms;
+}
+#endif
+
+struct Size
+{
+    unsigned int width,
+                 height;
+};
+
+} // namespace
+
+int main()
+{
+    // sources are typical album covers, destinations are sizes requested by web clients.
+    const Size sources[] = { { 1000, 1000 }, { 1200, 1200 }, { 600, 600 }, { 1417, 1411 }, { 500, 333 } };
+    const Size destinations[] = { { 300, 300 }, { 150, 150 }, { 64, 64 }, { 75, 75 }, { 299, 199 }, { 1, 1 } };
+    const Pattern patterns[] = { GRADIENT, NOISE, CHECKERBOARD };
+    const unsigned int kMAX_ALLOWED_ERROR = 1;
+
+#ifdef CHECK_WITH_FREEIMAGE
+    FreeImage_Initialise();
+#endif
+
+    unsigned int checks_count = 0,
+                 failures_count = 0;
+    for (auto bytes_per_pixel : { 3u, 4u }) {
+        for (auto& source_size : sources) {
+            for (auto pattern : patterns) {
+                const Image source = makeImage(pattern, source_size.width, source_size.height, bytes_per_pixel);
+                for (auto& size : destinations) {
+                    if (size.width > source.width || size.height > source.height) {
+                        continue;
+                    }
+
+                    ++checks_count;
+                    const Image reference = downscaleReference(source, size.width, size.height);
+                    Image result(0, 0, bytes_per_pixel);
+                    try {
+                        result = downscale(source, size.width, size.height);
+                    } catch (std::exception& e) {
+                        printf("FAILED: %s\n", e.what());
+                        ++failures_count;
+                        continue;
+                    }
+                    const Difference difference = compare(result, reference);
+                    const bool failed = difference.max > int(kMAX_ALLOWED_ERROR);
+                    failures_count += failed ? 1 : 0;
+
+                    // timings of one pattern are enough, speed does not depend on content.
+                    if (pattern != NOISE && !failed) {
+                        continue;
+                    }
+                    const double ms = measure([&] { downscale(source, size.width, size.height); });
+                    printf("%s%ux%u -> %ux%u, %u bpp, %s: max error %d, mean error %.3f, %.3f ms(%.0f Mpixel/s)",
+                           failed ? "FAILED: " : "",
+                           source.width, source.height, size.width, size.height, bytes_per_pixel * 8, patternName(pattern),
+                           difference.max, difference.mean, ms, source.width * source.height / ms / 1000);
+#ifdef CHECK_WITH_FREEIMAGE
+                    int freeimage_max_difference = 0;
+                    const double freeimage_ms = measureFreeImage(source, reference, &freeimage_max_difference);
+                    printf(", FreeImage bicubic: %.3f ms, max difference from area average %d", freeimage_ms, freeimage_max_difference);
+#endif
+                    printf("\n");
+                }
+            }
+        }
+    }
+
+    // destination which is larger than source and unsupported pixel format must be rejected.
+    const Image small = makeImage(GRADIENT, 10, 10, 3);
+    const Image gray = makeImage(GRADIENT, 10, 10, 1);
+    const Size invalid_sizes[] = { { 11, 5 }, { 5, 11 }, { 0, 5 } };
+    for (auto& size : invalid_sizes) {
+        ++checks_count;
+        try {
+            downscale(small, size.width, size.height);
+            printf("FAILED: downscaling 10x10 to %ux%u is not rejected\n", size.width, size.height);
+            ++failures_count;
+        } catch (std::runtime_error&) {
+        }
+    }
+    ++checks_count;
+    try {
+        downscale(gray, 5, 5);
+        printf("FAILED: 8 bpp image is not rejected\n");
+        ++failures_count;
+    } catch (std::runtime_error&) {
+    }
+
+#ifdef CHECK_WITH_FREEIMAGE
+    FreeImage_DeInitialise();
+#endif
+
+    printf("%u of %u checks failed\n", failures_count, checks_count);
+    return failures_count == 0 ? 0 : 1;
+}
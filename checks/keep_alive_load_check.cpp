@@ -0,0 +1,371 @@
+// Copyright (c) 2014, Alexey Ivanov
+
+// Load check of HTTP/1.1 persistent connections: many sequential RPC calls are sent over new connection each
+// ("Connection: close") and over persistent connections, then batches of calls are pipelined in single write.
+// Server here models keep-alive loop of Http::Connection(see Connection::parse_buffer, start_next_request): the real
+// Http::request_parser is reset between requests and parses pipelined data left in buffer, connection is closed after
+// keep_alive_max_requests requests. Calls/s of each mode and count of TCP connections are reported.
+// Exit code is non zero if any reply is lost, reordered or connection is not reused.
+//
+// With arguments "host port" the same calls(RPC method Version) are sent to running plugin instead of model server,
+// nothing is checked in this case: keep-alive settings of plugin are unknown here.
+
+#include "stdafx.h"
+#include "http_server/request_parser.h"
+#include "http_server/request.h"
+#include <boost/algorithm/string/predicate.hpp>
+#include <boost/asio.hpp>
+#include <boost/bind.hpp>
+#include <boost/enable_shared_from_this.hpp>
+#include <boost/shared_ptr.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+using namespace Http;
+using boost::asio::ip::tcp;
+
+typedef std::chrono::steady_clock Clock;
+
+const unsigned int kMAX_REQUESTS = 100; // default keep_alive_max_requests of plugin.
+const unsigned int kCALLS_COUNT = 2000;
+const unsigned int kPIPELINE_DEPTH = 16;
+
+bool isKeepAliveRequested(const Request& req)
+{
+    const std::string* connection_value;
+    if ( get_header_value(req, HEADER_CONNECTION, connection_value) ) {
+        if ( boost::iequals(*connection_value, "close") ) {
+            return false;
+        }
+        if ( boost::iequals(*connection_value, "keep-alive") ) {
+            return true;
+        }
+    }
+    return req.http_version_major > 1 || (req.http_version_major == 1 && req.http_version_minor >= 1);
+}
+
+//! Keep-alive loop of Http::Connection without player thread, admission control and idle timer. Reply echoes request content.
+class ModelConnection : public boost::enable_shared_from_this<ModelConnection>
+{
+public:
+    explicit ModelConnection(boost::asio::io_service& io_service)
+        :
+        socket_(io_service),
+        buffer_(8 * 1024),
+        unparsed_data_begin_(nullptr),
+        unparsed_data_end_(nullptr),
+        requests_count_(0),
+        keep_alive_(false)
+    {}
+
+    tcp::socket& socket()
+        { return socket_; }
+
+    void start()
+        { read_some_to_buffer(); }
+
+private:
+
+    void read_some_to_buffer()
+    {
+        socket_.async_read_some( boost::asio::buffer(buffer_),
+                                 boost::bind(&ModelConnection::handle_read,
+                                             shared_from_this(),
+                                             boost::asio::placeholders::error,
+                                             boost::asio::placeholders::bytes_transferred
+                                             )
+                                );
+    }
+
+    void handle_read(const boost::system::error_code& e, std::size_t bytes_transferred)
+    {
+        if (!e) {
+            parse_buffer(&buffer_[0], &buffer_[0] + bytes_transferred);
+        }
+    }
+
+    void parse_buffer(char* begin, char* end)
+    {
+        boost::tribool result;
+        boost::tie(result, unparsed_data_begin_) = request_parser_.parse(request_, begin, end);
+        unparsed_data_end_ = end;
+
+        if (result) {
+            ++requests_count_;
+            keep_alive_ = requests_count_ < kMAX_REQUESTS && isKeepAliveRequested(request_);
+            write_reply(200, request_.content);
+        } else if (!result) {
+            keep_alive_ = false;
+            write_reply(400, "");
+        } else {
+            read_some_to_buffer();
+        }
+    }
+
+    void write_reply(int status, const std::string& content)
+    {
+        reply_ = "HTTP/1.1 " + std::to_string(status) + (status == 200 ? " OK" : " Bad Request") + "\r\n"
+                 + "Content-Type: application/json\r\n"
+                 + "Content-Length: " + std::to_string( content.size() ) + "\r\n"
+                 + "Connection: " + (keep_alive_ ? "keep-alive" : "close") + "\r\n"
+                 + "\r\n" + content;
+        boost::asio::async_write( socket_, boost::asio::buffer(reply_),
+                                  boost::bind(&ModelConnection::handle_write,
+                                              shared_from_this(),
+                                              boost::asio::placeholders::error
+                                              )
+                                 );
+    }
+
+    void handle_write(const boost::system::error_code& e)
+    {
+        if (e) {
+            return;
+        }
+        if (keep_alive_) {
+            start_next_request();
+        } else {
+            boost::system::error_code ignored_ec;
+            socket_.shutdown(tcp::socket::shutdown_both, ignored_ec);
+        }
+    }
+
+    void start_next_request()
+    {
+        request_parser_.reset();
+        if (unparsed_data_begin_ != unparsed_data_end_) {
+            // pipelined request was already read.
+            parse_buffer(unparsed_data_begin_, unparsed_data_end_);
+        } else {
+            read_some_to_buffer();
+        }
+    }
+
+    tcp::socket socket_;
+    std::vector<char> buffer_;
+    char* unparsed_data_begin_;
+    char* unparsed_data_end_;
+    request_parser request_parser_;
+    Request request_;
+    std::string reply_;
+    unsigned int requests_count_;
+    bool keep_alive_;
+};
+
+class ModelServer
+{
+public:
+    ModelServer()
+        :
+        acceptor_( io_service_, tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0) ),
+        connections_count_(0)
+    {
+        accept();
+        thread_ = std::thread([this] { io_service_.run(); });
+    }
+
+    ~ModelServer()
+    {
+        io_service_.stop();
+        thread_.join();
+    }
+
+    unsigned short port() const
+        { return acceptor_.local_endpoint().port(); }
+
+    //! Returns count of accepted connections and resets it.
+    unsigned int takeConnectionsCount()
+        { return connections_count_.exchange(0); }
+
+private:
+
+    void accept()
+    {
+        boost::shared_ptr<ModelConnection> connection( new ModelConnection(io_service_) );
+        acceptor_.async_accept( connection->socket(),
+                                [this, connection] (const boost::system::error_code& e) {
+                                    if (!e) {
+                                        ++connections_count_;
+                                        boost::system::error_code ignored_ec;
+                                        connection->socket().set_option(tcp::no_delay(true), ignored_ec); // as Http::Server does.
+                                        connection->start();
+                                    }
+                                    accept();
+                                }
+                               );
+    }
+
+    boost::asio::io_service io_service_;
+    tcp::acceptor acceptor_;
+    std::atomic<unsigned int> connections_count_;
+    std::thread thread_;
+};
+
+//! Blocking HTTP client which sends RPC calls and reads replies, reconnects when server closes connection.
+class Client
+{
+public:
+    Client(const tcp::endpoint& endpoint, bool keep_alive)
+        :
+        endpoint_(endpoint),
+        socket_(io_service_),
+        keep_alive_(keep_alive)
+    {}
+
+    //! Sends calls with ids [first_id, first_id + count) in one write, returns false if any reply is wrong.
+    //! Calls which are not answered before server closes connection are resent over new connection like browser does.
+    bool call(unsigned int first_id, unsigned int count)
+    {
+        if ( !socket_.is_open() ) {
+            socket_.connect(endpoint_);
+        }
+
+        std::string requests;
+        for (unsigned int id = first_id; id != first_id + count; ++id) {
+            const std::string content = "{\"jsonrpc\":\"2.0\",\"method\":\"Version\",\"params\":{},\"id\":" + std::to_string(id) + "}";
+            requests += std::string("POST /RPC_JSON HTTP/1.1\r\n")
+                        + "Host: 127.0.0.1\r\n"
+                        + "Content-Type: application/json\r\n"
+                        + "Content-Length: " + std::to_string( content.size() ) + "\r\n"
+                        + (keep_alive_ ? "" : "Connection: close\r\n")
+                        + "\r\n" + content;
+        }
+        boost::asio::write( socket_, boost::asio::buffer(requests) );
+
+        bool connection_closed = false;
+        unsigned int id = first_id;
+        for (; id != first_id + count && !connection_closed; ++id) {
+            std::string content;
+            if (   !readReply(&content, &connection_closed)
+                || content.find( "\"id\":" + std::to_string(id) ) == std::string::npos
+                )
+            {
+                return false;
+            }
+        }
+        if (connection_closed) {
+            boost::system::error_code ignored_ec;
+            socket_.close(ignored_ec);
+            response_.consume( response_.size() );
+        }
+        return id == first_id + count || call(id, first_id + count - id);
+    }
+
+private:
+
+    bool readReply(std::string* content, bool* connection_closed)
+    {
+        boost::system::error_code ec;
+        const std::size_t headers_size = boost::asio::read_until(socket_, response_, "\r\n\r\n", ec);
+        if (ec) {
+            *connection_closed = true;
+            return false;
+        }
+        std::string headers(headers_size, '\0');
+        response_.sgetn(&headers[0], headers_size);
+
+        const std::string kCONTENT_LENGTH = "Content-Length: ";
+        const std::size_t content_length_pos = headers.find(kCONTENT_LENGTH);
+        if ( !boost::starts_with(headers, "HTTP/1.1 200") || content_length_pos == std::string::npos ) {
+            *connection_closed = true;
+            return false;
+        }
+        const std::size_t content_length = std::strtoul(headers.c_str() + content_length_pos + kCONTENT_LENGTH.size(), nullptr, 10);
+        if (response_.size() < content_length) {
+            boost::asio::read(socket_, response_, boost::asio::transfer_exactly(content_length - response_.size()), ec);
+            if (ec) {
+                *connection_closed = true;
+                return false;
+            }
+        }
+        content->resize(content_length);
+        if (content_length != 0) {
+            response_.sgetn(&(*content)[0], content_length);
+        }
+        *connection_closed = headers.find("Connection: keep-alive") == std::string::npos;
+        return true;
+    }
+
+    boost::asio::io_service io_service_;
+    tcp::endpoint endpoint_;
+    tcp::socket socket_;
+    boost::asio::streambuf response_;
+    bool keep_alive_;
+};
+
+struct Mode
+{
+    const char* name;
+    bool keep_alive;
+    unsigned int pipeline_depth;
+    unsigned int expected_connections_count; // 0 if it is unknown.
+};
+
+//! Sends kCALLS_COUNT calls, prints calls/s. Returns false if any reply is wrong.
+bool runMode(const tcp::endpoint& endpoint, const Mode& mode, ModelServer* server)
+{
+    Client client(endpoint, mode.keep_alive);
+    bool ok = true;
+    const Clock::time_point start = Clock::now();
+    for (unsigned int id = 0; ok && id < kCALLS_COUNT; id += mode.pipeline_depth) {
+        try {
+            ok = client.call(id, mode.pipeline_depth);
+        } catch (std::exception& e) {
+            printf("%s: %s\n", mode.name, e.what());
+            ok = false;
+        }
+    }
+    const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    if (!server) {
+        printf("%s: %.0f calls/s\n", mode.name, kCALLS_COUNT / seconds);
+        return ok;
+    }
+
+    const unsigned int connections_count = server->takeConnectionsCount();
+    ok = ok && connections_count == mode.expected_connections_count;
+    printf("%s%s: %.0f calls/s, %u calls over %u connections\n",
+           ok ? "" : "FAILED: ", mode.name, kCALLS_COUNT / seconds, kCALLS_COUNT, connections_count);
+    return ok;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    const Mode modes[] = {
+        { "new connection per call", false, 1, kCALLS_COUNT },
+        { "persistent connection", true, 1, kCALLS_COUNT / kMAX_REQUESTS },
+        { "persistent connection, pipelined", true, kPIPELINE_DEPTH, kCALLS_COUNT / kMAX_REQUESTS } // batches are not aligned with kMAX_REQUESTS, so the rest of batch is resent.
+    };
+
+    if (argc == 3) {
+        boost::asio::io_service io_service;
+        tcp::resolver resolver(io_service);
+        const tcp::endpoint endpoint = *resolver.resolve( tcp::resolver::query(argv[1], argv[2]) );
+        for (auto& mode : modes) {
+            runMode(endpoint, mode, nullptr);
+        }
+        return 0;
+    }
+
+    ModelServer server;
+    const tcp::endpoint endpoint(boost::asio::ip::address_v4::loopback(), server.port());
+    unsigned int checks_count = 0,
+                 failures_count = 0;
+    for (auto& mode : modes) {
+        ++checks_count;
+        failures_count += runMode(endpoint, mode, &server) ? 0 : 1;
+    }
+
+    printf("%u of %u checks failed\n", failures_count, checks_count);
+    return failures_count == 0 ? 0 : 1;
+}
@@ -0,0 +1,270 @@
+// Copyright (c) 2014, Alexey Ivanov
+
+// Speed check of loading playlist entries into in-memory playlists DB.
+// 100k synthetic entries(fields of TAIMPFileInfo, strings are UTF-16 like in AIMP SDK) are loaded into :memory: DB
+// with schema of AIMPManager30 in two ways:
+//  - before: statement is prepared for each load, each row is inserted by autocommit step(loadEntries before statement cache);
+//  - after: statement is taken from Utilities::StatementCache, all rows are inserted in one Utilities::Transaction.
+// Both the first load and reload of whole playlist(all rows are replaced) are measured, rows/sec are reported.
+// Exit code is non zero if DB content is wrong after any load.
+
+#include "stdafx.h"
+#include "utils/sqlite_util.h"
+#include <boost/crc.hpp>
+#include <ctime>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+using namespace Utilities;
+
+const int kENTRIES_COUNT = 100000;
+const int kPLAYLIST_ID = 1;
+
+const char* const kINSERT_QUERY = "REPLACE INTO PlaylistsEntries VALUES (?,?,?,?,?,?,"
+                                                                       "?,?,?,?,?,"
+                                                                       "?,?,?,?,?)";
+
+//! Fields of AIMP3SDK::TAIMPFileInfo which are stored in DB.
+struct FileInfo
+{
+    std::u16string album,
+                   artist,
+                   date,
+                   filename,
+                   genre,
+                   title;
+    int bitrate,
+        channels,
+        duration;
+    sqlite3_int64 filesize;
+    int rating,
+        samplerate;
+};
+
+std::u16string toUTF16(const std::string& ascii)
+{
+    return std::u16string( ascii.begin(), ascii.end() );
+}
+
+std::vector<FileInfo> makeEntries()
+{
+    std::vector<FileInfo> entries(kENTRIES_COUNT);
+    char buffer[128];
+    for (int i = 0; i != kENTRIES_COUNT; ++i) {
+        FileInfo& info = entries[i];
+        sprintf(buffer, "Album %d", i / 12);
+        info.album = toUTF16(buffer);
+        sprintf(buffer, "Artist %d", i / 50);
+        info.artist = toUTF16(buffer);
+        sprintf(buffer, "%d", 1960 + i % 55);
+        info.date = toUTF16(buffer);
+        sprintf(buffer, "D:\\Music\\Artist %d\\Album %d\\%02d - Track title %d.mp3", i / 50, i / 12, i % 12 + 1, i);
+        info.filename = toUTF16(buffer);
+        info.genre = toUTF16(i % 3 ? "Rock" : "Jazz");
+        sprintf(buffer, "Track title %d", i);
+        info.title = toUTF16(buffer);
+        info.bitrate = 320;
+        info.channels = 2;
+        info.duration = 180000 + i % 120000;
+        info.filesize = 5000000 + i;
+        info.rating = i % 6;
+        info.samplerate = 44100;
+    }
+    return entries;
+}
+
+void check(int rc, const char* what) // throws std::runtime_error
+{
+    if (SQLITE_OK != rc && SQLITE_DONE != rc) {
+        throw std::runtime_error( MakeString() << what << " error " << rc );
+    }
+}
+
+void execute(sqlite3* db, const char* query) // throws std::runtime_error
+{
+    check(sqlite3_exec(db, query, nullptr, nullptr, nullptr), query);
+}
+
+//! Schema of AIMPManager30::initPlaylistDB(). Returns false if search index is requested but is not available.
+bool createSchema(sqlite3* db, bool with_search_index) // throws std::runtime_error
+{
+    execute(db, "CREATE TABLE PlaylistsEntries ( playlist_id    INTEGER,"
+                                                "entry_id       INTEGER,"
+                                                "entry_index    INTEGER,"
+                                                "album          VARCHAR(128),"
+                                                "artist         VARCHAR(128),"
+                                                "date           VARCHAR(16),"
+                                                "filename       VARCHAR(260),"
+                                                "genre          VARCHAR(32),"
+                                                "title          VARCHAR(260),"
+                                                "bitrate        INTEGER,"
+                                                "channels_count INTEGER,"
+                                                "duration       INTEGER,"
+                                                "filesize       BIGINT,"
+                                                "rating         TINYINT,"
+                                                "samplerate     INTEGER,"
+                                                "crc32          BIGINT,"
+                                                "PRIMARY KEY (entry_id)"
+                                                ")");
+    execute(db, "CREATE INDEX PlaylistsEntriesPlaylistIndex ON PlaylistsEntries (playlist_id, entry_index)");
+    if (!with_search_index) {
+        return true;
+    }
+
+    // the same as createEntriesSearchIndex() in manager_impl_common.h, it is optional there too.
+    try {
+        execute(db, "PRAGMA recursive_triggers = ON");
+        execute(db, "CREATE VIRTUAL TABLE PlaylistsEntriesSearchIndex USING fts4(title, artist, album, date, genre, tokenize=unicode61)");
+        execute(db, "CREATE TRIGGER PlaylistsEntriesSearchIndexInsert AFTER INSERT ON PlaylistsEntries BEGIN "
+                        "INSERT INTO PlaylistsEntriesSearchIndex(docid, title, artist, album, date, genre) VALUES (new.rowid, new.title, new.artist, new.album, new.date, new.genre); "
+                    "END");
+        execute(db, "CREATE TRIGGER PlaylistsEntriesSearchIndexDelete AFTER DELETE ON PlaylistsEntries BEGIN "
+                        "DELETE FROM PlaylistsEntriesSearchIndex WHERE docid=old.rowid; "
+                    "END");
+        return true;
+    } catch (std::runtime_error&) {
+        return false;
+    }
+}
+
+void bindText(sqlite3_stmt* stmt, int index, const std::u16string& text) // throws std::runtime_error
+{
+    check(sqlite3_bind_text16(stmt, index, text.data(), static_cast<int>( text.size() * sizeof(char16_t) ), SQLITE_STATIC), "sqlite3_bind_text16");
+}
+
+//! Binds and inserts entry like AIMPManager30::loadEntries() does.
+void insertEntry(sqlite3* db, sqlite3_stmt* stmt, const FileInfo& info, int entry_index) // throws std::runtime_error
+{
+    check(sqlite3_bind_int(stmt, 1, kPLAYLIST_ID), "sqlite3_bind_int");
+    check(sqlite3_bind_int(stmt, 2, entry_index + 1000), "sqlite3_bind_int");
+    check(sqlite3_bind_int(stmt, 3, entry_index), "sqlite3_bind_int");
+    bindText(stmt, 4, info.album);
+    bindText(stmt, 5, info.artist);
+    bindText(stmt, 6, info.date);
+    bindText(stmt, 7, info.filename);
+    bindText(stmt, 8, info.genre);
+    bindText(stmt, 9, info.title);
+    check(sqlite3_bind_int(stmt, 10, info.bitrate), "sqlite3_bind_int");
+    check(sqlite3_bind_int(stmt, 11, info.channels), "sqlite3_bind_int");
+    check(sqlite3_bind_int(stmt, 12, info.duration), "sqlite3_bind_int");
+    check(sqlite3_bind_int64(stmt, 13, info.filesize), "sqlite3_bind_int64");
+    check(sqlite3_bind_int(stmt, 14, info.rating), "sqlite3_bind_int");
+    check(sqlite3_bind_int(stmt, 15, info.samplerate), "sqlite3_bind_int");
+    check(sqlite3_bind_int64( stmt, 16, crc32( info.title.data(), static_cast<unsigned int>( info.title.size() * sizeof(char16_t) ) ) ), "sqlite3_bind_int64");
+
+    const int rc = sqlite3_step(stmt);
+    if (SQLITE_DONE != rc) {
+        throw std::runtime_error( MakeString() << "sqlite3_step() error " << rc << ": " << sqlite3_errmsg(db) );
+    }
+    sqlite3_reset(stmt);
+}
+
+void loadBefore(sqlite3* db, const std::vector<FileInfo>& entries) // throws std::runtime_error
+{
+    sqlite3_stmt* stmt = createStmt(db, kINSERT_QUERY);
+    ON_BLOCK_EXIT(&sqlite3_finalize, stmt);
+    for (size_t i = 0; i != entries.size(); ++i) {
+        insertEntry( db, stmt, entries[i], static_cast<int>(i) );
+    }
+}
+
+void loadAfter(sqlite3* db, StatementCache& statement_cache, const std::vector<FileInfo>& entries) // throws std::runtime_error
+{
+    Transaction transaction(db);
+    sqlite3_stmt* stmt = statement_cache.get(kINSERT_QUERY);
+    for (size_t i = 0; i != entries.size(); ++i) {
+        insertEntry( db, stmt, entries[i], static_cast<int>(i) );
+    }
+    transaction.commit();
+}
+
+//! Returns rows/sec of load.
+template <typename Load>
+double measure(Load load)
+{
+    const clock_t start = clock();
+    load();
+    const double seconds = double(clock() - start) / CLOCKS_PER_SEC;
+    return kENTRIES_COUNT / (seconds > 0 ? seconds : 1e-6);
+}
+
+bool contentIsValid(sqlite3* db)
+{
+    const bool entries_ok = getRowsCount(db, "SELECT entry_id FROM PlaylistsEntries") == kENTRIES_COUNT;
+    const bool title_ok = getRowsCount(db, "SELECT entry_id FROM PlaylistsEntries WHERE entry_index=99999 AND title='Track title 99999'") == 1;
+    return entries_ok && title_ok;
+}
+
+} // namespace
+
+//! utils/util.cpp depends on plugin logger, so crc32 is defined here the same way.
+crc32_t Utilities::crc32(const void* buffer, unsigned int length)
+{
+    boost::crc_32_type crc32_calculator;
+    crc32_calculator.process_bytes(buffer, length);
+    return crc32_calculator.checksum();
+}
+
+namespace
+{
+
+//! Loads entries twice in new DB, prints speed. Returns number of failed checks.
+unsigned int checkLoad(const std::vector<FileInfo>& entries, bool before, bool with_search_index, unsigned int* checks_count)
+{
+    const char* const mode_name = before ? "before(statement per load, autocommit)" : "after(statement cache, transaction)";
+    sqlite3* db = nullptr;
+    if ( sqlite3_open(":memory:", &db) != SQLITE_OK ) {
+        ++*checks_count;
+        printf("FAILED: sqlite3_open\n");
+        return 1;
+    }
+    ON_BLOCK_EXIT(&sqlite3_close, db);
+    StatementCache statement_cache;
+    statement_cache.attach(db);
+    ON_BLOCK_EXIT_OBJ(statement_cache, &StatementCache::clear); // all statements must be finalized before closing DB.
+
+    unsigned int failures_count = 0;
+    try {
+        if ( !createSchema(db, with_search_index) ) {
+            printf("%s: search index is not available in this sqlite build\n", mode_name);
+            return 0;
+        }
+
+        double speeds[2];
+        for (int i = 0; i != 2; ++i) { // the first load inserts rows, the second one replaces all of them.
+            speeds[i] = before ? measure([&] { loadBefore(db, entries); })
+                               : measure([&] { loadAfter(db, statement_cache, entries); });
+            ++*checks_count;
+            failures_count += contentIsValid(db) ? 0 : 1;
+        }
+        printf("%s%s, %s search index: load %.0f rows/s, reload %.0f rows/s\n",
+               failures_count == 0 ? "" : "FAILED: ", mode_name, with_search_index ? "with" : "without", speeds[0], speeds[1]);
+    } catch (std::exception& e) {
+        ++*checks_count;
+        ++failures_count;
+        printf("FAILED: %s: %s\n", mode_name, e.what());
+    }
+    return failures_count;
+}
+
+} // namespace
+
+int main()
+{
+    const std::vector<FileInfo> entries = makeEntries();
+    unsigned int checks_count = 0,
+                 failures_count = 0;
+
+    // full text search index triggers dominate in load time, so loads are measured without it too.
+    for (int with_search_index = 0; with_search_index != 2; ++with_search_index) {
+        failures_count += checkLoad(entries, true, with_search_index != 0, &checks_count);
+        failures_count += checkLoad(entries, false, with_search_index != 0, &checks_count);
+    }
+
+    printf("%u of %u checks failed\n", failures_count, checks_count);
+    return failures_count == 0 ? 0 : 1;
+}
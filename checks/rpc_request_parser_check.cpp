@@ -0,0 +1,400 @@
+// Copyright (c) 2014, Alexey Ivanov
+
+// Conformance, fuzz and throughput check of JsonRpc::RequestParser and XmlRpc::RequestParser.
+// Conformance: numbers must be typed exactly at int/uint limits, invalid JSON(numbers, strings, UTF-8, structure) must be rejected.
+// Fuzz: valid requests are mutated(byte replacement, insertion, removal, truncation) by deterministic generator,
+// parsers must not crash and must not throw anything except Rpc::Exception(XML-RPC parser reports type errors by it).
+// Throughput: typical requests of web client and large GetPlaylistEntries requests are parsed repeatedly.
+// Exit code is non zero if any check fails.
+
+#include "jsonrpc/request_parser.h"
+#include "xmlrpc/request_parser.h"
+#include "rpc/value.h"
+#include "rpc/exception.h"
+#include <boost/cstdint.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <ctime>
+#include <exception>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+using Rpc::Value;
+
+//! Linear congruential generator: mutations are the same on each run and platform.
+class Random
+{
+public:
+    explicit Random(boost::uint32_t seed) : state_(seed) {}
+
+    boost::uint32_t next()
+        { state_ = state_ * 1103515245u + 12345u; return state_ >> 8; }
+
+    boost::uint32_t next(boost::uint32_t bound)
+        { return next() % bound; }
+
+private:
+    boost::uint32_t state_;
+};
+
+struct Counters
+{
+    unsigned int checks,
+                 failures;
+};
+
+void report(Counters* counters, bool ok, const std::string& description)
+{
+    ++counters->checks;
+    if (!ok) {
+        ++counters->failures;
+        printf("FAILED: %s\n", description.c_str());
+    }
+}
+
+std::string jsonCall(const std::string& param)
+{
+    return "{\"jsonrpc\":\"2.0\",\"method\":\"GetPlaylistEntries\",\"params\":[" + param + "],\"id\":1}";
+}
+
+//! Returns false if request is rejected.
+bool parseJson(const std::string& request, Value* root)
+{
+    JsonRpc::RequestParser parser;
+    return parser.parse("", request, root);
+}
+
+struct NumberCase
+{
+    const char* text;
+    Value::TYPE type; // TYPE_NONE means number must be rejected.
+    double value;
+};
+
+void checkJsonNumbers(Counters* counters)
+{
+    const NumberCase cases[] = {
+        { "0",           Value::TYPE_INT,    0 },
+        { "-0",          Value::TYPE_INT,    0 },
+        { "2147483647",  Value::TYPE_INT,    2147483647.0 },
+        { "2147483648",  Value::TYPE_UINT,   2147483648.0 },
+        { "4294967290",  Value::TYPE_UINT,   4294967290.0 },
+        { "4294967295",  Value::TYPE_UINT,   4294967295.0 },
+        { "4294967296",  Value::TYPE_DOUBLE, 4294967296.0 },
+        { "42949672950", Value::TYPE_DOUBLE, 42949672950.0 },
+        { "-2147483640", Value::TYPE_INT,    -2147483640.0 },
+        { "-2147483647", Value::TYPE_INT,    -2147483647.0 },
+        { "-2147483648", Value::TYPE_INT,    -2147483648.0 },
+        { "-2147483649", Value::TYPE_DOUBLE, -2147483649.0 },
+        { "0.5",         Value::TYPE_DOUBLE, 0.5 },
+        { "-1.5e+3",     Value::TYPE_DOUBLE, -1500 },
+        { "1E-2",        Value::TYPE_DOUBLE, 0.01 },
+        { "10e2",        Value::TYPE_DOUBLE, 1000 },
+        { "+1",          Value::TYPE_NONE,   0 },
+        { "0123",        Value::TYPE_NONE,   0 },
+        { "-01",         Value::TYPE_NONE,   0 },
+        { "00",          Value::TYPE_NONE,   0 },
+        { "1.",          Value::TYPE_NONE,   0 },
+        { ".5",          Value::TYPE_NONE,   0 },
+        { "1.e5",        Value::TYPE_NONE,   0 },
+        { "1e",          Value::TYPE_NONE,   0 },
+        { "1e+",         Value::TYPE_NONE,   0 },
+        { "-",           Value::TYPE_NONE,   0 },
+        { "--1",         Value::TYPE_NONE,   0 },
+        { "1-2",         Value::TYPE_NONE,   0 },
+        { "1.5.5",       Value::TYPE_NONE,   0 },
+        { "0x10",        Value::TYPE_NONE,   0 },
+        { "1 2",         Value::TYPE_NONE,   0 }
+    };
+
+    for (auto& number : cases) {
+        Value root;
+        const bool parsed = parseJson(jsonCall(number.text), &root);
+        bool ok;
+        if (number.type == Value::TYPE_NONE) {
+            ok = !parsed;
+        } else {
+            ok = parsed && root["params"][0].type() == number.type;
+            if (ok) {
+                const Value& param = root["params"][0];
+                const double value = number.type == Value::TYPE_INT  ? static_cast<int>(param)
+                                   : number.type == Value::TYPE_UINT ? static_cast<unsigned int>(param)
+                                                                     : static_cast<double>(param);
+                ok = std::fabs(value - number.value) <= std::fabs(number.value) * 1e-12;
+            }
+        }
+        report(counters, ok, std::string("JSON number ") + number.text);
+    }
+}
+
+void checkJsonDocuments(Counters* counters)
+{
+    const struct { const char* text; bool valid; } cases[] = {
+        { "{\"method\":\"Play\",\"params\":{},\"id\":null}",                true },
+        { "[{\"method\":\"Play\"},{\"method\":\"Stop\"}]",                 true },
+        { " \t\r\n{ \"method\" : \"Play\" , \"params\" : [ true , false , null ] } \n", true },
+        { "{\"method\":\"\\u00e9\\ud83d\\ude00\\\"\\\\\\/\\b\\f\\n\\r\\t\"}", true },
+        { "{\"method\":\"\xC3\xA9\xE2\x82\xAC\xF0\x9F\x98\x80\"}",          true },
+        { "[]",                                                         false }, // empty batch.
+        { "",                                                           false },
+        { "{\"method\":\"Play\",}",                                     false }, // trailing comma.
+        { "[1,]",                                                       false },
+        { "{\"method\":\"Play\"} x",                                    false }, // trailing garbage.
+        { "{\"method\":\"Play\"",                                       false },
+        { "{method:\"Play\"}",                                          false },
+        { "{\"method\":'Play'}",                                        false },
+        { "{\"method\":\"Play\"} // comment",                           false },
+        { "{\"method\":tru}",                                           false },
+        { "{\"method\":\"a\tb\"}",                                      false }, // unescaped control char.
+        { "{\"method\":\"\\x41\"}",                                     false },
+        { "{\"method\":\"\\ud83d\"}",                                   false }, // unpaired high surrogate.
+        { "{\"method\":\"\\ude00\"}",                                   false }, // unpaired low surrogate.
+        { "{\"method\":\"\\u12\"}",                                     false },
+        { "{\"method\":\"\xC0\xAF\"}",                                  false }, // overlong sequence.
+        { "{\"method\":\"\xED\xA0\x80\"}",                              false }, // encoded surrogate.
+        { "{\"method\":\"\xF4\x90\x80\x80\"}",                          false }, // code point above U+10FFFF.
+        { "{\"method\":\"\xE2\x82\"}",                                  false }, // truncated sequence.
+        { "{\"method\":\"\x80\"}",                                      false }  // continuation byte without lead.
+    };
+    for (auto& document : cases) {
+        Value root;
+        report(counters, parseJson(document.text, &root) == document.valid, std::string("JSON document ") + document.text);
+    }
+
+    { // strings are decoded to UTF-8.
+        Value root;
+        const bool ok = parseJson("{\"method\":\"\\u00e9\\ud83d\\ude00\"}", &root)
+                        && static_cast<const std::string&>(root["method"]) == "\xC3\xA9\xF0\x9F\x98\x80";
+        report(counters, ok, "JSON \\u escapes decoding");
+    }
+
+    { // duplicated members: the last wins like in Json::Reader.
+        Value root;
+        const bool ok = parseJson("{\"method\":[1,2],\"method\":\"Play\"}", &root)
+                        && root["method"].type() == Value::TYPE_STRING;
+        report(counters, ok, "JSON duplicated members");
+    }
+
+    { // nesting is limited, deep document must be rejected without stack overflow.
+        const std::string deep = std::string(100000, '[') + std::string(100000, ']');
+        Value root;
+        report(counters, !parseJson(deep, &root), "JSON deeply nested arrays");
+        const std::string allowed = "{\"params\":" + std::string(60, '[') + std::string(60, ']') + "}";
+        report(counters, parseJson(allowed, &root), "JSON arrays nested 61 levels deep");
+    }
+
+    { // oversized payload is rejected before parsing.
+        Value root;
+        report(counters, !parseJson( jsonCall( "\"" + std::string(1024 * 1024, 'a') + "\"" ), &root ), "JSON oversized request");
+    }
+}
+
+//! Returns false if request is rejected. Rpc::Exception is rejection too.
+bool parseXml(const std::string& request, Value* root)
+{
+    XmlRpc::RequestParser parser;
+    try {
+        return parser.parse("", request, root);
+    } catch (Rpc::Exception&) {
+        return false;
+    }
+}
+
+std::string xmlCall(const std::string& params)
+{
+    return "<?xml version=\"1.0\"?><methodCall><methodName>GetPlaylistEntries</methodName><params>" + params + "</params></methodCall>";
+}
+
+size_t depth(const Value& value)
+{
+    size_t max_child_depth = 0;
+    if (value.type() == Value::TYPE_ARRAY) {
+        for (size_t i = 0; i != value.size(); ++i) {
+            max_child_depth = std::max( max_child_depth, depth( value[static_cast<int>(i)] ) );
+        }
+    }
+    return 1 + max_child_depth;
+}
+
+void checkXmlDocuments(Counters* counters)
+{
+    Value root;
+    bool ok = parseXml(xmlCall("<param><value><int>-5</int></value></param>"
+                               "<param><value><i4>7</i4></value></param>"
+                               "<param><value><boolean>1</boolean></value></param>"
+                               "<param><value><double>0.25</double></value></param>"
+                               "<param><value><string>a&lt;b&amp;c</string></value></param>"
+                               "<param><value>untyped</value></param>"
+                               "<param><value><nil/></value></param>"
+                               "<param><value><array><data><value><int>1</int></value><value><int>2</int></value></data></array></value></param>"
+                               "<param><value><struct><member><name>x</name><value><int>1</int></value></member>"
+                                                     "<member><name>x</name><value><int>2</int></value></member></struct></value></param>"),
+                       &root);
+    if (ok) {
+        const Value& params = root["params"];
+        ok =    static_cast<const std::string&>(root["method"]) == "GetPlaylistEntries"
+             && params.size() == 9
+             && static_cast<int>(params[0]) == -5
+             && static_cast<int>(params[1]) == 7
+             && static_cast<bool>(params[2])
+             && static_cast<double>(params[3]) == 0.25
+             && static_cast<const std::string&>(params[4]) == "a<b&c"
+             && static_cast<const std::string&>(params[5]) == "untyped"
+             && params[6].type() == Value::TYPE_NULL
+             && params[7].size() == 2 && static_cast<int>(params[7][1]) == 2
+             && static_cast<int>(params[8]["x"]) == 1; // first of duplicated members wins.
+    }
+    report(counters, ok, "XML-RPC values");
+
+    report(counters, !parseXml("<methodCall><methodName>Play</methodName><params>", &root), "XML-RPC unterminated params");
+    report(counters, !parseXml("<methodCall><params></params></methodCall>", &root), "XML-RPC without method name");
+
+    std::string deep;
+    for (int i = 0; i != 100; ++i) {
+        deep += "<value><array><data>";
+    }
+    // values nested deeper than limit are not parsed, so tree is cut.
+    report(counters, !parseXml(xmlCall("<param>" + deep + "</param>"), &root) || depth(root["params"][0]) <= 65, "XML-RPC deeply nested arrays");
+    report(counters, !parseXml( xmlCall( "<param><value>" + std::string(1024 * 1024, 'a') + "</value></param>" ), &root ), "XML-RPC oversized request");
+}
+
+//! Parses random mutations of sample requests. Returns false if parser crashed by unexpected exception.
+template <typename Parse>
+void fuzz(const char* name, const std::vector<std::string>& samples, Parse parse, unsigned int iterations, Random& random, Counters* counters)
+{
+    unsigned int accepted = 0;
+    const char interesting[] = "{}[]<>/\":,\\0123456789-+.eE \t\"&;u";
+    for (unsigned int i = 0; i != iterations; ++i) {
+        std::string request = samples[random.next( static_cast<boost::uint32_t>( samples.size() ) )];
+        const unsigned int mutations_count = 1 + random.next(4);
+        for (unsigned int m = 0; m != mutations_count && !request.empty(); ++m) {
+            const size_t pos = random.next( static_cast<boost::uint32_t>( request.size() ) );
+            const char c = random.next(2) == 0 ? static_cast<char>( random.next(256) )
+                                               : interesting[random.next(sizeof(interesting) - 1)];
+            switch (random.next(4)) {
+            case 0:
+                request[pos] = c;
+                break;
+            case 1:
+                request.insert(pos, 1, c);
+                break;
+            case 2:
+                request.erase(pos, 1 + random.next(8));
+                break;
+            default:
+                request.resize(pos);
+                break;
+            }
+        }
+
+        try {
+            Value root;
+            accepted += parse(request, &root) ? 1 : 0;
+        } catch (std::exception& e) {
+            report(counters, false, std::string(name) + " fuzz: exception " + e.what() + " on request " + request);
+            return;
+        } catch (...) {
+            report(counters, false, std::string(name) + " fuzz: unknown exception on request " + request);
+            return;
+        }
+    }
+    report(counters, true, "");
+    printf("%s fuzz: %u mutated requests, %u accepted\n", name, iterations, accepted);
+}
+
+//! Prints parsing speed of request.
+template <typename Parse>
+void measure(const char* name, const std::string& request, Parse parse, Counters* counters)
+{
+    unsigned int runs = 0;
+    bool ok = true;
+    const clock_t start = clock();
+    clock_t elapsed;
+    do {
+        Value root;
+        ok = parse(request, &root) && ok;
+        ++runs;
+        elapsed = clock() - start;
+    } while (elapsed < CLOCKS_PER_SEC / 5);
+    const double seconds = double(elapsed) / CLOCKS_PER_SEC;
+    report(counters, ok, std::string(name) + " is not parsed");
+    printf("%s(%u bytes): %.0f requests/s, %.1f Mb/s\n", name, static_cast<unsigned int>( request.size() ),
+           runs / seconds, request.size() * runs / seconds / (1024 * 1024));
+}
+
+std::string makeLargeJsonRequest()
+{
+    // GetPlaylistEntries with all fields, ordering and search: parameters are object with arrays of strings.
+    std::string fields;
+    for (int i = 0; fields.size() < 200 * 1024; ++i) {
+        char field[64];
+        sprintf(field, "%s\"field number %d with \\u00e9 escape\"", i == 0 ? "" : ",", i);
+        fields += field;
+    }
+    return jsonCall("{\"playlist_id\":-12345,\"fields\":[" + fields + "],\"order_fields\":[{\"field\":\"title\",\"dir\":\"asc\"}],"
+                    "\"start_index\":0,\"entries_count\":4294967295,\"search_string\":\"\xD0\xBF\xD1\x80\xD0\xB8\"}");
+}
+
+std::string makeLargeXmlRequest()
+{
+    std::string fields;
+    for (int i = 0; fields.size() < 200 * 1024; ++i) {
+        char field[128];
+        sprintf(field, "<value><string>field number %d with &amp; escape</string></value>", i);
+        fields += field;
+    }
+    return xmlCall("<param><value><struct><member><name>playlist_id</name><value><int>-12345</int></value></member>"
+                   "<member><name>fields</name><value><array><data>" + fields + "</data></array></value></member>"
+                   "<member><name>start_index</name><value><int>0</int></value></member></struct></value></param>");
+}
+
+} // namespace
+
+int main()
+{
+    Counters counters = { 0, 0 };
+
+    checkJsonNumbers(&counters);
+    checkJsonDocuments(&counters);
+    checkXmlDocuments(&counters);
+
+    const std::string json_status = "{\"jsonrpc\":\"2.0\",\"method\":\"GetPlayerControlPanelState\",\"params\":{},\"id\":17}";
+    const std::string json_entries = jsonCall("{\"playlist_id\":123,\"fields\":[\"id\",\"title\",\"artist\",\"album\",\"duration\"],"
+                                              "\"order_fields\":[{\"field\":\"artist\",\"dir\":\"desc\"}],\"start_index\":-1e2,"
+                                              "\"entries_count\":50,\"search_string\":\"a \\\"b\\\" \\u0441\"}");
+    const std::string json_batch = "[" + json_status + "," + json_entries + ",{\"method\":\"SetVolume\",\"params\":{\"level\":4294967295},\"id\":null}]";
+    const std::string xml_status = "<?xml version=\"1.0\"?><methodCall><methodName>GetPlayerControlPanelState</methodName><params></params></methodCall>";
+    const std::string xml_entries = xmlCall("<param><value><struct><member><name>playlist_id</name><value><i4>123</i4></value></member>"
+                                            "<member><name>fields</name><value><array><data><value>id</value><value><string>title</string></value></data></array></value></member>"
+                                            "<member><name>start_index</name><value><double>-1e2</double></value></member>"
+                                            "<member><name>search_string</name><value>&lt;a&gt; &quot;b&quot;</value></member>"
+                                            "<member><name>reverse</name><value><boolean>0</boolean></value></member>"
+                                            "<member><name>none</name><value><nil/></value></member></struct></value></param>");
+
+    Random random(2014);
+    std::vector<std::string> json_samples;
+    json_samples.push_back(json_status);
+    json_samples.push_back(json_entries);
+    json_samples.push_back(json_batch);
+    fuzz("JSON-RPC", json_samples, parseJson, 200000, random, &counters);
+
+    std::vector<std::string> xml_samples;
+    xml_samples.push_back(xml_status);
+    xml_samples.push_back(xml_entries);
+    fuzz("XML-RPC", xml_samples, parseXml, 200000, random, &counters);
+
+    measure("JSON-RPC status request", json_status, parseJson, &counters);
+    measure("JSON-RPC entries request", json_entries, parseJson, &counters);
+    measure("JSON-RPC batch request", json_batch, parseJson, &counters);
+    measure("JSON-RPC large request", makeLargeJsonRequest(), parseJson, &counters);
+    measure("XML-RPC status request", xml_status, parseXml, &counters);
+    measure("XML-RPC entries request", xml_entries, parseXml, &counters);
+    measure("XML-RPC large request", makeLargeXmlRequest(), parseXml, &counters);
+
+    printf("%u of %u checks failed\n", counters.failures, counters.checks);
+    return counters.failures == 0 ? 0 : 1;
+}
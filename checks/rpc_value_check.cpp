@@ -0,0 +1,213 @@
+// Copyright (c) 2014, Alexey Ivanov
+
+// Speed and allocations check of Rpc::Value on the largest RPC response: 10k entries of GetPlaylistEntries.
+// Response is built like GetPlaylistEntries::fillEntries() does, copied, moved and serialized by JSON-RPC and XML-RPC serializers.
+// Allocations are counted by replaced global operator new. JSON response is parsed back by JsonRpc::RequestParser
+// and compared with original value. Exit code is non zero if any check fails.
+
+#include "rpc/value.h"
+#include "rpc/exception.h"
+#include "jsonrpc/request_parser.h"
+#include "jsonrpc/response_serializer.h"
+#include "xmlrpc/response_serializer.h"
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <new>
+#include <string>
+
+namespace
+{
+unsigned long long allocations_count = 0;
+}
+
+void* operator new(std::size_t size)
+{
+    ++allocations_count;
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+namespace
+{
+
+using Rpc::Value;
+
+const int kENTRIES_COUNT = 10000;
+
+struct Counters
+{
+    unsigned int checks,
+                 failures;
+};
+
+void report(Counters* counters, bool ok, const char* description)
+{
+    ++counters->checks;
+    if (!ok) {
+        ++counters->failures;
+        printf("FAILED: %s\n", description);
+    }
+}
+
+//! Entry with fields id, title, artist, album, duration, filesize, rating as web client requests them.
+void fillEntry(int index, Value* entry)
+{
+    char title[64];
+    sprintf(title, "Track title number %d", index);
+    char artist[32];
+    sprintf(artist, "Artist %d", index % 97);
+    entry->setSize(7);
+    (*entry)[0] = index;
+    (*entry)[1] = title;
+    (*entry)[2] = artist;
+    (*entry)[3] = index % 3 == 0 ? "Album with name longer than small string buffer" : "Album";
+    (*entry)[4] = 180000 + index;
+    (*entry)[5] = 3000000u + static_cast<unsigned int>(index);
+    (*entry)[6] = index % 6;
+}
+
+void buildResponse(Value* root)
+{
+    (*root)["id"] = 1;
+    Value& result = (*root)["result"];
+    result["count_of_found_entries"] = kENTRIES_COUNT;
+    result["total_entries_count"] = kENTRIES_COUNT;
+    Value& entries = result["entries"];
+    entries.setSize(0);
+    entries.setSize(kENTRIES_COUNT);
+    for (int i = 0; i != kENTRIES_COUNT; ++i) {
+        fillEntry(i, &entries[i]);
+    }
+}
+
+bool isInteger(const Value& value)
+    { return value.type() == Value::TYPE_INT || value.type() == Value::TYPE_UINT; }
+
+long long toInteger(const Value& value)
+    { return value.type() == Value::TYPE_INT ? static_cast<int>(value) : static_cast<long long>( static_cast<unsigned int>(value) ); }
+
+//! Integers are compared by value: JSON does not keep signedness, so uint can be read back as int.
+bool equal(const Value& lhs, const Value& rhs)
+{
+    if ( isInteger(lhs) && isInteger(rhs) ) {
+        return toInteger(lhs) == toInteger(rhs);
+    }
+    if ( lhs.type() != rhs.type() ) {
+        return false;
+    }
+    switch ( lhs.type() ) {
+    case Value::TYPE_BOOL:
+        return static_cast<bool>(lhs) == static_cast<bool>(rhs);
+    case Value::TYPE_DOUBLE:
+        return static_cast<double>(lhs) == static_cast<double>(rhs);
+    case Value::TYPE_STRING:
+        return static_cast<const std::string&>(lhs) == static_cast<const std::string&>(rhs);
+    case Value::TYPE_ARRAY:
+        if ( lhs.size() != rhs.size() ) {
+            return false;
+        }
+        for (size_t i = 0; i != lhs.size(); ++i) {
+            if ( !equal( lhs[static_cast<int>(i)], rhs[static_cast<int>(i)] ) ) {
+                return false;
+            }
+        }
+        return true;
+    case Value::TYPE_OBJECT:
+        {
+        auto rhs_it = rhs.getObjectMembersBegin();
+        for (auto it = lhs.getObjectMembersBegin(), end = lhs.getObjectMembersEnd(); it != end; ++it, ++rhs_it) {
+            if ( rhs_it == rhs.getObjectMembersEnd() || it->first != rhs_it->first || !equal(it->second, rhs_it->second) ) {
+                return false;
+            }
+        }
+        return rhs_it == rhs.getObjectMembersEnd();
+        }
+    default:
+        return true;
+    }
+}
+
+struct Measurement
+{
+    double ms;
+    double allocations;
+};
+
+//! Returns average time and allocations count of one call.
+template <typename Function>
+Measurement measure(Function function)
+{
+    unsigned int runs = 0;
+    const unsigned long long start_allocations = allocations_count;
+    const clock_t start = clock();
+    clock_t elapsed;
+    do {
+        function();
+        ++runs;
+        elapsed = clock() - start;
+    } while (elapsed < CLOCKS_PER_SEC / 5);
+    const Measurement measurement = { double(elapsed) * 1000 / CLOCKS_PER_SEC / runs,
+                                      double(allocations_count - start_allocations) / runs };
+    return measurement;
+}
+
+void print(const char* name, const Measurement& measurement)
+{
+    printf("%s: %.3f ms, %.0f allocations(%.2f per entry)\n", name, measurement.ms, measurement.allocations, measurement.allocations / kENTRIES_COUNT);
+}
+
+} // namespace
+
+int main()
+{
+    Counters counters = { 0, 0 };
+
+    Value response;
+    buildResponse(&response);
+
+    print("build response", measure([] { Value root; buildResponse(&root); }) );
+
+    print("copy response", measure([&response] { Value copy(response); }) );
+
+    {
+        Value copy(response);
+        const unsigned long long start_allocations = allocations_count;
+        Value moved( std::move(copy) );
+        copy = std::move(moved);
+        report(&counters, allocations_count == start_allocations, "move of response allocates memory");
+        report(&counters, equal(copy, response), "moved response differs from original");
+    }
+
+    const JsonRpc::ResponseSerializer json_serializer;
+    std::string json;
+    json_serializer.serializeSuccess(response, &json);
+    print("serialize to JSON", measure([&] { std::string out; json_serializer.serializeSuccess(response, &out); }) );
+
+    const XmlRpc::ResponseSerializer xml_serializer;
+    std::string xml;
+    xml_serializer.serializeSuccess(response, &xml);
+    print("serialize to XML", measure([&] { std::string out; xml_serializer.serializeSuccess(response, &out); }) );
+    printf("JSON size %u bytes, XML size %u bytes\n", static_cast<unsigned int>( json.size() ), static_cast<unsigned int>( xml.size() ) );
+
+    { // JSON-RPC response contains "jsonrpc" member in addition to id and result.
+        Value parsed;
+        JsonRpc::RequestParser parser;
+        const bool ok =    parser.parse("", json, &parsed)
+                        && equal(parsed["id"], response["id"])
+                        && equal(parsed["result"], response["result"]);
+        report(&counters, ok, "JSON response parsed back differs from original");
+    }
+
+    report(&counters, xml.find("<value><i4>3009999</i4></value>") != std::string::npos, "XML response does not contain last entry");
+
+    printf("%u of %u checks failed\n", counters.failures, counters.checks);
+    return counters.failures == 0 ? 0 : 1;
+}
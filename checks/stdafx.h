@@ -0,0 +1,26 @@
+// Stand-in of src/stdafx.h for standalone checks: checked sources include precompiled header,
+// they need only a few headers from it and MSVC secure CRT functions, which are mapped to standard ones on other compilers.
+
+#pragma once
+
+#include <boost/filesystem/path.hpp> // declarations of utils/util.h.
+#include <boost/foreach.hpp>
+
+#ifdef _MSC_VER
+#   include <tchar.h>
+#else
+#   include <cstddef>
+#   include <cstdio>
+
+template <std::size_t size, typename... Args>
+int sprintf_s(char (&buffer)[size], const char* format, Args... args)
+    { return snprintf(buffer, size, format, args...); }
+
+template <typename... Args>
+int sprintf_s(char* buffer, std::size_t size, const char* format, Args... args)
+    { return snprintf(buffer, size, format, args...); }
+
+#   define sscanf_s sscanf
+
+typedef wchar_t TCHAR;
+#endif
@@ -99,6 +99,13 @@ function AimpManager() {
         };
     }
     initLocalizedErrorMessages();
+
+    // WebSocket carries RPC calls and subscription responses while it is open, POST requests are used otherwise.
+    this.websocket = null;
+    this.websocket_calls = {}; // calls sent over websocket, by request id.
+    this.websocket_queue = []; // calls made while websocket is connecting.
+    this.websocket_request_id = 0;
+    this.openWebSocket();
 }
 
 AimpManager.prototype = {
@@ -145,13 +152,111 @@ onRpcException : function (on_exception_client) {
     };
 },
 
-callRpc : function(method, params, callbacks) {
-    method({ params : params,
-             onSuccess : callbacks.on_success,
-             onException : this.onRpcException(callbacks.on_exception),
-             onComplete : callbacks.on_complete
-           }
-    );
+callRpc : function(method_name, params, callbacks) {
+    var call = { params : params,
+                 onSuccess : callbacks.on_success,
+                 onException : this.onRpcException(callbacks.on_exception),
+                 onComplete : callbacks.on_complete
+               };
+
+    if (this.websocket === null) {
+        this.aimp_service[method_name](call);
+    } else if (this.websocket.readyState == WebSocket.OPEN) {
+        this.sendOverWebSocket(method_name, call);
+    } else {
+        this.websocket_queue.push({ method_name : method_name, call : call });
+    }
+},
+
+/*
+    Opens WebSocket connection to plugin.
+    If connection can not be opened calls are sent by POST requests, if opened connection is lost it is reopened after delay.
+*/
+openWebSocket : function() {
+    if (window.WebSocket === undefined || window.JSON === undefined) {
+        return; // old browser, use POST requests.
+    }
+
+    var manager = this;
+    var websocket;
+    try {
+        websocket = new WebSocket( (window.location.protocol == 'https:' ? 'wss://' : 'ws://') + window.location.host + '/websocket' );
+    } catch (e) {
+        return;
+    }
+    var was_opened = false;
+    this.websocket = websocket;
+
+    websocket.onopen = function() {
+        was_opened = true;
+        var queue = manager.websocket_queue;
+        manager.websocket_queue = [];
+        for (var i = 0; i < queue.length; ++i) {
+            manager.sendOverWebSocket(queue[i].method_name, queue[i].call);
+        }
+    };
+
+    websocket.onmessage = function(event) {
+        manager.onWebSocketResponse( JSON.parse(event.data) );
+    };
+
+    websocket.onclose = function() {
+        manager.websocket = null;
+
+        // calls which were not sent yet go by POST requests.
+        var queue = manager.websocket_queue;
+        manager.websocket_queue = [];
+        for (var i = 0; i < queue.length; ++i) {
+            manager.aimp_service[queue[i].method_name](queue[i].call);
+        }
+
+        // responses of sent calls are lost, subscribers resubscribe in their on_complete handlers.
+        var calls = manager.websocket_calls;
+        manager.websocket_calls = {};
+        for (var id in calls) {
+            if ( calls.hasOwnProperty(id) ) {
+                manager.onWebSocketResponse({ id : id, error : { code : 0, message : 'WebSocket connection is closed' } }, calls[id]);
+            }
+        }
+
+        if (was_opened) {
+            setTimeout(function() { manager.openWebSocket(); }, 5000);
+        }
+    };
+},
+
+sendOverWebSocket : function(method_name, call) {
+    var id = ++this.websocket_request_id;
+    this.websocket_calls[id] = call;
+    this.websocket.send( JSON.stringify({ jsonrpc : '2.0', method : method_name, params : call.params, id : id }) );
+},
+
+/*
+    Calls handlers of call like RPC client does for POST responses.
+        Param call - optional, call is found by response id if it is not specified.
+*/
+onWebSocketResponse : function(response, call) {
+    if (call === undefined) {
+        call = this.websocket_calls[response.id];
+        if (call === undefined) {
+            return;
+        }
+        delete this.websocket_calls[response.id];
+    }
+
+    if (response.error !== undefined) {
+        var error = new Error(response.error.message);
+        error.code = response.error.code;
+        if (call.onException) {
+            call.onException(error);
+        }
+    } else if (call.onSuccess) {
+        call.onSuccess(response.result);
+    }
+
+    if (call.onComplete) {
+        call.onComplete(response);
+    }
 },
 
 /*
@@ -163,7 +268,7 @@ callRpc : function(method, params, callbacks) {
     Result is array of objects with members specified by params.fields param.
 */
 getPlaylists : function(params, callbacks) {
-    this.callRpc(this.aimp_service.GetPlaylists, params, callbacks);
+    this.callRpc('GetPlaylists', params, callbacks);
 },
 
 /*
@@ -191,7 +296,7 @@ getPlaylists : function(params, callbacks) {
             which match params.search_string. See params.search_string param description for details.
 */
 getPlaylistEntries : function(params, callbacks) {
-    this.callRpc(this.aimp_service.GetPlaylistEntries, params, callbacks);
+    this.callRpc('GetPlaylistEntries', params, callbacks);
 },
 
 /*
@@ -203,7 +308,7 @@ getPlaylistEntries : function(params, callbacks) {
         track_index_on_page - if track is not found this value is -1.
 */
 getEntryPositionInDatatable : function(params, callbacks) {
-    this.callRpc(this.aimp_service.GetEntryPositionInDataTable, params, callbacks);
+    this.callRpc('GetEntryPositionInDataTable', params, callbacks);
 },
 
 /*
@@ -212,7 +317,7 @@ getEntryPositionInDatatable : function(params, callbacks) {
         Param callbacks - see description in AimpManager comments.
 */
 getPlaylistEntriesCount : function(params, callbacks) {
-    this.callRpc(this.aimp_service.GetPlaylistEntriesCount, params, callbacks);
+    this.callRpc('GetPlaylistEntriesCount', params, callbacks);
 },
 
 /*
@@ -237,7 +342,7 @@ getPlaylistEntriesCount : function(params, callbacks) {
     Result - is object with member 'formatted_string', string.
 */
 getFormattedTrackTitle : function(params, callbacks) {
-    this.callRpc(this.aimp_service.GetFormattedEntryTitle, params, callbacks);
+    this.callRpc('GetFormattedEntryTitle', params, callbacks);
 },
 
 /*
@@ -248,7 +353,7 @@ getFormattedTrackTitle : function(params, callbacks) {
     Result - is object with following members: 'id', 'title', 'artist', 'album', 'date', 'genre', 'bitrate', 'duration', 'filesize', 'rating'.
 */
 getTrackInfo : function(params, callbacks) {
-    this.callRpc(this.aimp_service.GetPlaylistEntryInfo, params, callbacks);
+    this.callRpc('GetPlaylistEntryInfo', params, callbacks);
 },
 
 /*
@@ -259,7 +364,7 @@ getTrackInfo : function(params, callbacks) {
         Param callbacks - see description in AimpManager comments.
 */
 setTrackRating : function(params, callbacks) {
-    this.callRpc(this.aimp_service.SetTrackRating, params, callbacks);
+    this.callRpc('SetTrackRating', params, callbacks);
 },
 
 /*
@@ -270,7 +375,7 @@ setTrackRating : function(params, callbacks) {
     By default start playback current track in current playlist.
 */
 play : function(params, callbacks) {
-    this.callRpc(this.aimp_service.Play, params, callbacks);
+    this.callRpc('Play', params, callbacks);
 },
 
 /*
@@ -279,7 +384,7 @@ play : function(params, callbacks) {
         Param callbacks - see description in AimpManager comments.
 */
 stop : function(params, callbacks) {
-    this.callRpc(this.aimp_service.Stop, params, callbacks);
+    this.callRpc('Stop', params, callbacks);
 },
 
 /*
@@ -288,7 +393,7 @@ stop : function(params, callbacks) {
         Param callbacks - see description in AimpManager comments.
 */
 pause : function(params, callbacks) {
-    this.callRpc(this.aimp_service.Pause, params, callbacks);
+    this.callRpc('Pause', params, callbacks);
 },
 
 /*
@@ -297,7 +402,7 @@ pause : function(params, callbacks) {
         Param callbacks - see description in AimpManager comments.
 */
 playPrevious : function(params, callbacks) {
-    this.callRpc(this.aimp_service.PlayPrevious, params, callbacks);
+    this.callRpc('PlayPrevious', params, callbacks);
 },
 
 /*
@@ -306,7 +411,7 @@ playPrevious : function(params, callbacks) {
         Param callbacks - see description in AimpManager comments.
 */
 playNext : function(params, callbacks) {
-    this.callRpc(this.aimp_service.PlayNext, params, callbacks);
+    this.callRpc('PlayNext', params, callbacks);
 },
 
 /*
@@ -316,7 +421,7 @@ playNext : function(params, callbacks) {
         Param callbacks - see description in AimpManager comments.
 */
 enqueueTrack : function(params, callbacks) {
-    this.callRpc(this.aimp_service.EnqueueTrack, params, callbacks);
+    this.callRpc('EnqueueTrack', params, callbacks);
 },
 
 /*
@@ -326,7 +431,7 @@ enqueueTrack : function(params, callbacks) {
         Param callbacks - see description in AimpManager comments.
 */
 removeTrackFromPlayQueue : function(params, callbacks) {
-    this.callRpc(this.aimp_service.RemoveTrackFromPlayQueue, params, callbacks);
+    this.callRpc('RemoveTrackFromPlayQueue', params, callbacks);
 },
 
 /*
@@ -381,7 +486,7 @@ removeTrackFromPlayQueue : function(params, callbacks) {
     Returns current value of status if params.value is not specified.
 */
 status : function(params, callbacks) {
-    this.callRpc(this.aimp_service.Status, params, callbacks);
+    this.callRpc('Status', params, callbacks);
 },
 
 /*
@@ -395,7 +500,7 @@ trackPosition : function(params, callbacks) {
                                                               value : params.position
                                                             }
                                                           : {};
-    this.callRpc(this.aimp_service.Status, status_params, callbacks);
+    this.callRpc('Status', status_params, callbacks);
 },
 
 /*
@@ -405,7 +510,7 @@ trackPosition : function(params, callbacks) {
     With empty params returns current mode.
 */
 shufflePlaybackMode : function(params, callbacks) {
-    this.callRpc(this.aimp_service.ShufflePlaybackMode, params, callbacks);
+    this.callRpc('ShufflePlaybackMode', params, callbacks);
 },
 
 /*
@@ -415,7 +520,7 @@ shufflePlaybackMode : function(params, callbacks) {
     With empty params returns current mode.
 */
 repeatPlaybackMode : function(params, callbacks) {
-    this.callRpc(this.aimp_service.RepeatPlaybackMode, params, callbacks);
+    this.callRpc('RepeatPlaybackMode', params, callbacks);
 },
 
 /*
@@ -425,7 +530,7 @@ repeatPlaybackMode : function(params, callbacks) {
     With empty params returns current volume level.
 */
 volume : function(params, callbacks) {
-    this.callRpc(this.aimp_service.VolumeLevel, params, callbacks);
+    this.callRpc('VolumeLevel', params, callbacks);
 },
 
 /*
@@ -435,7 +540,7 @@ volume : function(params, callbacks) {
     With empty params returns current mode.
 */
 mute : function(params, callbacks) {
-    this.callRpc(this.aimp_service.Mute, params, callbacks);
+    this.callRpc('Mute', params, callbacks);
 },
 
 /*
@@ -445,7 +550,7 @@ mute : function(params, callbacks) {
     With empty params returns current mode.
 */
 radioCapture : function(params, callbacks) {
-    this.callRpc(this.aimp_service.RadioCaptureMode, params, callbacks);
+    this.callRpc('RadioCaptureMode', params, callbacks);
 },
 
 /*
@@ -464,7 +569,7 @@ radioCapture : function(params, callbacks) {
         shuffle_mode_on - flag of shuffle mode;
 */
 getControlPanelState : function(params, callbacks) {
-    this.callRpc(this.aimp_service.GetPlayerControlPanelState, params, callbacks);
+    this.callRpc('GetPlayerControlPanelState', params, callbacks);
 },
 
 /*
@@ -492,7 +597,7 @@ getControlPanelState : function(params, callbacks) {
     Result is specific for each event.
 */
 subscribe : function(params, callbacks) {
-    this.callRpc(this.aimp_service.SubscribeOnAIMPStateUpdateEvent, params, callbacks);
+    this.callRpc('SubscribeOnAIMPStateUpdateEvent', params, callbacks);
 },
 
 /*
@@ -504,7 +609,7 @@ subscribe : function(params, callbacks) {
         Param callbacks - see description in AimpManager comments.
 */
 getCover : function(params, callbacks) {
-    this.callRpc(this.aimp_service.GetCover, params, callbacks);
+    this.callRpc('GetCover', params, callbacks);
 },
 
 /*
@@ -514,7 +619,7 @@ getCover : function(params, callbacks) {
         Param callbacks - see description in AimpManager comments.
 */
 downloadTrack : function(params, callbacks) {
-    this.callRpc(this.aimp_service.DownloadTrack, params, callbacks);
+    this.callRpc('DownloadTrack', params, callbacks);
 },
 
 /*
@@ -522,7 +627,7 @@ downloadTrack : function(params, callbacks) {
         Param callbacks - see description in AimpManager comments.
 */
 pluginCapabilities : function(callbacks) {
-    this.callRpc(this.aimp_service.PluginCapabilities, {}, callbacks);
+    this.callRpc('PluginCapabilities', {}, callbacks);
 },
 
 /*
@@ -532,7 +637,7 @@ pluginCapabilities : function(callbacks) {
         Param callbacks - see description in AimpManager comments.
 */
 addURLToPlaylist : function(params, callbacks) {
-    this.callRpc(this.aimp_service.AddURLToPlaylist, params, callbacks);
+    this.callRpc('AddURLToPlaylist', params, callbacks);
 }
 
 }; // AimpManager.prototype
@@ -256,6 +256,13 @@ public:
     */
     virtual void saveCoverToFile(TrackDescription track_desc, const std::wstring& filename, int cover_width = 0, int cover_height = 0) const = 0; // throw std::runtime_error
 
+    /*!
+        \brief Returns full size album cover of track converted to 24bpp. AIMP decodes cover once.
+               Image is a copy of AIMP bitmap, so it can be processed in any thread.
+        \throw std::runtime_error in case of any error.
+    */
+    virtual std::auto_ptr<ImageUtils::AIMPCoverImage> getCoverImage(TrackDescription track_desc) const = 0; // throw std::runtime_error
+
     /*
         Returns track rating.
         rating value is in range [0-5]. Zero value means rating is not set.
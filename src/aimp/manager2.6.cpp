@@ -74,7 +74,8 @@ AIMPManager26::AIMPManager26(boost::intrusive_ptr<AIMP2SDK::IAIMP2Controller> ai
     playlists_check_timer_( io_service_, boost::posix_time::seconds(kPLAYLISTS_CHECK_PERIOD_SEC) ),
 #endif
     next_listener_id_(0),
-    playlists_db_(nullptr)
+    playlists_db_(nullptr),
+    entries_search_index_available_(false)
 {
     try {
         initializeAIMPObjects();
@@ -97,9 +98,9 @@ AIMPManager26::~AIMPManager26()
     unregisterNotifiers();
 
 #ifdef MANUAL_PLAYLISTS_CONTENT_CHANGES_DETERMINATION
-    BOOST_LOG_SEV(logger(), info) << "Stopping playlists check timer.";
+    AIMP_LOG_SEV(logger(), info) << "Stopping playlists check timer.";
     playlists_check_timer_.cancel();
-    BOOST_LOG_SEV(logger(), info) << "Playlists check timer was stopped.";
+    AIMP_LOG_SEV(logger(), info) << "Playlists check timer was stopped.";
 #endif
 
     shutdownPlaylistDB();
@@ -139,10 +140,7 @@ void AIMPManager26::loadPlaylist(int playlist_index)
     const int files_count = aimp2_playlist_manager_->AIMP_PLS_GetFilesCount(id);
 
     { // db code
-    sqlite3_stmt* stmt = createStmt(playlists_db_,
-                                    "REPLACE INTO Playlists VALUES (?,?,?,?,?,?,?)"
-                                    );
-    ON_BLOCK_EXIT(&sqlite3_finalize, stmt);
+    sqlite3_stmt* stmt = playlists_db_stmt_cache_.get("REPLACE INTO Playlists VALUES (?,?,?,?,?,?,?)");
 
 #define bind(type, field_index, value)  rc_db = sqlite3_bind_##type(stmt, field_index, value); \
                                         if (SQLITE_OK != rc_db) { \
@@ -316,13 +314,12 @@ void AIMPManager26::loadEntries(PlaylistID playlist_id) // throws std::runtime_e
     
     deletePlaylistEntriesFromPlaylistDB(playlist_id); // remove old entries before adding new ones.
 
-    sqlite3_stmt* stmt = createStmt(playlists_db_, "INSERT INTO PlaylistsEntries VALUES (?,?,?,?,?,?,"
-                                                                                         "?,?,?,?,?,"
-                                                                                         "?,?,?,?,?)"
-                                    );
-    ON_BLOCK_EXIT(&sqlite3_finalize, stmt);
+    sqlite3_stmt* stmt = playlists_db_stmt_cache_.get("INSERT INTO PlaylistsEntries VALUES (?,?,?,?,?,?,"
+                                                                                            "?,?,?,?,?,"
+                                                                                            "?,?,?,?,?)"
+                                                      );
 
-    //BOOST_LOG_SEV(logger(), debug) << "The statement has "
+    //AIMP_LOG_SEV(logger(), debug) << "The statement has "
     //                               << sqlite3_bind_parameter_count(stmt)
     //                               << " wildcards";
 
@@ -376,7 +373,7 @@ void AIMPManager26::loadEntries(PlaylistID playlist_id) // throws std::runtime_e
                 sqlite3_reset(stmt);
             }
         } else {
-            BOOST_LOG_SEV(logger(), error) << "Error occured while getting entry info " << entry_index << " from playlist with ID = " << playlist_id;
+            AIMP_LOG_SEV(logger(), error) << "Error occured while getting entry info " << entry_index << " from playlist with ID = " << playlist_id;
             throw std::runtime_error("Error occured while getting playlist entries.");
         }
     }
@@ -511,10 +508,12 @@ void AIMPManager26::checkIfPlaylistsChanged()
     // reload entries of playlists from list.
     for (PlaylistID playlist_id : playlists_to_reload) {
         try {
+            Transaction transaction(playlists_db_); // insert all entries of playlist by single commit.
             loadEntries(playlist_id); // avoid using of playlists_[playlist_id], since it requires Playlist's default ctor.
             updatePlaylistCrcInDB( playlist_id, getPlaylistCRC32(playlist_id) );
+            transaction.commit();
         } catch (std::exception& e) {
-            BOOST_LOG_SEV(logger(), error) << "Error occured while playlist(id = " << playlist_id << ") entries loading. Reason: " << e.what();
+            AIMP_LOG_SEV(logger(), error) << "Error occured while playlist(id = " << playlist_id << ") entries loading. Reason: " << e.what();
         }
     }
 
@@ -534,10 +533,12 @@ void AIMPManager26::checkIfPlaylistsChanged()
         };
         foreach_row("SELECT id FROM Playlists", playlists_db_, handler);
 
+        Transaction transaction(playlists_db_);
         for (PlaylistID playlist_id : playlists_to_delete) {
             playlist_crc32_list_.erase(playlist_id);
             deletePlaylistFromPlaylistDB(playlist_id);
         }
+        transaction.commit();
     }
  
     if (playlists_content_changed) {
@@ -547,10 +548,7 @@ void AIMPManager26::checkIfPlaylistsChanged()
 
 void AIMPManager26::updatePlaylistCrcInDB(PlaylistID playlist_id, crc32_t crc32)
 {
-    sqlite3_stmt* stmt = createStmt(playlists_db_,
-                                    "UPDATE Playlists SET crc32=? WHERE id=?"
-                                    );
-    ON_BLOCK_EXIT(&sqlite3_finalize, stmt);
+    sqlite3_stmt* stmt = playlists_db_stmt_cache_.get("UPDATE Playlists SET crc32=? WHERE id=?");
 
 #define bind(type, field_index, value)  rc_db = sqlite3_bind_##type(stmt, field_index, value); \
                                         if (SQLITE_OK != rc_db) { \
@@ -668,7 +666,7 @@ void AIMPManager26::onTimerPlaylistsChangeCheck(const boost::system::error_code&
         // Do check
         checkIfPlaylistsChanged();
     } else if (e != boost::asio::error::operation_aborted) { // "operation_aborted" error code is sent when timer is cancelled.
-        BOOST_LOG_SEV(logger(), error) << "err:"__FUNCTION__" timer error:" << e;
+        AIMP_LOG_SEV(logger(), error) << "err:"__FUNCTION__" timer error:" << e;
     }
 }
 
@@ -695,7 +693,7 @@ void AIMPManager26::registerNotifiers()
                                                                reinterpret_cast<DWORD>(this) // user data that will be passed in internalAIMPStateNotifier().
                                                               );
         if (!result) {
-            BOOST_LOG_SEV(logger(), error) << "Error occured while register " << callback.second << " callback";
+            AIMP_LOG_SEV(logger(), error) << "Error occured while register " << callback.second << " callback";
         }
     }
 }
@@ -707,7 +705,7 @@ void AIMPManager26::unregisterNotifiers()
         // unregister notifier.
         const boolean result = aimp2_controller_->AIMP_CallBack_Remove(callback_id, &internalAIMPStateNotifier);
         if (!result) {
-            BOOST_LOG_SEV(logger(), error) <<  "Error occured while unregister " << callback.second << " callback";
+            AIMP_LOG_SEV(logger(), error) <<  "Error occured while unregister " << callback.second << " callback";
         }
     }
 }
@@ -1079,7 +1077,7 @@ void AIMPManager26::onTick()
         const int new_value = aimp2_controller_->AIMP_Status_Get(status);
         if (desc.value != new_value) {
             if (STATUS_POS != desc.key) {
-                BOOST_LOG_SEV(logger(), debug) << "status(STATUS_" << asString(status) << ") changed from " << desc.value << " to " << new_value;
+                AIMP_LOG_SEV(logger(), debug) << "status(STATUS_" << asString(status) << ") changed from " << desc.value << " to " << new_value;
             }
             desc.value = new_value;
         }
@@ -1160,7 +1158,7 @@ AIMPManager::PLAYBACK_STATE AIMPManager26::getPlaybackState() const
         break;
     default:
         assert(!"getStatus(STATUS_Player) returned unknown value");
-        BOOST_LOG_SEV(logger(), error) << "getStatus(STATUS_Player) returned unknown value " << internal_state;
+        AIMP_LOG_SEV(logger(), error) << "getStatus(STATUS_Player) returned unknown value " << internal_state;
     }
 
     return state;
@@ -1197,11 +1195,20 @@ void AIMPManager26::saveCoverToFile(TrackDescription track_desc, const std::wstr
         cover->saveToFile(filename);
     } catch (std::exception& e) {
         const std::string& str = MakeString() << "Error occured while cover saving to file for " << track_desc << ". Reason: " << e.what();
-        BOOST_LOG_SEV(logger(), error) << str;
+        AIMP_LOG_SEV(logger(), error) << str;
         throw std::runtime_error(str);
     }
 }
 
+std::auto_ptr<ImageUtils::AIMPCoverImage> AIMPManager26::getCoverImage(TrackDescription track_desc) const // throw std::runtime_error
+{
+    try {
+        return getCoverImage(getAbsoluteTrackDesc(track_desc), 0, 0);
+    } catch (std::invalid_argument& e) {
+        throw std::runtime_error( e.what() );
+    }
+}
+
 std::auto_ptr<ImageUtils::AIMPCoverImage> AIMPManager26::getCoverImage(TrackDescription track_desc, int cover_width, int cover_height) const
 {
     if (cover_width < 0 || cover_height < 0) {
@@ -1234,7 +1241,9 @@ std::auto_ptr<ImageUtils::AIMPCoverImage> AIMPManager26::getCoverImage(TrackDesc
             cover_size.cy = cover_height;
         }
 
-        cover_bitmap_handle = aimp2_cover_art_manager_->GetCoverArtForFile(const_cast<PWCHAR>( entry_filename.c_str() ), &cover_size);
+        if (cover_size.cx != cover_full_size.cx || cover_size.cy != cover_full_size.cy) { // do not decode cover twice if original size is requested.
+            cover_bitmap_handle = aimp2_cover_art_manager_->GetCoverArtForFile(const_cast<PWCHAR>( entry_filename.c_str() ), &cover_size);
+        }
     }
 
     using namespace ImageUtils;
@@ -1348,9 +1357,9 @@ void WINAPI AIMPManager26::internalAIMPStateNotifier(DWORD User, DWORD dwCBType)
             const CallbackIdNameMap& callback_names = aimp_manager->aimp_callback_names_;
             auto callback_name_it = callback_names.find(dwCBType);
             if ( callback_name_it != callback_names.end() ) {
-                BOOST_LOG_SEV(logger(), info) << "callback " << callback_name_it->second << " is invoked";
+                AIMP_LOG_SEV(logger(), info) << "callback " << callback_name_it->second << " is invoked";
             } else {
-                BOOST_LOG_SEV(logger(), info) << "callback " << dwCBType << " is invoked";
+                AIMP_LOG_SEV(logger(), info) << "callback " << dwCBType << " is invoked";
             }
         }
         break;
@@ -1750,6 +1759,7 @@ void AIMPManager26::initPlaylistDB() // throws std::runtime_error
     int rc = sqlite3_open(":memory:", &playlists_db_);
     THROW_IF_NOT_OK_WITH_MSG( rc, MakeString() << "Playlist database creation failure. Reason: sqlite3_open error "
                                                << rc << ": " << sqlite3_errmsg(playlists_db_) );
+    playlists_db_stmt_cache_.attach(playlists_db_);
 
     { // add case-insensitivity support to LIKE operator (used for search tracks) since default LIKE operator since it supports case-insensitive search only on ASCII chars by default).
     rc = sqlite3_unicode_init(playlists_db_);
@@ -1787,6 +1797,29 @@ void AIMPManager26::initPlaylistDB() // throws std::runtime_error
                                                << rc << ": " << errmsg );
     }
 
+    { // create index for entries of playlist: all entries queries filter by playlist_id and by default order by entry_index.
+    char* errmsg = nullptr;
+    ON_BLOCK_EXIT(&sqlite3_free, errmsg);
+    rc = sqlite3_exec(playlists_db_,
+                      "CREATE INDEX PlaylistsEntriesPlaylistIndex ON PlaylistsEntries (playlist_id, entry_index)",
+                      nullptr, /* Callback function */
+                      nullptr, /* 1st argument to callback */
+                      &errmsg
+                      );
+    THROW_IF_NOT_OK_WITH_MSG( rc, MakeString() << "Playlist content index creation failure. Reason: sqlite3_exec(create index) error "
+                                               << rc << ": " << errmsg );
+    }
+
+    { // create full text search index for entries. It is optional: search falls back to LIKE operator if index is not available.
+    try {
+        createEntriesSearchIndex(playlists_db_);
+        entries_search_index_available_ = true;
+    } catch (std::exception& e) {
+        entries_search_index_available_ = false;
+        AIMP_LOG_SEV(logger(), warning) << "Entries search index is not available, slow search will be used. Reason: " << e.what();
+    }
+    }
+
     { // create table for playlist.
     char* errmsg = nullptr;
     ON_BLOCK_EXIT(&sqlite3_free, errmsg);
@@ -1813,51 +1846,46 @@ void AIMPManager26::initPlaylistDB() // throws std::runtime_error
 
 void AIMPManager26::shutdownPlaylistDB()
 {
+    playlists_db_stmt_cache_.clear(); // all statements must be finalized before closing DB.
     const int rc = sqlite3_close(playlists_db_);
     if (SQLITE_OK != rc) {
-        BOOST_LOG_SEV(logger(), error) << "sqlite3_close error: " << rc;
+        AIMP_LOG_SEV(logger(), error) << "sqlite3_close error: " << rc;
     }
     playlists_db_ = nullptr;
 }
 
+namespace {
+// On error it prints error reason to log only.
+void executeDeleteQuery(Utilities::StatementCache& stmt_cache, sqlite3* db, const char* query, int id, const char* log_tag)
+{
+    try {
+        sqlite3_stmt* stmt = stmt_cache.get(query);
+        int rc_db = sqlite3_bind_int(stmt, 1, id);
+        if (SQLITE_OK != rc_db) {
+            throw std::runtime_error(MakeString() << "Error sqlite3_bind_int " << rc_db);
+        }
+        rc_db = sqlite3_step(stmt);
+        sqlite3_reset(stmt);
+        if (SQLITE_DONE != rc_db) {
+            throw std::runtime_error(MakeString() << "sqlite3_step() error " << rc_db << ": " << sqlite3_errmsg(db));
+        }
+    } catch (std::exception& e) {
+        AIMP_LOG_SEV(logger(), error) << log_tag << " failed. Reason: " << e.what()
+                                       << ". Query: " << query << ", id: " << id;
+    }
+}
+} // namespace
+
 void AIMPManager26::deletePlaylistFromPlaylistDB(PlaylistID playlist_id)
 {
     deletePlaylistEntriesFromPlaylistDB(playlist_id);
 
-    const std::string query = MakeString() << "DELETE FROM Playlists WHERE id=" << playlist_id;
-
-    char* errmsg = nullptr;
-    const int rc = sqlite3_exec(playlists_db_,
-                                query.c_str(),
-                                nullptr, /* Callback function */
-                                nullptr, /* 1st argument to callback */
-                                &errmsg
-                                );
-    if (SQLITE_OK != rc) {
-        BOOST_LOG_SEV(logger(), error) << __FUNCTION__" failed. Reason: sqlite3_exec() error "
-                                       << rc << ": " << errmsg
-                                       << ". Query: " << query;
-        sqlite3_free(errmsg);
-    }
+    executeDeleteQuery(playlists_db_stmt_cache_, playlists_db_, "DELETE FROM Playlists WHERE id=?", playlist_id, __FUNCTION__);
 }
 
 void AIMPManager26::deletePlaylistEntriesFromPlaylistDB(PlaylistID playlist_id)
 {
-    const std::string query = MakeString() << "DELETE FROM PlaylistsEntries WHERE playlist_id=" << playlist_id;
-
-    char* errmsg = nullptr;
-    const int rc = sqlite3_exec(playlists_db_,
-                                query.c_str(),
-                                nullptr, /* Callback function */
-                                nullptr, /* 1st argument to callback */
-                                &errmsg
-                                );
-    if (SQLITE_OK != rc) {
-        BOOST_LOG_SEV(logger(), error) << __FUNCTION__" failed. Reason: sqlite3_exec() error "
-                                       << rc << ": " << errmsg 
-                                       << ". Query: " << query;
-        sqlite3_free(errmsg);
-    }
+    executeDeleteQuery(playlists_db_stmt_cache_, playlists_db_, "DELETE FROM PlaylistsEntries WHERE playlist_id=?", playlist_id, __FUNCTION__);
 }
 
 void AIMPManager26::addFileToPlaylist(const boost::filesystem::wpath& path, PlaylistID playlist_id) // throws std::runtime_error
@@ -1892,7 +1920,7 @@ PlaylistID AIMPManager26::createPlaylist(const std::wstring& title)
 void AIMPManager26::removeTrack(TrackDescription track_desc, bool physically) // throws std::runtime_error
 {
     if (physically) {
-        BOOST_LOG_SEV(logger(), warning) << __FUNCTION__": AIMP2 SDK does not support track physical removing";
+        AIMP_LOG_SEV(logger(), warning) << __FUNCTION__": AIMP2 SDK does not support track physical removing";
     }
 
     track_desc = getAbsoluteTrackDesc(track_desc);
@@ -101,6 +101,8 @@ public:
 
     virtual void saveCoverToFile(TrackDescription track_desc, const std::wstring& filename, int cover_width = 0, int cover_height = 0) const; // throw std::runtime_error
 
+    virtual std::auto_ptr<ImageUtils::AIMPCoverImage> getCoverImage(TrackDescription track_desc) const; // throw std::runtime_error
+
     virtual void removeTrack(TrackDescription track_desc, bool physically = false); // throws std::runtime_error
 
     virtual EventsListenerID registerListener(EventsListener listener);
@@ -115,6 +117,14 @@ public:
     sqlite3* playlists_db() const
         { return playlists_db_; }
 
+    //! Finalizes cached prepared statements of playlists DB. Must be called after schema of DB was changed outside of manager.
+    void onPlaylistsDBSchemaChanged()
+        { playlists_db_stmt_cache_.clear(); }
+
+    //! Returns true if full text search index of entries is created. See createEntriesSearchIndex().
+    bool entries_search_index_available() const
+        { return entries_search_index_available_; }
+
 private:
 
     /*!
@@ -200,6 +210,10 @@ private:
 
     sqlite3* playlists_db_;
 
+    Utilities::StatementCache playlists_db_stmt_cache_; //!< prepared statements of frequently executed playlists_db_ queries.
+
+    bool entries_search_index_available_;
+
     PlaylistCRC32& getPlaylistCRC32Object(PlaylistID playlist_id) const; // throws std::runtime_error
     typedef std::map<PlaylistID, PlaylistCRC32> PlaylistCRC32List;
     mutable PlaylistCRC32List playlist_crc32_list_;
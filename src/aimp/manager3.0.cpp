@@ -172,7 +172,8 @@ AIMPManager30::AIMPManager30(boost::intrusive_ptr<AIMP3SDK::IAIMPCoreUnit> aimp3
     :
     aimp3_core_unit_(aimp3_core_unit),
     next_listener_id_(0),
-    playlists_db_(nullptr)
+    playlists_db_(nullptr),
+    entries_search_index_available_(false)
 {
     try {
         initializeAIMPObjects();
@@ -254,15 +255,15 @@ void AIMPManager30::onStorageActivated(AIMP3SDK::HPLS /*handle*/)
 void AIMPManager30::onStorageAdded(AIMP3SDK::HPLS handle)
 {
     try {
-        BOOST_LOG_SEV(logger(), debug) << "onStorageAdded: id = " << cast<PlaylistID>(handle);
+        AIMP_LOG_SEV(logger(), debug) << "onStorageAdded: id = " << cast<PlaylistID>(handle);
         int playlist_index = getPlaylistIndexByHandle(handle);
         loadPlaylist(handle, playlist_index);
         notifyAllExternalListeners(EVENT_PLAYLISTS_CONTENT_CHANGE);
     } catch (std::exception& e) {
-        BOOST_LOG_SEV(logger(), error) << "Error in "__FUNCTION__ << " for playlist with handle " << handle << ". Reason: " << e.what();
+        AIMP_LOG_SEV(logger(), error) << "Error in "__FUNCTION__ << " for playlist with handle " << handle << ". Reason: " << e.what();
     } catch (...) {
         // we can't propagate exception from here since it is called from AIMP. Just log unknown error.
-        BOOST_LOG_SEV(logger(), error) << "Unknown exception in "__FUNCTION__ << " for playlist with handle " << handle;
+        AIMP_LOG_SEV(logger(), error) << "Unknown exception in "__FUNCTION__ << " for playlist with handle " << handle;
     }
 }
 
@@ -309,16 +310,21 @@ void AIMPManager30::onStorageChanged(AIMP3SDK::HPLS handle, DWORD flags)
     using namespace AIMP3SDK;
 
     try {
-        BOOST_LOG_SEV(logger(), debug) << "onStorageChanged()...: id = " << cast<PlaylistID>(handle) << ", flags = " << flags << ": " << playlistNotifyFlagsToString(flags);
+        AIMP_LOG_SEV(logger(), debug) << "onStorageChanged()...: id = " << cast<PlaylistID>(handle) << ", flags = " << flags << ": " << playlistNotifyFlagsToString(flags);
 
         PlaylistID playlist_id = cast<PlaylistID>(handle);
-        bool is_playlist_changed = false;
+        bool is_playlist_changed = false,
+             is_entries_loaded = false;
+        std::vector<crc32_t> entries_crc32;
+
+        Transaction transaction(playlists_db_); // all DB changes are applied by single commit.
+
         if (   (AIMP_PLAYLIST_NOTIFY_NAME       & flags) != 0 
             || (AIMP_PLAYLIST_NOTIFY_ENTRYINFO  & flags) != 0
             || (AIMP_PLAYLIST_NOTIFY_STATISTICS & flags) != 0 
             )
         {
-            BOOST_LOG_SEV(logger(), debug) << "updatePlaylist";
+            AIMP_LOG_SEV(logger(), debug) << "updatePlaylist";
             is_playlist_changed = true;
         }
 
@@ -326,24 +332,34 @@ void AIMPManager30::onStorageChanged(AIMP3SDK::HPLS handle, DWORD flags)
             || (AIMP_PLAYLIST_NOTIFY_CONTENT   & flags) != 0 
             )
         {
-            BOOST_LOG_SEV(logger(), debug) << "loadEntries";
-            loadEntries(playlist_id); 
+            AIMP_LOG_SEV(logger(), debug) << "loadEntries";
+            loadEntries(playlist_id, &entries_crc32);
+            is_entries_loaded = true;
             is_playlist_changed = true;
         }
 
         if (is_playlist_changed) {
             int playlist_index = getPlaylistIndexByHandle(handle);
             loadPlaylist(handle, playlist_index);
-            updatePlaylistCrcInDB(playlist_id, getPlaylistCRC32(playlist_id));
+
+            // in-memory crc32 is updated only after commit: if commit fails, it stays reset and will be recalculated by DB data.
+            PlaylistCRC32 playlist_crc32 = getPlaylistCRC32Object(playlist_id);
+            if (is_entries_loaded) {
+                playlist_crc32.set_crc32_entries(entries_crc32);
+            }
+            updatePlaylistCrcInDB( playlist_id, playlist_crc32.crc32() );
+            transaction.commit();
+            getPlaylistCRC32Object(playlist_id) = playlist_crc32;
+
             notifyAllExternalListeners(EVENT_PLAYLISTS_CONTENT_CHANGE);
         }
 
-        BOOST_LOG_SEV(logger(), debug) << "...onStorageChanged()";
+        AIMP_LOG_SEV(logger(), debug) << "...onStorageChanged()";
     } catch (std::exception& e) {
-        BOOST_LOG_SEV(logger(), error) << "Error in "__FUNCTION__ << " for playlist with handle " << handle << ". Reason: " << e.what();
+        AIMP_LOG_SEV(logger(), error) << "Error in "__FUNCTION__ << " for playlist with handle " << handle << ". Reason: " << e.what();
     } catch (...) {
         // we can't propagate exception from here since it is called from AIMP. Just log unknown error.
-        BOOST_LOG_SEV(logger(), error) << "Unknown exception in "__FUNCTION__ << " for playlist with handle " << handle;
+        AIMP_LOG_SEV(logger(), error) << "Unknown exception in "__FUNCTION__ << " for playlist with handle " << handle;
     }
 }
 
@@ -352,13 +368,15 @@ void AIMPManager30::onStorageRemoved(AIMP3SDK::HPLS handle)
     try {
         const int playlist_id = cast<PlaylistID>(handle);
         playlist_crc32_list_.erase(playlist_id);
+        Transaction transaction(playlists_db_);
         deletePlaylistFromPlaylistDB(playlist_id);
+        transaction.commit();
         notifyAllExternalListeners(EVENT_PLAYLISTS_CONTENT_CHANGE);
     } catch (std::exception& e) {
-        BOOST_LOG_SEV(logger(), error) << "Error in "__FUNCTION__ << " for playlist with handle " << handle << ". Reason: " << e.what();
+        AIMP_LOG_SEV(logger(), error) << "Error in "__FUNCTION__ << " for playlist with handle " << handle << ". Reason: " << e.what();
     } catch (...) {
         // we can't propagate exception from here since it is called from AIMP. Just log unknown error.
-        BOOST_LOG_SEV(logger(), error) << "Unknown exception in "__FUNCTION__ << " for playlist with handle " << handle;
+        AIMP_LOG_SEV(logger(), error) << "Unknown exception in "__FUNCTION__ << " for playlist with handle " << handle;
     }
 }
 
@@ -416,10 +434,7 @@ void AIMPManager30::loadPlaylist(AIMP3SDK::HPLS handle, int playlist_index)
     const int entries_count = aimp3_playlist_manager_->StorageGetEntryCount(handle);
 
     { // db code
-    sqlite3_stmt* stmt = createStmt(playlists_db_,
-                                    "REPLACE INTO Playlists VALUES (?,?,?,?,?,?,?)"
-                                    );
-    ON_BLOCK_EXIT(&sqlite3_finalize, stmt);
+    sqlite3_stmt* stmt = playlists_db_stmt_cache_.get("REPLACE INTO Playlists VALUES (?,?,?,?,?,?,?)");
 
 #define bind(type, field_index, value)  rc_db = sqlite3_bind_##type(stmt, field_index, value); \
                                         if (SQLITE_OK != rc_db) { \
@@ -478,10 +493,7 @@ crc32_t AIMPManager30::getPlaylistCRC32(PlaylistID playlist_id) const // throws
 
 void AIMPManager30::updatePlaylistCrcInDB(PlaylistID playlist_id, crc32_t crc32) // throws std::runtime_error
 {
-    sqlite3_stmt* stmt = createStmt(playlists_db_,
-                                    "UPDATE Playlists SET crc32=? WHERE id=?"
-                                    );
-    ON_BLOCK_EXIT(&sqlite3_finalize, stmt);
+    sqlite3_stmt* stmt = playlists_db_stmt_cache_.get("UPDATE Playlists SET crc32=? WHERE id=?");
 
 #define bind(type, field_index, value)  rc_db = sqlite3_bind_##type(stmt, field_index, value); \
                                         if (SQLITE_OK != rc_db) { \
@@ -502,7 +514,64 @@ void AIMPManager30::updatePlaylistCrcInDB(PlaylistID playlist_id, crc32_t crc32)
     }
 }
 
-void AIMPManager30::loadEntries(PlaylistID playlist_id) // throws std::runtime_error
+namespace {
+
+//! Describes entry which is already stored in playlists DB.
+struct StoredEntry
+{
+    int entry_index;
+    crc32_t crc32;
+    StoredEntry(int entry_index, crc32_t crc32) : entry_index(entry_index), crc32(crc32) {}
+};
+typedef std::map<PlaylistEntryID, StoredEntry> StoredEntries;
+
+StoredEntries getStoredEntries(sqlite3* db, StatementCache& stmt_cache, PlaylistID playlist_id) // throws std::runtime_error
+{
+    const char * const query = "SELECT entry_id, entry_index, crc32 FROM PlaylistsEntries WHERE playlist_id=?";
+    sqlite3_stmt* stmt = stmt_cache.get(query);
+    ON_BLOCK_EXIT(&sqlite3_reset, stmt);
+
+    const int rc_bind = sqlite3_bind_int(stmt, 1, playlist_id);
+    if (SQLITE_OK != rc_bind) {
+        throw std::runtime_error(MakeString() << "Error sqlite3_bind_int " << rc_bind);
+    }
+
+    StoredEntries entries;
+    for(;;) {
+        const int rc_db = sqlite3_step(stmt);
+        if (SQLITE_ROW == rc_db) {
+            entries.insert( std::make_pair( sqlite3_column_int(stmt, 0),
+                                            StoredEntry( sqlite3_column_int(stmt, 1),
+                                                         static_cast<crc32_t>( sqlite3_column_int64(stmt, 2) )
+                                                        )
+                                           )
+                           );
+        } else if (SQLITE_DONE == rc_db) {
+            break;
+        } else {
+            const std::string msg = MakeString() << "sqlite3_step() error "
+                                                 << rc_db << ": " << sqlite3_errmsg(db)
+                                                 << ". Query: " << query;
+            throw std::runtime_error(msg);
+        }
+    }
+    return entries;
+}
+
+void stepStmt(sqlite3* db, sqlite3_stmt* stmt) // throws std::runtime_error
+{
+    const int rc_db = sqlite3_step(stmt);
+    if (SQLITE_DONE != rc_db) {
+        const std::string msg = MakeString() << "sqlite3_step() error "
+                                             << rc_db << ": " << sqlite3_errmsg(db);
+        throw std::runtime_error(msg);
+    }
+    sqlite3_reset(stmt);
+}
+
+} // namespace
+
+void AIMPManager30::loadEntries(PlaylistID playlist_id, std::vector<crc32_t>* entries_crc32) // throws std::runtime_error
 {
     PROFILE_EXECUTION_TIME(__FUNCTION__);
 
@@ -515,30 +584,27 @@ void AIMPManager30::loadEntries(PlaylistID playlist_id) // throws std::runtime_e
     }
 
     using namespace AIMP3SDK;
-    // PROFILE_EXECUTION_TIME(__FUNCTION__);
 
     AIMP3Util::FileInfoHelper file_info_helper; // used for get entries from AIMP conveniently.
 
     const AIMP3SDK::HPLS playlist_handle = cast<AIMP3SDK::HPLS>(playlist_id);
     const int entries_count = aimp3_playlist_manager_->StorageGetEntryCount(playlist_handle);
 
-    deletePlaylistEntriesFromPlaylistDB(playlist_id); // remove old entries before adding new ones.
-
-    sqlite3_stmt* stmt = createStmt(playlists_db_, "INSERT INTO PlaylistsEntries VALUES (?,?,?,?,?,?,"
-                                                                                        "?,?,?,?,?,"
-                                                                                        "?,?,?,?,?)"
-                                    );
-    ON_BLOCK_EXIT(&sqlite3_finalize, stmt);
-
-    //BOOST_LOG_SEV(logger(), debug) << "The statement has "
-    //                               << sqlite3_bind_parameter_count(stmt)
-    //                               << " wildcards";
-
-#define bind(type, field_index, value)  rc_db = sqlite3_bind_##type(stmt, field_index, value); \
-                                        if (SQLITE_OK != rc_db) { \
-                                            const std::string msg = MakeString() << "Error sqlite3_bind_"#type << " " << rc_db; \
-                                            throw std::runtime_error(msg); \
-                                        }
+    // Only changed entries are written to DB: entries are compared with stored ones by crc32.
+    StoredEntries stored_entries = getStoredEntries(playlists_db_, playlists_db_stmt_cache_, playlist_id);
+
+    sqlite3_stmt* stmt = playlists_db_stmt_cache_.get("REPLACE INTO PlaylistsEntries VALUES (?,?,?,?,?,?,"
+                                                                                            "?,?,?,?,?,"
+                                                                                            "?,?,?,?,?)"
+                                                      );
+    sqlite3_stmt* stmt_update_index = playlists_db_stmt_cache_.get("UPDATE PlaylistsEntries SET entry_index=? WHERE entry_id=?");
+    sqlite3_stmt* stmt_delete = playlists_db_stmt_cache_.get("DELETE FROM PlaylistsEntries WHERE entry_id=? AND playlist_id=?");
+
+#define bind(stmt, type, field_index, value)  rc_db = sqlite3_bind_##type(stmt, field_index, value); \
+                                              if (SQLITE_OK != rc_db) { \
+                                                  const std::string msg = MakeString() << "Error sqlite3_bind_"#type << " " << rc_db; \
+                                                  throw std::runtime_error(msg); \
+                                              }
 #define bindText(field_index, info_field_name)  rc_db = sqlite3_bind_text16(stmt, field_index, info.##info_field_name##Buffer, info.##info_field_name##BufferSizeInChars * sizeof(WCHAR), SQLITE_STATIC); \
                                                 if (SQLITE_OK != rc_db) { \
                                                     const std::string msg = MakeString() << "sqlite3_bind_text16" << " " << rc_db; \
@@ -546,15 +612,20 @@ void AIMPManager30::loadEntries(PlaylistID playlist_id) // throws std::runtime_e
                                                 }
 
     int rc_db;
-    bind(int, 1, playlist_id);
-    
+    bind(stmt, int, 1, playlist_id);
+
+    entries_crc32->clear(); // in playlist order, see PlaylistCRC32::calc_crc32_entries().
+    entries_crc32->reserve(entries_count);
+
+    size_t inserted_count = 0,
+           updated_count = 0;
     for (int entry_index = 0; entry_index < entries_count; ++entry_index) {
         const HPLSENTRY entry_handle = aimp3_playlist_manager_->StorageGetEntry(playlist_handle, entry_index);
 
         HRESULT r = aimp3_playlist_manager_->EntryPropertyGetValue( entry_handle, AIMP3SDK::AIMP_PLAYLIST_ENTRY_PROPERTY_INFO,
                                                                     &file_info_helper.getEmptyFileInfo(), sizeof(file_info_helper.getEmptyFileInfo()) );
         if (S_OK != r) {
-            const std::string msg = MakeString() << "IAIMPAddonsPlaylistManager::EntryPropertyGetValue(AIMP_PLAYLIST_ENTRY_PROPERTY_INFO) error " 
+            const std::string msg = MakeString() << "IAIMPAddonsPlaylistManager::EntryPropertyGetValue(AIMP_PLAYLIST_ENTRY_PROPERTY_INFO) error "
                                                  << r << " occured while getting entry info " << entry_index
                                                  << " from playlist with ID = " << playlist_id;
             throw std::runtime_error(msg);
@@ -564,44 +635,74 @@ void AIMPManager30::loadEntries(PlaylistID playlist_id) // throws std::runtime_e
 
         int rating = 0;
         { // get rating manually, since AIMP3 does not fill TAIMPFileInfo::Rating value.
-            r = aimp3_playlist_manager_->EntryPropertyGetValue( entry_handle, AIMP3SDK::AIMP_PLAYLIST_ENTRY_PROPERTY_MARK, &rating, sizeof(rating) );    
+            r = aimp3_playlist_manager_->EntryPropertyGetValue( entry_handle, AIMP3SDK::AIMP_PLAYLIST_ENTRY_PROPERTY_MARK, &rating, sizeof(rating) );
             if (S_OK != r) {
                 rating = 0;
             }
         }
 
-        { // special db code
-            // bind all values
-            
+        const AIMP3SDK::TAIMPFileInfo& info = file_info_helper.getFileInfoWithCorrectStringLengthsAndNonEmptyTitle();
 
-            const AIMP3SDK::TAIMPFileInfo& info = file_info_helper.getFileInfoWithCorrectStringLengthsAndNonEmptyTitle();
-            bind(int,    2, entry_id);
-            bind(int,    3, entry_index);
-            bindText(    4, Album);
-            bindText(    5, Artist);
-            bindText(    6, Date);
-            bindText(    7, FileName);
-            bindText(    8, Genre);
-            bindText(    9, Title);
-            bind(int,   10, info.BitRate);
-            bind(int,   11, info.Channels);
-            bind(int,   12, info.Duration);
-            bind(int64, 13, info.FileSize);
-            bind(int,   14, rating);
-            bind(int,   15, info.SampleRate);
-            bind(int64, 16, crc32(info));
-
-            rc_db = sqlite3_step(stmt);
-            if (SQLITE_DONE != rc_db) {
-                const std::string msg = MakeString() << "sqlite3_step() error "
-                                                     << rc_db << ": " << sqlite3_errmsg(playlists_db_);
-                throw std::runtime_error(msg);
+        crc32_t entry_crc32;
+        { // crc32 must include rating to be equal to PlaylistCRC32::crc32_entry().
+            AIMP3SDK::TAIMPFileInfo info_with_rating = info;
+            info_with_rating.Rating = rating;
+            entry_crc32 = crc32(info_with_rating);
+        }
+        entries_crc32->push_back(entry_crc32);
+
+        auto stored_entry_it = stored_entries.find(entry_id);
+        if (stored_entry_it != stored_entries.end()) {
+            const StoredEntry stored_entry = stored_entry_it->second;
+            stored_entries.erase(stored_entry_it);
+
+            if (stored_entry.crc32 == entry_crc32) {
+                if (stored_entry.entry_index != entry_index) { // entry was moved only.
+                    bind(stmt_update_index, int, 1, entry_index);
+                    bind(stmt_update_index, int, 2, entry_id);
+                    stepStmt(playlists_db_, stmt_update_index);
+                    ++updated_count;
+                }
+                continue;
             }
-            sqlite3_reset(stmt);
+            ++updated_count;
+        } else {
+            ++inserted_count;
+        }
+
+        { // special db code
+            // bind all values
+            bind(stmt, int,    2, entry_id);
+            bind(stmt, int,    3, entry_index);
+            bindText(          4, Album);
+            bindText(          5, Artist);
+            bindText(          6, Date);
+            bindText(          7, FileName);
+            bindText(          8, Genre);
+            bindText(          9, Title);
+            bind(stmt, int,   10, info.BitRate);
+            bind(stmt, int,   11, info.Channels);
+            bind(stmt, int,   12, info.Duration);
+            bind(stmt, int64, 13, info.FileSize);
+            bind(stmt, int,   14, rating);
+            bind(stmt, int,   15, info.SampleRate);
+            bind(stmt, int64, 16, entry_crc32);
+
+            stepStmt(playlists_db_, stmt);
         }
     }
+
+    // remove entries which do not exist in playlist anymore.
+    bind(stmt_delete, int, 2, playlist_id);
+    BOOST_FOREACH(const auto& stored_entry, stored_entries) {
+        bind(stmt_delete, int, 1, stored_entry.first);
+        stepStmt(playlists_db_, stmt_delete);
+    }
 #undef bind
 #undef bindText
+
+    AIMP_LOG_SEV(logger(), debug) << "loadEntries: playlist " << playlist_id << ": inserted " << inserted_count
+                                   << ", updated " << updated_count << ", deleted " << stored_entries.size();
 }
 
 void AIMPManager30::startPlayback()
@@ -1224,7 +1325,7 @@ std::string AIMPManager30::getAIMPVersion() const
     HRESULT r = aimp3_core_unit_->GetVersion(&version_info);
 
     if (S_OK != r) {
-        BOOST_LOG_SEV(logger(), error) << "IAIMPCoreUnit::GetVersion returned " << r;
+        AIMP_LOG_SEV(logger(), error) << "IAIMPCoreUnit::GetVersion returned " << r;
         return "";
     }
     
@@ -1325,7 +1426,7 @@ AIMPManager30::PLAYBACK_STATE AIMPManager30::getPlaybackState() const
         break;
     default:
         assert(!"getStatus(STATUS_Player) returned unknown value");
-        BOOST_LOG_SEV(logger(), error) << "getStatus(STATUS_Player) returned unknown value " << internal_state;
+        AIMP_LOG_SEV(logger(), error) << "getStatus(STATUS_Player) returned unknown value " << internal_state;
     }
 
     return state;
@@ -1366,11 +1467,20 @@ void AIMPManager30::saveCoverToFile(TrackDescription track_desc, const std::wstr
         cover->saveToFile(filename);
     } catch (std::exception& e) {
         const std::string& str = MakeString() << "Error occured while cover saving to file for " << track_desc << ". Reason: " << e.what();
-        BOOST_LOG_SEV(logger(), error) << str;
+        AIMP_LOG_SEV(logger(), error) << str;
         throw std::runtime_error(str);
     }
 }
 
+std::auto_ptr<ImageUtils::AIMPCoverImage> AIMPManager30::getCoverImage(TrackDescription track_desc) const // throw std::runtime_error
+{
+    try {
+        return getCoverImage(getAbsoluteTrackDesc(track_desc), 0, 0);
+    } catch (std::invalid_argument& e) {
+        throw std::runtime_error( e.what() );
+    }
+}
+
 std::auto_ptr<ImageUtils::AIMPCoverImage> AIMPManager30::getCoverImage(TrackDescription track_desc, int cover_width, int cover_height) const
 {
     if (cover_width < 0 || cover_height < 0) {
@@ -1403,8 +1513,10 @@ std::auto_ptr<ImageUtils::AIMPCoverImage> AIMPManager30::getCoverImage(TrackDesc
             cover_size.cy = cover_height;
         }
 
-        cover_bitmap_handle = aimp3_coverart_manager_->CoverArtGetForFile(const_cast<PWCHAR>( entry_filename.c_str() ), &cover_size,
-			                                                              nullptr, 0);
+        if (cover_size.cx != cover_full_size.cx || cover_size.cy != cover_full_size.cy) { // do not decode cover twice if original size is requested.
+            cover_bitmap_handle = aimp3_coverart_manager_->CoverArtGetForFile(const_cast<PWCHAR>( entry_filename.c_str() ), &cover_size,
+			                                                                  nullptr, 0);
+        }
     }
 
     using namespace ImageUtils;
@@ -1599,6 +1711,7 @@ void AIMPManager30::initPlaylistDB() // throws std::runtime_error
     int rc = sqlite3_open(":memory:", &playlists_db_);
     THROW_IF_NOT_OK_WITH_MSG( rc, MakeString() << "Playlist database creation failure. Reason: sqlite3_open error "
                                                << rc << ": " << sqlite3_errmsg(playlists_db_) );
+    playlists_db_stmt_cache_.attach(playlists_db_);
 
     { // add case-insensitivity support to LIKE operator (used for search tracks) since default LIKE operator since it supports case-insensitive search only on ASCII chars by default).
     rc = sqlite3_unicode_init(playlists_db_);
@@ -1636,6 +1749,29 @@ void AIMPManager30::initPlaylistDB() // throws std::runtime_error
                                                << rc << ": " << errmsg );
     }
 
+    { // create index for entries of playlist: all entries queries filter by playlist_id and by default order by entry_index.
+    char* errmsg = nullptr;
+    ON_BLOCK_EXIT(&sqlite3_free, errmsg);
+    rc = sqlite3_exec(playlists_db_,
+                      "CREATE INDEX PlaylistsEntriesPlaylistIndex ON PlaylistsEntries (playlist_id, entry_index)",
+                      nullptr, /* Callback function */
+                      nullptr, /* 1st argument to callback */
+                      &errmsg
+                      );
+    THROW_IF_NOT_OK_WITH_MSG( rc, MakeString() << "Playlist content index creation failure. Reason: sqlite3_exec(create index) error "
+                                               << rc << ": " << errmsg );
+    }
+
+    { // create full text search index for entries. It is optional: search falls back to LIKE operator if index is not available.
+    try {
+        createEntriesSearchIndex(playlists_db_);
+        entries_search_index_available_ = true;
+    } catch (std::exception& e) {
+        entries_search_index_available_ = false;
+        AIMP_LOG_SEV(logger(), warning) << "Entries search index is not available, slow search will be used. Reason: " << e.what();
+    }
+    }
+
     { // create table for playlist.
     char* errmsg = nullptr;
     ON_BLOCK_EXIT(&sqlite3_free, errmsg);
@@ -1661,9 +1797,10 @@ void AIMPManager30::initPlaylistDB() // throws std::runtime_error
 
 void AIMPManager30::shutdownPlaylistDB()
 {
+    playlists_db_stmt_cache_.clear(); // all statements must be finalized before closing DB.
     const int rc = sqlite3_close(playlists_db_);
     if (SQLITE_OK != rc) {
-        BOOST_LOG_SEV(logger(), error) << "sqlite3_close error: " << rc;
+        AIMP_LOG_SEV(logger(), error) << "sqlite3_close error: " << rc;
     }
     playlists_db_ = nullptr;
 }
@@ -1680,7 +1817,7 @@ void executeQuery(const std::string& query, sqlite3* db, const char* log_tag)
                                 &errmsg
                                 );
     if (SQLITE_OK != rc) {
-        BOOST_LOG_SEV(logger(), error) << log_tag << " failed. Reason: sqlite3_exec() error "
+        AIMP_LOG_SEV(logger(), error) << log_tag << " failed. Reason: sqlite3_exec() error "
                                        << rc << ": " << errmsg 
                                        << ". Query: " << query;
         sqlite3_free(errmsg);
@@ -1699,9 +1836,17 @@ void AIMPManager30::deletePlaylistFromPlaylistDB(PlaylistID playlist_id)
 
 void AIMPManager30::deletePlaylistEntriesFromPlaylistDB(PlaylistID playlist_id)
 {
-    const std::string query = MakeString() << "DELETE FROM PlaylistsEntries WHERE playlist_id=" << playlist_id;
-
-    executeQuery(query, playlists_db_, __FUNCTION__);
+    // On error it prints error reason to log only, like executeQuery().
+    try {
+        sqlite3_stmt* stmt = playlists_db_stmt_cache_.get("DELETE FROM PlaylistsEntries WHERE playlist_id=?");
+        const int rc_db = sqlite3_bind_int(stmt, 1, playlist_id);
+        if (SQLITE_OK != rc_db) {
+            throw std::runtime_error(MakeString() << "Error sqlite3_bind_int " << rc_db);
+        }
+        stepStmt(playlists_db_, stmt);
+    } catch (std::exception& e) {
+        AIMP_LOG_SEV(logger(), error) << __FUNCTION__ << " failed. Reason: " << e.what();
+    }
 }
 
 void AIMPManager30::addFileToPlaylist(const boost::filesystem::wpath& path, PlaylistID playlist_id) // throws std::runtime_error
@@ -1802,7 +1947,7 @@ void AIMPManager30::removeTrack(TrackDescription track_desc, bool physically) //
             fs::remove(filename_to_delete, ec);
             if (ec) {
                 std::string msg = MakeString() << "boost::filesystem::remove() failed. Result " << ec << ". Filename: " << StringEncoding::utf16_to_utf8(filename_to_delete.native());
-                BOOST_LOG_SEV(logger(), error) << "AIMPManager30::removeTrack error: " << msg;
+                AIMP_LOG_SEV(logger(), error) << "AIMPManager30::removeTrack error: " << msg;
                 throw std::runtime_error(msg);
             }
         }
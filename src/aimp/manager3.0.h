@@ -83,6 +83,8 @@ public:
     virtual bool isCoverImageFileExist(TrackDescription track_desc, boost::filesystem::wpath* path = nullptr) const;
 
     virtual void saveCoverToFile(TrackDescription track_desc, const std::wstring& filename, int cover_width = 0, int cover_height = 0) const; // throw std::runtime_error
+
+    virtual std::auto_ptr<ImageUtils::AIMPCoverImage> getCoverImage(TrackDescription track_desc) const; // throw std::runtime_error
     
     virtual EventsListenerID registerListener(EventsListener listener);
 
@@ -120,6 +122,14 @@ public:
     sqlite3* playlists_db() const
         { return playlists_db_; }
 
+    //! Finalizes cached prepared statements of playlists DB. Must be called after schema of DB was changed outside of manager.
+    void onPlaylistsDBSchemaChanged()
+        { playlists_db_stmt_cache_.clear(); }
+
+    //! Returns true if full text search index of entries is created. See createEntriesSearchIndex().
+    bool entries_search_index_available() const
+        { return entries_search_index_available_; }
+
 private:
 
     void onAimpCoreMessage(DWORD AMessage, int AParam1, void *AParam2, HRESULT *AResult);
@@ -151,10 +161,13 @@ private:
 
     /*!
         \brief Loads playlist entries from AIMP.
+               Should be called inside transaction since it can modify many rows.
+        \param entries_crc32 - receives crc32 of each entry in playlist order, see PlaylistCRC32::set_crc32_entries().
+                              It must be applied to playlist crc32 only after transaction is committed.
         \throw std::invalid_argument if playlist with specified ID does not exist.
         \throw std::runtime_error if error occured while loading entries data.
     */
-    void loadEntries(PlaylistID playlist_id); // throws std::runtime_error
+    void loadEntries(PlaylistID playlist_id, std::vector<crc32_t>* entries_crc32); // throws std::runtime_error
 
     //! Loads playlist by AIMP internal index.
     void loadPlaylist(int playlist_index); // throws std::runtime_error
@@ -192,6 +205,10 @@ private:
 protected:
     sqlite3* playlists_db_;
 
+    Utilities::StatementCache playlists_db_stmt_cache_; //!< prepared statements of frequently executed playlists_db_ queries.
+
+    bool entries_search_index_available_;
+
 private:
     
     PlaylistCRC32& getPlaylistCRC32Object(PlaylistID playlist_id) const; // throws std::runtime_error
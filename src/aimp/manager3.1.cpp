@@ -275,7 +275,7 @@ void executeQuery(const std::string& query, sqlite3* db, const char* log_tag)
                                 &errmsg
                                 );
     if (SQLITE_OK != rc) {
-        BOOST_LOG_SEV(logger(), error) << log_tag << " failed. Reason: sqlite3_exec() error "
+        AIMP_LOG_SEV(logger(), error) << log_tag << " failed. Reason: sqlite3_exec() error "
                                        << rc << ": " << errmsg 
                                        << ". Query: " << query;
         sqlite3_free(errmsg);
@@ -100,6 +100,85 @@ inline size_t getEntriesCountDB(PlaylistID playlist_id, sqlite3* playlists_db)
     return total_entries_count;
 }
 
+//! Name of full text search table which indexes text fields of PlaylistsEntries. Index docid is rowid of PlaylistsEntries.
+const char* const kENTRIES_SEARCH_INDEX_TABLE = "PlaylistsEntriesSearchIndex";
+
+/*!
+    \brief Creates FTS4 index over title, artist, album, date and genre of PlaylistsEntries table.
+           Index is kept in sync with table by triggers, so entries loaders do not need to care about it.
+    \remark Throws if sqlite3 library is built without FTS4 or unicode61 tokenizer. Search should fall back to LIKE operator in this case.
+*/
+inline void createEntriesSearchIndex(sqlite3* db) // throws std::runtime_error
+{
+    using namespace Utilities;
+
+    const char* const queries[] = {
+        // REPLACE INTO deletes old row implicitly, delete trigger is fired for such rows only if recursive triggers are enabled.
+        "PRAGMA recursive_triggers = ON",
+        // unicode61 tokenizer folds case of non-ASCII chars like sqlite3_unicode's LIKE does.
+        "CREATE VIRTUAL TABLE PlaylistsEntriesSearchIndex USING fts4(title, artist, album, date, genre, tokenize=unicode61)",
+        "CREATE TRIGGER PlaylistsEntriesSearchIndexInsert AFTER INSERT ON PlaylistsEntries BEGIN "
+            "INSERT INTO PlaylistsEntriesSearchIndex(docid, title, artist, album, date, genre) VALUES (new.rowid, new.title, new.artist, new.album, new.date, new.genre); "
+        "END",
+        "CREATE TRIGGER PlaylistsEntriesSearchIndexDelete AFTER DELETE ON PlaylistsEntries BEGIN "
+            "DELETE FROM PlaylistsEntriesSearchIndex WHERE docid=old.rowid; "
+        "END",
+        "CREATE TRIGGER PlaylistsEntriesSearchIndexUpdate AFTER UPDATE OF title, artist, album, date, genre ON PlaylistsEntries BEGIN "
+            "UPDATE PlaylistsEntriesSearchIndex SET title=new.title, artist=new.artist, album=new.album, date=new.date, genre=new.genre WHERE docid=new.rowid; "
+        "END"
+    };
+
+    for (size_t i = 0; i != sizeof(queries) / sizeof(queries[0]); ++i) {
+        char* errmsg = nullptr;
+        ON_BLOCK_EXIT(&sqlite3_free, errmsg);
+        const int rc = sqlite3_exec(db, queries[i], nullptr, nullptr, &errmsg);
+        if (SQLITE_OK != rc) {
+            const std::string msg = MakeString() << "Search index creation failure. Reason: sqlite3_exec() error "
+                                                 << rc << ": " << (errmsg ? errmsg : "")
+                                                 << ". Query: " << queries[i];
+            throw std::runtime_error(msg);
+        }
+    }
+}
+
+/*!
+    \brief Converts user's search string to FTS MATCH expression.
+           Each word of search string is searched as prefix of word in any indexed field, all words must be found.
+    \return empty string if search string does not contain words.
+*/
+inline std::string makeEntriesSearchIndexQuery(const std::string& search_string)
+{
+    std::string result;
+    std::string token;
+    for (size_t i = 0, end = search_string.size(); i <= end; ++i) {
+        const char c = i < end ? search_string[i] : ' ';
+        if (c == ' ' || c == '\t') {
+            if ( !token.empty() ) {
+                if ( !result.empty() ) {
+                    result += ' ';
+                }
+                // quote token to prevent interpretation of FTS operators(OR, NEAR, -, etc.) in user input.
+                result += '"';
+                result += token;
+                result += "*\"";
+                token.clear();
+            }
+        } else if (c != '"') {
+            token += c;
+        }
+    }
+    return result;
+}
+
+inline bool isEntriesSearchIndexAvailable(const AIMPPlayer::AIMPManager& aimp_manager) {
+    if (       const AIMPPlayer::AIMPManager30* mgr3 = dynamic_cast<const AIMPPlayer::AIMPManager30*>(&aimp_manager) ) {
+        return mgr3->entries_search_index_available();
+    } else if (const AIMPPlayer::AIMPManager26* mgr2 = dynamic_cast<const AIMPPlayer::AIMPManager26*>(&aimp_manager) ) {
+        return mgr2->entries_search_index_available();
+    }
+    return false;
+}
+
 inline sqlite3* getPlaylistsDB(const AIMPPlayer::AIMPManager& aimp_manager) {
     if (       const AIMPPlayer::AIMPManager30* mgr3 = dynamic_cast<const AIMPPlayer::AIMPManager30*>(&aimp_manager) ) {
         return mgr3->playlists_db();
@@ -112,4 +191,13 @@ inline sqlite3* getPlaylistsDB(const AIMPPlayer::AIMPManager& aimp_manager) {
     }
 }
 
+//! Drops prepared statements which were cached by manager for playlists DB. Call it after DDL queries.
+inline void onPlaylistsDBSchemaChanged(AIMPPlayer::AIMPManager& aimp_manager) {
+    if (       AIMPPlayer::AIMPManager30* mgr3 = dynamic_cast<AIMPPlayer::AIMPManager30*>(&aimp_manager) ) {
+        mgr3->onPlaylistsDBSchemaChanged();
+    } else if (AIMPPlayer::AIMPManager26* mgr2 = dynamic_cast<AIMPPlayer::AIMPManager26*>(&aimp_manager) ) {
+        mgr2->onPlaylistsDBSchemaChanged();
+    }
+}
+
 } // namespace AIMPPlayer
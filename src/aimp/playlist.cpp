@@ -83,6 +83,17 @@ crc32_t PlaylistCRC32::calc_crc32_properties()
 
 crc32_t crc32_entry(sqlite3_stmt* stmt);
 
+void PlaylistCRC32::set_crc32_entries(const std::vector<crc32_t>& entries_crc32_list)
+{
+    boost::crc_32_type crc32_calculator;
+    if ( !entries_crc32_list.empty() ) {
+        crc32_calculator.process_bytes( &entries_crc32_list[0], entries_crc32_list.size() * sizeof(entries_crc32_list[0]) );
+    }
+
+    crc32_entries_ = crc32_calculator.checksum();
+    crc32_total_ = kCRC32_UNINITIALIZED;
+}
+
 crc32_t PlaylistCRC32::calc_crc32_entries()
 {
     using namespace Utilities;
@@ -90,7 +101,8 @@ crc32_t PlaylistCRC32::calc_crc32_entries()
     std::ostringstream query;
     query << "SELECT "
           << "album, artist, date, filename, genre, title, bitrate, channels_count, duration, filesize, rating, samplerate"
-          << " FROM PlaylistsEntries WHERE playlist_id=" << playlist_id_;
+          << " FROM PlaylistsEntries WHERE playlist_id=" << playlist_id_
+          << " ORDER BY entry_index"; // set_crc32_entries() relies on this order. Order is included in crc32 since moving of entries changes representation of playlist.
 
     sqlite3* db = playlist_db_;
     sqlite3_stmt* stmt = createStmt( db, query.str() );
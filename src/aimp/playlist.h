@@ -34,6 +34,12 @@ public:
     void reset_properties()
         { crc32_total_ = crc32_properties_ = kCRC32_UNINITIALIZED; }
 
+    /*!
+        \brief Sets entries crc32 which was calculated by entries loader, so there is no need to recalculate it by DB data.
+        \param entries_crc32_list - crc32 of each entry, list is ordered by entry index. See calc_crc32_entries().
+    */
+    void set_crc32_entries(const std::vector<crc32_t>& entries_crc32_list);
+
 private:
     crc32_t calc_crc32_properties();
     crc32_t calc_crc32_entries();
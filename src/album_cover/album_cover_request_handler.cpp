@@ -0,0 +1,141 @@
+// Copyright (c) 2014, Alexey Ivanov
+
+#include "stdafx.h"
+#include "request_handler.h"
+#include "cover_provider.h"
+#include "aimp/manager.h"
+#include "http_server/reply.h"
+#include "http_server/request.h"
+#include "http_server/mime_types.h"
+#include "http_server/file_reply.h"
+#include "plugin/logger.h"
+#include "utils/string_encoding.h"
+#include <boost/algorithm/string.hpp>
+#include <boost/bind.hpp>
+#include <boost/lexical_cast.hpp>
+#include <vector>
+
+namespace {
+using namespace ControlPlugin::PluginLogger;
+ModuleLoggerType& logger()
+    { return getLogManager().getModuleLogger<Http::Server>(); }
+}
+
+namespace AlbumCover
+{
+
+using namespace AIMPPlayer;
+
+namespace
+{
+
+const std::string kALBUM_COVER_TAG("/cover/");
+const unsigned int kMAX_ALBUMCOVER_SIZE = 2000; // the same limit as in GetCover RPC method.
+
+struct CoverRequest
+{
+    TrackDescription track_desc;
+    unsigned int width, height;
+    CoverRequest() : track_desc(0, 0), width(0), height(0) {}
+};
+
+//! Parses "/cover/<playlist_id>/<track_id>/<width>x<height>" URI, query is ignored. \throw std::runtime_error if URI is invalid.
+CoverRequest parseRequestUri(const std::string& request_uri)
+{
+    const std::string path = request_uri.substr( kALBUM_COVER_TAG.length(), request_uri.find('?') - kALBUM_COVER_TAG.length() );
+    std::vector<std::string> parts;
+    boost::split( parts, path, boost::is_any_of("/") );
+    if ( parts.size() == 3 && parts.back().empty() ) { // trailing slash.
+        parts.pop_back();
+    }
+    if (parts.size() != 2 && parts.size() != 3) {
+        throw std::runtime_error("unexpected format of album cover URI");
+    }
+
+    CoverRequest result;
+    try {
+        result.track_desc = TrackDescription( boost::lexical_cast<PlaylistID>(parts[0]),
+                                              boost::lexical_cast<PlaylistEntryID>(parts[1])
+                                             );
+        if (parts.size() == 3) {
+            const size_t x_pos = parts[2].find('x');
+            if (x_pos == std::string::npos) {
+                throw std::runtime_error("can't extract album cover size");
+            }
+            result.width = boost::lexical_cast<unsigned int>( parts[2].substr(0, x_pos) );
+            result.height = boost::lexical_cast<unsigned int>( parts[2].substr(x_pos + 1) );
+        }
+    } catch (boost::bad_lexical_cast&) {
+        throw std::runtime_error("can't extract playlist_id, track_id or size from album cover URI");
+    }
+
+    if (result.width > kMAX_ALBUMCOVER_SIZE || result.height > kMAX_ALBUMCOVER_SIZE) {
+        throw std::runtime_error("album cover size is too big");
+    }
+    return result;
+}
+
+} // namespace
+
+bool RequestHandler::handle_request(const Http::Request& req, Http::Reply& rep, Http::DelayedResponseSender_ptr delayed_response_sender)
+{
+    using namespace Http;
+
+    if (req.method != "GET") {
+        rep = Reply::stock_reply(Reply::not_implemented);
+        return true;
+    }
+
+    try {
+        const CoverRequest cover_request = parseRequestUri(req.uri);
+        const TrackDescription track_desc( aimp_manager_.getAbsoluteTrackDesc(cover_request.track_desc) );
+
+        std::wstring name;
+        if ( !cover_provider_.getCover( track_desc, cover_request.width, cover_request.height, &name,
+                                        boost::bind(&RequestHandler::onCoverRendered, this, req, delayed_response_sender, _1, _2)
+                                       )
+            )
+        {
+            return false; // response will be sent when cover is rendered.
+        }
+
+        fillCoverReply(req, name, rep);
+    } catch (std::exception& e) {
+        AIMP_LOG_SEV(logger(), debug) << "Album cover request " << req.uri << " failed. Reason: " << e.what();
+        rep = Reply::stock_reply(Reply::not_found);
+    }
+    return true;
+}
+
+void RequestHandler::onCoverRendered(RequestHandler* handler, const Http::Request& req, Http::DelayedResponseSender_ptr delayed_response_sender,
+                                     const std::wstring& name, const std::string& error)
+{
+    Http::Reply& rep = delayed_response_sender->get_reply();
+    if ( error.empty() ) {
+        handler->fillCoverReply(req, name, rep);
+    } else {
+        rep = Http::Reply::stock_reply(Http::Reply::not_found);
+    }
+    delayed_response_sender->sendReply();
+}
+
+void RequestHandler::fillCoverReply(const Http::Request& req, const std::wstring& name, Http::Reply& rep)
+{
+    using namespace Http;
+
+    std::time_t last_modified = 0;
+    const CoverCache::Content content = cover_provider_.cache().get(name, &last_modified);
+    if (!content) {
+        rep = Reply::stock_reply(Reply::not_found);
+        return;
+    }
+
+    // name of cover is hash of source and size, so it identifies content and serves as strong entity tag.
+    const std::string name_utf8 = StringEncoding::utf16_to_utf8(name);
+    const size_t dot_pos = name_utf8.find_last_of('.');
+    const std::string extension = dot_pos != std::string::npos ? boost::algorithm::to_lower_copy( name_utf8.substr(dot_pos) )
+                                                               : std::string();
+    fillContentReply( req, content, '"' + name_utf8 + '"', last_modified, mime_types::extension_to_type(extension), rep );
+}
+
+} // namespace AlbumCover
@@ -0,0 +1,235 @@
+// Copyright (c) 2014, Alexey Ivanov
+
+#include "stdafx.h"
+#include "cover_cache.h"
+#include "plugin/logger.h"
+#include "utils/string_encoding.h"
+#include "utils/util.h"
+#include <boost/filesystem/fstream.hpp>
+#include <boost/foreach.hpp>
+#include <algorithm>
+#include <iterator>
+#include <sstream>
+#include <vector>
+
+namespace {
+using namespace ControlPlugin::PluginLogger;
+ModuleLoggerType& logger()
+    { return getLogManager().getModuleLogger<Rpc::RequestHandler>(); }
+}
+
+namespace AlbumCover
+{
+
+namespace fs = boost::filesystem;
+
+namespace
+{
+
+const wchar_t kTEMP_FILE_EXTENSION[] = L".tmp";
+
+} // namespace
+
+CoverCache::CoverCache(const fs::wpath& directory, size_t memory_limit, size_t disk_limit)
+    :
+    directory_(directory),
+    memory_limit_(memory_limit),
+    disk_limit_(disk_limit),
+    disk_size_(0),
+    memory_size_(0)
+{
+    loadIndex();
+}
+
+std::wstring CoverCache::makeName(const std::string& source_hash, unsigned int width, unsigned int height, const std::wstring& extension)
+{
+    std::wostringstream name;
+    name << std::wstring( source_hash.begin(), source_hash.end() ) << L'_' << width << L'x' << height << extension;
+    return name.str();
+}
+
+void CoverCache::loadIndex()
+{
+    using namespace Utilities;
+
+    struct File {
+        std::time_t last_write_time;
+        std::wstring name;
+        size_t size;
+        bool operator<(const File& rhs) const
+            { return last_write_time < rhs.last_write_time; }
+    };
+    std::vector<File> files;
+
+    try {
+        if ( !fs::exists(directory_) ) {
+            fs::create_directories(directory_);
+        }
+
+        for (fs::directory_iterator it(directory_), end; it != end; ++it) {
+            const fs::wpath& path = it->path();
+            if ( !fs::is_regular_file(path) ) {
+                continue;
+            }
+            if (path.extension() == kTEMP_FILE_EXTENSION) {
+                boost::system::error_code ignored_ec;
+                fs::remove(path, ignored_ec); // file was not completely written before restart.
+                continue;
+            }
+            const File file = { fs::last_write_time(path), path.filename().native(), static_cast<size_t>( fs::file_size(path) ) };
+            files.push_back(file);
+        }
+    } catch (fs::filesystem_error& e) {
+        throw std::runtime_error( MakeString() << "album cover cache directory preparation failure. Reason: " << e.what() );
+    }
+
+    std::sort( files.begin(), files.end() );
+
+    boost::mutex::scoped_lock lock(mutex_);
+    BOOST_FOREACH(const File& file, files) {
+        addDiskEntry(file.name, file.size, file.last_write_time); // the newest file becomes most recently used.
+    }
+    evict();
+
+    AIMP_LOG_SEV(logger(), info) << "Album cover cache contains " << disk_entries_.size() << " files of total size " << disk_size_ << " bytes.";
+}
+
+bool CoverCache::contains(const std::wstring& name)
+{
+    boost::mutex::scoped_lock lock(mutex_);
+    const auto entry_it = disk_entries_.find(name);
+    if ( entry_it == disk_entries_.end() ) {
+        return false;
+    }
+    disk_lru_.splice(disk_lru_.begin(), disk_lru_, entry_it->second.lru_position);
+    return true;
+}
+
+CoverCache::Content CoverCache::get(const std::wstring& name, std::time_t* last_modified)
+{
+    {
+    boost::mutex::scoped_lock lock(mutex_);
+    const auto disk_entry_it = disk_entries_.find(name);
+    if ( disk_entry_it == disk_entries_.end() ) {
+        return Content();
+    }
+    disk_lru_.splice(disk_lru_.begin(), disk_lru_, disk_entry_it->second.lru_position);
+    if (last_modified) {
+        *last_modified = disk_entry_it->second.last_write_time;
+    }
+
+    const auto memory_entry_it = memory_entries_.find(name);
+    if ( memory_entry_it != memory_entries_.end() ) {
+        memory_lru_.splice(memory_lru_.begin(), memory_lru_, memory_entry_it->second.lru_position);
+        return memory_entry_it->second.content;
+    }
+    }
+
+    // read file outside of lock, other covers can be served meanwhile.
+    fs::ifstream file(directory_ / name, std::ios::in | std::ios::binary);
+    Content content( new std::string( (std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>() ) );
+    if ( !file.is_open() || file.bad() ) {
+        return Content(); // file was evicted meanwhile.
+    }
+
+    boost::mutex::scoped_lock lock(mutex_);
+    if ( disk_entries_.find(name) != disk_entries_.end() && memory_entries_.find(name) == memory_entries_.end() ) {
+        addMemoryEntry(name, content);
+        evict();
+    }
+    return content;
+}
+
+void CoverCache::put(const std::wstring& name, Content content)
+{
+    using namespace Utilities;
+
+    // write to temp file first: clients must never get partially written cover.
+    const fs::wpath path = directory_ / name;
+    const fs::wpath temp_path = directory_ / ( name + fs::unique_path(L".%%%%%%%%").native() + kTEMP_FILE_EXTENSION ); // unique since the same cover can be rendered concurrently.
+    {
+    fs::ofstream file(temp_path, std::ios::out | std::ios::binary | std::ios::trunc);
+    if ( !file.write( content->data(), content->size() ) ) {
+        file.close();
+        boost::system::error_code ignored_ec;
+        fs::remove(temp_path, ignored_ec);
+        throw std::runtime_error( MakeString() << "Failed to write album cover file " << StringEncoding::utf16_to_utf8( temp_path.native() ) );
+    }
+    }
+
+    boost::mutex::scoped_lock lock(mutex_);
+
+    try {
+        fs::rename(temp_path, path);
+    } catch (fs::filesystem_error& e) {
+        boost::system::error_code ignored_ec;
+        fs::remove(temp_path, ignored_ec);
+        throw std::runtime_error( MakeString() << "Failed to store album cover file. Reason: " << e.what() );
+    }
+
+    const auto disk_entry_it = disk_entries_.find(name);
+    if ( disk_entry_it != disk_entries_.end() ) { // cover was rendered concurrently, replace it.
+        disk_size_ -= disk_entry_it->second.size;
+        disk_lru_.erase(disk_entry_it->second.lru_position);
+        disk_entries_.erase(disk_entry_it);
+        removeMemoryEntry(name);
+    }
+    addDiskEntry( name, content->size(), std::time(nullptr) );
+    addMemoryEntry(name, content);
+    evict();
+}
+
+void CoverCache::addDiskEntry(const std::wstring& name, size_t size, std::time_t last_write_time)
+{
+    disk_lru_.push_front(name);
+    const DiskEntry entry = { size, last_write_time, disk_lru_.begin() };
+    disk_entries_[name] = entry;
+    disk_size_ += size;
+}
+
+void CoverCache::addMemoryEntry(const std::wstring& name, Content content)
+{
+    if (content->size() > memory_limit_) {
+        return; // does not fit anyway.
+    }
+    memory_lru_.push_front(name);
+    const MemoryEntry entry = { content, memory_lru_.begin() };
+    memory_entries_[name] = entry;
+    memory_size_ += content->size();
+}
+
+void CoverCache::removeMemoryEntry(const std::wstring& name)
+{
+    const auto entry_it = memory_entries_.find(name);
+    if ( entry_it != memory_entries_.end() ) {
+        memory_size_ -= entry_it->second.content->size();
+        memory_lru_.erase(entry_it->second.lru_position);
+        memory_entries_.erase(entry_it);
+    }
+}
+
+void CoverCache::evict()
+{
+    while (memory_size_ > memory_limit_ && !memory_lru_.empty()) {
+        removeMemoryEntry( memory_lru_.back() );
+    }
+
+    // most recently used file is never evicted, its URI was just returned to client.
+    while (disk_size_ > disk_limit_ && disk_lru_.size() > 1) {
+        const std::wstring name = disk_lru_.back();
+        const auto entry_it = disk_entries_.find(name);
+        assert( entry_it != disk_entries_.end() );
+        disk_size_ -= entry_it->second.size;
+        disk_lru_.pop_back();
+        disk_entries_.erase(entry_it);
+        removeMemoryEntry(name);
+
+        boost::system::error_code ec;
+        fs::remove(directory_ / name, ec);
+        if (ec) {
+            AIMP_LOG_SEV(logger(), warning) << "Failed to remove evicted album cover file " << StringEncoding::utf16_to_utf8(name) << ". Reason: " << ec;
+        }
+    }
+}
+
+} // namespace AlbumCover
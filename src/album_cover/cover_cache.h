@@ -0,0 +1,100 @@
+// Copyright (c) 2014, Alexey Ivanov
+
+#pragma once
+
+#include <boost/filesystem.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <ctime>
+#include <list>
+#include <map>
+#include <memory>
+#include <string>
+
+namespace AlbumCover
+{
+
+/*!
+    \brief Content-addressed store of encoded album covers.
+           Name of cover is built from hash of source image pixels and target size, so tracks which share album cover
+           share its scaled variants too. Covers are kept as files in cache directory(clients get them by URI)
+           and most recently used ones are also kept in memory. Both tiers are bounded and evict least recently used covers.
+           Files survive plugin restart: index is rebuilt from cache directory on creation.
+           All methods are thread safe.
+*/
+class CoverCache : boost::noncopyable
+{
+public:
+
+    typedef std::shared_ptr<const std::string> Content;
+
+    /*!
+        \param directory - cache directory, it is created if it does not exist.
+        \param memory_limit - max total size of covers in memory, zero disables memory tier.
+        \param disk_limit - max total size of cover files.
+    */
+    CoverCache(const boost::filesystem::wpath& directory, size_t memory_limit, size_t disk_limit); // throws std::runtime_error
+
+    //! Returns name of cover file: "<source hash>_<width>x<height><extension>".
+    static std::wstring makeName(const std::string& source_hash, unsigned int width, unsigned int height, const std::wstring& extension = L".jpg");
+
+    const boost::filesystem::wpath& directory() const
+        { return directory_; }
+
+    //! Returns true if cover file exists. Cover becomes most recently used.
+    bool contains(const std::wstring& name);
+
+    /*!
+        \brief Returns content of cover, it is loaded from file if it is not in memory. Returns null if cover does not exist.
+        \param last_modified - receives time when cover was stored, optional.
+    */
+    Content get(const std::wstring& name, std::time_t* last_modified = nullptr);
+
+    /*!
+        \brief Stores cover in file and in memory. Least recently used covers are evicted if limits are exceeded.
+        \throw std::runtime_error if file can not be written.
+    */
+    void put(const std::wstring& name, Content content); // throws std::runtime_error
+
+private:
+
+    typedef std::list<std::wstring> LruList; //!< most recently used names are at front.
+
+    struct DiskEntry
+    {
+        size_t size;
+        std::time_t last_write_time;
+        LruList::iterator lru_position;
+    };
+
+    struct MemoryEntry
+    {
+        Content content;
+        LruList::iterator lru_position;
+    };
+
+    void loadIndex(); // throws std::runtime_error
+
+    //! Following functions must be called under lock.
+    void addDiskEntry(const std::wstring& name, size_t size, std::time_t last_write_time);
+    void addMemoryEntry(const std::wstring& name, Content content);
+    void removeMemoryEntry(const std::wstring& name);
+    //! Removes least recently used entries over limits. Files are removed under lock, so put() of the same name can not race with removal.
+    void evict();
+
+    const boost::filesystem::wpath directory_;
+    const size_t memory_limit_;
+    const size_t disk_limit_;
+
+    boost::mutex mutex_;
+
+    std::map<std::wstring, DiskEntry> disk_entries_;
+    LruList disk_lru_;
+    size_t disk_size_;
+
+    std::map<std::wstring, MemoryEntry> memory_entries_;
+    LruList memory_lru_;
+    size_t memory_size_;
+};
+
+} // namespace AlbumCover
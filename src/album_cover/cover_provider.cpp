@@ -0,0 +1,225 @@
+// Copyright (c) 2014, Alexey Ivanov
+
+#include "stdafx.h"
+#include "cover_provider.h"
+#include "plugin/control_plugin.h"
+#include "plugin/logger.h"
+#include "plugin/settings.h"
+#include "utils/image.h"
+#include "utils/string_encoding.h"
+#include "utils/util.h"
+#include <boost/bind.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <boost/foreach.hpp>
+#include <boost/make_shared.hpp>
+#include <algorithm>
+#include <iterator>
+#include <sstream>
+
+namespace {
+using namespace ControlPlugin::PluginLogger;
+ModuleLoggerType& logger()
+    { return getLogManager().getModuleLogger<Rpc::RequestHandler>(); }
+}
+
+namespace AlbumCover
+{
+
+using namespace AIMPPlayer;
+namespace fs = boost::filesystem;
+
+namespace
+{
+
+const size_t kMAX_SOURCE_HASHES_COUNT = 4096; // memo is cleared when it grows over this count.
+
+ImageUtils::EncodingOptions encodingOptionsFromSettings()
+{
+    const ControlPlugin::PluginSettings::Settings::AlbumCovers& settings = ControlPlugin::AIMPControlPlugin::settings().album_covers;
+    ImageUtils::EncodingOptions options;
+    options.jpeg_quality = settings.jpeg_quality;
+    options.progressive_jpeg = settings.progressive_jpeg;
+    return options;
+}
+
+} // namespace
+
+CoverProvider::CoverProvider(AIMPManager& aimp_manager,
+                             ControlPlugin::PlayerThreadDispatcher& player_thread_dispatcher,
+                             const fs::wpath& cover_directory,
+                             bool free_image_dll_is_available
+                             )
+    :
+    aimp_manager_(aimp_manager),
+    free_image_dll_is_available_(free_image_dll_is_available),
+    cache_( cover_directory,
+            ControlPlugin::AIMPControlPlugin::settings().album_covers.memory_cache_size,
+            ControlPlugin::AIMPControlPlugin::settings().album_covers.disk_cache_size
+           ),
+    renderer_( cache_,
+               player_thread_dispatcher,
+               ControlPlugin::AIMPControlPlugin::settings().album_covers.resize_threads_count,
+               encodingOptionsFromSettings(),
+               ControlPlugin::AIMPControlPlugin::settings().album_covers.fast_downscaling ? ImageUtils::AREA_FILTER : ImageUtils::BICUBIC_FILTER
+              ),
+    source_hashes_( boost::make_shared<SourceHashes>() )
+{
+    BOOST_FOREACH(const auto& size, ControlPlugin::AIMPControlPlugin::settings().album_covers.pregenerated_sizes) {
+        pregenerated_sizes_.push_back( CoverRenderer::Size(size.width, size.height) );
+    }
+
+    aimp_events_listener_id_ = aimp_manager_.registerListener( boost::bind(&CoverProvider::aimpEventHandler,
+                                                                           this,
+                                                                           _1
+                                                                           )
+                                                              );
+}
+
+CoverProvider::~CoverProvider()
+{
+    aimp_manager_.unRegisterListener(aimp_events_listener_id_);
+}
+
+bool CoverProvider::getCover(TrackDescription track_desc, unsigned int width, unsigned int height, std::wstring* name, Callback callback)
+{
+    fs::wpath cover_file;
+    const std::wstring source_key = getSourceKey(track_desc, &cover_file);
+
+    if (!free_image_dll_is_available_) {
+        if (   !(width == 0 && height == 0) // only direct copy is possible without FreeImage.
+            || cover_file.empty()
+            )
+        {
+            throw std::runtime_error("FreeImage DLLs are not available.");
+        }
+        *name = storeCoverFile(source_key, cover_file);
+        return true;
+    }
+
+    const std::string source_hash = getSourceHash(source_key);
+    if ( !source_hash.empty() ) {
+        *name = CoverCache::makeName(source_hash, width, height);
+        if ( cache_.contains(*name) ) {
+            return true; // cover is ready, AIMP does not decode it at all.
+        }
+    }
+
+    // only decoding is done in player thread, scaling and encoding are done by workers.
+    std::shared_ptr<const ImageUtils::AIMPCoverImage> source( aimp_manager_.getCoverImage(track_desc).release() );
+    const std::vector<CoverRenderer::Size> sizes( 1, CoverRenderer::Size(width, height) );
+    renderer_.render( source, source_hash, sizes,
+                      boost::bind(&CoverProvider::onCoversRendered, source_hashes_, source_key, callback, _1, _2, _3)
+                     );
+    return false;
+}
+
+void CoverProvider::onCoversRendered(SourceHashes_ptr source_hashes, const std::wstring& source_key, Callback callback,
+                                     const std::string& source_hash, const std::vector<std::wstring>& names, const std::string& error)
+{
+    if ( error.empty() ) {
+        rememberSourceHash(*source_hashes, source_key, source_hash);
+    }
+
+    if (callback) {
+        callback(error.empty() ? names.front() : std::wstring(), error);
+    }
+}
+
+void CoverProvider::rememberSourceHash(SourceHashes& source_hashes, const std::wstring& source_key, const std::string& source_hash)
+{
+    if (source_hashes.size() >= kMAX_SOURCE_HASHES_COUNT) {
+        source_hashes.clear(); // it is just a memo, hashes will be calculated again.
+    }
+    source_hashes[source_key] = source_hash;
+}
+
+std::string CoverProvider::getSourceHash(const std::wstring& source_key) const
+{
+    const auto hash_it = source_hashes_->find(source_key);
+    return hash_it != source_hashes_->end() ? hash_it->second : std::string();
+}
+
+void CoverProvider::aimpEventHandler(AIMPManager::EVENTS event)
+{
+    switch (event) {
+    case AIMPManager::EVENT_PLAY_FILE: // it's sent when playback started.
+        pregenerateCovers();
+        break;
+    case AIMPManager::EVENT_PLAYLISTS_CONTENT_CHANGE: // track IDs can be reused and covers can be changed.
+        source_hashes_->clear();
+        break;
+    default:
+        break;
+    }
+}
+
+void CoverProvider::pregenerateCovers()
+{
+    if (!free_image_dll_is_available_ || pregenerated_sizes_.empty()) {
+        return;
+    }
+
+    try {
+        const TrackDescription track_desc( aimp_manager_.getAbsoluteTrackDesc( aimp_manager_.getPlayingTrack() ) );
+
+        fs::wpath cover_file;
+        const std::wstring source_key = getSourceKey(track_desc, &cover_file);
+
+        const std::string source_hash = getSourceHash(source_key);
+        if ( !source_hash.empty() ) {
+            const bool all_sizes_cached = pregenerated_sizes_.end() == std::find_if(pregenerated_sizes_.begin(), pregenerated_sizes_.end(),
+                                                                                    [&](const CoverRenderer::Size& size) {
+                                                                                        return !cache_.contains( CoverCache::makeName(source_hash, size.width, size.height) );
+                                                                                    });
+            if (all_sizes_cached) {
+                return;
+            }
+        }
+
+        std::shared_ptr<const ImageUtils::AIMPCoverImage> source( aimp_manager_.getCoverImage(track_desc).release() );
+        renderer_.render( source, source_hash, pregenerated_sizes_,
+                          boost::bind(&CoverProvider::onCoversRendered, source_hashes_, source_key, Callback(), _1, _2, _3)
+                         );
+    } catch (std::exception& e) {
+        // track can have no cover, it is not an error.
+        AIMP_LOG_SEV(logger(), debug) << "Album covers of playing track were not pregenerated. Reason: " << e.what();
+    }
+}
+
+std::wstring CoverProvider::getSourceKey(TrackDescription track_desc, fs::wpath* cover_file) const
+{
+    if ( aimp_manager_.isCoverImageFileExist(track_desc, cover_file) ) {
+        return cover_file->native();
+    }
+
+    std::wostringstream key;
+    key << L"track:" << track_desc.playlist_id << L':' << track_desc.track_id;
+    return key.str();
+}
+
+std::wstring CoverProvider::storeCoverFile(const std::wstring& source_key, const fs::wpath& cover_file)
+{
+    std::string source_hash = getSourceHash(source_key);
+    if ( !source_hash.empty() ) {
+        const std::wstring name = CoverCache::makeName( source_hash, 0, 0, cover_file.extension().native() );
+        if ( cache_.contains(name) ) {
+            return name;
+        }
+    }
+
+    fs::ifstream file(cover_file, std::ios::in | std::ios::binary);
+    CoverCache::Content content( new std::string( (std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>() ) );
+    if ( !file.is_open() || file.bad() ) {
+        throw std::runtime_error( Utilities::MakeString() << "Failed to read album cover file " << StringEncoding::utf16_to_utf8( cover_file.native() ) );
+    }
+
+    source_hash = CoverRenderer::hashOf( content->data(), content->size() );
+    const std::wstring name = CoverCache::makeName( source_hash, 0, 0, cover_file.extension().native() );
+    if ( !cache_.contains(name) ) {
+        cache_.put(name, content);
+    }
+    rememberSourceHash(*source_hashes_, source_key, source_hash);
+    return name;
+}
+
+} // namespace AlbumCover
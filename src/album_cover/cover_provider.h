@@ -0,0 +1,99 @@
+// Copyright (c) 2014, Alexey Ivanov
+
+#pragma once
+
+#include "aimp/manager.h"
+#include "cover_cache.h"
+#include "cover_renderer.h"
+#include <boost/filesystem.hpp>
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace AlbumCover
+{
+
+/*!
+    \brief Gives album covers of tracks from content-addressed cache, missing covers are rendered by background workers.
+           Hash of cover source is remembered for each cover file or track, so cached covers are given without decoding by AIMP.
+           Covers of configured sizes are rendered when track starts playing.
+           Must be used from player thread only.
+*/
+class CoverProvider : boost::noncopyable
+{
+public:
+
+    /*!
+        \brief Called in player thread when rendering of cover is done.
+        \param name - name of cover in cache, empty if error occured.
+        \param error - error description, empty on success.
+    */
+    typedef boost::function<void (const std::wstring& name, const std::string& error)> Callback;
+
+    /*!
+        \param cover_directory - directory of cover files.
+        \param free_image_dll_is_available - covers can not be scaled without FreeImage, only cover files of full size are given as is then.
+    */
+    CoverProvider(AIMPPlayer::AIMPManager& aimp_manager,
+                  ControlPlugin::PlayerThreadDispatcher& player_thread_dispatcher,
+                  const boost::filesystem::wpath& cover_directory,
+                  bool free_image_dll_is_available
+                  ); // throws std::runtime_error
+
+    ~CoverProvider();
+
+    /*!
+        \brief Gets cover of specified size. Zero width or height is calculated proportionally, both zeros mean original size.
+        \param track_desc - absolute track description.
+        \param name - receives name of cover in cache if it is ready.
+        \return true if cover is ready, callback is not called in this case.
+                false if cover is being rendered, callback gets result later.
+        \throw std::runtime_error if track has no cover or it can not be decoded.
+    */
+    bool getCover(AIMPPlayer::TrackDescription track_desc, unsigned int width, unsigned int height, std::wstring* name, Callback callback); // throws std::runtime_error
+
+    CoverCache& cache()
+        { return cache_; }
+
+private:
+
+    //! Hashes of cover sources by key of source(path of cover file or track).
+    typedef std::map<std::wstring, std::string> SourceHashes;
+    typedef boost::shared_ptr<SourceHashes> SourceHashes_ptr;
+
+    void aimpEventHandler(AIMPPlayer::AIMPManager::EVENTS event);
+
+    //! Renders covers of pregenerated sizes for playing track.
+    void pregenerateCovers();
+
+    //! Returns path of cover file if it exists, otherwise key of track.
+    std::wstring getSourceKey(AIMPPlayer::TrackDescription track_desc, boost::filesystem::wpath* cover_file) const;
+
+    //! Returns hash of cover source if it is known, otherwise empty string.
+    std::string getSourceHash(const std::wstring& source_key) const;
+
+    //! Stores cover file as is, used if FreeImage is not available.
+    std::wstring storeCoverFile(const std::wstring& source_key, const boost::filesystem::wpath& cover_file); // throws std::runtime_error
+
+    static void rememberSourceHash(SourceHashes& source_hashes, const std::wstring& source_key, const std::string& source_hash);
+
+    //! Renderer callbacks do not use provider object, they can be called after its destruction.
+    static void onCoversRendered(SourceHashes_ptr source_hashes, const std::wstring& source_key, Callback callback,
+                                 const std::string& source_hash, const std::vector<std::wstring>& names, const std::string& error);
+
+    AIMPPlayer::AIMPManager& aimp_manager_;
+    bool free_image_dll_is_available_;
+
+    CoverCache cache_;
+    CoverRenderer renderer_; //!< must be destroyed before cache_ since workers use it.
+    std::vector<CoverRenderer::Size> pregenerated_sizes_;
+
+    SourceHashes_ptr source_hashes_;
+
+    AIMPPlayer::AIMPManager::EventsListenerID aimp_events_listener_id_;
+};
+
+} // namespace AlbumCover
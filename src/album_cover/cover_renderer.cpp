@@ -0,0 +1,132 @@
+// Copyright (c) 2014, Alexey Ivanov
+
+#include "stdafx.h"
+#include "cover_renderer.h"
+#include "cover_cache.h"
+#include "plugin/logger.h"
+#include "plugin/player_thread_dispatcher.h"
+#include "utils/image.h"
+#include <boost/bind.hpp>
+#include <boost/foreach.hpp>
+#include <boost/uuid/sha1.hpp>
+
+namespace {
+using namespace ControlPlugin::PluginLogger;
+ModuleLoggerType& logger()
+    { return getLogManager().getModuleLogger<Rpc::RequestHandler>(); }
+}
+
+namespace AlbumCover
+{
+
+namespace
+{
+
+std::string digestToHex(boost::uuids::detail::sha1& sha1)
+{
+    unsigned int digest[5];
+    sha1.get_digest(digest);
+
+    const char kHEX_DIGITS[] = "0123456789abcdef";
+    std::string hex;
+    hex.reserve(40);
+    for (size_t i = 0; i != 5; ++i) {
+        for (int shift = 28; shift >= 0; shift -= 4) {
+            hex.push_back( kHEX_DIGITS[(digest[i] >> shift) & 0xF] );
+        }
+    }
+    return hex;
+}
+
+void runWorker(boost::asio::io_service& io_service)
+{
+    for (;;) {
+        try {
+            io_service.run();
+            break; // io_service was stopped.
+        } catch (std::exception& e) {
+            AIMP_LOG_SEV(logger(), error) << "Unhandled exception inside album cover worker thread: " << e.what();
+        }
+    }
+}
+
+} // namespace
+
+CoverRenderer::CoverRenderer(CoverCache& cache, ControlPlugin::PlayerThreadDispatcher& player_thread_dispatcher, unsigned int threads_count,
+                             const ImageUtils::EncodingOptions& encoding_options, ImageUtils::SCALINGFILTER scaling_filter)
+    :
+    cache_(cache),
+    player_thread_dispatcher_(player_thread_dispatcher),
+    encoding_options_(encoding_options),
+    scaling_filter_(scaling_filter),
+    work_( new boost::asio::io_service::work(io_service_) )
+{
+    threads_count = std::max(threads_count, 1u);
+    for (unsigned int i = 0; i != threads_count; ++i) {
+        workers_.create_thread( boost::bind( &runWorker, boost::ref(io_service_) ) );
+    }
+}
+
+CoverRenderer::~CoverRenderer()
+{
+    work_.reset();
+    io_service_.stop();
+    workers_.join_all();
+}
+
+void CoverRenderer::render(std::shared_ptr<const ImageUtils::AIMPCoverImage> source, const std::string& source_hash, const std::vector<Size>& sizes, Callback callback)
+{
+    io_service_.post( boost::bind(&CoverRenderer::renderInWorker, this, source, source_hash, sizes, callback) );
+}
+
+void CoverRenderer::renderInWorker(std::shared_ptr<const ImageUtils::AIMPCoverImage> source, std::string source_hash, const std::vector<Size>& sizes, Callback callback)
+{
+    std::vector<std::wstring> names;
+    std::string error_message;
+    try {
+        if ( source_hash.empty() ) {
+            source_hash = hashOf(*source);
+        }
+
+        BOOST_FOREACH(const Size& size, sizes) {
+            const std::wstring name = CoverCache::makeName(source_hash, size.width, size.height);
+            if ( !cache_.contains(name) ) {
+                std::vector<BYTE> image_data;
+                source->scaled(size.width, size.height, scaling_filter_)->saveToVector(ImageUtils::JPEG_IMAGE, image_data, encoding_options_);
+                cache_.put( name, CoverCache::Content( new std::string( image_data.begin(), image_data.end() ) ) );
+            }
+            names.push_back(name);
+        }
+    } catch (std::exception& e) {
+        error_message = e.what();
+        source_hash.clear();
+        names.clear();
+        AIMP_LOG_SEV(logger(), error) << "Album cover rendering failed in "__FUNCTION__ << ". Reason: " << error_message;
+    }
+
+    if (callback) {
+        player_thread_dispatcher_.post( boost::bind(callback, source_hash, names, error_message) );
+    }
+}
+
+std::string CoverRenderer::hashOf(const ImageUtils::AIMPCoverImage& image)
+{
+    boost::uuids::detail::sha1 sha1;
+    const unsigned int size[] = { image.getWidth(), image.getHeight(), image.getBitsPerPixel() };
+    sha1.process_bytes( size, sizeof(size) );
+
+    const unsigned int line_size = image.getLine(); // scan line without alignment padding.
+    for (unsigned int y = 0, height = image.getHeight(); y != height; ++y) {
+        sha1.process_bytes(image.getScanLine(y), line_size);
+    }
+    return digestToHex(sha1);
+}
+
+std::string CoverRenderer::hashOf(const char* data, size_t size)
+{
+    boost::uuids::detail::sha1 sha1;
+    sha1.process_bytes(data, size);
+    return digestToHex(sha1);
+}
+
+} // namespace AlbumCover
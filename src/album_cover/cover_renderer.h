@@ -0,0 +1,83 @@
+// Copyright (c) 2014, Alexey Ivanov
+
+#pragma once
+
+#include "utils/image.h"
+#include <boost/asio.hpp>
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/thread/thread.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace ControlPlugin { class PlayerThreadDispatcher; }
+
+namespace AlbumCover
+{
+
+class CoverCache;
+
+/*!
+    \brief Scales and encodes album covers in background worker threads and stores results in cache.
+           Player thread only gets source image from AIMP(AIMP SDK can not be used from other threads),
+           hashing, scaling and encoding are done by workers.
+*/
+class CoverRenderer : boost::noncopyable
+{
+public:
+
+    struct Size
+    {
+        unsigned int width, height; //!< zero width or height is calculated proportionally, both zeros mean original size.
+        Size(unsigned int width, unsigned int height) : width(width), height(height) {}
+    };
+
+    /*!
+        \brief Called in player thread when rendering is done.
+        \param source_hash - hash of source image pixels, empty if error occured.
+        \param names - names of covers in cache in order of requested sizes.
+        \param error - error description, empty on success.
+    */
+    typedef boost::function<void (const std::string& source_hash, const std::vector<std::wstring>& names, const std::string& error)> Callback;
+
+    /*!
+        \param threads_count - count of worker threads, at least one is started.
+        \param encoding_options - options of JPEG encoding of covers.
+        \param scaling_filter - filter of downscaling of covers.
+    */
+    CoverRenderer(CoverCache& cache, ControlPlugin::PlayerThreadDispatcher& player_thread_dispatcher, unsigned int threads_count,
+                  const ImageUtils::EncodingOptions& encoding_options, ImageUtils::SCALINGFILTER scaling_filter);
+
+    //! Stops workers. Jobs which were not started are dropped, their callbacks are not called.
+    ~CoverRenderer();
+
+    /*!
+        \brief Queues rendering of cover of specified sizes. Sizes which are already in cache are not rendered again.
+        \param source - full size cover, it is not changed by workers.
+        \param source_hash - hash of source if it is known, empty string otherwise.
+        \param callback - can be empty if caller is not interested in result.
+    */
+    void render(std::shared_ptr<const ImageUtils::AIMPCoverImage> source, const std::string& source_hash, const std::vector<Size>& sizes, Callback callback);
+
+    //! Returns hex string of SHA-1 of image pixels.
+    static std::string hashOf(const ImageUtils::AIMPCoverImage& image);
+
+    //! Returns hex string of SHA-1 of data. Used for cover files which are stored as is.
+    static std::string hashOf(const char* data, size_t size);
+
+private:
+
+    void renderInWorker(std::shared_ptr<const ImageUtils::AIMPCoverImage> source, std::string source_hash, const std::vector<Size>& sizes, Callback callback);
+
+    CoverCache& cache_;
+    ControlPlugin::PlayerThreadDispatcher& player_thread_dispatcher_;
+    const ImageUtils::EncodingOptions encoding_options_;
+    const ImageUtils::SCALINGFILTER scaling_filter_;
+
+    boost::asio::io_service io_service_;
+    std::unique_ptr<boost::asio::io_service::work> work_; //!< keeps workers running while there are no jobs.
+    boost::thread_group workers_;
+};
+
+} // namespace AlbumCover
@@ -0,0 +1,51 @@
+// Copyright (c) 2014, Alexey Ivanov
+
+#pragma once
+
+#include "http_server/request_handler.h"
+#include <boost/noncopyable.hpp>
+#include <string>
+
+namespace AIMPPlayer { class AIMPManager; }
+namespace Http {
+    struct Request; 
+    struct Reply;
+}
+
+namespace AlbumCover
+{
+
+class CoverProvider;
+
+/*!
+    \brief Serves album covers by GET /cover/<playlist_id>/<track_id>/<width>x<height> requests, size part is optional(original size).
+           Covers are sent from memory cache of CoverProvider with strong ETag(cover name is hash of its content) and Last-Modified headers,
+           so clients revalidate them cheaply. Response is delayed while cover is being rendered.
+           Must be used from player thread only.
+*/
+class RequestHandler : boost::noncopyable
+{
+public:
+    RequestHandler(AIMPPlayer::AIMPManager& aimp_manager, CoverProvider& cover_provider)
+        :
+        aimp_manager_(aimp_manager),
+        cover_provider_(cover_provider)
+    {}
+
+    //! Returns true if reply should be sent immediately, false if it will be sent by delayed_response_sender.
+    bool handle_request(const Http::Request& req, Http::Reply& rep, Http::DelayedResponseSender_ptr delayed_response_sender);
+
+private:
+
+    //! Fills reply with cover content or 404 reply if cover was evicted from cache meanwhile.
+    void fillCoverReply(const Http::Request& req, const std::wstring& name, Http::Reply& rep);
+
+    //! Called in player thread when cover is rendered. Request is copied since original one is destroyed when connection waits for response.
+    static void onCoverRendered(RequestHandler* handler, const Http::Request& req, Http::DelayedResponseSender_ptr delayed_response_sender,
+                                const std::wstring& name, const std::string& error);
+
+    AIMPPlayer::AIMPManager& aimp_manager_;
+    CoverProvider& cover_provider_;
+};
+
+} // namespace AlbumCover
@@ -7,6 +7,7 @@
 #include "../http_server/reply.h"
 #include "../http_server/request.h"
 #include "../http_server/mime_types.h"
+#include "../http_server/file_reply.h"
 
 #include "utils/string_encoding.h"
 #include "utils/util.h"
@@ -83,20 +84,13 @@ bool RequestHandler::handle_request(const Http::Request& req, Http::Reply& rep)
 
     try {
         namespace fs = boost::filesystem;
-        rep.filename = getTrackSourcePath(req.uri);
-        const fs::wpath path(rep.filename);
-        
-        const uintmax_t file_size = fs::file_size(path);
-
-        // fill http headers.
-        rep.status = Reply::ok;
-        rep.headers.resize(3);
-        rep.headers[0].name = "Content-Length";
-        rep.headers[0].value = boost::lexical_cast<std::string>(file_size);
-        rep.headers[1].name = "Content-Type";
-        rep.headers[1].value = mime_types::extension_to_type( path.extension().string().c_str() );
-        rep.headers[2].name = "Content-Disposition";
-        rep.headers[2].value = Utilities::MakeString() << "attachment; filename=\"" << StringEncoding::utf16_to_utf8( path.filename().native() ) << "\"";
+        const fs::wpath path( getTrackSourcePath(req.uri) );
+
+        // Range requests let audio element seek without downloading whole track.
+        fillFileReply( req, path, mime_types::extension_to_type( path.extension().string().c_str() ), rep );
+        rep.headers.emplace_back();
+        rep.headers.back().name = "Content-Disposition";
+        rep.headers.back().value = Utilities::MakeString() << "attachment; filename=\"" << StringEncoding::utf16_to_utf8( path.filename().native() ) << "\"";
     } catch (std::exception&) {
         rep.filename.clear();
         rep = Reply::stock_reply(Reply::not_found);
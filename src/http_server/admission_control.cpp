@@ -0,0 +1,188 @@
+// Copyright (c) 2014, Alexey Ivanov
+
+#include "stdafx.h"
+#include "admission_control.h"
+#include "plugin/logger.h"
+#include <algorithm>
+
+namespace {
+using namespace ControlPlugin::PluginLogger;
+ModuleLoggerType& logger()
+    { return getLogManager().getModuleLogger<Http::Server>(); }
+}
+
+namespace Http
+{
+
+namespace
+{
+
+//! Idle clients are removed when count of tracked clients reaches this value.
+const size_t kIDLE_CLIENTS_CLEANUP_THRESHOLD = 256;
+
+//! Token bucket is refilled completely in this time.
+const unsigned long kBUCKET_REFILL_MS = 1000;
+
+//! Client waits this time before new connection if server is overloaded.
+const char kCONNECTION_RETRY_AFTER_SEC[] = "5";
+
+//! Client waits this time before next request when it exceeded rate or subscriptions limit.
+const char kREQUEST_RETRY_AFTER_SEC[] = "1";
+
+} // namespace anonymous
+
+AdmissionControl::AdmissionControl(const Limits& limits)
+    :
+    limits_(limits)
+{
+    stats_.connections_count = 0;
+    stats_.connections_accepted = stats_.connections_rejected = 0;
+    stats_.requests_rejected = stats_.subscriptions_rejected = 0;
+}
+
+AdmissionControl::Client& AdmissionControl::getClient(const std::string& client_address)
+{
+    Clients::iterator it = clients_.find(client_address);
+    if ( it == clients_.end() ) {
+        const unsigned long now = GetTickCount();
+        if (clients_.size() >= kIDLE_CLIENTS_CLEANUP_THRESHOLD) {
+            removeIdleClients(now);
+        }
+
+        Client client;
+        client.connections = client.subscriptions = 0;
+        client.tokens = limits_.max_requests_per_second;
+        client.last_refill_tick = now;
+        it = clients_.insert( std::make_pair(client_address, client) ).first;
+    }
+    return it->second;
+}
+
+void AdmissionControl::removeIdleClients(unsigned long now)
+{
+    for (Clients::iterator it = clients_.begin(); it != clients_.end(); ) {
+        const Client& client = it->second;
+        if (   client.connections == 0
+            && client.subscriptions == 0
+            && now - client.last_refill_tick >= kBUCKET_REFILL_MS // unsigned arithmetic handles wrap of tick counter.
+            )
+        {
+            it = clients_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+bool AdmissionControl::admitConnection(const std::string& client_address)
+{
+    boost::mutex::scoped_lock lock(mutex_);
+
+    if (limits_.max_connections != 0 && stats_.connections_count >= limits_.max_connections) {
+        ++stats_.connections_rejected;
+        logRejection("connection", client_address);
+        return false;
+    }
+
+    ++getClient(client_address).connections;
+    ++stats_.connections_count;
+    ++stats_.connections_accepted;
+    return true;
+}
+
+void AdmissionControl::connectionClosed(const std::string& client_address)
+{
+    boost::mutex::scoped_lock lock(mutex_);
+
+    Clients::iterator it = clients_.find(client_address);
+    assert( it != clients_.end() && it->second.connections != 0 );
+    if ( it != clients_.end() && it->second.connections != 0 ) {
+        --it->second.connections;
+    }
+    assert(stats_.connections_count != 0);
+    --stats_.connections_count;
+}
+
+bool AdmissionControl::admitRequest(const std::string& client_address)
+{
+    if (limits_.max_requests_per_second == 0) {
+        return true;
+    }
+
+    boost::mutex::scoped_lock lock(mutex_);
+
+    Client& client = getClient(client_address);
+    const unsigned long now = GetTickCount();
+    const double capacity = limits_.max_requests_per_second;
+    client.tokens = std::min(capacity,
+                             client.tokens + capacity * (now - client.last_refill_tick) / kBUCKET_REFILL_MS
+                             );
+    client.last_refill_tick = now;
+
+    if (client.tokens < 1) {
+        ++stats_.requests_rejected;
+        logRejection("request", client_address);
+        return false;
+    }
+    client.tokens -= 1;
+    return true;
+}
+
+bool AdmissionControl::admitSubscription(const std::string& client_address)
+{
+    boost::mutex::scoped_lock lock(mutex_);
+
+    Client& client = getClient(client_address);
+    if (limits_.max_subscriptions_per_client != 0 && client.subscriptions >= limits_.max_subscriptions_per_client) {
+        ++stats_.subscriptions_rejected;
+        logRejection("subscription", client_address);
+        return false;
+    }
+    ++client.subscriptions;
+    return true;
+}
+
+void AdmissionControl::subscriptionFinished(const std::string& client_address)
+{
+    boost::mutex::scoped_lock lock(mutex_);
+
+    Clients::iterator it = clients_.find(client_address);
+    assert( it != clients_.end() && it->second.subscriptions != 0 );
+    if ( it != clients_.end() && it->second.subscriptions != 0 ) {
+        --it->second.subscriptions;
+    }
+}
+
+AdmissionControl::Stats AdmissionControl::stats() const
+{
+    boost::mutex::scoped_lock lock(mutex_);
+    return stats_;
+}
+
+void AdmissionControl::logRejection(const char* what, const std::string& client_address) const
+{
+    // debug level: rejections come in bursts from overloading clients, counters are available by GetServerStatus.
+    AIMP_LOG_SEV(logger(), debug) << "Admission control: " << what << " of " << client_address << " is rejected. Totally rejected connections: "
+                                   << stats_.connections_rejected << ", requests: " << stats_.requests_rejected
+                                   << ", subscriptions: " << stats_.subscriptions_rejected
+                                   << ". Open connections: " << stats_.connections_count;
+}
+
+void SubscriptionSlot::release()
+{
+    if ( InterlockedExchange(&released_, 1) == 0 ) {
+        admission_control_->subscriptionFinished(client_address_);
+    }
+}
+
+Reply AdmissionControl::rejectReply(Reply::status_type status)
+{
+    Reply rep = Reply::stock_reply(status);
+    rep.headers.push_back(header());
+    rep.headers.back().name = "Retry-After";
+    rep.headers.back().value = status == Reply::service_unavailable ? kCONNECTION_RETRY_AFTER_SEC
+                                                                    : kREQUEST_RETRY_AFTER_SEC;
+    return rep;
+}
+
+} // namespace Http
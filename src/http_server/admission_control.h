@@ -0,0 +1,126 @@
+// Copyright (c) 2014, Alexey Ivanov
+
+#pragma once
+
+#include "reply.h"
+#include <boost/cstdint.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <map>
+#include <string>
+
+namespace Http
+{
+
+/*!
+    \brief Limits load which clients can put on server:
+            - total count of open connections;
+            - count of pending comet requests(state event subscriptions) and open event streams of one client IP;
+            - rate of requests of one client IP(token bucket which holds one second worth of requests).
+           Excess connections and requests are rejected by I/O threads with 503/429 replies which contain Retry-After header,
+           so burst of requests never reaches player thread.
+           Object is used from I/O threads and player thread, all methods are synchronized.
+           Connections and delayed responses share ownership of it, so they can release their counters after request handler is destroyed.
+*/
+class AdmissionControl : boost::noncopyable
+{
+public:
+
+    //! Zero value disables corresponding limit.
+    struct Limits
+    {
+        unsigned int max_connections;
+        unsigned int max_subscriptions_per_client;
+        unsigned int max_requests_per_second;
+    };
+
+    //! Counters of rejected load.
+    struct Stats
+    {
+        unsigned int connections_count; //!< currently open connections.
+        boost::uint64_t connections_accepted,
+                        connections_rejected,
+                        requests_rejected,
+                        subscriptions_rejected;
+    };
+
+    explicit AdmissionControl(const Limits& limits);
+
+    //! Returns false if connection must be rejected. Admitted connection must be released by connectionClosed().
+    bool admitConnection(const std::string& client_address);
+    void connectionClosed(const std::string& client_address);
+
+    //! Returns false if client exceeded rate limit and request must be rejected.
+    bool admitRequest(const std::string& client_address);
+
+    //! Returns false if client has too many pending subscriptions. Admitted subscription must be released by subscriptionFinished().
+    bool admitSubscription(const std::string& client_address);
+    void subscriptionFinished(const std::string& client_address);
+
+    Stats stats() const;
+
+    //! Returns stock reply with Retry-After header for rejected connection(service_unavailable) or request(too_many_requests).
+    static Reply rejectReply(Reply::status_type status);
+
+private:
+
+    struct Client
+    {
+        unsigned int connections;
+        unsigned int subscriptions;
+        double tokens; //!< requests which client can send right now.
+        unsigned long last_refill_tick; //!< GetTickCount() value of last refill of tokens.
+    };
+    typedef std::map<std::string, Client> Clients;
+
+    //! Returns state of client, creates it if needed.
+    Client& getClient(const std::string& client_address);
+
+    //! Removes clients which have no connections and subscriptions, and whose token bucket is full already.
+    void removeIdleClients(unsigned long now);
+
+    void logRejection(const char* what, const std::string& client_address) const;
+
+    const Limits limits_;
+    Clients clients_;
+    Stats stats_;
+    mutable boost::mutex mutex_;
+};
+
+typedef boost::shared_ptr<AdmissionControl> AdmissionControl_ptr;
+
+/*!
+    \brief Admitted subscription of client. It is held by delayed response and by connection which waits for it,
+           slot is released by the first of them: when response is sent or when connection is closed by client,
+           so client which reconnects does not wait for stale subscriptions of closed connections.
+*/
+class SubscriptionSlot : boost::noncopyable
+{
+public:
+    SubscriptionSlot(AdmissionControl_ptr admission_control, const std::string& client_address)
+        :
+        admission_control_(admission_control),
+        client_address_(client_address),
+        released_(0)
+    {}
+
+    ~SubscriptionSlot()
+        { release(); }
+
+    //! Can be called from any thread, only the first call releases slot.
+    void release();
+
+    bool released() const
+        { return released_ != 0; }
+
+private:
+
+    AdmissionControl_ptr admission_control_;
+    const std::string client_address_;
+    volatile LONG released_;
+};
+
+typedef boost::shared_ptr<SubscriptionSlot> SubscriptionSlot_ptr;
+
+} // namespace Http
@@ -8,6 +8,9 @@
 #include "utils/string_encoding.h"
 #include "utils/util.h"
 #include <boost/algorithm/string.hpp>
+#include <ctime>
+#include <unordered_map>
+#include <wincrypt.h>
 
 namespace {
 using namespace ControlPlugin::PluginLogger;
@@ -24,6 +27,15 @@ using ControlPlugin::PluginLogger::LogManager;
 using namespace Utilities;
 
 const wchar_t * const kPASSWORDS_FILE_NAME = L".htpasswd";
+const char * const kSESSION_COOKIE_NAME = "aimp_session";
+
+const std::time_t kNONCE_LIFETIME = 60 * 60; // seconds.
+const std::time_t kSESSION_LIFETIME = 60 * 60; // seconds since last request of session.
+const size_t kMAX_SESSIONS_COUNT = 256;
+const size_t kMAX_VERIFIED_CREDENTIALS_COUNT = 256;
+const size_t kSECRET_SIZE = 16; // bytes.
+const size_t kSESSION_TOKEN_SIZE = 16; // bytes.
+const size_t kMD5_HEX_LENGTH = 32;
 
 struct HTEntry
 {
@@ -33,15 +45,168 @@ struct HTEntry
 };
 typedef std::vector<HTEntry> HTEntries;
 
+//! Parameters of Authorization header of Digest scheme.
+struct DigestCredentials
+{
+    std::string username, nonce, uri, response, qop, nc, cnonce;
+};
+
+namespace
+{
+
+void skipSeparators(const char*& current, const char* end)
+{
+    while (current != end && (*current == ' ' || *current == '\t' || *current == ',')) {
+        ++current;
+    }
+}
+
+/*!
+    \brief Parses "Digest username="user", nonce="...", nc=00000001, ..." in one pass.
+    \return false if scheme is not Digest, header is malformed or some of required parameters is absent.
+*/
+bool parseDigestCredentials(const std::string& header, DigestCredentials* credentials)
+{
+    static const char kSCHEME[] = "Digest ";
+    const size_t kSCHEME_LENGTH = sizeof(kSCHEME) - 1;
+    if ( header.size() < kSCHEME_LENGTH || _strnicmp(header.c_str(), kSCHEME, kSCHEME_LENGTH) != 0 ) {
+        return false;
+    }
+
+    const struct { const char* name; std::string DigestCredentials::* value; } kPARAMETERS[] = {
+        { "username", &DigestCredentials::username },
+        { "nonce",    &DigestCredentials::nonce },
+        { "uri",      &DigestCredentials::uri },
+        { "response", &DigestCredentials::response },
+        { "qop",      &DigestCredentials::qop },
+        { "nc",       &DigestCredentials::nc },
+        { "cnonce",   &DigestCredentials::cnonce }
+    };
+
+    const char* current = header.c_str() + kSCHEME_LENGTH;
+    const char* const end = header.c_str() + header.size();
+    for (skipSeparators(current, end); current != end; skipSeparators(current, end)) {
+        const char* const name_begin = current;
+        while (current != end && *current != '=' && *current != ' ' && *current != ',') {
+            ++current;
+        }
+        const size_t name_length = current - name_begin;
+        if (current == end || *current != '=') {
+            return false;
+        }
+        ++current;
+
+        std::string value;
+        if (current != end && *current == '"') {
+            for (++current; current != end && *current != '"'; ++current) {
+                if (*current == '\\' && current + 1 != end) {
+                    ++current; // quoted pair.
+                }
+                value.push_back(*current);
+            }
+            if (current == end) {
+                return false; // quoted string is not terminated.
+            }
+            ++current;
+        } else {
+            const char* const value_begin = current;
+            while (current != end && *current != ',' && *current != ' ') {
+                ++current;
+            }
+            value.assign(value_begin, current);
+        }
+
+        BOOST_FOREACH(const auto& parameter, kPARAMETERS) {
+            if ( strlen(parameter.name) == name_length && _strnicmp(parameter.name, name_begin, name_length) == 0 ) {
+                (credentials->*parameter.value).swap(value);
+                break;
+            }
+        }
+    }
+
+    BOOST_FOREACH(const auto& parameter, kPARAMETERS) {
+        if ( (credentials->*parameter.value).empty() ) {
+            return false;
+        }
+    }
+    return true;
+}
+
+//! Compares strings in time which does not depend on position of the first difference, so response can not be guessed by timing.
+bool constantTimeEquals(const std::string& lhs, const std::string& rhs)
+{
+    if ( lhs.size() != rhs.size() ) {
+        return false;
+    }
+    unsigned char difference = 0;
+    for (size_t i = 0, size = lhs.size(); i != size; ++i) {
+        difference |= static_cast<unsigned char>(lhs[i] ^ rhs[i]);
+    }
+    return difference == 0;
+}
+
+//! Returns value of cookie from Cookie header: "name1=value1; name2=value2".
+bool findCookie(const std::string& cookies, const char* name, std::string* value)
+{
+    const size_t name_length = strlen(name);
+    size_t item_begin = 0;
+    while ( item_begin < cookies.size() ) {
+        size_t item_end = cookies.find(';', item_begin);
+        if (item_end == std::string::npos) {
+            item_end = cookies.size();
+        }
+        while (item_begin < item_end && cookies[item_begin] == ' ') {
+            ++item_begin;
+        }
+        if (   item_end - item_begin > name_length
+            && cookies.compare(item_begin, name_length, name) == 0
+            && cookies[item_begin + name_length] == '='
+            )
+        {
+            value->assign(cookies, item_begin + name_length + 1, item_end - item_begin - name_length - 1);
+            return true;
+        }
+        item_begin = item_end + 1;
+    }
+    return false;
+}
+
+std::string toHex(const unsigned char* data, size_t size)
+{
+    const char kHEX_DIGITS[] = "0123456789abcdef";
+    std::string hex;
+    hex.reserve(size * 2);
+    for (size_t i = 0; i != size; ++i) {
+        hex.push_back( kHEX_DIGITS[data[i] >> 4] );
+        hex.push_back( kHEX_DIGITS[data[i] & 0xF] );
+    }
+    return hex;
+}
+
+} // namespace
+
 struct AuthManager::Impl
 {
     bool enabled_;
-    HTEntries ht_entries_;
-    static const std::string kHEADER_AUTHORIZATION_NAME;
+    std::unordered_map<std::string, std::string> ha1_by_user_; //!< users of realm_ only.
     std::string realm_;
 
+    HCRYPTPROV crypt_provider_;
+    std::string secret_; //!< key of nonce signatures, nonces of previous plugin instance become invalid.
+
+    typedef std::unordered_map<std::string, std::time_t> Sessions; //!< expiration time by session token.
+    Sessions sessions_;
+
+    //! Expiration time of nonce by method and Authorization header which passed Digest check. Clients which do not accept cookies repeat them.
+    typedef std::unordered_map<std::string, std::time_t> VerifiedCredentials;
+    VerifiedCredentials verified_credentials_;
+
+    boost::mutex mutex_; //!< guards sessions_ and verified_credentials_.
+
     Impl()
-        : enabled_(false)
+        :
+        enabled_(false),
+        crypt_provider_(0)
     {
         realm_ = StringEncoding::utf16_to_utf8(ControlPlugin::AIMPControlPlugin::settings().http_server.realm);
 
@@ -49,16 +214,35 @@ struct AuthManager::Impl
         password_file_path /= kPASSWORDS_FILE_NAME;
 
         if (boost::filesystem::exists(password_file_path)) {
+            HTEntries ht_entries;
             try {
-                ht_entries_ = loadAuthData(password_file_path);
-                enabled_ = true;
+                ht_entries = loadAuthData(password_file_path);
             } catch (std::ios_base::failure&) {
-                BOOST_LOG_SEV(logger(), critical) << "Error reading of passwords file at " << password_file_path << ". Reason: bad file format.";
+                AIMP_LOG_SEV(logger(), critical) << "Error reading of passwords file at " << password_file_path << ". Reason: bad file format.";
                 throw;
             } catch (std::exception& e) {
-                BOOST_LOG_SEV(logger(), error) << "Error reading of passwords file at " << password_file_path << ". Reason: " << e.what();
+                AIMP_LOG_SEV(logger(), error) << "Error reading of passwords file at " << password_file_path << ". Reason: " << e.what();
                 throw;
             }
+
+            BOOST_FOREACH(HTEntry& entry, ht_entries) {
+                if (entry.realm == realm_) {
+                    ha1_by_user_[entry.user] = boost::algorithm::to_lower_copy(entry.ha1);
+                }
+            }
+
+            if ( !CryptAcquireContext(&crypt_provider_, nullptr, nullptr, PROV_RSA_FULL, CRYPT_VERIFYCONTEXT) ) {
+                throw std::runtime_error( MakeString() << "Failed to acquire cryptographic provider for authentication. Error code: " << GetLastError() );
+            }
+            secret_ = randomHex(kSECRET_SIZE);
+            enabled_ = true;
+        }
+    }
+
+    ~Impl()
+    {
+        if (crypt_provider_) {
+            CryptReleaseContext(crypt_provider_, 0);
         }
     }
 
@@ -82,13 +266,13 @@ struct AuthManager::Impl
             if (line.empty()) continue;
 
             line_is.clear();
-            line_is.str(line);
-
-            entries.emplace_back();
-            HTEntry& entry = entries.back();
-
-            std::getline(line_is, entry.user,  ':');
-            std::getline(line_is, entry.realm, ':');
+            line_is.str(line);
+
+            entries.emplace_back();
+            HTEntry& entry = entries.back();
+
+            std::getline(line_is, entry.user,  ':');
+            std::getline(line_is, entry.realm, ':');
             std::getline(line_is, entry.ha1       );
         }
         return entries;
@@ -97,45 +281,171 @@ struct AuthManager::Impl
     bool enabled() const {
         return enabled_;
     }
-    
-    bool isAuthenticated(const Request& req) const {
-        const std::string* autorization_value;
-        if (!get_header_value(req.headers, kHEADER_AUTHORIZATION_NAME, autorization_value)) {
-            return false;
-        }
-        const char* hdr = autorization_value->c_str();
-
-        if (mg_strncasecmp(hdr, "Digest ", 7) != 0) return 0;
-
-        const int MAX_REQUEST_SIZE = 16384;
-        char user[100], nonce[100], uri[MAX_REQUEST_SIZE], cnonce[100], resp[100], qop[100], nc[100];
-
-        if (!mg_parse_header(hdr, "username", user, sizeof(user))) return 0;
-        if (!mg_parse_header(hdr, "cnonce", cnonce, sizeof(cnonce))) return 0;
-        if (!mg_parse_header(hdr, "response", resp, sizeof(resp))) return 0;
-        if (!mg_parse_header(hdr, "uri", uri, sizeof(uri))) return 0;
-        if (!mg_parse_header(hdr, "qop", qop, sizeof(qop))) return 0;
-        if (!mg_parse_header(hdr, "nc", nc, sizeof(nc))) return 0;
-        if (!mg_parse_header(hdr, "nonce", nonce, sizeof(nonce))) return 0;
-
-        for(auto ht_entry : ht_entries_) {
-            if ( ht_entry.user == user && ht_entry.realm == realm() ) {
-                return check_password(req.method.c_str(), ht_entry.ha1.c_str(), uri, nonce, nc, cnonce, qop, resp) == MG_AUTH_OK;
-            }
-        }
-        return false;
+
+    Result authenticate(const Request& req, std::string* new_session_token) {
+        new_session_token->clear();
+        const std::time_t now = std::time(nullptr);
+        boost::mutex::scoped_lock lock(mutex_);
+
+        if ( authenticateBySession(req, now) ) {
+            return AUTHENTICATED;
+        }
+
+        const std::string* authorization;
+        if ( !get_header_value(req, HEADER_AUTHORIZATION, authorization) ) {
+            return UNAUTHENTICATED;
+        }
+
+        const Result result = authenticateByDigest(req.method, *authorization, now);
+        if (result == AUTHENTICATED) {
+            try {
+                *new_session_token = createSession(now);
+            } catch (std::exception& e) {
+                AIMP_LOG_SEV(logger(), error) << "Session was not created. Reason: " << e.what(); // client will pass Digest check on each request.
+            }
+        }
+        return result;
+    }
+
+    bool isAuthenticated(const Request& req) {
+        const std::time_t now = std::time(nullptr);
+        boost::mutex::scoped_lock lock(mutex_);
+
+        if ( authenticateBySession(req, now) ) {
+            return true;
+        }
+        const std::string* authorization;
+        return get_header_value(req, HEADER_AUTHORIZATION, authorization)
+               && authenticateByDigest(req.method, *authorization, now) == AUTHENTICATED;
+    }
+
+    bool authenticateBySession(const Request& req, std::time_t now) {
+        const std::string* cookies;
+        std::string token;
+        if (   !get_header_value(req, HEADER_COOKIE, cookies)
+            || !findCookie(*cookies, kSESSION_COOKIE_NAME, &token)
+            )
+        {
+            return false;
+        }
+
+        const auto session_it = sessions_.find(token);
+        if ( session_it == sessions_.end() ) {
+            return false;
+        }
+        if (session_it->second <= now) {
+            sessions_.erase(session_it);
+            return false;
+        }
+        session_it->second = now + kSESSION_LIFETIME;
+        return true;
+    }
+
+    std::string createSession(std::time_t now) {
+        if (sessions_.size() >= kMAX_SESSIONS_COUNT) {
+            for (auto it = sessions_.begin(); it != sessions_.end(); ) {
+                if (it->second <= now) {
+                    it = sessions_.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+            if (sessions_.size() >= kMAX_SESSIONS_COUNT) { // drop least recently used session, its client will pass Digest check again.
+                auto oldest_it = sessions_.begin();
+                for (auto it = sessions_.begin(); it != sessions_.end(); ++it) {
+                    if (it->second < oldest_it->second) {
+                        oldest_it = it;
+                    }
+                }
+                sessions_.erase(oldest_it);
+            }
+        }
+
+        const std::string token = randomHex(kSESSION_TOKEN_SIZE);
+        sessions_[token] = now + kSESSION_LIFETIME;
+        return token;
+    }
+
+    Result authenticateByDigest(const std::string& method, const std::string& authorization, std::time_t now) {
+        std::string cache_key(method);
+        cache_key += ' ';
+        cache_key += authorization;
+
+        const auto verified_it = verified_credentials_.find(cache_key);
+        if ( verified_it != verified_credentials_.end() ) {
+            return now < verified_it->second ? AUTHENTICATED : STALE_NONCE;
+        }
+
+        DigestCredentials credentials;
+        if ( !parseDigestCredentials(authorization, &credentials) ) {
+            return UNAUTHENTICATED;
+        }
+
+        const auto user_it = ha1_by_user_.find(credentials.username);
+        if ( user_it == ha1_by_user_.end() ) {
+            return UNAUTHENTICATED;
+        }
+
+        std::time_t nonce_issue_time;
+        if ( !verifyNonce(credentials.nonce, &nonce_issue_time) ) {
+            return UNAUTHENTICATED;
+        }
+
+        char ha2[kMD5_HEX_LENGTH + 1],
+             expected_response[kMD5_HEX_LENGTH + 1];
+        mg_md5(ha2, method.c_str(), ":", credentials.uri.c_str(), NULL);
+        mg_md5(expected_response, user_it->second.c_str(), ":", credentials.nonce.c_str(), ":", credentials.nc.c_str(),
+               ":", credentials.cnonce.c_str(), ":", credentials.qop.c_str(), ":", ha2, NULL);
+        if ( !constantTimeEquals(boost::algorithm::to_lower_copy(credentials.response), expected_response) ) {
+            return UNAUTHENTICATED;
+        }
+
+        const std::time_t nonce_expiration = nonce_issue_time + kNONCE_LIFETIME;
+        if (verified_credentials_.size() >= kMAX_VERIFIED_CREDENTIALS_COUNT) {
+            verified_credentials_.clear(); // it is just a cache.
+        }
+        verified_credentials_[cache_key] = nonce_expiration;
+        return now < nonce_expiration ? AUTHENTICATED : STALE_NONCE;
     }
 
     const std::string& realm() const {
         return realm_;
     }
 
-    unsigned long generate_nonce() const {
-        return (unsigned long)time(nullptr);
+    //! Nonce is hex time of issue followed by MD5 signature of it.
+    std::string generateNonce() const {
+        const std::string issue_time = MakeString() << std::hex << static_cast<unsigned long long>( std::time(nullptr) );
+        return issue_time + nonceSignature(issue_time);
+    }
+
+    //! Returns true if nonce was issued by this object. Expiration is not checked.
+    bool verifyNonce(const std::string& nonce, std::time_t* issue_time) const {
+        if (nonce.size() <= kMD5_HEX_LENGTH || nonce.size() > kMD5_HEX_LENGTH + 16) {
+            return false;
+        }
+        const std::string time_hex = nonce.substr(0, nonce.size() - kMD5_HEX_LENGTH);
+        if ( !constantTimeEquals(nonce.substr(time_hex.size()), nonceSignature(time_hex)) ) {
+            return false;
+        }
+        *issue_time = static_cast<std::time_t>( _strtoui64(time_hex.c_str(), nullptr, 16) );
+        return true;
+    }
+
+    std::string nonceSignature(const std::string& issue_time) const {
+        char signature[kMD5_HEX_LENGTH + 1];
+        mg_md5(signature, secret_.c_str(), ":", issue_time.c_str(), ":", secret_.c_str(), NULL);
+        return signature;
+    }
+
+    std::string randomHex(size_t size) const {
+        std::vector<BYTE> data(size);
+        if ( !CryptGenRandom(crypt_provider_, static_cast<DWORD>(size), &data[0]) ) {
+            throw std::runtime_error( MakeString() << "Failed to generate random data for authentication. Error code: " << GetLastError() );
+        }
+        return toHex(&data[0], size);
     }
 };
 
-const std::string AuthManager::Impl::kHEADER_AUTHORIZATION_NAME = "Authorization";
 
 AuthManager::AuthManager()
     : impl_(new Impl())
@@ -151,7 +461,11 @@ bool AuthManager::enabled() const {
     return impl_->enabled();
 }
 
-bool AuthManager::isAuthenticated(const Request& req) const {
+AuthManager::Result AuthManager::authenticate(const Request& req, std::string* new_session_token) {
+    return impl_->authenticate(req, new_session_token);
+}
+
+bool AuthManager::isAuthenticated(const Request& req) {
     return impl_->isAuthenticated(req);
 }
 
@@ -159,8 +473,12 @@ const std::string& AuthManager::realm() const {
     return impl_->realm();
 }
 
-unsigned long AuthManager::generate_nonce() const {
-    return impl_->generate_nonce();
+std::string AuthManager::generateNonce() const {
+    return impl_->generateNonce();
+}
+
+const char* AuthManager::sessionCookieName() {
+    return kSESSION_COOKIE_NAME;
 }
 
 } // namespace Authentication
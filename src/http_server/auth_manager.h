@@ -1,6 +1,9 @@
 #pragma once
 
 #include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+#include <memory>
+#include <string>
 
 namespace Http
 {
@@ -10,19 +13,42 @@ struct Request;
 namespace Authentication
 {
 
+/*!
+    \brief Digest authentication(RFC 2617, qop="auth") of HTTP requests by users of .htpasswd file in plugin directory.
+           Client which passed Digest check gets session token in cookie, its next requests are authenticated by one hash lookup.
+           Nonces are not stored: nonce contains time of issue signed by secret of plugin instance, it expires after an hour.
+           Can be used from any thread: upload requests are checked in connection I/O thread before their content is written to disk.
+*/
 class AuthManager : private boost::noncopyable
 {
 public:
-    AuthManager();
+
+    enum Result {
+        AUTHENTICATED,
+        UNAUTHENTICATED,
+        STALE_NONCE //!< credentials are valid but nonce is expired, client should repeat request with new nonce without asking user.
+    };
+
+    AuthManager(); // throws std::runtime_error
     ~AuthManager();
 
     bool enabled() const;
 
-    bool isAuthenticated(const Request&) const; 
+    /*!
+        \param new_session_token - receives token of new session if request was authenticated by Digest credentials, empty string otherwise.
+                                   Client should get it in cookie named sessionCookieName().
+    */
+    Result authenticate(const Request& req, std::string* new_session_token);
+
+    //! Returns true if request carries valid session cookie or Digest credentials. Session is not created.
+    bool isAuthenticated(const Request& req);
 
     const std::string& realm() const;
 
-    unsigned long generate_nonce() const;
+    //! Returns new nonce for WWW-Authenticate header.
+    std::string generateNonce() const;
+
+    static const char* sessionCookieName();
 
 private:
 
@@ -30,5 +56,7 @@ private:
     std::unique_ptr<Impl> impl_;
 };
 
+typedef boost::shared_ptr<AuthManager> AuthManager_ptr;
+
 } // namespace Authentication
-} // namespace Http
\ No newline at end of file
+} // namespace Http
@@ -0,0 +1,35 @@
+// Copyright (c) 2014, Alexey Ivanov
+
+#include "stdafx.h"
+#include "compression_stats.h"
+
+namespace Http
+{
+
+CompressionStats::CompressionStats()
+{
+    counters_.responses_count = counters_.chunked_responses_count = 0;
+    counters_.original_bytes = counters_.compressed_bytes = 0;
+    counters_.seconds = 0;
+}
+
+CompressionStats::Counters CompressionStats::add(bool chunked, boost::uint64_t original_bytes, boost::uint64_t compressed_bytes, double seconds)
+{
+    boost::mutex::scoped_lock lock(mutex_);
+    ++counters_.responses_count;
+    if (chunked) {
+        ++counters_.chunked_responses_count;
+    }
+    counters_.original_bytes += original_bytes;
+    counters_.compressed_bytes += compressed_bytes;
+    counters_.seconds += seconds;
+    return counters_;
+}
+
+CompressionStats::Counters CompressionStats::counters() const
+{
+    boost::mutex::scoped_lock lock(mutex_);
+    return counters_;
+}
+
+} // namespace Http
@@ -0,0 +1,46 @@
+// Copyright (c) 2014, Alexey Ivanov
+
+#pragma once
+
+#include <boost/cstdint.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+
+namespace Http
+{
+
+/*!
+    \brief Counters of RPC responses compression.
+           Responses are compressed by connections in I/O threads, so methods are synchronized.
+           Connections share ownership of it, so they can count responses after request handler is destroyed.
+*/
+class CompressionStats : boost::noncopyable
+{
+public:
+
+    struct Counters
+    {
+        unsigned int responses_count, //!< all compressed responses including chunked ones.
+                     chunked_responses_count; //!< responses which content was produced by portions(Reply::content_producer).
+        boost::uint64_t original_bytes,
+                        compressed_bytes;
+        double seconds; //!< total time spent in compression.
+    };
+
+    CompressionStats();
+
+    //! Counts compressed response. Returns counters including it.
+    Counters add(bool chunked, boost::uint64_t original_bytes, boost::uint64_t compressed_bytes, double seconds);
+
+    Counters counters() const;
+
+private:
+
+    Counters counters_;
+    mutable boost::mutex mutex_;
+};
+
+typedef boost::shared_ptr<CompressionStats> CompressionStats_ptr;
+
+} // namespace Http
@@ -4,11 +4,15 @@
 // file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
 
 #include "stdafx.h"
+#include <algorithm>
 #include <vector>
 #include <boost/bind.hpp>
+#include <boost/lexical_cast.hpp>
 #include "connection.h"
 #include "http_server/request_handler.h"
 #include "plugin/logger.h"
+#include "plugin/player_thread_dispatcher.h"
+#include "utils/gzip_encoder.h"
 
 //#include <ctime>
 //#include <iostream>
@@ -20,21 +24,25 @@ namespace TransmitFile {
 
 #if defined(BOOST_ASIO_HAS_WINDOWS_OVERLAPPED_PTR)
 
-using boost::asio::ip::tcp;
 using boost::asio::windows::overlapped_ptr;
 using boost::asio::windows::random_access_handle;
 
 // A wrapper for the TransmitFile overlapped I/O operation.
+// Sends length bytes of file starting from offset. Length must not be zero since TransmitFile treats zero as whole file.
 template <typename SocketT, typename Handler>
 void transmit_file(SocketT& socket,
-    random_access_handle& file, Handler handler)
+    random_access_handle& file, boost::uint64_t offset, DWORD length, Handler handler)
 {
+  assert(length != 0);
+
   // Construct an OVERLAPPED-derived object to contain the handler.
   overlapped_ptr overlapped(socket.get_io_service(), handler);
+  overlapped.get()->Offset = static_cast<DWORD>(offset & 0xFFFFFFFF);
+  overlapped.get()->OffsetHigh = static_cast<DWORD>(offset >> 32);
 
   // Initiate the TransmitFile operation.
   BOOL ok = ::TransmitFile(socket.native_handle(),
-      file.native_handle(), 0, 0, overlapped.get(), 0, 0);
+      file.native_handle(), length, 0, overlapped.get(), 0, 0);
   DWORD last_error = ::GetLastError();
 
   // Check if the operation completed immediately.
@@ -55,99 +63,115 @@ void transmit_file(SocketT& socket,
   }
 }
 
-template <typename SocketT>
-class connection
-  : public boost::enable_shared_from_this< connection<SocketT> >,
-	private boost::noncopyable
-{
-public:
-  typedef boost::shared_ptr< connection<SocketT> > pointer;
+#else // defined(BOOST_ASIO_HAS_WINDOWS_OVERLAPPED_PTR)
+# error Overlapped I/O not available on this platform
+#endif // defined(BOOST_ASIO_HAS_WINDOWS_OVERLAPPED_PTR)
 
-  static pointer create(boost::asio::io_service& io_service,
-						std::unique_ptr<SocketT> socket,
-                        const std::wstring& filename)
-  {
-    return pointer(new connection(io_service, std::move(socket), filename));
-  }
+} // namespace TransmitFile
 
-  SocketT& socket()
-  {
-    assert(socket_);
-    return *socket_;
-  }
+namespace {
 
-  void start()
-  {
-    boost::system::error_code ec;
-    HANDLE h = ::CreateFile(filename_.c_str(), GENERIC_READ, FILE_SHARE_READ, 0,
-                            OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_OVERLAPPED, 0);
-    if (h == INVALID_HANDLE_VALUE) {
-        BOOST_LOG_SEV(logger(), error) << "TransmitFile. CreateFile error: " << GetLastError();
-    }
+const std::string kCONNECTION_HEADER_NAME = "Connection";
 
-    file_.assign(h, ec);
-    if (file_.is_open())
-    {
-      transmit_file(socket(), file_,
-          boost::bind(&connection::handle_write, shared_from_this(),
-            boost::asio::placeholders::error,
-            boost::asio::placeholders::bytes_transferred));
-    }
-  }
+/// File is sent by portions of this size, so TransmitFile operations of concurrent downloads interleave.
+const DWORD kFILE_CHUNK_SIZE = 1024 * 1024;
 
-private:
-  connection(boost::asio::io_service& io_service, std::unique_ptr<SocketT> socket, const std::wstring& filename)
-    : socket_(std::move(socket)),
-      filename_(filename),
-      file_(io_service)
-  {
-	assert(socket_);
-  }
+/// WebSocket client is pinged with this interval and is disconnected if it sends nothing between two pings.
+const long kWEBSOCKET_PING_INTERVAL_SEC = 30;
 
-  void handle_write(const boost::system::error_code& /*error*/,
-                    size_t /*bytes_transferred*/)
-  {
-    boost::system::error_code ignored_ec;
-    socket_->shutdown(SocketT::shutdown_both, ignored_ec);
-  }
+/// Message of WebSocket client which exceeded request rate is retried after this delay, token bucket refills meanwhile.
+const long kWEBSOCKET_THROTTLE_DELAY_MS = 100;
 
-  std::unique_ptr<SocketT> socket_;
-  std::wstring filename_;
-  random_access_handle file_;
-};
+/// Does nothing, it is posted to player thread to destroy bound object there.
+void keepUntilPlayerThread(ContentProducer_ptr /*producer*/)
+{}
 
-#else // defined(BOOST_ASIO_HAS_WINDOWS_OVERLAPPED_PTR)
-# error Overlapped I/O not available on this platform
-#endif // defined(BOOST_ASIO_HAS_WINDOWS_OVERLAPPED_PTR)
+/// Returns IP address of client. Port is not included since each connection of client has its own port.
+std::string remoteAddress(boost::asio::ip::tcp::socket& socket)
+{
+    boost::system::error_code ec;
+    const boost::asio::ip::tcp::endpoint endpoint = socket.remote_endpoint(ec);
+    return ec ? std::string() : endpoint.address().to_string();
+}
 
-} // namespace TransmitFile
+/// Returns address of bluetooth client.
+template <typename SocketT>
+std::string remoteAddress(SocketT& socket)
+{
+    boost::system::error_code ec;
+    const typename SocketT::endpoint_type endpoint = socket.remote_endpoint(ec);
+    return ec ? std::string() : boost::lexical_cast<std::string>(endpoint);
+}
+
+/// Returns true if client asks to keep connection alive: HTTP/1.1 connections are persistent by default, HTTP/1.0 ones need "Connection: keep-alive" header.
+bool isKeepAliveRequested(const Request& req)
+{
+    const std::string* connection_value;
+    if ( get_header_value(req, HEADER_CONNECTION, connection_value) ) {
+        if ( boost::iequals(*connection_value, "close") ) {
+            return false;
+        }
+        if ( boost::iequals(*connection_value, "keep-alive") ) {
+            return true;
+        }
+    }
+    return req.http_version_major > 1 || (req.http_version_major == 1 && req.http_version_minor >= 1);
+}
+
+} // namespace anonymous
 
 template <typename SocketT>
-Connection<SocketT>::Connection(boost::asio::io_service& io_service, RequestHandler& handler)
+Connection<SocketT>::Connection(boost::asio::io_service& io_service,
+                                RequestHandler& handler,
+                                ControlPlugin::PlayerThreadDispatcher& player_thread_dispatcher,
+                                const KeepAliveSettings& keep_alive_settings)
     :
     strand_(io_service),
     socket_(std::unique_ptr<SocketT>(new SocketT(io_service))),
-    request_handler_(handler)
+    request_handler_(handler),
+    admission_control_( handler.admission_control() ),
+    compression_stats_( handler.compression_stats() ),
+    player_thread_dispatcher_(player_thread_dispatcher),
+    admitted_(false),
+    buffer_(kMIN_BUFFER_SIZE),
+    buffer_filled_(false),
+    unparsed_data_begin_(nullptr),
+    unparsed_data_end_(nullptr),
+    keep_alive_settings_(keep_alive_settings),
+    idle_timer_(io_service),
+    file_(io_service),
+    file_offset_(0),
+    file_remaining_(0),
+    chunks_original_bytes_(0),
+    chunks_compressed_bytes_(0),
+    chunks_compression_seconds_(0),
+    waiting_for_request_(false),
+    keep_alive_(false),
+    requests_count_(0)
 {
     try {
-        BOOST_LOG_SEV(logger(), info) << "Creating connection to host " << socket().remote_endpoint();
+        AIMP_LOG_SEV(logger(), info) << "Creating connection to host " << socket().remote_endpoint();
     } catch (boost::system::system_error&) {
-        BOOST_LOG_SEV(logger(), info) << "Creating connection.";
+        AIMP_LOG_SEV(logger(), info) << "Creating connection.";
     }
 }
 
 template <typename SocketT>
 Connection<SocketT>::~Connection()
 {
+    if (admitted_) {
+        admission_control_->connectionClosed(client_address_);
+    }
+
     ///!!! TODO: avoid pointer.
     if (socket_) {
         try {
-            BOOST_LOG_SEV(logger(), info) << "Destroying connection to host " << socket().remote_endpoint();
+            AIMP_LOG_SEV(logger(), info) << "Destroying connection to host " << socket().remote_endpoint();
         } catch (boost::system::system_error&) {
-            BOOST_LOG_SEV(logger(), info) << "Destroying connection.";
+            AIMP_LOG_SEV(logger(), info) << "Destroying connection.";
         }
     } else {
-        BOOST_LOG_SEV(logger(), info) << "Socket was passed to another connection.";
+        AIMP_LOG_SEV(logger(), info) << "Socket was passed to another connection.";
     }
 }
 
@@ -161,12 +185,122 @@ SocketT& Connection<SocketT>::socket()
 template <typename SocketT>
 void Connection<SocketT>::start()
 {
+    client_address_ = remoteAddress( socket() );
+    admitted_ = admission_control_->admitConnection(client_address_);
+    if (!admitted_) {
+        // do not wait for request, client gets reply as soon as possible.
+        strand_.post( boost::bind(&Connection<SocketT>::reject,
+                                  shared_from_this(),
+                                  Reply::service_unavailable
+                                  )
+                     );
+        return;
+    }
+
+    start_idle_timer();
     read_some_to_buffer();
 }
 
+template <typename SocketT>
+void Connection<SocketT>::reject(Reply::status_type status)
+{
+    keep_alive_ = false;
+    reply_ = AdmissionControl::rejectReply(status);
+    write_reply_content();
+}
+
+template <typename SocketT>
+void Connection<SocketT>::start_idle_timer()
+{
+    waiting_for_request_ = true;
+    if (keep_alive_settings_.timeout == 0) {
+        return; // connections are not persistent, wait for first request as long as client wants.
+    }
+
+    idle_timer_.expires_from_now( boost::posix_time::seconds(keep_alive_settings_.timeout) );
+    idle_timer_.async_wait( strand_.wrap(boost::bind(&Connection<SocketT>::handle_idle_timeout,
+                                                     shared_from_this(),
+                                                     boost::asio::placeholders::error
+                                                     )
+                                         )
+                           );
+}
+
+template <typename SocketT>
+void Connection<SocketT>::handle_idle_timeout(const boost::system::error_code& e)
+{
+    // timer can expire right before request was received or restarted, so check state and deadline too.
+    if (   e != boost::asio::error::operation_aborted && waiting_for_request_ && socket_
+        && idle_timer_.expires_at() <= boost::asio::deadline_timer::traits_type::now()
+        )
+    {
+        // Close connection, this cancels pending read operation.
+        boost::system::error_code ignored_ec;
+        socket().shutdown(SocketT::shutdown_both, ignored_ec);
+        socket().close(ignored_ec);
+    }
+}
+
+template <typename SocketT>
+void Connection<SocketT>::start_next_request()
+{
+    reply_.status = Reply::ok;
+    reply_.headers.clear();
+    reply_.content.clear(); // keep allocated memory for next reply.
+    reply_.shared_content.reset();
+    reply_.filename.clear();
+    reply_.file_offset = reply_.file_length = 0;
+    reply_.compress_content = false;
+    reply_.content_producer.reset();
+    reply_.compression_level = 0;
+    request_parser_.reset();
+
+    start_idle_timer();
+
+    if (unparsed_data_begin_ != unparsed_data_end_) {
+        // pipelined request was already read.
+        parse_buffer(unparsed_data_begin_, unparsed_data_end_);
+    } else {
+        if (buffer_.size() > kMIN_BUFFER_SIZE) {
+            // typical request fits in small buffer, do not keep memory of idle connection.
+            std::vector<char>(kMIN_BUFFER_SIZE).swap(buffer_);
+        }
+        buffer_filled_ = false;
+        read_some_to_buffer();
+    }
+}
+
+template <typename SocketT>
+void Connection<SocketT>::prepare_reply(Reply& reply)
+{
+    // Persistent connection requires content length to be known by client. 304 reply has no body by definition.
+    // Produced content is delimited by chunked transfer encoding.
+    const std::string* content_length_value;
+    if (   keep_alive_
+        && reply.status != Reply::not_modified
+        && !reply.content_producer
+        && !get_header_value(reply.headers, "Content-Length", content_length_value)
+        )
+    {
+        keep_alive_ = false;
+    }
+
+    reply.headers.push_back(header());
+    reply.headers.back().name = kCONNECTION_HEADER_NAME;
+    reply.headers.back().value = keep_alive_ ? "keep-alive" : "close";
+}
+
 template <typename SocketT>
 void Connection<SocketT>::read_some_to_buffer()
 {
+    assert(unparsed_data_begin_ == unparsed_data_end_);
+
+    if ( buffer_filled_ && buffer_.size() < kMAX_BUFFER_SIZE ) {
+        // client sends a lot of data, read it by larger portions. Old content is already parsed, do not copy it.
+        std::vector<char>(buffer_.size() * 2).swap(buffer_);
+        buffer_filled_ = false;
+    }
+
     socket().async_read_some(boost::asio::buffer(buffer_),
                             strand_.wrap(boost::bind(&Connection<SocketT>::handle_read,
                                                      shared_from_this(),
@@ -180,6 +314,31 @@ void Connection<SocketT>::read_some_to_buffer()
 template <typename SocketT>
 void Connection<SocketT>::write_reply_content()
 {
+    if (reply_.content_producer) {
+        // send content by portions as producer makes them.
+        if (reply_.compression_level != 0) {
+            // content encoding headers were added by request handler.
+            chunk_encoder_.reset( new Utilities::GzipEncoder(reply_.compression_level, &encoded_chunk_) );
+            chunks_original_bytes_ = chunks_compressed_bytes_ = 0;
+            chunks_compression_seconds_ = 0;
+        }
+        prepare_reply(reply_);
+        boost::asio::async_write(socket(),
+                                 reply_.to_buffers_headers_only(),
+                                 strand_.wrap(boost::bind(&Connection<SocketT>::handle_write_headers_on_chunked_sending,
+                                                          shared_from_this(),
+                                                          boost::asio::placeholders::error
+                                                          )
+                                              )
+                                 );
+        return;
+    }
+
+    if (reply_.compress_content) {
+        request_handler_.compressReplyContent(reply_); // compress here, not in player thread.
+    }
+    prepare_reply(reply_);
+
     if ( !reply_.filename.empty() ) {
         // send large file.
         boost::asio::async_write(socket(),
@@ -208,25 +367,12 @@ void Connection<SocketT>::handle_read(const boost::system::error_code& e,
                                       std::size_t bytes_transferred)
 {
     if (!e) {
-        boost::tribool result;
-        boost::tie(result, boost::tuples::ignore) = request_parser_.parse(request_,
-                                                                          buffer_.data(),
-                                                                          buffer_.data() + bytes_transferred
-                                                                          );
-        if (result) {
-            ICometDelayedConnection_ptr comet_connection( new CometDelayedConnection<SocketT>( shared_from_this() ) );
-            bool reply_immediately = request_handler_.handle_request(request_, reply_, comet_connection);
-            if (reply_immediately) {
-                write_reply_content();
-            }
-        } else if (!result) {
-            reply_ = Reply::stock_reply(Reply::bad_request);
-            write_reply_content();
-        } else {
-            read_some_to_buffer();
-        }
+        buffer_filled_ = bytes_transferred == buffer_.size();
+        parse_buffer(&buffer_[0], &buffer_[0] + bytes_transferred);
     } else {
-        // BOOST_LOG_SEV(logger(), debug) << "Connection<SocketT>::handle_read(): failed to read data. Reason: " << e.message();
+        // AIMP_LOG_SEV(logger(), debug) << "Connection<SocketT>::handle_read(): failed to read data. Reason: " << e.message();
+        boost::system::error_code ignored_ec;
+        idle_timer_.cancel(ignored_ec);
     }
 
     // If an error occurs then no new asynchronous operations are started. This
@@ -235,10 +381,73 @@ void Connection<SocketT>::handle_read(const boost::system::error_code& e,
     // handler returns. The Connection class's destructor closes the socket.
 }
 
+template <typename SocketT>
+void Connection<SocketT>::parse_buffer(char* begin, char* end)
+{
+    boost::tribool result;
+    boost::tie(result, unparsed_data_begin_) = request_parser_.parse(request_, begin, end);
+    unparsed_data_end_ = end;
+
+    if (result || !result) {
+        waiting_for_request_ = false;
+        boost::system::error_code ignored_ec;
+        idle_timer_.cancel(ignored_ec);
+    }
+
+    if (result) {
+        ++requests_count_;
+        keep_alive_ =    keep_alive_settings_.timeout != 0
+                      && requests_count_ < keep_alive_settings_.max_requests
+                      && isKeepAliveRequested(request_);
+
+        if ( !admission_control_->admitRequest(client_address_) ) {
+            // reject burst here in I/O thread, it must not reach player thread.
+            reply_ = AdmissionControl::rejectReply(Reply::too_many_requests);
+            write_reply_content();
+            return;
+        }
+
+        // request handler works with AIMP, so pass request to player thread.
+        player_thread_dispatcher_.post( boost::bind(&Connection<SocketT>::handle_request,
+                                                    shared_from_this()
+                                                    )
+                                       );
+    } else if (!result) {
+        keep_alive_ = false;
+        reply_ = Reply::stock_reply(Reply::bad_request);
+        write_reply_content();
+    } else {
+        // request is not complete yet: timeout counts from the last received portion, so large uploads are not interrupted.
+        if (begin != end) {
+            start_idle_timer();
+        }
+        read_some_to_buffer();
+    }
+}
+
+template <typename SocketT>
+void Connection<SocketT>::handle_request()
+{
+    ICometDelayedConnection_ptr comet_connection( new CometDelayedConnection<SocketT>( shared_from_this() ) );
+    bool reply_immediately = request_handler_.handle_request(request_, reply_, comet_connection);
+    if (reply_immediately) {
+        // return to I/O thread.
+        strand_.post( boost::bind(&Connection<SocketT>::write_reply_content,
+                                  shared_from_this()
+                                  )
+                     );
+    }
+}
+
 template <typename SocketT>
 void Connection<SocketT>::handle_write(const boost::system::error_code& e)
 {
     if (!e) {
+        if (keep_alive_) {
+            start_next_request();
+            return;
+        }
+
         // Initiate graceful connection closure.
         boost::system::error_code ignored_ec;
         socket().shutdown(SocketT::shutdown_both, ignored_ec);
@@ -253,29 +462,291 @@ void Connection<SocketT>::handle_write(const boost::system::error_code& e)
 template <typename SocketT>
 void Connection<SocketT>::handle_write_headers_on_file_sending(const boost::system::error_code& e)
 {
-    if (!e) {
-        // http headers were sent successfully, now send file content.
-        typedef TransmitFile::connection<SocketT> TransmitFileConnection;
-        TransmitFileConnection::pointer tfc = TransmitFileConnection::create(strand_.get_io_service(),
-                                                                             std::move(socket_), // this object is not socket owner anymore.
-																		     reply_.filename);
-        assert(!socket_);
-        
-        tfc->start();
+    if (e) {
+        return;
     }
 
-    // No new asynchronous operations are started. This means that all shared_ptr
-    // references to the connection object will disappear and the object will be
-    // destroyed automatically after this handler returns.
-    // All file transferring work will do TransmitFileConnection.
+    // http headers were sent successfully, now send file content.
+    HANDLE h = ::CreateFileW(reply_.filename.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, 0,
+                             OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_OVERLAPPED | FILE_FLAG_SEQUENTIAL_SCAN, 0);
+    if (h == INVALID_HANDLE_VALUE) {
+        AIMP_LOG_SEV(logger(), error) << "TransmitFile. CreateFile error: " << GetLastError();
+    } else {
+        boost::system::error_code ec;
+        file_.assign(h, ec);
+        if (!ec) {
+            file_offset_ = reply_.file_offset;
+            file_remaining_ = reply_.file_length;
+            transmit_next_file_chunk();
+            return;
+        }
+        ::CloseHandle(h);
+    }
+
+    // client already got Content-Length, so the only way to report error is to close connection.
+    boost::system::error_code ignored_ec;
+    socket().shutdown(SocketT::shutdown_both, ignored_ec);
+}
+
+template <typename SocketT>
+void Connection<SocketT>::transmit_next_file_chunk()
+{
+    if (file_remaining_ == 0) {
+        boost::system::error_code ignored_ec;
+        file_.close(ignored_ec);
+        handle_write( boost::system::error_code() );
+        return;
+    }
+
+    const DWORD chunk_size = static_cast<DWORD>( std::min<boost::uint64_t>(file_remaining_, kFILE_CHUNK_SIZE) );
+    TransmitFile::transmit_file(socket(), file_, file_offset_, chunk_size,
+                                strand_.wrap(boost::bind(&Connection<SocketT>::handle_file_chunk_sent,
+                                                         shared_from_this(),
+                                                         boost::asio::placeholders::error,
+                                                         boost::asio::placeholders::bytes_transferred
+                                                         )
+                                             )
+                                );
+}
+
+template <typename SocketT>
+void Connection<SocketT>::handle_file_chunk_sent(const boost::system::error_code& e, std::size_t bytes_transferred)
+{
+    if (e || bytes_transferred == 0) {
+        boost::system::error_code ignored_ec;
+        file_.close(ignored_ec);
+        socket().shutdown(SocketT::shutdown_both, ignored_ec);
+        return;
+    }
+
+    file_offset_ += bytes_transferred;
+    file_remaining_ -= std::min<boost::uint64_t>(bytes_transferred, file_remaining_);
+    transmit_next_file_chunk();
+}
+
+template <typename SocketT>
+void Connection<SocketT>::handle_write_headers_on_chunked_sending(const boost::system::error_code& e)
+{
+    if (e) {
+        release_content_producer();
+        return;
+    }
+
+    player_thread_dispatcher_.post( boost::bind(&Connection<SocketT>::produce_next_chunk,
+                                                shared_from_this()
+                                                )
+                                   );
+}
+
+template <typename SocketT>
+void Connection<SocketT>::produce_next_chunk()
+{
+    chunk_.clear(); // strand does not touch chunk_ till write_chunk() is posted.
+    bool last;
+    try {
+        last = !reply_.content_producer->produce(&chunk_, kCHUNK_SIZE);
+    } catch (std::exception& e) {
+        AIMP_LOG_SEV(logger(), error) << "Reply content producing failed, connection is closed. Reason: " << e.what();
+        reply_.content_producer.reset();
+        strand_.post( boost::bind(&Connection<SocketT>::abort_chunked_reply,
+                                  shared_from_this()
+                                  )
+                     );
+        return;
+    }
+
+    if (last) {
+        reply_.content_producer.reset(); // release DB statements in player thread.
+    }
+
+    // return to I/O thread.
+    strand_.post( boost::bind(&Connection<SocketT>::write_chunk,
+                              shared_from_this(),
+                              last
+                              )
+                 );
+}
+
+template <typename SocketT>
+void Connection<SocketT>::write_chunk(bool last)
+{
+    const std::string* data = &chunk_;
+    if (chunk_encoder_) {
+        // compress here, not in player thread. Encoder appends to encoded_chunk_ only complete deflate blocks, so it can be empty.
+        const boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+        chunk_encoder_->write( chunk_.data(), chunk_.size() );
+        if (last) {
+            chunk_encoder_->finish();
+        }
+        chunks_compression_seconds_ += (boost::posix_time::microsec_clock::universal_time() - start).total_microseconds() / 1e6;
+        chunks_original_bytes_ += chunk_.size();
+        chunks_compressed_bytes_ += encoded_chunk_.size();
+        if (last) {
+            chunk_encoder_.reset();
+            compression_stats_->add(true, chunks_original_bytes_, chunks_compressed_bytes_, chunks_compression_seconds_);
+        }
+        data = &encoded_chunk_;
+    }
+
+    static const char kCRLF[] = { '\r', '\n' };
+    static const char kLAST_CHUNK[] = { '0', '\r', '\n', '\r', '\n' };
+
+    std::vector<boost::asio::const_buffer> buffers;
+    if ( !data->empty() ) { // zero-size chunk would end content.
+        char size_line[20];
+        sprintf_s( size_line, "%X\r\n", static_cast<unsigned int>( data->size() ) );
+        chunk_size_line_ = size_line;
+        buffers.push_back( boost::asio::buffer(chunk_size_line_) );
+        buffers.push_back( boost::asio::buffer(*data) );
+        buffers.push_back( boost::asio::buffer(kCRLF) );
+    }
+    if (last) {
+        buffers.push_back( boost::asio::buffer(kLAST_CHUNK) );
+    }
+
+    if ( buffers.empty() ) {
+        // encoder keeps whole portion in its window, nothing to send yet.
+        player_thread_dispatcher_.post( boost::bind(&Connection<SocketT>::produce_next_chunk,
+                                                    shared_from_this()
+                                                    )
+                                       );
+        return;
+    }
+
+    boost::asio::async_write(socket(),
+                             buffers,
+                             strand_.wrap(boost::bind(&Connection<SocketT>::handle_write_chunk,
+                                                      shared_from_this(),
+                                                      last,
+                                                      boost::asio::placeholders::error
+                                                      )
+                                          )
+                             );
+}
+
+template <typename SocketT>
+void Connection<SocketT>::handle_write_chunk(bool last, const boost::system::error_code& e)
+{
+    encoded_chunk_.clear();
+    if (e || last) {
+        if (e) {
+            release_content_producer();
+        }
+        handle_write(e);
+        return;
+    }
+
+    player_thread_dispatcher_.post( boost::bind(&Connection<SocketT>::produce_next_chunk,
+                                                shared_from_this()
+                                                )
+                                   );
+}
+
+template <typename SocketT>
+void Connection<SocketT>::abort_chunked_reply()
+{
+    keep_alive_ = false;
+    chunk_encoder_.reset();
+    boost::system::error_code ignored_ec;
+    socket().shutdown(SocketT::shutdown_both, ignored_ec);
+    socket().close(ignored_ec);
+}
+
+template <typename SocketT>
+void Connection<SocketT>::release_content_producer()
+{
+    ContentProducer_ptr producer;
+    producer.swap(reply_.content_producer);
+    if (producer) {
+        // handler holds the last reference, so producer is destroyed in player thread after handler execution.
+        player_thread_dispatcher_.post( boost::bind(&keepUntilPlayerThread, producer) );
+    }
+}
+
+template <typename SocketT>
+void Connection<SocketT>::hold_subscription_slot(SubscriptionSlot_ptr slot)
+{
+    // drop slots of responses which were already sent, so long-lived connection does not accumulate them.
+    subscription_slots_.erase(std::remove_if(subscription_slots_.begin(), subscription_slots_.end(),
+                                             [](const SubscriptionSlot_ptr& held_slot) { return held_slot->released(); }
+                                             ),
+                              subscription_slots_.end()
+                              );
+    subscription_slots_.push_back(slot);
+}
+
+template <typename SocketT>
+void Connection<SocketT>::release_subscription_slots()
+{
+    for (auto& slot : subscription_slots_) {
+        slot->release();
+    }
+    subscription_slots_.clear();
+}
+
+template <typename SocketT>
+void CometDelayedConnection<SocketT>::holdSubscriptionSlot(SubscriptionSlot_ptr slot)
+{
+    // called from player thread, socket should be accessed only from connection's strand.
+    connection_->strand_.post( boost::bind(&CometDelayedConnection<SocketT>::watch_client_close,
+                                           shared_from_this(),
+                                           slot
+                                           )
+                              );
+}
+
+template <typename SocketT>
+void CometDelayedConnection<SocketT>::watch_client_close(SubscriptionSlot_ptr slot)
+{
+    connection_->hold_subscription_slot(slot);
+
+    // null_buffers: wait for readability only, data of next pipelined request stays in socket for connection.
+    connection_->socket().async_read_some( boost::asio::null_buffers(),
+                                           connection_->strand_.wrap(boost::bind(&CometDelayedConnection<SocketT>::handle_client_activity,
+                                                                                 boost::weak_ptr<ConnectionType>(connection_),
+                                                                                 boost::asio::placeholders::error
+                                                                                 )
+                                                                     )
+                                          );
+}
+
+template <typename SocketT>
+void CometDelayedConnection<SocketT>::handle_client_activity(boost::weak_ptr<ConnectionType> weak_connection, const boost::system::error_code& e)
+{
+    ConnectionType_ptr connection = weak_connection.lock();
+    if (!connection) {
+        return; // connection is closed already, slots were released with it.
+    }
+
+    boost::system::error_code ec;
+    if ( e || connection->socket().available(ec) == 0 || ec ) { // readable socket without data means client closed connection.
+        AIMP_LOG_SEV(logger(), debug) << "Client " << connection->client_address_ << " closed connection before delayed response was sent.";
+        connection->release_subscription_slots();
+    }
 }
 
 template <typename SocketT>
 void CometDelayedConnection<SocketT>::sendResponse(DelayedResponseSender_ptr comet_http_response_sender)
 {
-    BOOST_LOG_SEV(logger(), debug) << "CometDelayedConnection::sendResponse to " << connection_->socket().remote_endpoint();
+    // called from player thread, socket should be accessed only from connection's strand.
+    connection_->strand_.post( boost::bind(&CometDelayedConnection<SocketT>::write_response,
+                                           shared_from_this(),
+                                           comet_http_response_sender
+                                           )
+                              );
+}
+
+template <typename SocketT>
+void CometDelayedConnection<SocketT>::write_response(DelayedResponseSender_ptr comet_http_response_sender)
+{
+    AIMP_LOG_SEV(logger(), debug) << "CometDelayedConnection::sendResponse to " << connection_->socket().remote_endpoint();
+    Reply& reply = comet_http_response_sender->get_reply();
+    if (reply.compress_content) {
+        connection_->request_handler_.compressReplyContent(reply);
+    }
+    connection_->prepare_reply(reply);
     boost::asio::async_write( connection_->socket(),
-                              comet_http_response_sender->get_reply().to_buffers(),
+                              reply.to_buffers(),
                               connection_->strand_.wrap(boost::bind(&CometDelayedConnection<SocketT>::handle_write,
                                                                     shared_from_this(),
                                                                     comet_http_response_sender,
@@ -289,20 +760,554 @@ template <typename SocketT>
 void CometDelayedConnection<SocketT>::handle_write(DelayedResponseSender_ptr comet_http_response_sender, const boost::system::error_code& e)
 {
     if (!e) {
-        BOOST_LOG_SEV(logger(), debug) << "CometDelayedConnection::success sending response to " << connection_->socket().remote_endpoint();
-        // Initiate graceful connection closure.
-        boost::system::error_code ignored_ec;
-        connection_->socket().shutdown(SocketT::shutdown_both, ignored_ec);
+        AIMP_LOG_SEV(logger(), debug) << "CometDelayedConnection::success sending response to " << connection_->socket().remote_endpoint();
+        // Continue work of persistent connection or initiate graceful connection closure.
+        connection_->handle_write(e);
     } else {
-        BOOST_LOG_SEV(logger(), debug) << "CometDelayedConnection::fail to send response to "
+        AIMP_LOG_SEV(logger(), debug) << "CometDelayedConnection::fail to send response to "
                                        << connection_->socket().remote_endpoint()
                                        << ". Reason: " << e.message();
     }
 
-    // No new asynchronous operations are started. This means that all shared_ptr
+    // No new asynchronous operations are started by CometDelayedConnection. This means that all shared_ptr
     // references to the CometDelayedConnection object will disappear and the object will be
     // destroyed automatically after this handler returns. The Connection class's
-    // destructor closes the socket.
+    // destructor closes the socket if connection is not persistent.
+}
+
+template <typename SocketT>
+IEventStream_ptr CometDelayedConnection<SocketT>::createEventStream(SubscriptionSlot_ptr slot)
+{
+    return IEventStream_ptr( new EventStream<SocketT>(connection_, slot) );
+}
+
+template <typename SocketT>
+void CometDelayedConnection<SocketT>::startWebSocket(const WebSocket::Settings& settings)
+{
+    boost::shared_ptr< WebSocketConnection<SocketT> > websocket( new WebSocketConnection<SocketT>(connection_, settings) );
+    websocket->start();
+}
+
+template <typename SocketT>
+void EventStream<SocketT>::start()
+{
+    // called from player thread, socket should be accessed only from connection's strand.
+    connection_->strand_.post( boost::bind(&EventStream<SocketT>::write_headers,
+                                           shared_from_this()
+                                           )
+                              );
+}
+
+template <typename SocketT>
+bool EventStream<SocketT>::sendEvent(std::shared_ptr<const std::string> event)
+{
+    if (closed_) {
+        return false;
+    }
+
+    connection_->strand_.post( boost::bind(&EventStream<SocketT>::enqueue_event,
+                                           shared_from_this(),
+                                           event
+                                           )
+                              );
+    return true;
+}
+
+template <typename SocketT>
+void EventStream<SocketT>::write_headers()
+{
+    AIMP_LOG_SEV(logger(), debug) << "EventStream is started for " << connection_->socket().remote_endpoint();
+
+    // stream has no length, it lasts until connection is closed.
+    connection_->keep_alive_ = false;
+    connection_->prepare_reply(connection_->reply_);
+
+    boost::asio::async_write( connection_->socket(),
+                              connection_->reply_.to_buffers_headers_only(),
+                              connection_->strand_.wrap(boost::bind(&EventStream<SocketT>::handle_write_headers,
+                                                                    shared_from_this(),
+                                                                    boost::asio::placeholders::error
+                                                                    )
+                                                        )
+                             );
+}
+
+template <typename SocketT>
+void EventStream<SocketT>::handle_write_headers(const boost::system::error_code& e)
+{
+    writing_ = false;
+    if (e || closed_) {
+        close();
+        return;
+    }
+
+    connection_->socket().async_read_some(boost::asio::buffer(read_buffer_),
+                                          connection_->strand_.wrap(boost::bind(&EventStream<SocketT>::handle_read,
+                                                                                shared_from_this(),
+                                                                                boost::asio::placeholders::error,
+                                                                                boost::asio::placeholders::bytes_transferred
+                                                                                )
+                                                                    )
+                                          );
+    write_next_event();
+}
+
+template <typename SocketT>
+void EventStream<SocketT>::handle_read(const boost::system::error_code& /*e*/, std::size_t /*bytes_transferred*/)
+{
+    // client closed connection or sent unexpected data.
+    close();
+}
+
+template <typename SocketT>
+void EventStream<SocketT>::enqueue_event(std::shared_ptr<const std::string> event)
+{
+    if (closed_) {
+        return;
+    }
+
+    if (events_.size() >= kMAX_QUEUED_EVENTS) {
+        AIMP_LOG_SEV(logger(), debug) << "EventStream: client does not read events, closing connection.";
+        close();
+        return;
+    }
+
+    events_.push_back(event);
+    if (!writing_) {
+        write_next_event();
+    }
+}
+
+template <typename SocketT>
+void EventStream<SocketT>::write_next_event()
+{
+    if ( events_.empty() ) {
+        return;
+    }
+
+    writing_ = true;
+    boost::asio::async_write( connection_->socket(),
+                              boost::asio::buffer( *events_.front() ),
+                              connection_->strand_.wrap(boost::bind(&EventStream<SocketT>::handle_write_event,
+                                                                    shared_from_this(),
+                                                                    events_.front(),
+                                                                    boost::asio::placeholders::error
+                                                                    )
+                                                        )
+                             );
+}
+
+template <typename SocketT>
+void EventStream<SocketT>::handle_write_event(std::shared_ptr<const std::string> /*event*/, const boost::system::error_code& e)
+{
+    writing_ = false;
+    if (e || closed_) { // queue is cleared if stream was closed while event was being written.
+        close();
+        return;
+    }
+
+    events_.pop_front();
+    write_next_event();
+}
+
+template <typename SocketT>
+void EventStream<SocketT>::close()
+{
+    if ( InterlockedExchange(&closed_, 1) != 0 ) {
+        return;
+    }
+
+    events_.clear(); // event being written is kept alive by write handler.
+    subscription_slot_->release(); // client can open new stream right away.
+
+    // pending read and write complete with error, then all shared_ptr references to the stream and connection disappear.
+    boost::system::error_code ignored_ec;
+    connection_->socket().shutdown(SocketT::shutdown_both, ignored_ec);
+    connection_->socket().close(ignored_ec);
+}
+
+template <typename SocketT>
+WebSocketConnection<SocketT>::WebSocketConnection(ConnectionType_ptr connection, const WebSocket::Settings& settings)
+    :
+    connection_(connection),
+    settings_(settings),
+    parser_(settings.deflate),
+    unparsed_data_begin_(connection->unparsed_data_begin_),
+    unparsed_data_end_(connection->unparsed_data_end_),
+    writing_(true), // frames wait in queue until handshake is sent.
+    closing_(false),
+    closed_(0),
+    ping_timer_( connection->socket().get_io_service() ),
+    throttle_timer_( connection->socket().get_io_service() ),
+    ping_pending_(false)
+{}
+
+template <typename SocketT>
+void WebSocketConnection<SocketT>::start()
+{
+    // called from player thread, socket should be accessed only from connection's strand.
+    connection_->strand_.post( boost::bind(&WebSocketConnection<SocketT>::write_handshake,
+                                           shared_from_this()
+                                           )
+                              );
+}
+
+template <typename SocketT>
+void WebSocketConnection<SocketT>::write_handshake()
+{
+    AIMP_LOG_SEV(logger(), debug) << "WebSocket is started for " << connection_->socket().remote_endpoint()
+                                   << (settings_.deflate ? " with" : " without") << " compression";
+
+    // handshake reply must not contain "Connection: close" header, so prepare_reply() is not used.
+    boost::asio::async_write( connection_->socket(),
+                              connection_->reply_.to_buffers_headers_only(),
+                              connection_->strand_.wrap(boost::bind(&WebSocketConnection<SocketT>::handle_write_handshake,
+                                                                    shared_from_this(),
+                                                                    boost::asio::placeholders::error
+                                                                    )
+                                                        )
+                             );
+}
+
+template <typename SocketT>
+void WebSocketConnection<SocketT>::handle_write_handshake(const boost::system::error_code& e)
+{
+    writing_ = false;
+    if (e || closed_) {
+        close();
+        return;
+    }
+
+    start_ping_timer();
+    write_next_frame();
+    continue_reading();
+}
+
+template <typename SocketT>
+void WebSocketConnection<SocketT>::read_some()
+{
+    std::vector<char>& buffer = connection_->buffer_;
+    connection_->socket().async_read_some(boost::asio::buffer(buffer),
+                                          connection_->strand_.wrap(boost::bind(&WebSocketConnection<SocketT>::handle_read,
+                                                                                shared_from_this(),
+                                                                                boost::asio::placeholders::error,
+                                                                                boost::asio::placeholders::bytes_transferred
+                                                                                )
+                                                                    )
+                                          );
+}
+
+template <typename SocketT>
+void WebSocketConnection<SocketT>::handle_read(const boost::system::error_code& e, std::size_t bytes_transferred)
+{
+    if (e || closed_) {
+        close();
+        return;
+    }
+
+    ping_pending_ = false;
+    const char* begin = &connection_->buffer_[0];
+    parse(begin, begin + bytes_transferred);
+}
+
+template <typename SocketT>
+void WebSocketConnection<SocketT>::parse(const char* begin, const char* end)
+{
+    using namespace WebSocket;
+
+    try {
+        while (begin != end) {
+            if ( !parser_.parse(begin, end) ) {
+                break;
+            }
+
+            const FrameParser::Message& message = parser_.message();
+            switch (message.opcode) {
+            case OPCODE_TEXT:
+                // request handler works with AIMP, so pass message to player thread. Rest of data is parsed after message is handled.
+                unparsed_data_begin_ = begin;
+                unparsed_data_end_ = end;
+                dispatch_message( std::make_shared<std::string>(message.payload) );
+                return;
+            case OPCODE_BINARY:
+                start_closing( makeCloseFrame(CLOSE_UNSUPPORTED_DATA) );
+                return;
+            case OPCODE_PING:
+                enqueue_frame( makeFrame(OPCODE_PONG, message.payload, 0) );
+                break;
+            case OPCODE_CLOSE:
+                // echo status of client.
+                start_closing( makeFrame(OPCODE_CLOSE, message.payload.substr(0, 2), 0) );
+                return;
+            default: // pong only confirms that client is alive.
+                break;
+            }
+        }
+    } catch (ProtocolError& e) {
+        AIMP_LOG_SEV(logger(), debug) << "WebSocket: closing connection due to protocol error: " << e.what();
+        start_closing( makeCloseFrame( e.status() ) );
+        return;
+    }
+
+    if (!closed_) {
+        read_some();
+    }
+}
+
+template <typename SocketT>
+void WebSocketConnection<SocketT>::dispatch_message(std::shared_ptr<std::string> message)
+{
+    // message is charged like HTTP request: batch in one message costs one request as in HTTP POST.
+    if ( !connection_->admission_control_->admitRequest( clientAddress() ) ) {
+        // burst must not reach player thread. Client can not send more meanwhile since reading is paused.
+        throttle_timer_.expires_from_now( boost::posix_time::milliseconds(kWEBSOCKET_THROTTLE_DELAY_MS) );
+        throttle_timer_.async_wait( connection_->strand_.wrap(boost::bind(&WebSocketConnection<SocketT>::handle_throttle_timer,
+                                                                          shared_from_this(),
+                                                                          message,
+                                                                          boost::asio::placeholders::error
+                                                                          )
+                                                              )
+                                   );
+        return;
+    }
+
+    // request handler works with AIMP, so pass message to player thread.
+    connection_->player_thread_dispatcher_.post( boost::bind(&WebSocketConnection<SocketT>::handle_message,
+                                                             shared_from_this(),
+                                                             message
+                                                             )
+                                                );
+}
+
+template <typename SocketT>
+void WebSocketConnection<SocketT>::handle_throttle_timer(std::shared_ptr<std::string> message, const boost::system::error_code& e)
+{
+    if (e == boost::asio::error::operation_aborted || closing_ || closed_) {
+        return;
+    }
+
+    dispatch_message(message);
+}
+
+template <typename SocketT>
+void WebSocketConnection<SocketT>::handle_message(std::shared_ptr<std::string> message)
+{
+    if (!closed_) {
+        std::shared_ptr<std::string> response = std::make_shared<std::string>();
+        if ( connection_->request_handler_.handle_websocket_message( *message, response.get(), shared_from_this() ) ) {
+            // return to I/O thread.
+            connection_->strand_.post( boost::bind(&WebSocketConnection<SocketT>::send_message,
+                                                   shared_from_this(),
+                                                   response
+                                                   )
+                                      );
+        }
+    }
+
+    connection_->strand_.post( boost::bind(&WebSocketConnection<SocketT>::continue_reading,
+                                           shared_from_this()
+                                           )
+                              );
+}
+
+template <typename SocketT>
+void WebSocketConnection<SocketT>::continue_reading()
+{
+    if (closing_ || closed_) {
+        return;
+    }
+
+    const char* begin = unparsed_data_begin_;
+    const char* end = unparsed_data_end_;
+    unparsed_data_begin_ = unparsed_data_end_ = nullptr;
+    if (begin != end) {
+        parse(begin, end);
+    } else {
+        read_some();
+    }
+}
+
+template <typename SocketT>
+void WebSocketConnection<SocketT>::send_message(std::shared_ptr<std::string> message)
+{
+    send_text(*message);
+}
+
+template <typename SocketT>
+void WebSocketConnection<SocketT>::send_text(const std::string& text)
+{
+    const int compression_level = settings_.deflate && text.size() >= settings_.compression_min_size ? settings_.compression_level
+                                                                                                      : 0;
+    enqueue_frame( WebSocket::makeFrame(WebSocket::OPCODE_TEXT, text, compression_level) );
+}
+
+template <typename SocketT>
+void WebSocketConnection<SocketT>::sendResponse(DelayedResponseSender_ptr comet_http_response_sender)
+{
+    // called from player thread, socket should be accessed only from connection's strand.
+    connection_->strand_.post( boost::bind(&WebSocketConnection<SocketT>::send_response_content,
+                                           shared_from_this(),
+                                           comet_http_response_sender
+                                           )
+                              );
+}
+
+template <typename SocketT>
+void WebSocketConnection<SocketT>::send_response_content(DelayedResponseSender_ptr comet_http_response_sender)
+{
+    send_text(comet_http_response_sender->get_reply().content);
+}
+
+template <typename SocketT>
+void WebSocketConnection<SocketT>::holdSubscriptionSlot(SubscriptionSlot_ptr slot)
+{
+    // called from player thread, slots of connection are accessed only from connection's strand.
+    connection_->strand_.post( boost::bind(&WebSocketConnection<SocketT>::hold_subscription_slot,
+                                           shared_from_this(),
+                                           slot
+                                           )
+                              );
+}
+
+template <typename SocketT>
+void WebSocketConnection<SocketT>::hold_subscription_slot(SubscriptionSlot_ptr slot)
+{
+    if (closed_) {
+        slot->release();
+        return;
+    }
+    connection_->hold_subscription_slot(slot);
+}
+
+template <typename SocketT>
+IEventStream_ptr WebSocketConnection<SocketT>::createEventStream(SubscriptionSlot_ptr /*slot*/)
+{
+    assert(!"event streams are not supported over WebSocket");
+    return IEventStream_ptr();
+}
+
+template <typename SocketT>
+void WebSocketConnection<SocketT>::startWebSocket(const WebSocket::Settings& /*settings*/)
+{
+    assert(!"connection is already switched to WebSocket");
+}
+
+template <typename SocketT>
+void WebSocketConnection<SocketT>::enqueue_frame(std::shared_ptr<const std::string> frame)
+{
+    if (closing_ || closed_) {
+        return;
+    }
+
+    if (frames_.size() >= kMAX_QUEUED_FRAMES) {
+        AIMP_LOG_SEV(logger(), debug) << "WebSocket: client does not read messages, closing connection.";
+        close();
+        return;
+    }
+
+    frames_.push_back(frame);
+    if (!writing_) {
+        write_next_frame();
+    }
+}
+
+template <typename SocketT>
+void WebSocketConnection<SocketT>::start_closing(std::shared_ptr<const std::string> close_frame)
+{
+    if (closing_ || closed_) {
+        return;
+    }
+
+    frames_.push_back(close_frame);
+    closing_ = true;
+    if (!writing_) {
+        write_next_frame();
+    }
+}
+
+template <typename SocketT>
+void WebSocketConnection<SocketT>::write_next_frame()
+{
+    if ( frames_.empty() ) {
+        if (closing_) {
+            close();
+        }
+        return;
+    }
+
+    writing_ = true;
+    boost::asio::async_write( connection_->socket(),
+                              boost::asio::buffer( *frames_.front() ),
+                              connection_->strand_.wrap(boost::bind(&WebSocketConnection<SocketT>::handle_write_frame,
+                                                                    shared_from_this(),
+                                                                    frames_.front(),
+                                                                    boost::asio::placeholders::error
+                                                                    )
+                                                        )
+                             );
+}
+
+template <typename SocketT>
+void WebSocketConnection<SocketT>::handle_write_frame(std::shared_ptr<const std::string> /*frame*/, const boost::system::error_code& e)
+{
+    writing_ = false;
+    if (e || closed_) { // queue is cleared if connection was closed while frame was being written.
+        close();
+        return;
+    }
+
+    frames_.pop_front();
+    write_next_frame();
+}
+
+template <typename SocketT>
+void WebSocketConnection<SocketT>::start_ping_timer()
+{
+    ping_timer_.expires_from_now( boost::posix_time::seconds(kWEBSOCKET_PING_INTERVAL_SEC) );
+    ping_timer_.async_wait( connection_->strand_.wrap(boost::bind(&WebSocketConnection<SocketT>::handle_ping_timer,
+                                                                  shared_from_this(),
+                                                                  boost::asio::placeholders::error
+                                                                  )
+                                                      )
+                           );
+}
+
+template <typename SocketT>
+void WebSocketConnection<SocketT>::handle_ping_timer(const boost::system::error_code& e)
+{
+    if (e == boost::asio::error::operation_aborted || closing_ || closed_) {
+        return;
+    }
+
+    if (ping_pending_) {
+        AIMP_LOG_SEV(logger(), debug) << "WebSocket: client does not answer ping, closing connection.";
+        close();
+        return;
+    }
+
+    ping_pending_ = true;
+    enqueue_frame( WebSocket::makeFrame( WebSocket::OPCODE_PING, std::string(), 0 ) );
+    start_ping_timer();
+}
+
+template <typename SocketT>
+void WebSocketConnection<SocketT>::close()
+{
+    if ( InterlockedExchange(&closed_, 1) != 0 ) {
+        return;
+    }
+
+    frames_.clear(); // frame being written is kept alive by write handler.
+
+    // pending operations complete with error, then all shared_ptr references to WebSocketConnection and connection disappear.
+    // subscriptions of this connection must not hold slots of client till next event.
+    connection_->release_subscription_slots();
+
+    boost::system::error_code ignored_ec;
+    ping_timer_.cancel(ignored_ec);
+    throttle_timer_.cancel(ignored_ec);
+    connection_->socket().shutdown(SocketT::shutdown_both, ignored_ec);
+    connection_->socket().close(ignored_ec);
 }
 
 } // namespace Http
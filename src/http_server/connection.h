@@ -7,34 +7,65 @@
 #define CONNECTION_H
 
 #include <boost/asio.hpp>
-#include <boost/array.hpp>
+#include <boost/cstdint.hpp>
 #include <boost/noncopyable.hpp>
 #include <boost/shared_ptr.hpp>
 #include <boost/enable_shared_from_this.hpp>
+#include <boost/weak_ptr.hpp>
+#include <deque>
+#include <string>
+#include <vector>
+#include "admission_control.h"
+#include "compression_stats.h"
+#include "event_stream.h"
 #include "reply.h"
 #include "request.h"
 #include "request_parser.h"
+#include "websocket.h"
+
+namespace ControlPlugin { class PlayerThreadDispatcher; }
+namespace Utilities { class GzipEncoder; }
 
 namespace Http {
 
 class RequestHandler;
 
+/// Settings of persistent(keep-alive) connections.
+struct KeepAliveSettings
+{
+    /// Idle time in seconds after which connection is closed. Zero disables persistent connections.
+    unsigned int timeout;
+
+    /// Max count of requests served by one connection.
+    unsigned int max_requests;
+};
+
 /// Represents a single tcp-ip connection from a client.
+/// Connection is persistent(HTTP/1.1 keep-alive): after reply is sent next request is read from the same socket.
+/// Pipelined requests which were read to buffer along with previous one are handled one by one.
 template <typename SocketT>
 class Connection : /*public Connection, */public boost::enable_shared_from_this< Connection<SocketT> >, private boost::noncopyable
 {
     template <typename T>
     friend class CometDelayedConnection;
+    template <typename T>
+    friend class EventStream;
+    template <typename T>
+    friend class WebSocketConnection;
 
 public:
 
     /// Construct a connection with the given io_service.
+    /// Request is handled in player thread by means of player_thread_dispatcher, all I/O is done in io_service threads.
     Connection(boost::asio::io_service& io_service,
-               RequestHandler& handler);
+               RequestHandler& handler,
+               ControlPlugin::PlayerThreadDispatcher& player_thread_dispatcher,
+               const KeepAliveSettings& keep_alive_settings);
 
     ~Connection();
     
     /// Start the first asynchronous operation for the connection.
+    /// Connection over limit of admission control gets 503 reply and is closed.
     void start();
 
     /// Get the socket associated with the connection.
@@ -42,10 +73,33 @@ public:
 
 private:
 
+    /// Send stock reply with Retry-After header and close connection.
+    void reject(Reply::status_type status);
+
+    /// Read next portion of data. Buffer can be resized here since there is no unparsed data which points to it.
     void read_some_to_buffer();
 
+    /// Parse data in range [begin, end) of buffer_ and start handling of request if it is complete.
+    void parse_buffer(char* begin, char* end);
+
+    /// Prepare to read next request on persistent connection.
+    void start_next_request();
+
+    /// Decide if connection will be kept alive after reply and add "Connection" header to reply.
+    void prepare_reply(Reply& reply);
+
+    /// Close connection if it is idle too long or if client stops sending request.
+    /// Timer is restarted on each portion of incomplete request.
+    void start_idle_timer();
+
+    /// Handle completion of idle timer wait.
+    void handle_idle_timeout(const boost::system::error_code& e);
+
     void write_reply_content();
 
+    /// Handle parsed request. Called in player thread.
+    void handle_request();
+
     /// Handle completion of a read operation.
     void handle_read(const boost::system::error_code& e, std::size_t bytes_transferred);
 
@@ -55,6 +109,36 @@ private:
     /// Handle completion of a header write operation.
     void handle_write_headers_on_file_sending(const boost::system::error_code& e);
 
+    /// Send next portion of reply file or finish reply if file is sent.
+    void transmit_next_file_chunk();
+
+    /// Handle completion of file portion sending.
+    void handle_file_chunk_sent(const boost::system::error_code& e, std::size_t bytes_transferred);
+
+    /// Handle completion of header write of reply which content is produced by portions(Reply::content_producer).
+    void handle_write_headers_on_chunked_sending(const boost::system::error_code& e);
+
+    /// Produce next portion of reply content to chunk_. Called in player thread since producer reads playlists DB.
+    void produce_next_chunk();
+
+    /// Send chunk_ with chunked transfer encoding, last chunk is followed by terminating zero-size chunk.
+    void write_chunk(bool last);
+
+    /// Handle completion of chunk sending: produce next portion or finish reply.
+    void handle_write_chunk(bool last, const boost::system::error_code& e);
+
+    /// Close connection since producer failed: client does not get terminating chunk and treats reply as incomplete.
+    void abort_chunked_reply();
+
+    /// Pass content producer of interrupted reply to player thread where it was used, it is destroyed there. Called in strand.
+    void release_content_producer();
+
+    /// Keep subscription slot of pending delayed response until connection is closed. Called in strand.
+    void hold_subscription_slot(SubscriptionSlot_ptr slot);
+
+    /// Release slots of pending delayed responses since client closed connection and will not get them. Called in strand.
+    void release_subscription_slots();
+
     /// Strand to ensure the connection's handlers are not called concurrently.
     boost::asio::io_service::strand strand_;
 
@@ -64,8 +148,69 @@ private:
     /// The handler used to process the incoming request.
     RequestHandler& request_handler_;
 
-    /// Buffer for incoming data.
-    boost::array<char, 8192> buffer_;
+    /// Limits of request handler, connection keeps reference since it can be destroyed after request handler.
+    AdmissionControl_ptr admission_control_;
+
+    /// Compression counters of request handler, compressed chunked replies are counted there.
+    CompressionStats_ptr compression_stats_;
+
+    /// Used to execute request_handler_ in player thread.
+    ControlPlugin::PlayerThreadDispatcher& player_thread_dispatcher_;
+
+    /// IP address of client, it is known after connection was accepted.
+    std::string client_address_;
+
+    /// True if connection was counted by admission control.
+    bool admitted_;
+
+    /// Subscription slots of delayed responses which wait for events, accessed only from strand.
+    std::vector<SubscriptionSlot_ptr> subscription_slots_;
+
+    /// Buffer for incoming data. It starts small and grows twice each time read fills it completely(large content, uploads)
+    /// up to kMAX_BUFFER_SIZE. It shrinks back to kMIN_BUFFER_SIZE when connection starts to wait for next request.
+    std::vector<char> buffer_;
+    bool buffer_filled_;
+    static const std::size_t kMIN_BUFFER_SIZE = 4 * 1024;
+    static const std::size_t kMAX_BUFFER_SIZE = 64 * 1024;
+
+    /// Range of buffer_ which was read but not parsed yet(pipelined requests).
+    char* unparsed_data_begin_;
+    char* unparsed_data_end_;
+
+    const KeepAliveSettings keep_alive_settings_;
+
+    /// Closes idle persistent connection.
+    boost::asio::deadline_timer idle_timer_;
+
+    /// File of reply, it is sent by TransmitFile portion by portion, next portion is sent after previous one was accepted by network stack.
+    boost::asio::windows::random_access_handle file_;
+    boost::uint64_t file_offset_;
+    boost::uint64_t file_remaining_;
+
+    /// Portion of produced reply content which is being sent. Memory is reused, so reply of any size needs about kCHUNK_SIZE bytes.
+    std::string chunk_;
+    static const std::size_t kCHUNK_SIZE = 32 * 1024;
+
+    /// Compressor of produced content if client accepts gzip, it keeps its state between chunks. Compressed data goes to encoded_chunk_.
+    std::unique_ptr<Utilities::GzipEncoder> chunk_encoder_;
+    std::string encoded_chunk_;
+
+    /// Compression totals of current chunked reply, they are added to compression_stats_ when reply is complete.
+    boost::uint64_t chunks_original_bytes_,
+                    chunks_compressed_bytes_;
+    double chunks_compression_seconds_;
+
+    /// Size line of chunk being sent.
+    std::string chunk_size_line_;
+
+    /// True while connection waits for next request.
+    bool waiting_for_request_;
+
+    /// True if connection should be kept alive after current reply is sent.
+    bool keep_alive_;
+
+    /// Count of requests received by connection.
+    unsigned int requests_count_;
 
     /// The incoming request.
     Request request_;
@@ -86,6 +231,19 @@ public:
     virtual ~ICometDelayedConnection() {}
 
     virtual void sendResponse(boost::shared_ptr<Http::DelayedResponseSender> comet_http_response_sender) = 0;
+
+    /// Create stream of server-sent events over this connection. Reply of handled request will be used for stream headers.
+    /// Stream holds admitted subscription slot of client and releases it when it is closed.
+    virtual IEventStream_ptr createEventStream(SubscriptionSlot_ptr slot) = 0;
+
+    /// Switch connection to WebSocket protocol. Reply of handled request must contain handshake.
+    virtual void startWebSocket(const WebSocket::Settings& settings) = 0;
+
+    /// IP address of client, it identifies client for admission control.
+    virtual const std::string& clientAddress() const = 0;
+
+    /// Release subscription slot if client closes connection before delayed response is sent. Called from player thread.
+    virtual void holdSubscriptionSlot(SubscriptionSlot_ptr slot) = 0;
 };
 
 typedef boost::shared_ptr<ICometDelayedConnection> ICometDelayedConnection_ptr;
@@ -104,13 +262,198 @@ public:
 
     virtual void sendResponse(boost::shared_ptr<Http::DelayedResponseSender> comet_http_response_sender);
 
+    virtual IEventStream_ptr createEventStream(SubscriptionSlot_ptr slot);
+
+    virtual void startWebSocket(const WebSocket::Settings& settings);
+
+    virtual const std::string& clientAddress() const
+        { return connection_->client_address_; }
+
+    virtual void holdSubscriptionSlot(SubscriptionSlot_ptr slot);
+
 private:
 
+    /// Hold slot and wait until client closes connection: it sends nothing while it waits for response.
+    void watch_client_close(SubscriptionSlot_ptr slot);
+
+    /// Wait is not canceled after response was sent, so handler does not keep connection alive.
+    static void handle_client_activity(boost::weak_ptr<ConnectionType> connection, const boost::system::error_code& e);
+
+    void write_response(boost::shared_ptr<Http::DelayedResponseSender> comet_http_response_sender);
+
     void handle_write(boost::shared_ptr<Http::DelayedResponseSender> comet_http_response_sender, const boost::system::error_code& e);
 
     ConnectionType_ptr connection_;
 };
 
+/// Stream of server-sent events. Events are queued and written one by one in connection's strand,
+/// event data is shared by all streams without copying.
+/// Client which does not read events fast enough is disconnected, so slow clients do not consume memory.
+template<typename SocketT>
+class EventStream : public IEventStream, public boost::enable_shared_from_this< EventStream<SocketT> >, private boost::noncopyable
+{
+    typedef Connection<SocketT> ConnectionType;
+    typedef boost::shared_ptr<ConnectionType> ConnectionType_ptr;
+
+public:
+    EventStream(ConnectionType_ptr connection, SubscriptionSlot_ptr subscription_slot)
+        :
+        connection_(connection),
+        subscription_slot_(subscription_slot),
+        writing_(true), // events wait in queue until headers are sent.
+        closed_(0)
+    {}
+
+    virtual void start();
+
+    virtual bool sendEvent(std::shared_ptr<const std::string> event);
+
+private:
+
+    /// Max count of events waiting for sending.
+    static const std::size_t kMAX_QUEUED_EVENTS = 64;
+
+    void write_headers();
+
+    void handle_write_headers(const boost::system::error_code& e);
+
+    /// Read from socket to detect closing of connection by client, client sends nothing after request.
+    void handle_read(const boost::system::error_code& e, std::size_t bytes_transferred);
+
+    void enqueue_event(std::shared_ptr<const std::string> event);
+
+    void write_next_event();
+
+    /// event is bound to handler to keep written buffer alive when close() clears queue during write.
+    void handle_write_event(std::shared_ptr<const std::string> event, const boost::system::error_code& e);
+
+    void close();
+
+    ConnectionType_ptr connection_;
+
+    /// Subscription of client, it is released as soon as stream is closed.
+    SubscriptionSlot_ptr subscription_slot_;
+
+    /// Events waiting for sending, accessed only from connection's strand.
+    std::deque< std::shared_ptr<const std::string> > events_;
+    bool writing_;
+
+    /// Set in strand, checked in player thread.
+    volatile LONG closed_;
+
+    char read_buffer_[64];
+};
+
+/// Connection which was switched to WebSocket protocol. Each text message from client is JSON-RPC request,
+/// it is handled in player thread like HTTP request, response is sent back as text message.
+/// Delayed responses(state notifications) are sent to the same socket when they are ready.
+/// Next message is read after previous one was handled, so client can not flood player thread.
+template<typename SocketT>
+class WebSocketConnection : public ICometDelayedConnection, public boost::enable_shared_from_this< WebSocketConnection<SocketT> >, private boost::noncopyable
+{
+    typedef Connection<SocketT> ConnectionType;
+    typedef boost::shared_ptr<ConnectionType> ConnectionType_ptr;
+
+public:
+    WebSocketConnection(ConnectionType_ptr connection, const WebSocket::Settings& settings);
+
+    /// Send handshake reply and start reading messages. Called from player thread.
+    void start();
+
+    virtual void sendResponse(boost::shared_ptr<Http::DelayedResponseSender> comet_http_response_sender);
+
+    /// Not supported: events are delivered as responses to subscription requests.
+    virtual IEventStream_ptr createEventStream(SubscriptionSlot_ptr slot);
+
+    /// Not supported: connection is already switched.
+    virtual void startWebSocket(const WebSocket::Settings& settings);
+
+    virtual const std::string& clientAddress() const
+        { return connection_->client_address_; }
+
+    virtual void holdSubscriptionSlot(SubscriptionSlot_ptr slot);
+
+private:
+
+    /// Max count of frames waiting for sending.
+    static const std::size_t kMAX_QUEUED_FRAMES = 64;
+
+    void write_handshake();
+
+    void handle_write_handshake(const boost::system::error_code& e);
+
+    void read_some();
+
+    void handle_read(const boost::system::error_code& e, std::size_t bytes_transferred);
+
+    /// Parse data in range [begin, end). Stops at text message which is passed to player thread.
+    void parse(const char* begin, const char* end);
+
+    /// Pass message to player thread if client does not exceed request rate, otherwise retry later. Reading is paused meanwhile.
+    void dispatch_message(std::shared_ptr<std::string> message);
+
+    void handle_throttle_timer(std::shared_ptr<std::string> message, const boost::system::error_code& e);
+
+    /// Handle text message. Called in player thread.
+    void handle_message(std::shared_ptr<std::string> message);
+
+    /// Continue parsing of data after message was handled.
+    void continue_reading();
+
+    void send_message(std::shared_ptr<std::string> message);
+
+    void send_response_content(boost::shared_ptr<Http::DelayedResponseSender> comet_http_response_sender);
+
+    void hold_subscription_slot(SubscriptionSlot_ptr slot);
+
+    /// Make frame of text message and send it. Compression is done here, in I/O thread.
+    void send_text(const std::string& text);
+
+    void enqueue_frame(std::shared_ptr<const std::string> frame);
+
+    /// Send close frame as the last one, connection is closed after it was written.
+    void start_closing(std::shared_ptr<const std::string> close_frame);
+
+    void write_next_frame();
+
+    /// frame is bound to handler to keep written buffer alive when close() clears queue during write.
+    void handle_write_frame(std::shared_ptr<const std::string> frame, const boost::system::error_code& e);
+
+    void start_ping_timer();
+
+    void handle_ping_timer(const boost::system::error_code& e);
+
+    void close();
+
+    ConnectionType_ptr connection_;
+
+    const WebSocket::Settings settings_;
+
+    WebSocket::FrameParser parser_;
+
+    /// Range of connection's buffer which was read but not parsed yet.
+    const char* unparsed_data_begin_;
+    const char* unparsed_data_end_;
+
+    /// Frames waiting for sending, accessed only from connection's strand.
+    std::deque< std::shared_ptr<const std::string> > frames_;
+    bool writing_;
+
+    /// True after close frame was queued.
+    bool closing_;
+
+    /// Set in strand, checked in player thread.
+    volatile LONG closed_;
+
+    boost::asio::deadline_timer ping_timer_;
+
+    /// Delays message of client which exceeded request rate.
+    boost::asio::deadline_timer throttle_timer_;
+
+    /// True if ping was sent and nothing was received since then.
+    bool ping_pending_;
+};
+
 } // namespace Http
 
 #endif // CONNECTION_H
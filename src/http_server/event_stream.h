@@ -0,0 +1,55 @@
+// Copyright (c) 2014, Alexey Ivanov
+
+#pragma once
+
+#include <boost/shared_ptr.hpp>
+#include <boost/weak_ptr.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Http
+{
+
+/*!
+    \brief Persistent stream of server-sent events(text/event-stream) over connection of handled request.
+           Connection stays open after reply headers, each event is written as soon as it is sent.
+           Stream is kept alive by its pending socket operations and holds its connection, so it is destroyed with connection
+           when client disconnects only if listener keeps weak references to streams.
+*/
+class IEventStream
+{
+public:
+    virtual ~IEventStream() {}
+
+    //! Sends reply headers. Called once from player thread after stream was accepted by listener.
+    virtual void start() = 0;
+
+    /*!
+        \brief Queues event for sending. Called from player thread, event can be shared by many streams.
+        \param event - formatted event: "event: <name>\ndata: <data>\n\n".
+        \return false if stream is closed(client disconnected or did not read events in time), stream should be dropped.
+    */
+    virtual bool sendEvent(std::shared_ptr<const std::string> event) = 0;
+};
+
+typedef boost::shared_ptr<IEventStream> IEventStream_ptr;
+
+//! Receives event streams requested by clients. Called from player thread.
+class EventStreamListener
+{
+public:
+
+    /*!
+        \param events - names of events client subscribes to.
+        \param stream - listener must keep weak reference to it, closed streams must not hold their connections.
+        \return false if events list is empty or contains unsupported event, client gets 400 reply in this case.
+    */
+    virtual bool addEventStream(const std::vector<std::string>& events, IEventStream_ptr stream) = 0;
+
+protected:
+
+    ~EventStreamListener() {}
+};
+
+} // namespace Http
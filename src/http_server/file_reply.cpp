@@ -0,0 +1,249 @@
+// Copyright (c) 2014, Alexey Ivanov
+
+#include "stdafx.h"
+#include "file_reply.h"
+#include "reply.h"
+#include "request.h"
+#include "request_parser.h"
+#include "utils/util.h"
+#include <algorithm>
+#include <cstdio>
+#include <boost/lexical_cast.hpp>
+
+namespace Http
+{
+
+namespace
+{
+
+void pushHeader(const char* name, const std::string& value, Reply& rep)
+{
+    rep.headers.push_back(header());
+    rep.headers.back().name = name;
+    rep.headers.back().value = value;
+}
+
+void skipSpaces(const char*& current, const char* end)
+{
+    while (current != end && (*current == ' ' || *current == '\t')) {
+        ++current;
+    }
+}
+
+void trimSpaces(const char*& begin, const char*& end)
+{
+    skipSpaces(begin, end);
+    while (begin != end && (end[-1] == ' ' || end[-1] == '\t')) {
+        --end;
+    }
+}
+
+//! Reads decimal number. \return false if there is no digits or number is too big.
+bool readNumber(const char*& current, const char* end, boost::uint64_t* number)
+{
+    const char* const start = current;
+    boost::uint64_t result = 0;
+    for (; current != end && *current >= '0' && *current <= '9'; ++current) {
+        if (current - start == 18) { // 18 digits always fit in uint64.
+            return false;
+        }
+        result = result * 10 + (*current - '0');
+    }
+    *number = result;
+    return current != start;
+}
+
+//! Returns true if there is no If-Range header or it matches validator of current file version.
+bool ifRangeMatches(const Request& req, const std::string& etag, const std::string& last_modified)
+{
+    const std::string* if_range;
+    if ( !get_header_value(req, HEADER_IF_RANGE, if_range) ) {
+        return true;
+    }
+    // strong comparison is required, so weak entity tags never match.
+    return *if_range == etag || *if_range == last_modified;
+}
+
+//! Returns true if If-Modified-Since header of request contains exactly the date which was sent in Last-Modified. Clients send it back as is.
+bool lastModifiedMatches(const Request& req, const std::string& last_modified)
+{
+    const std::string* if_modified_since;
+    return !last_modified.empty() && get_header_value(req, HEADER_IF_MODIFIED_SINCE, if_modified_since) && *if_modified_since == last_modified;
+}
+
+} // namespace anonymous
+
+bool etagMatches(const Request& req, const std::string& etag)
+{
+    const std::string* if_none_match;
+    if ( !get_header_value(req, HEADER_IF_NONE_MATCH, if_none_match) ) {
+        return false;
+    }
+
+    const char* item_begin = if_none_match->c_str();
+    const char* const value_end = item_begin + if_none_match->size();
+    while (item_begin < value_end) {
+        const char* item_end = std::find(item_begin, value_end, ',');
+        const char* tag_begin = item_begin;
+        const char* tag_end = item_end;
+        trimSpaces(tag_begin, tag_end);
+        if (tag_end - tag_begin >= 2 && tag_begin[0] == 'W' && tag_begin[1] == '/') {
+            tag_begin += 2;
+        }
+        if (   (tag_end - tag_begin == 1 && *tag_begin == '*')
+            || etag.compare( 0, std::string::npos, tag_begin, tag_end - tag_begin ) == 0
+            )
+        {
+            return true;
+        }
+        item_begin = item_end + 1;
+    }
+    return false;
+}
+
+RangeParseResult parseByteRange(const std::string& range, boost::uint64_t entity_size, boost::uint64_t* first, boost::uint64_t* last)
+{
+    static const char kBYTES_UNIT[] = "bytes=";
+    const size_t kBYTES_UNIT_LENGTH = sizeof(kBYTES_UNIT) - 1;
+    if (range.compare(0, kBYTES_UNIT_LENGTH, kBYTES_UNIT) != 0) {
+        return RANGE_IGNORED;
+    }
+
+    const char* current = range.c_str() + kBYTES_UNIT_LENGTH;
+    const char* const end = range.c_str() + range.size();
+    if (std::find(current, end, ',') != end) {
+        return RANGE_IGNORED; // several ranges.
+    }
+
+    boost::uint64_t first_pos = 0,
+                    last_pos = 0;
+    skipSpaces(current, end);
+    const bool has_first = readNumber(current, end, &first_pos);
+    if (current == end || *current != '-') {
+        return RANGE_IGNORED;
+    }
+    ++current;
+    const bool has_last = readNumber(current, end, &last_pos);
+    skipSpaces(current, end);
+    if (current != end) {
+        return RANGE_IGNORED;
+    }
+
+    if (!has_first) { // suffix range: last last_pos bytes.
+        if (!has_last) {
+            return RANGE_IGNORED;
+        }
+        if (last_pos == 0 || entity_size == 0) {
+            return RANGE_NOT_SATISFIABLE;
+        }
+        *first = entity_size - std::min(last_pos, entity_size);
+        *last = entity_size - 1;
+        return RANGE_SATISFIABLE;
+    }
+
+    if (has_last && last_pos < first_pos) {
+        return RANGE_IGNORED;
+    }
+    if (first_pos >= entity_size) {
+        return RANGE_NOT_SATISFIABLE;
+    }
+    *first = first_pos;
+    *last = has_last ? std::min(last_pos, entity_size - 1)
+                     : entity_size - 1;
+    return RANGE_SATISFIABLE;
+}
+
+std::string formatHttpDate(std::time_t time)
+{
+    // strftime() is not used since its names of days and months depend on locale.
+    static const char* const kDAYS[] = { "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat" };
+    static const char* const kMONTHS[] = { "Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec" };
+
+    std::tm tm;
+    if (gmtime_s(&tm, &time) != 0) {
+        return std::string();
+    }
+
+    char date[32];
+    sprintf_s(date, sizeof(date), "%s, %02d %s %04d %02d:%02d:%02d GMT",
+              kDAYS[tm.tm_wday], tm.tm_mday, kMONTHS[tm.tm_mon], tm.tm_year + 1900, tm.tm_hour, tm.tm_min, tm.tm_sec);
+    return date;
+}
+
+void fillFileReply(const Request& req, const boost::filesystem::wpath& path, const std::string& content_type, Reply& rep) // throws boost::filesystem::filesystem_error
+{
+    namespace fs = boost::filesystem;
+    const boost::uint64_t file_size = fs::file_size(path);
+    const std::time_t last_write_time = fs::last_write_time(path);
+
+    char etag[48];
+    sprintf_s(etag, sizeof(etag), "\"%llx-%llx\"", static_cast<unsigned long long>(last_write_time), static_cast<unsigned long long>(file_size));
+    const std::string last_modified = formatHttpDate(last_write_time);
+
+    boost::uint64_t first = 0,
+                    last = 0;
+    RangeParseResult range_result = RANGE_IGNORED;
+    const std::string* range;
+    if ( get_header_value(req, HEADER_RANGE, range) && ifRangeMatches(req, etag, last_modified) ) {
+        range_result = parseByteRange(*range, file_size, &first, &last);
+    }
+
+    pushHeader("Accept-Ranges", "bytes", rep);
+    pushHeader("ETag", etag, rep);
+    if ( !last_modified.empty() ) {
+        pushHeader("Last-Modified", last_modified, rep);
+    }
+
+    switch (range_result) {
+    case RANGE_NOT_SATISFIABLE:
+        rep.status = Reply::requested_range_not_satisfiable;
+        rep.filename.clear();
+        rep.content.clear();
+        pushHeader( "Content-Range", Utilities::MakeString() << "bytes */" << file_size, rep );
+        pushHeader("Content-Length", "0", rep);
+        return;
+    case RANGE_SATISFIABLE:
+        rep.status = Reply::partial_content;
+        rep.file_offset = first;
+        rep.file_length = last - first + 1;
+        pushHeader( "Content-Range", Utilities::MakeString() << "bytes " << first << '-' << last << '/' << file_size, rep );
+        break;
+    default:
+        rep.status = Reply::ok;
+        rep.file_offset = 0;
+        rep.file_length = file_size;
+        break;
+    }
+
+    rep.filename = path.native();
+    pushHeader( "Content-Length", boost::lexical_cast<std::string>(rep.file_length), rep );
+    pushHeader("Content-Type", content_type, rep);
+}
+
+void fillContentReply(const Request& req, std::shared_ptr<const std::string> content, const std::string& etag, std::time_t last_modified_time,
+                      const std::string& content_type, Reply& rep)
+{
+    const std::string last_modified = formatHttpDate(last_modified_time);
+
+    pushHeader("ETag", etag, rep);
+    if ( !last_modified.empty() ) {
+        pushHeader("Last-Modified", last_modified, rep);
+    }
+    pushHeader("Cache-Control", "no-cache", rep);
+
+    // If-None-Match has priority, If-Modified-Since is used only by clients which do not send entity tags.
+    const std::string* if_none_match;
+    const bool not_modified = get_header_value(req, HEADER_IF_NONE_MATCH, if_none_match) ? etagMatches(req, etag)
+                                                                                         : lastModifiedMatches(req, last_modified);
+    if (not_modified) {
+        rep.status = Reply::not_modified;
+        return;
+    }
+
+    rep.status = Reply::ok;
+    rep.shared_content = content;
+    pushHeader( "Content-Length", boost::lexical_cast<std::string>( content->size() ), rep );
+    pushHeader("Content-Type", content_type, rep);
+}
+
+} // namespace Http
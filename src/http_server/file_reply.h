@@ -0,0 +1,49 @@
+// Copyright (c) 2014, Alexey Ivanov
+
+#pragma once
+
+#include <boost/cstdint.hpp>
+#include <boost/filesystem.hpp>
+#include <ctime>
+#include <memory>
+#include <string>
+
+namespace Http
+{
+
+struct Reply;
+struct Request;
+
+/*!
+    \brief Fills reply which sends file(or its part) by TransmitFile.
+           Single byte range of Range header gives 206 reply, unsatisfiable range gives 416 reply.
+           Several ranges are not supported, whole file is sent in this case as RFC 7233 allows.
+           Range is ignored if If-Range header does not match current ETag or Last-Modified date of file.
+           Reply also gets Accept-Ranges, ETag, Last-Modified, Content-Length and Content-Type headers.
+*/
+void fillFileReply(const Request& req, const boost::filesystem::wpath& path, const std::string& content_type, Reply& rep); // throws boost::filesystem::filesystem_error
+
+enum RangeParseResult { RANGE_IGNORED, RANGE_SATISFIABLE, RANGE_NOT_SATISFIABLE };
+
+/*!
+    \brief Parses value of Range header("bytes=0-499", "bytes=500-", "bytes=-500").
+    \param first, last - receive inclusive bounds of range if RANGE_SATISFIABLE is returned.
+    \return RANGE_IGNORED if range is invalid or contains several ranges.
+*/
+RangeParseResult parseByteRange(const std::string& range, boost::uint64_t entity_size, boost::uint64_t* first, boost::uint64_t* last);
+
+//! Returns date in format of RFC 1123: "Sun, 06 Nov 1994 08:49:37 GMT".
+std::string formatHttpDate(std::time_t time);
+
+//! Returns true if If-None-Match header of request contains etag. Weak comparison is used as RFC 7232 requires.
+bool etagMatches(const Request& req, const std::string& etag);
+
+/*!
+    \brief Fills reply which sends content from memory with ETag, Last-Modified and Cache-Control: no-cache headers,
+           so client revalidates its copy on each request.
+           Reply gets status 304 without content if If-None-Match(or If-Modified-Since if there is no If-None-Match) matches.
+*/
+void fillContentReply(const Request& req, std::shared_ptr<const std::string> content, const std::string& etag, std::time_t last_modified,
+                      const std::string& content_type, Reply& rep);
+
+} // namespace Http
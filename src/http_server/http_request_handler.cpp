@@ -9,14 +9,23 @@
 #include "http_server/request_handler.h"
 #include "download_track/request_handler.h"
 #include "upload_track/request_handler.h"
-#include <fstream>
+#include "album_cover/request_handler.h"
+#include <algorithm>
+#include <cstdlib>
 #include <sstream>
 #include <string>
+#include <vector>
+#include <boost/algorithm/string.hpp>
+#include <boost/filesystem.hpp>
 #include <boost/lexical_cast.hpp>
 #include "reply.h"
 #include "request.h"
+#include "request_parser.h"
+#include "websocket.h"
+#include "file_reply.h"
 #include "mime_types.h"
 #include "rpc/request_handler.h"
+#include "utils/gzip_encoder.h"
 #include "utils/util.h"
 #include "plugin/settings.h"
 #include "plugin/control_plugin.h"
@@ -27,21 +36,102 @@ namespace {
 using namespace ControlPlugin::PluginLogger;
 ModuleLoggerType& logger()
     { return getLogManager().getModuleLogger<Server>(); }
+
+void trimSpaces(const char*& begin, const char*& end)
+{
+    while (begin != end && (*begin == ' ' || *begin == '\t')) {
+        ++begin;
+    }
+    while (begin != end && (end[-1] == ' ' || end[-1] == '\t')) {
+        --end;
+    }
+}
+
+//! Returns true if Accept-Encoding header of request allows gzip content coding.
+bool acceptsGzip(const Request& req)
+{
+    const std::string* accept_encoding;
+    if ( !get_header_value(req, HEADER_ACCEPT_ENCODING, accept_encoding) ) {
+        return false;
+    }
+
+    // Accept-Encoding: gzip;q=1.0, identity; q=0.5, *;q=0
+    bool any_coding_accepted = false;
+    const char* item_begin = accept_encoding->c_str();
+    const char* const value_end = item_begin + accept_encoding->size();
+    while (item_begin < value_end) {
+        const char* item_end = std::find(item_begin, value_end, ',');
+        const char* coding_end = std::find(item_begin, item_end, ';');
+        const char* coding_begin = item_begin;
+        trimSpaces(coding_begin, coding_end);
+        const bool is_gzip = coding_end - coding_begin == 4 && _strnicmp(coding_begin, "gzip", 4) == 0,
+                   is_any = coding_end - coding_begin == 1 && *coding_begin == '*';
+        if (is_gzip || is_any) {
+            // coding is acceptable unless it has zero quality value.
+            const std::string params(coding_end, item_end);
+            const std::size_t q_pos = params.find("q=");
+            const bool accepted = q_pos == std::string::npos || atof( params.c_str() + q_pos + 2 ) > 0;
+            if (is_gzip) {
+                return accepted; // explicit gzip item has priority over '*'.
+            }
+            any_coding_accepted = accepted;
+        }
+        item_begin = item_end + 1;
+    }
+    return any_coding_accepted;
+}
+
+void pushHeader(const char* name, const std::string& value, Reply& rep)
+{
+    rep.headers.push_back(header());
+    rep.headers.back().name = name;
+    rep.headers.back().value = value;
+}
+
+double secondsSince(const LARGE_INTEGER& start)
+{
+    LARGE_INTEGER now, frequency;
+    QueryPerformanceCounter(&now);
+    QueryPerformanceFrequency(&frequency);
+    return static_cast<double>(now.QuadPart - start.QuadPart) / frequency.QuadPart;
 }
 
+} // namespace anonymous
+
 
 const std::string kDOWNLOAD_TRACK_TAG("/downloadTrack/"),
                   kUPLOAD_TRACK_TAG("/uploadTrack"),
-                  kCookieHeaderName("Cookie");
+                  kALBUM_COVER_TAG("/cover/"),
+                  kEVENT_STREAM_TAG("/events"),
+                  kWEBSOCKET_TAG("/websocket"),
+                  kJSON_RPC_URI("/RPC_JSON");
+
+AdmissionControl::Limits RequestHandler::admissionLimitsFromSettings()
+{
+    using namespace ControlPlugin::PluginSettings;
+    const Settings::HttpServer& settings = ControlPlugin::AIMPControlPlugin::settings().http_server;
+
+    AdmissionControl::Limits limits;
+    limits.max_connections = settings.max_connections;
+    limits.max_subscriptions_per_client = settings.max_subscriptions_per_client;
+    limits.max_requests_per_second = settings.max_requests_per_second;
+    return limits;
+}
+
+int RequestHandler::compressionLevelFromSettings()
+{
+    return ControlPlugin::AIMPControlPlugin::settings().http_server.rpc_compression_level;
+}
+
+std::size_t RequestHandler::compressionMinSizeFromSettings()
+{
+    return ControlPlugin::AIMPControlPlugin::settings().http_server.rpc_compression_min_size;
+}
 
 void RequestHandler::trySendInitCookies(const Request& req, Reply& rep)
 {
-    const std::vector<header>& headers = req.headers;
-    if ( std::find_if(headers.begin(), headers.end(),
-                      [](const header& h) { return h.name == kCookieHeaderName; }
-                      ) == headers.end()
-        )
-    {
+    const std::string* cookie;
+    if ( !get_header_value(req, HEADER_COOKIE, cookie) ) {
         using namespace ControlPlugin::PluginSettings;
         const Settings& settings = ControlPlugin::AIMPControlPlugin::settings();
         BOOST_FOREACH(auto& cookie_namevalue, settings.http_server.init_cookies) {
@@ -58,38 +148,96 @@ bool RequestHandler::handle_request(const Request& req, Reply& rep, ICometDelaye
 {
     trySendInitCookies(req, rep); // try to send init cookie on any request(not only RPC) cause we should render static web-interface controls with that cookies.
 
+    std::string session_cookie; // value of Set-Cookie header of new session, it must reach client by immediate or delayed reply.
+
     // authentication
-    if (auth_manager_.enabled()) {
-        if (!auth_manager_.isAuthenticated(req)) {
-            BOOST_LOG_SEV(logger(), debug) << "Unauthenticated access, headers: ";
+    if (auth_manager_->enabled()) {
+        std::string session_token;
+        const Authentication::AuthManager::Result auth_result = auth_manager_->authenticate(req, &session_token);
+        if (auth_result != Authentication::AuthManager::AUTHENTICATED) {
+            AIMP_LOG_SEV(logger(), debug) << "Unauthenticated access, headers: ";
             for (auto& h : req.headers) {
-                BOOST_LOG_SEV(logger(), debug) << h.name << ": " << h.value;
+                AIMP_LOG_SEV(logger(), debug) << h.name << ": " << h.value;
             }
-            BOOST_LOG_SEV(logger(), debug) << "Unauthenticated access, ...headers";
+            AIMP_LOG_SEV(logger(), debug) << "Unauthenticated access, ...headers";
 
-            fillAuthFailReply(rep);
+            fillAuthFailReply(auth_result == Authentication::AuthManager::STALE_NONCE, rep);
             return true;
         }
+
+        if ( !session_token.empty() ) { // next requests of client are authenticated by session cookie without Digest check.
+            session_cookie = Utilities::MakeString() << Authentication::AuthManager::sessionCookieName() << '=' << session_token
+                                                     << "; Path=/; HttpOnly; SameSite=Strict";
+            addSessionCookie(session_cookie, rep); // event stream and WebSocket handshake send headers of this reply.
+        }
+    }
+
+    const bool reply_immediately = dispatch_request(req, rep, connection, session_cookie);
+    if (reply_immediately) {
+        addSessionCookie(session_cookie, rep); // handler could replace reply with stock one.
+    }
+    return reply_immediately;
+}
+
+void RequestHandler::addSessionCookie(const std::string& session_cookie, Reply& rep)
+{
+    if ( session_cookie.empty() ) {
+        return;
+    }
+    BOOST_FOREACH(const header& h, rep.headers) {
+        if (h.name == "Set-Cookie" && h.value == session_cookie) {
+            return;
+        }
+    }
+    pushHeader("Set-Cookie", session_cookie, rep);
+}
+
+bool RequestHandler::dispatch_request(const Request& req, Reply& rep, ICometDelayedConnection_ptr connection, const std::string& session_cookie)
+{
+    // check it before RPC frontends since WebCtl frontend accepts any URI with query.
+    if (   Utilities::stringStartsWith(req.uri, kEVENT_STREAM_TAG)
+        && (req.uri.size() == kEVENT_STREAM_TAG.size() || req.uri[kEVENT_STREAM_TAG.size()] == '?')
+        )
+    {
+        return handle_event_stream_request(req, rep, connection);
+    }
+
+    if ( req.uri == kWEBSOCKET_TAG && WebSocket::isUpgradeRequest(req) ) {
+        return handle_websocket_request(req, rep, connection);
     }
 
     if ( Rpc::Frontend* frontend = rpc_request_handler_.getFrontEnd(req.uri) ) { // handle RPC call.        
         std::string response_content_type;
-        DelayedResponseSender_ptr comet_delayed_response_sender( new DelayedResponseSender(connection, *this) );
+        DelayedResponseSender_ptr comet_delayed_response_sender( new DelayedResponseSender( connection, *this, acceptsGzip(req), session_cookie ) );
 
+        // chunked transfer encoding of large results appeared in HTTP/1.1.
+        const bool chunked_reply_supported = req.http_version_major > 1 || (req.http_version_major == 1 && req.http_version_minor >= 1);
         boost::tribool result = rpc_request_handler_.handleRequest(req.uri,
                                                                    req.content,
                                                                    comet_delayed_response_sender,
                                                                    *frontend,
                                                                    &rep.content,
-                                                                   &response_content_type
+                                                                   &response_content_type,
+                                                                   chunked_reply_supported ? &rep.content_producer : nullptr
                                                                    );
         if (result || !result) {
-            if ( Utilities::stringStartsWith(rep.content, kDOWNLOAD_TRACK_TAG) ) { // handle special download track response.
+            if ( comet_delayed_response_sender->subscriptionRejected() ) {
+                rep = AdmissionControl::rejectReply(Reply::too_many_requests);
+                return true;
+            }
+
+            if (rep.content_producer) { // large result is sent by portions as it is read from playlists DB.
+                fillReplyWithProducedContent(response_content_type, rep);
+                if ( acceptsGzip(req) ) {
+                    setProducedContentCompression(rep);
+                }
+            } else if ( Utilities::stringStartsWith(rep.content, kDOWNLOAD_TRACK_TAG) ) { // handle special download track response.
                 Request req_download_track(req);
                 req_download_track.uri = rep.content;
                 rep.content.clear();
                 return download_track_request_handler_.handle_request(req_download_track, rep);
             } else { // usual RPC response.
+                rep.compress_content = acceptsGzip(req);
                 fillReplyWithContent(response_content_type, rep);
             }
             return true; // response will be sent immediately.
@@ -100,6 +248,13 @@ bool RequestHandler::handle_request(const Request& req, Reply& rep, ICometDelaye
         return download_track_request_handler_.handle_request(req, rep);
     } else if ( Utilities::stringStartsWith(req.uri, kUPLOAD_TRACK_TAG) ) { // handle special upload track request.
         return upload_track_request_handler_.handle_request(req, rep);
+    } else if ( Utilities::stringStartsWith(req.uri, kALBUM_COVER_TAG) ) { // handle album cover request.
+        if (!album_cover_request_handler_) {
+            rep = Reply::stock_reply(Reply::not_found);
+            return true;
+        }
+        DelayedResponseSender_ptr delayed_response_sender( new DelayedResponseSender( connection, *this, false, session_cookie ) );
+        return album_cover_request_handler_->handle_request(req, rep, delayed_response_sender);
     } else {
         handle_file_request(req, rep);
     }
@@ -107,6 +262,83 @@ bool RequestHandler::handle_request(const Request& req, Reply& rep, ICometDelaye
     return true;
 }
 
+bool RequestHandler::handle_event_stream_request(const Request& req, Reply& rep, ICometDelayedConnection_ptr connection)
+{
+    if (!event_stream_listener_) {
+        rep = Reply::stock_reply(Reply::not_found);
+        return true;
+    }
+
+    // collect values of all "event" parameters of query.
+    std::vector<std::string> events;
+    const std::size_t query_pos = req.uri.find('?');
+    if (query_pos != std::string::npos) {
+        const std::string query = req.uri.substr(query_pos + 1);
+        std::vector<std::string> params;
+        boost::split( params, query, boost::is_any_of("&") );
+        BOOST_FOREACH(const std::string& param, params) {
+            std::string event;
+            if ( Utilities::stringStartsWith(param, "event=") && url_decode(param.substr(6), event) ) {
+                events.push_back(event);
+            }
+        }
+    }
+
+    // stream takes subscription slot of client for its whole life, so one client can not hold many connections by streams.
+    const std::string& client_address = connection->clientAddress();
+    if ( !admission_control_->admitSubscription(client_address) ) {
+        rep = AdmissionControl::rejectReply(Reply::too_many_requests);
+        return true;
+    }
+    IEventStream_ptr stream = connection->createEventStream( SubscriptionSlot_ptr( new SubscriptionSlot(admission_control_, client_address) ) );
+    if ( req.method != "GET" || !event_stream_listener_->addEventStream(events, stream) ) {
+        rep = Reply::stock_reply(Reply::bad_request);
+        return true;
+    }
+
+    rep.status = Reply::ok;
+    pushHeader("Content-Type", "text/event-stream", rep);
+    pushHeader("Cache-Control", "no-cache", rep);
+    stream->start();
+    return false; // events are sent by stream until client disconnects.
+}
+
+bool RequestHandler::handle_websocket_request(const Request& req, Reply& rep, ICometDelayedConnection_ptr connection)
+{
+    using namespace ControlPlugin::PluginSettings;
+    const Settings::HttpServer& settings = ControlPlugin::AIMPControlPlugin::settings().http_server;
+
+    WebSocket::Settings websocket_settings;
+    websocket_settings.compression_level = settings.rpc_compression_level;
+    websocket_settings.compression_min_size = settings.rpc_compression_min_size;
+    if ( !WebSocket::fillHandshakeReply(req, settings.rpc_compression_level != 0, rep, &websocket_settings.deflate) ) {
+        rep = Reply::stock_reply(Reply::bad_request);
+        return true;
+    }
+
+    connection->startWebSocket(websocket_settings);
+    return false; // connection sends handshake reply itself and then works by WebSocket protocol.
+}
+
+bool RequestHandler::handle_websocket_message(const std::string& message, std::string* response, ICometDelayedConnection_ptr connection)
+{
+    Rpc::Frontend* frontend = rpc_request_handler_.getFrontEnd(kJSON_RPC_URI);
+    assert(frontend);
+
+    // WebSocket connection compresses messages itself.
+    DelayedResponseSender_ptr comet_delayed_response_sender( new DelayedResponseSender( connection, *this, false, std::string() ) ); // session is already established by handshake.
+    std::string response_content_type;
+    const boost::tribool result = rpc_request_handler_.handleRequest(kJSON_RPC_URI,
+                                                                     message,
+                                                                     comet_delayed_response_sender,
+                                                                     *frontend,
+                                                                     response,
+                                                                     &response_content_type,
+                                                                     nullptr // message must be complete, result is not streamed.
+                                                                     );
+    return result || !result;
+}
+
 void RequestHandler::handle_file_request(const Request& req, Reply& rep)
 {
     // Decode url to path.
@@ -137,23 +369,52 @@ void RequestHandler::handle_file_request(const Request& req, Reply& rep)
         extension = request_path.substr(last_dot_pos);
     }
 
-    // Open the file to send back.
-    std::string full_path = document_root_ + request_path;
-    std::ifstream is(full_path.c_str(), std::ios::in | std::ios::binary);
-    if (!is) {
-        rep = Reply::stock_reply(Reply::not_found);
+    const std::string full_path = document_root_ + request_path;
+    const StaticFileCache::File_ptr file = static_file_cache_.getFile(full_path);
+    if (!file) {
+        handle_uncached_file_request(req, full_path, extension, rep);
         return;
     }
 
-    // Fill out the reply to be sent to the client.
-    char buf[512];
-    while (is.read( buf, sizeof(buf) ).gcount() > 0) {
-        rep.content.append( buf, static_cast<std::size_t>( is.gcount() ) ); // cast from int64 to uint32 is safe here since we have maximum 512 bytes.
+    // Client revalidates cached copy on each request, so changes of web interface are visible immediately.
+    const bool send_gzip = file->gzip_content && acceptsGzip(req);
+    const std::string& etag = send_gzip ? file->gzip_etag : file->etag;
+    pushHeader("ETag", etag, rep);
+    pushHeader("Cache-Control", "no-cache", rep);
+    if (file->gzip_content) {
+        pushHeader("Vary", "Accept-Encoding", rep);
+    }
+
+    if ( etagMatches(req, etag) ) {
+        rep.status = Reply::not_modified;
+        return;
     }
 
+    if (send_gzip) {
+        pushHeader("Content-Encoding", "gzip", rep);
+    }
+    rep.shared_content = send_gzip ? file->gzip_content : file->content;
     fillReplyWithContent(mime_types::extension_to_type(extension), rep);
 }
 
+void RequestHandler::handle_uncached_file_request(const Request& req, const std::string& full_path, const std::string& extension, Reply& rep)
+{
+    // File is too large for cache, let connection send it by TransmitFile.
+    namespace fs = boost::filesystem;
+    const fs::path path(full_path);
+    boost::system::error_code ec;
+    if ( !fs::is_regular_file(path, ec) ) {
+        rep = Reply::stock_reply(Reply::not_found);
+        return;
+    }
+
+    try {
+        fillFileReply( req, path.wstring(), mime_types::extension_to_type(extension), rep );
+    } catch (fs::filesystem_error&) {
+        rep = Reply::stock_reply(Reply::not_found);
+    }
+}
+
 void RequestHandler::fillReplyWithContent(const std::string& content_type, Reply& rep)
 {
     // Fill out the reply to be sent to the client.
@@ -161,20 +422,84 @@ void RequestHandler::fillReplyWithContent(const std::string& content_type, Reply
     
     rep.headers.push_back(header());
     rep.headers.back().name = "Content-Length";
-    rep.headers.back().value = boost::lexical_cast<std::string>( rep.content.size() );
+    rep.headers.back().value = boost::lexical_cast<std::string>( rep.content_size() );
+
+    rep.headers.push_back(header());
+    rep.headers.back().name = "Content-Type";
+    rep.headers.back().value = content_type;
+}
+
+void RequestHandler::fillReplyWithProducedContent(const std::string& content_type, Reply& rep)
+{
+    rep.status = Reply::ok;
+
+    rep.headers.push_back(header());
+    rep.headers.back().name = "Transfer-Encoding";
+    rep.headers.back().value = "chunked";
 
     rep.headers.push_back(header());
     rep.headers.back().name = "Content-Type";
     rep.headers.back().value = content_type;
 }
 
-void RequestHandler::fillAuthFailReply(Reply& rep)
+void RequestHandler::compressReplyContent(Reply& rep)
 {
-    rep.status = Reply::unauthorized;
-
-    rep.headers.emplace_back();
+    rep.compress_content = false;
+    if (compression_level_ == 0 || rep.content.size() < compression_min_size_) {
+        return;
+    }
+
+    LARGE_INTEGER start;
+    QueryPerformanceCounter(&start);
+
+    std::string compressed;
+    compressed.reserve(rep.content.size() / 4); // usual compression ratio of JSON/XML responses.
+    Utilities::GzipEncoder encoder(compression_level_, &compressed);
+    encoder.write( rep.content.data(), rep.content.size() );
+    encoder.finish();
+
+    const double seconds = secondsSince(start);
+
+    // log line is built outside of stats lock, other I/O threads do not wait for it.
+    const CompressionStats::Counters totals = compression_stats_->add( false, rep.content.size(), std::min( compressed.size(), rep.content.size() ), seconds );
+    AIMP_LOG_SEV(logger(), debug) << "RPC response compressed: " << rep.content.size() << " -> " << compressed.size()
+                                   << " bytes in " << seconds * 1000 << " ms. Total saved "
+                                   << totals.original_bytes - totals.compressed_bytes << " bytes of "
+                                   << totals.original_bytes << " in " << totals.responses_count
+                                   << " responses, " << totals.seconds * 1000 << " ms.";
+
+    if ( compressed.size() < rep.content.size() ) {
+        rep.content.swap(compressed);
+        BOOST_FOREACH(header& h, rep.headers) {
+            if ( boost::iequals(h.name, "Content-Length") ) {
+                h.value = boost::lexical_cast<std::string>( rep.content.size() );
+            }
+        }
+        pushHeader("Content-Encoding", "gzip", rep);
+        pushHeader("Vary", "Accept-Encoding", rep);
+    }
+}
+
+void RequestHandler::setProducedContentCompression(Reply& rep) const
+{
+    // size of produced content is unknown, but producers are used for large results only, so min size is not checked.
+    if (compression_level_ == 0) {
+        return;
+    }
+
+    rep.compression_level = compression_level_;
+    pushHeader("Content-Encoding", "gzip", rep);
+    pushHeader("Vary", "Accept-Encoding", rep);
+}
+
+void RequestHandler::fillAuthFailReply(bool stale_nonce, Reply& rep)
+{
+    rep.status = Reply::unauthorized;
+
+    rep.headers.emplace_back();
     rep.headers.back().name = "WWW-Authenticate";
-    rep.headers.back().value = Utilities::MakeString() << "Digest qop=\"auth\", realm=\"" << auth_manager_.realm() << "\", nonce=\"" << auth_manager_.generate_nonce() << "\"";
+    rep.headers.back().value = Utilities::MakeString() << "Digest qop=\"auth\", realm=\"" << auth_manager_->realm() << "\", nonce=\"" << auth_manager_->generateNonce() << "\""
+                                                       << (stale_nonce ? ", stale=true" : ""); // client repeats request with new nonce without asking user.
 }
 
 bool RequestHandler::url_decode(const std::string& in, std::string& out)
@@ -206,15 +531,49 @@ bool RequestHandler::url_decode(const std::string& in, std::string& out)
     return true;
 }
 
+DelayedResponseSender::~DelayedResponseSender()
+{
+    if (subscription_slot_) {
+        subscription_slot_->release();
+    }
+}
+
+bool DelayedResponseSender::admitSubscription()
+{
+    if (!subscription_slot_ && !subscription_rejected_) {
+        const std::string& client_address = comet_connection_->clientAddress();
+        if ( admission_control_->admitSubscription(client_address) ) {
+            subscription_slot_.reset( new SubscriptionSlot(admission_control_, client_address) );
+            comet_connection_->holdSubscriptionSlot(subscription_slot_);
+        } else {
+            subscription_rejected_ = true;
+        }
+    }
+    return !subscription_rejected_;
+}
+
 const Reply& DelayedResponseSender::get_reply() const
 { 
     return reply_;
 }
 
+Reply& DelayedResponseSender::get_reply()
+{ 
+    return reply_;
+}
+
 void DelayedResponseSender::send(const std::string& response, const std::string& response_content_type)
 {
     reply_.content = response;
+    reply_.compress_content = compress_response_; // connection compresses content in I/O thread.
     http_request_handler_.fillReplyWithContent(response_content_type, reply_);
+    RequestHandler::addSessionCookie(session_cookie_, reply_);
+    comet_connection_->sendResponse( shared_from_this() );
+}
+
+void DelayedResponseSender::sendReply()
+{
+    RequestHandler::addSessionCookie(session_cookie_, reply_);
     comet_connection_->sendResponse( shared_from_this() );
 }
 
@@ -8,6 +8,7 @@
 #include "request_parser.h"
 #include "request.h"
 #include <boost/lexical_cast.hpp>
+#include <boost/algorithm/string/predicate.hpp>
 #include "mpfd_parser_factory.h"
 #include "http_server/header.h"
 
@@ -16,6 +17,7 @@ namespace Http {
 request_parser::request_parser()
     :
     content_length_(0),
+    headers_count_(0),
     state_(method_start),
     content_consumed_(0)
 {
@@ -24,12 +26,10 @@ request_parser::request_parser()
 void request_parser::reset()
 {
     state_ = method_start;
+    content_length_ = 0;
     content_consumed_ = 0;
 }
 
-std::string request_parser::content_length_name_ = "Content-Length";
-const std::string content_type_name = "Content-Type";
-
 boost::tribool request_parser::consume(Request& req, char input)
 {
     switch (state_)
@@ -39,9 +39,11 @@ boost::tribool request_parser::consume(Request& req, char input)
         req.uri.clear();
         req.http_version_major = 0;
         req.http_version_minor = 0;
-        req.headers.clear();
         req.content.clear();
+        req.mpfd_parser.reset();
         content_length_ = 0;
+        content_consumed_ = 0;
+        headers_count_ = 0; // keep header objects to reuse memory of their strings.
 
         if ( !is_char(input) || is_ctl(input) || is_tspecial(input) ) {
             return false;
@@ -56,6 +58,8 @@ boost::tribool request_parser::consume(Request& req, char input)
             return boost::indeterminate;
         } else if ( !is_char(input) || is_ctl(input) || is_tspecial(input) ) {
             return false;
+        } else if (req.method.size() == kMAX_METHOD_LENGTH) {
+            return false;
         } else {
             req.method.push_back(input);
             return boost::indeterminate;
@@ -162,14 +166,20 @@ boost::tribool request_parser::consume(Request& req, char input)
         if (input == '\r') {
             state_ = expecting_newline_3;
             return boost::indeterminate;
-        } else if ( !req.headers.empty() && (input == ' ' || input == '\t') ) {
+        } else if ( headers_count_ != 0 && (input == ' ' || input == '\t') ) {
             state_ = header_lws;
             return boost::indeterminate;
         } else if ( !is_char(input) || is_ctl(input) || is_tspecial(input) ) {
             return false;
+        } else if (headers_count_ == kMAX_HEADERS_COUNT) {
+            return false;
         } else {
-            req.headers.push_back(header());
-            req.headers.back().name.push_back(input);
+            if ( headers_count_ == req.headers.size() ) {
+                req.headers.push_back(header());
+            }
+            header& h = req.headers[headers_count_++];
+            h.name.assign(1, input);
+            h.value.clear();
             state_ = header_name;
             return boost::indeterminate;
         }
@@ -183,7 +193,7 @@ boost::tribool request_parser::consume(Request& req, char input)
             return false;
         } else {
             state_ = header_value;
-            req.headers.back().value.push_back(input);
+            req.headers[headers_count_ - 1].value.push_back(input);
             return boost::indeterminate;
         }
     case header_name:
@@ -193,7 +203,7 @@ boost::tribool request_parser::consume(Request& req, char input)
         } else if ( !is_char(input) || is_ctl(input) || is_tspecial(input) ) {
             return false;
         } else {
-            req.headers.back().name.push_back(input);
+            req.headers[headers_count_ - 1].name.push_back(input);
             return boost::indeterminate;
         }
     case space_before_header_value:
@@ -210,7 +220,7 @@ boost::tribool request_parser::consume(Request& req, char input)
         } else if ( is_ctl(input) ) {
             return false;
         } else {
-            req.headers.back().value.push_back(input);
+            req.headers[headers_count_ - 1].value.push_back(input);
             return boost::indeterminate;
         }
     case expecting_newline_2:
@@ -222,11 +232,17 @@ boost::tribool request_parser::consume(Request& req, char input)
         }
     case expecting_newline_3:
         if (input == '\n') {
+            req.headers.resize(headers_count_); // drop headers left from previous request.
+            index_known_headers(req);
+
             // Check for optional Content-Length header.
             const std::string* content_length_value;
-            if (get_header_value(req.headers, content_length_name_, content_length_value)) {
+            if (get_header_value(req, HEADER_CONTENT_LENGTH, content_length_value)) {
                 try {
                     content_length_ = boost::lexical_cast<std::size_t>(*content_length_value);
+                    if (content_length_ == 0) {
+                        return true; // no content, do not wait for next byte since it belongs to next request on persistent connection.
+                    }
                     state_ = select_content_parser;
                     return boost::indeterminate;
                 } catch (boost::bad_lexical_cast&) {
@@ -242,25 +258,35 @@ boost::tribool request_parser::consume(Request& req, char input)
         state_ = content;
 
         const std::string* content_type_value;
-        if (get_header_value(req.headers, content_type_name, content_type_value)) {
+        if (get_header_value(req, HEADER_CONTENT_TYPE, content_type_value)) {
             if (boost::starts_with(*content_type_value, "multipart/form-data;")) {
                 using namespace MPFD;
-                if (ParserFactory::instance()) {
-                    req.mpfd_parser = ParserFactory::instance()->createParser(*content_type_value);
+                if ( !ParserFactory::instance() ) {
+                    return false;
+                }
+                try {
+                    req.mpfd_parser = ParserFactory::instance()->createParser(req, *content_type_value);
+                } catch (std::exception&) {
+                    return false;
+                }
+                if (req.mpfd_parser) {
                     state_ = content_multipart_formdata;
                     return boost::indeterminate;
-                } else {
-                    return false;
                 }
             }
         }
 
+        if (content_length_ > kMAX_CONTENT_LENGTH) {
+            return false;
+        }
+        req.content.reserve(content_length_);
         return consume(req, input);
                                 }
     case content:
         // Content.
         if (req.content.size() < content_length_) {
             req.content.push_back(input);
+            ++content_consumed_;
             if (req.content.size() == content_length_) {
                 return true;  // all content has been consumed, stop parsing.
             }
@@ -275,6 +301,48 @@ boost::tribool request_parser::consume(Request& req, char input)
     }
 }
 
+std::string& request_parser::current_field(Request& req) const
+{
+    switch (state_) {
+    case uri:
+        return req.uri;
+    case header_name:
+        return req.headers[headers_count_ - 1].name;
+    case header_value:
+        return req.headers[headers_count_ - 1].value;
+    default:
+        assert(state_ == content);
+        return req.content;
+    }
+}
+
+boost::tribool request_parser::check_current_field(const Request& req) const
+{
+    switch (state_) {
+    case uri:
+        if (req.uri.size() > kMAX_URI_LENGTH) {
+            return false;
+        }
+        break;
+    case header_name:
+    case header_value: {
+        const header& h = req.headers[headers_count_ - 1];
+        if (h.name.size() + h.value.size() > kMAX_HEADER_LENGTH) {
+            return false;
+        }
+        break;
+                       }
+    case content:
+        if (req.content.size() == content_length_) {
+            return true; // all content has been consumed, stop parsing.
+        }
+        break;
+    default:
+        break;
+    }
+    return boost::indeterminate;
+}
+
 bool request_parser::is_char(int c)
 {
     return c >= 0 && c <= 127;
@@ -319,6 +387,99 @@ bool headers_equal(const std::string& a, const std::string& b)
                     &tolower_compare);
 }
 
+namespace {
+
+struct KnownHeaderName
+{
+    const char* name;
+    std::size_t length;
+};
+
+const KnownHeaderName kKNOWN_HEADER_NAMES[KNOWN_HEADERS_COUNT] = {
+    { "Accept-Encoding", 15 },
+    { "Authorization",   13 },
+    { "Connection",      10 },
+    { "Content-Length",  14 },
+    { "Content-Type",    12 },
+    { "Cookie",           6 },
+    { "If-Modified-Since", 17 },
+    { "If-None-Match",   13 },
+    { "If-Range",         8 },
+    { "Range",            5 }
+};
+
+/*!
+    \brief Perfect hash table of known header names.
+           Hash is computed from name length and its first letter only, it has no collisions on known names.
+           So at most one name comparison is needed to identify header.
+*/
+class KnownHeadersTable
+{
+public:
+    KnownHeadersTable()
+    {
+        std::fill(table_, table_ + kTABLE_SIZE, -1);
+        for (int i = 0; i < KNOWN_HEADERS_COUNT; ++i) {
+            const std::size_t slot = hash(kKNOWN_HEADER_NAMES[i].name, kKNOWN_HEADER_NAMES[i].length);
+            assert(table_[slot] == -1 && "hash function has collision on known header names");
+            table_[slot] = i;
+        }
+    }
+
+    /// Returns KnownHeader value or -1 if name is unknown.
+    int find(const std::string& name) const
+    {
+        if ( name.empty() ) {
+            return -1;
+        }
+
+        const int id = table_[hash( name.c_str(), name.length() )];
+        if (id == -1 || kKNOWN_HEADER_NAMES[id].length != name.length()) {
+            return -1;
+        }
+        for (std::size_t i = 0; i != name.length(); ++i) {
+            if ( ::tolower( static_cast<unsigned char>(name[i]) ) != ::tolower(kKNOWN_HEADER_NAMES[id].name[i]) ) {
+                return -1;
+            }
+        }
+        return id;
+    }
+
+private:
+
+    static const std::size_t kTABLE_SIZE = 32;
+
+    static std::size_t hash(const char* name, std::size_t length)
+        { return (length * 7 + ::tolower( static_cast<unsigned char>(name[0]) )) % kTABLE_SIZE; }
+
+    int table_[kTABLE_SIZE];
+};
+
+const KnownHeadersTable kKNOWN_HEADERS_TABLE;
+
+} // namespace
+
+void request_parser::index_known_headers(Request& req)
+{
+    std::fill(req.known_headers, req.known_headers + KNOWN_HEADERS_COUNT, -1);
+    for (std::size_t i = 0, count = req.headers.size(); i != count; ++i) {
+        const int id = kKNOWN_HEADERS_TABLE.find(req.headers[i].name);
+        if (id != -1 && req.known_headers[id] == -1) { // the first header wins as in search by name.
+            req.known_headers[id] = static_cast<int>(i);
+        }
+    }
+}
+
+bool get_header_value(const Request& req, KnownHeader header_id, const std::string*& header_value)
+{
+    const int index = req.known_headers[header_id];
+    if (index != -1) {
+        header_value = &req.headers[index].value;
+        return true;
+    }
+    return false;
+}
+
 bool get_header_value(const std::vector<header>& headers, const std::string& header_name, const std::string*& header_value)
 {
     const auto header_it = std::find_if(headers.begin(), headers.end(),
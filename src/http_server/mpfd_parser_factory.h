@@ -1,17 +1,25 @@
 #pragma once
 
-#include <boost/filesystem.hpp>
-
-namespace MPFD {
-    class Parser;
-}
+#include "multipart_form_data_parser.h"
+#include <memory>
+#include <string>
 
 namespace Http {
+
+struct Request;
+
 namespace MPFD {
 
+//! Creates parsers of multipart/form-data content. Parser is created in connection I/O thread as soon as request headers are received.
 class ParserFactory {
 public:
-    virtual std::unique_ptr<::MPFD::Parser> createParser(const std::string& content_type) = 0;
+    virtual ~ParserFactory() {}
+
+    /*!
+        Returns null if content of request must not be handled by streaming parser, it is received as usual content then.
+        \param req - request with uri and headers, its content is not received yet.
+    */
+    virtual std::unique_ptr<MultipartFormDataParser> createParser(const Request& req, const std::string& content_type) = 0; // throws std::exception
 
 
     typedef std::shared_ptr<ParserFactory> ParserFactoryPtr;
@@ -25,20 +33,5 @@ private:
     static ParserFactoryPtr s_instance;
 };
 
-class ParserFactoryImpl : public ParserFactory, private boost::noncopyable
-{
-public:
-    ParserFactoryImpl(boost::filesystem::wpath temp_dir)
-        :
-        temp_dir_(temp_dir)
-    {}
-
-    virtual std::unique_ptr<::MPFD::Parser> createParser(const std::string& content_type);
-
-private:
-
-    boost::filesystem::wpath temp_dir_; 
-}; 
-
 } // namespace MPFD
 } // namespace Http
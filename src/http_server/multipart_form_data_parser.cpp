@@ -0,0 +1,224 @@
+// Copyright (c) 2014, Alexey Ivanov
+
+#include "stdafx.h"
+#include "multipart_form_data_parser.h"
+#include "utils/util.h"
+#include <boost/algorithm/string.hpp>
+#include <stdexcept>
+
+namespace Http
+{
+
+namespace
+{
+
+const char kCRLF[] = "\r\n";
+const char kHEADERS_END[] = "\r\n\r\n";
+const size_t kMAX_BOUNDARY_LENGTH = 70; // RFC 2046.
+
+std::string trim(const std::string& s)
+{
+    return boost::trim_copy_if( s, boost::is_any_of(" \t") );
+}
+
+//! Returns value of parameter of header value like 'form-data; name="file"; filename="a.mp3"'. Quoted values can contain ';'.
+bool getParameter(const std::string& header_value, const char* parameter_name, std::string* parameter_value)
+{
+    size_t pos = header_value.find(';');
+    while (pos != std::string::npos) {
+        ++pos; // skip ';'
+        const size_t equal_pos = header_value.find('=', pos);
+        if (equal_pos == std::string::npos) {
+            return false;
+        }
+        const std::string name = trim( header_value.substr(pos, equal_pos - pos) );
+
+        std::string value;
+        pos = equal_pos + 1;
+        while (pos < header_value.size() && (header_value[pos] == ' ' || header_value[pos] == '\t')) {
+            ++pos;
+        }
+        if (pos < header_value.size() && header_value[pos] == '"') {
+            for (++pos; pos < header_value.size() && header_value[pos] != '"'; ++pos) {
+                if (header_value[pos] == '\\' && pos + 1 < header_value.size()) {
+                    ++pos;
+                }
+                value.push_back(header_value[pos]);
+            }
+            pos = header_value.find(';', pos);
+        } else {
+            const size_t value_end = header_value.find(';', pos);
+            value = trim( header_value.substr(pos, value_end == std::string::npos ? std::string::npos : value_end - pos) );
+            pos = value_end;
+        }
+
+        if ( boost::iequals(name, parameter_name) ) {
+            *parameter_value = value;
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+MultipartFormDataParser::MultipartFormDataParser(const std::string& content_type, std::unique_ptr<Handler> handler)
+    :
+    handler_( std::move(handler) ),
+    buffer_(kCRLF), // first boundary has no preceding CRLF, add it to find all boundaries by the same delimiter.
+    state_(PREAMBLE)
+{
+    using namespace Utilities;
+
+    std::string boundary;
+    if ( !getParameter(content_type, "boundary", &boundary) || boundary.empty() || boundary.size() > kMAX_BOUNDARY_LENGTH ) {
+        throw std::runtime_error(MakeString() << "Invalid boundary in Content-Type: " << content_type);
+    }
+    delimiter_ = std::string(kCRLF) + "--" + boundary;
+}
+
+void MultipartFormDataParser::write(const char* data, size_t size)
+{
+    while (size != 0) {
+        const size_t portion_size = size < kMAX_PORTION_SIZE ? size : kMAX_PORTION_SIZE;
+        buffer_.append(data, portion_size);
+        data += portion_size;
+        size -= portion_size;
+        process();
+    }
+}
+
+void MultipartFormDataParser::process()
+{
+    bool state_changed = true;
+    while (state_changed) {
+        switch (state_) {
+        case PREAMBLE:
+        case PART_DATA:
+            state_changed = processData();
+            break;
+        case BOUNDARY_END:
+            state_changed = processBoundaryEnd();
+            break;
+        case PART_HEADERS:
+            state_changed = processPartHeaders();
+            break;
+        case EPILOGUE:
+            buffer_.clear(); // data after final boundary is ignored.
+            state_changed = false;
+            break;
+        default:
+            assert(!"unexpected state");
+            state_changed = false;
+            break;
+        }
+    }
+}
+
+bool MultipartFormDataParser::processData()
+{
+    const size_t delimiter_pos = buffer_.find(delimiter_);
+    if (delimiter_pos == std::string::npos) {
+        // keep tail which can be beginning of delimiter, pass the rest.
+        if ( buffer_.size() >= delimiter_.size() ) {
+            const size_t size = buffer_.size() - (delimiter_.size() - 1);
+            if (state_ == PART_DATA) {
+                handler_->partData(buffer_.data(), size);
+            }
+            buffer_.erase(0, size);
+        }
+        return false;
+    }
+
+    if (state_ == PART_DATA) {
+        if (delimiter_pos != 0) {
+            handler_->partData(buffer_.data(), delimiter_pos);
+        }
+        handler_->partEnd();
+    }
+    buffer_.erase( 0, delimiter_pos + delimiter_.size() );
+    state_ = BOUNDARY_END;
+    return true;
+}
+
+bool MultipartFormDataParser::processBoundaryEnd()
+{
+    // boundary is followed by optional whitespace and CRLF, or by "--" if it is final one.
+    const size_t end = buffer_.find_first_not_of(" \t");
+    if (end == std::string::npos || buffer_.size() - end < 2) {
+        return false;
+    }
+
+    if (buffer_.compare(end, 2, "--") == 0) {
+        state_ = EPILOGUE;
+    } else if (buffer_.compare(end, 2, kCRLF) == 0) {
+        state_ = PART_HEADERS;
+    } else {
+        throw std::runtime_error("Boundary is not followed by CRLF in multipart content");
+    }
+    buffer_.erase(0, end + 2);
+    return true;
+}
+
+bool MultipartFormDataParser::processPartHeaders()
+{
+    // part without headers starts with CRLF right after boundary line.
+    const size_t headers_end = buffer_.compare(0, 2, kCRLF) == 0 ? 0
+                                                                  : buffer_.find(kHEADERS_END);
+    if (headers_end == std::string::npos) {
+        if (buffer_.size() > kMAX_PART_HEADERS_SIZE) {
+            throw std::runtime_error("Headers of multipart content part are too large");
+        }
+        return false;
+    }
+
+    const Part part = parsePartHeaders( buffer_.substr(0, headers_end) );
+    buffer_.erase( 0, headers_end == 0 ? 2 : headers_end + sizeof(kHEADERS_END) - 1 );
+    handler_->partBegin(part);
+    state_ = PART_DATA;
+    return true;
+}
+
+MultipartFormDataParser::Part MultipartFormDataParser::parsePartHeaders(const std::string& headers)
+{
+    using namespace Utilities;
+
+    Part part;
+    part.is_file = false;
+    bool has_disposition = false;
+
+    size_t line_begin = 0;
+    while ( line_begin < headers.size() ) {
+        size_t line_end = headers.find(kCRLF, line_begin);
+        if (line_end == std::string::npos) {
+            line_end = headers.size();
+        }
+        const std::string line = headers.substr(line_begin, line_end - line_begin);
+        line_begin = line_end + 2;
+
+        const size_t colon_pos = line.find(':');
+        if (colon_pos == std::string::npos) {
+            throw std::runtime_error(MakeString() << "Invalid header of multipart content part: " << line);
+        }
+        const std::string name = trim( line.substr(0, colon_pos) ),
+                          value = trim( line.substr(colon_pos + 1) );
+
+        if ( boost::iequals(name, "Content-Disposition") ) {
+            if ( !boost::istarts_with(value, "form-data") ) {
+                throw std::runtime_error(MakeString() << "Unexpected Content-Disposition of multipart content part: " << value);
+            }
+            has_disposition = true;
+            getParameter(value, "name", &part.name);
+            part.is_file = getParameter(value, "filename", &part.filename);
+        } else if ( boost::iequals(name, "Content-Type") ) {
+            part.content_type = value;
+        }
+    }
+
+    if (!has_disposition) {
+        throw std::runtime_error("Multipart content part has no Content-Disposition header");
+    }
+    return part;
+}
+
+} // namespace Http
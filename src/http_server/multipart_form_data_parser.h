@@ -0,0 +1,78 @@
+// Copyright (c) 2014, Alexey Ivanov
+
+#pragma once
+
+#include <boost/noncopyable.hpp>
+#include <memory>
+#include <string>
+
+namespace Http
+{
+
+/*!
+    \brief Streaming parser of multipart/form-data content(RFC 2388).
+           Data of each part is passed to handler as soon as it arrives. Parser keeps only headers of current part
+           and tail of data which can be beginning of boundary, so memory usage does not depend on content size.
+*/
+class MultipartFormDataParser : boost::noncopyable
+{
+public:
+
+    struct Part
+    {
+        std::string name; //!< name of form field.
+        std::string filename; //!< file name as client sent it, empty for text fields.
+        std::string content_type;
+        bool is_file; //!< true if Content-Disposition contains filename parameter.
+    };
+
+    //! Receives content of parts. Any method can throw std::exception to reject content.
+    class Handler
+    {
+    public:
+        virtual ~Handler() {}
+        virtual void partBegin(const Part& part) = 0;
+        virtual void partData(const char* data, size_t size) = 0;
+        virtual void partEnd() = 0;
+    };
+
+    //! Max size of headers of single part.
+    static const size_t kMAX_PART_HEADERS_SIZE = 8 * 1024;
+
+    /*!
+        \param content_type - value of Content-Type header which contains boundary.
+        \param handler - receives parts, it is owned by parser.
+    */
+    MultipartFormDataParser(const std::string& content_type, std::unique_ptr<Handler> handler); // throws std::runtime_error
+
+    //! Parses next portion of content, portions can be split at any point.
+    void write(const char* data, size_t size); // throws std::runtime_error, std::exception from handler.
+
+    //! Returns true if final boundary was found.
+    bool finished() const
+        { return state_ == EPILOGUE; }
+
+    Handler& handler() const
+        { return *handler_; }
+
+private:
+
+    enum State { PREAMBLE, BOUNDARY_END, PART_HEADERS, PART_DATA, EPILOGUE };
+
+    //! Data is added to buffer by portions of this size at most, so buffer does not grow when large data is written at once.
+    static const size_t kMAX_PORTION_SIZE = 16 * 1024;
+
+    void process();
+    bool processData();
+    bool processBoundaryEnd();
+    bool processPartHeaders();
+
+    static Part parsePartHeaders(const std::string& headers); // throws std::runtime_error
+
+    std::unique_ptr<Handler> handler_;
+    std::string delimiter_; //!< CRLF, "--" and boundary.
+    std::string buffer_; //!< data which was not processed yet.
+    State state_;
+};
+
+} // namespace Http
@@ -12,6 +12,9 @@ namespace Http {
 
 namespace status_strings {
 
+// WebSocket handshake requires HTTP/1.1 status line.
+const std::string switching_protocols =
+"HTTP/1.1 101 Switching Protocols\r\n";
 const std::string ok =
 "HTTP/1.0 200 OK\r\n";
 const std::string created =
@@ -20,6 +23,8 @@ const std::string accepted =
 "HTTP/1.0 202 Accepted\r\n";
 const std::string no_content =
 "HTTP/1.0 204 No Content\r\n";
+const std::string partial_content =
+"HTTP/1.0 206 Partial Content\r\n";
 const std::string multiple_choices =
 "HTTP/1.0 300 Multiple Choices\r\n";
 const std::string moved_permanently =
@@ -36,6 +41,10 @@ const std::string forbidden =
 "HTTP/1.0 403 Forbidden\r\n";
 const std::string not_found =
 "HTTP/1.0 404 Not Found\r\n";
+const std::string requested_range_not_satisfiable =
+"HTTP/1.0 416 Requested Range Not Satisfiable\r\n";
+const std::string too_many_requests =
+"HTTP/1.0 429 Too Many Requests\r\n";
 const std::string internal_server_error =
 "HTTP/1.0 500 Internal Server Error\r\n";
 const std::string not_implemented =
@@ -49,6 +58,8 @@ boost::asio::const_buffer to_buffer(Reply::status_type status)
 {
     switch (status)
     {
+    case Reply::switching_protocols:
+        return boost::asio::buffer(switching_protocols);
     case Reply::ok:
         return boost::asio::buffer(ok);
     case Reply::created:
@@ -57,6 +68,8 @@ boost::asio::const_buffer to_buffer(Reply::status_type status)
         return boost::asio::buffer(accepted);
     case Reply::no_content:
         return boost::asio::buffer(no_content);
+    case Reply::partial_content:
+        return boost::asio::buffer(partial_content);
     case Reply::multiple_choices:
         return boost::asio::buffer(multiple_choices);
     case Reply::moved_permanently:
@@ -73,6 +86,10 @@ boost::asio::const_buffer to_buffer(Reply::status_type status)
         return boost::asio::buffer(forbidden);
     case Reply::not_found:
         return boost::asio::buffer(not_found);
+    case Reply::requested_range_not_satisfiable:
+        return boost::asio::buffer(requested_range_not_satisfiable);
+    case Reply::too_many_requests:
+        return boost::asio::buffer(too_many_requests);
     case Reply::internal_server_error:
         return boost::asio::buffer(internal_server_error);
     case Reply::not_implemented:
@@ -98,7 +115,7 @@ const char crlf[] = { '\r', '\n' };
 std::vector<boost::asio::const_buffer> Reply::to_buffers() const
 {
     std::vector<boost::asio::const_buffer> buffers( to_buffers_headers_only() ); // make code simple: rely on move semantic.
-    buffers.push_back(boost::asio::buffer(content));
+    buffers.push_back( boost::asio::buffer(shared_content ? *shared_content : content) );
     return buffers;
 }
 
@@ -135,6 +152,11 @@ const char no_content[] =
 "<head><title>No Content</title></head>"
 "<body><h1>204 Content</h1></body>"
 "</html>";
+const char partial_content[] =
+"<html>"
+"<head><title>Partial Content</title></head>"
+"<body><h1>206 Partial Content</h1></body>"
+"</html>";
 const char multiple_choices[] =
 "<html>"
 "<head><title>Multiple Choices</title></head>"
@@ -175,6 +197,16 @@ const char not_found[] =
 "<head><title>Not Found</title></head>"
 "<body><h1>404 Not Found</h1></body>"
 "</html>";
+const char requested_range_not_satisfiable[] =
+"<html>"
+"<head><title>Requested Range Not Satisfiable</title></head>"
+"<body><h1>416 Requested Range Not Satisfiable</h1></body>"
+"</html>";
+const char too_many_requests[] =
+"<html>"
+"<head><title>Too Many Requests</title></head>"
+"<body><h1>429 Too Many Requests</h1></body>"
+"</html>";
 const char internal_server_error[] =
 "<html>"
 "<head><title>Internal Server Error</title></head>"
@@ -208,6 +240,8 @@ std::string to_string(Reply::status_type status)
         return accepted;
     case Reply::no_content:
         return no_content;
+    case Reply::partial_content:
+        return partial_content;
     case Reply::multiple_choices:
         return multiple_choices;
     case Reply::moved_permanently:
@@ -224,6 +258,10 @@ std::string to_string(Reply::status_type status)
         return forbidden;
     case Reply::not_found:
         return not_found;
+    case Reply::requested_range_not_satisfiable:
+        return requested_range_not_satisfiable;
+    case Reply::too_many_requests:
+        return too_many_requests;
     case Reply::internal_server_error:
         return internal_server_error;
     case Reply::not_implemented:
@@ -6,23 +6,51 @@
 #ifndef HTTP_REPLY_H
 #define HTTP_REPLY_H
 
+#include <memory>
 #include <string>
 #include <vector>
 #include <boost/asio.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/shared_ptr.hpp>
 #include "http_server/header.h"
 
 namespace Http {
 
+/// Source of reply content which is too large to be built in memory at once(for example all entries of big playlist).
+/// Connection sends content portion by portion with chunked transfer encoding, next portion is produced after previous one was sent.
+class ContentProducer
+{
+public:
+    virtual ~ContentProducer() {}
+
+    /// Append next portion of content of about max_size bytes to out. Return false if it was the last portion.
+    /// Called in player thread. Exception interrupts reply, connection is closed then.
+    virtual bool produce(std::string* out, std::size_t max_size) = 0;
+};
+
+typedef boost::shared_ptr<ContentProducer> ContentProducer_ptr;
+
 /// A reply to be sent to a client.
 struct Reply
 {
+    Reply()
+        :
+        status(ok),
+        file_offset(0),
+        file_length(0),
+        compress_content(false),
+        compression_level(0)
+    {}
+
     /// The status of the reply.
     enum status_type
     {
+        switching_protocols = 101,
         ok = 200,
         created = 201,
         accepted = 202,
         no_content = 204,
+        partial_content = 206,
         multiple_choices = 300,
         moved_permanently = 301,
         moved_temporarily = 302,
@@ -31,6 +59,8 @@ struct Reply
         unauthorized = 401,
         forbidden = 403,
         not_found = 404,
+        requested_range_not_satisfiable = 416,
+        too_many_requests = 429,
         internal_server_error = 500,
         not_implemented = 501,
         bad_gateway = 502,
@@ -43,9 +73,29 @@ struct Reply
     /// The content to be sent in the reply.
     std::string content;
 
+    /// Immutable content shared with other replies(for example cached static file). It is sent instead 'content' if not null.
+    std::shared_ptr<const std::string> shared_content;
+
+    /// Returns size of content which will be sent.
+    std::size_t content_size() const
+        { return shared_content ? shared_content->size() : content.size(); }
+
     /// The name of file to be sent in the reply instead 'content'. Used for effective sending large files.
     std::wstring filename;
 
+    /// Range [file_offset, file_offset + file_length) of file to be sent. Used only if filename is not empty.
+    boost::uint64_t file_offset;
+    boost::uint64_t file_length;
+
+    /// Content will be gzip encoded by connection in I/O thread right before sending. Set only if client accepts gzip.
+    bool compress_content;
+
+    /// Producer of content which is sent instead 'content' with chunked transfer encoding if not null.
+    ContentProducer_ptr content_producer;
+
+    /// Gzip level of produced content, 0 if it is sent uncompressed. Set by request handler, connection creates encoder by it in I/O thread.
+    int compression_level;
+
     /// Convert the reply into a vector of buffers. The buffers do not own the
     /// underlying memory blocks, therefore the reply object must remain valid and
     /// not be changed until the write operation has completed.
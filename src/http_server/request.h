@@ -9,10 +9,26 @@
 #include <string>
 #include <vector>
 #include "http_server/header.h"
-#include "http_server/mpfd_parser/Parser.h"
+#include "http_server/multipart_form_data_parser.h"
 
 namespace Http {
 
+/// Headers used by server itself. Their positions in Request::headers are found by parser, so lookup does not need search.
+enum KnownHeader
+{
+    HEADER_ACCEPT_ENCODING,
+    HEADER_AUTHORIZATION,
+    HEADER_CONNECTION,
+    HEADER_CONTENT_LENGTH,
+    HEADER_CONTENT_TYPE,
+    HEADER_COOKIE,
+    HEADER_IF_MODIFIED_SINCE,
+    HEADER_IF_NONE_MATCH,
+    HEADER_IF_RANGE,
+    HEADER_RANGE,
+    KNOWN_HEADERS_COUNT
+};
+
 /// A request received from a client.
 struct Request
 {
@@ -31,12 +47,15 @@ struct Request
     /// The headers included with the request.
     std::vector<header> headers;
 
+    /// Indices of known headers in headers vector, -1 if header is absent.
+    int known_headers[KNOWN_HEADERS_COUNT];
+
     /// The optional content sent with the request.
     std::string content;
 
     /// The optional multipart form data content sent with the request.
-    /// Will contain all data.
-    std::shared_ptr<MPFD::Parser> mpfd_parser;
+    /// Content is not kept in request, parser passes it to its handler as it arrives.
+    std::shared_ptr<MultipartFormDataParser> mpfd_parser;
 };
 
 } // namespace Http
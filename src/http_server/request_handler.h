@@ -10,8 +10,14 @@
 
 #include <string>
 #include <map>
+#include <memory>
+#include <boost/cstdint.hpp>
 #include <boost/noncopyable.hpp>
+#include "admission_control.h"
+#include "compression_stats.h"
 #include "connection.h"
+#include "event_stream.h"
+#include "static_file_cache.h"
 
 // headers for DelayedResponseSender class
 #include <boost/enable_shared_from_this.hpp>
@@ -20,6 +26,7 @@
 namespace Rpc           { class RequestHandler; }
 namespace DownloadTrack { class RequestHandler; }
 namespace UploadTrack   { class RequestHandler; }
+namespace AlbumCover    { class RequestHandler; }
 
 namespace Http
 {
@@ -35,15 +42,28 @@ class RequestHandler : private boost::noncopyable
 public:
 
     /// Construct with document root directory and Rpc handler.
+    /// event_stream_listener receives event streams requested by GET /events?event=<name>&event=<name>, streams are disabled if it is null.
+    /// GET /websocket switches connection to WebSocket protocol which carries JSON-RPC messages in both directions.
+    /// album_cover_request_handler serves GET /cover/<playlist_id>/<track_id>/<width>x<height>, covers are not available if it is null.
     explicit RequestHandler(const std::string& document_root,
                             Rpc::RequestHandler& rpc_request_handler,
                             DownloadTrack::RequestHandler& download_track_request_handler,
-                            UploadTrack::RequestHandler& upload_track_request_handler)
+                            UploadTrack::RequestHandler& upload_track_request_handler,
+                            AlbumCover::RequestHandler* album_cover_request_handler,
+                            EventStreamListener* event_stream_listener)
         :
         document_root_(document_root),
+        static_file_cache_(kSTATIC_FILE_CACHE_MEMORY_LIMIT),
+        admission_control_( new AdmissionControl( admissionLimitsFromSettings() ) ),
+        auth_manager_( new Authentication::AuthManager() ),
         rpc_request_handler_(rpc_request_handler),
         download_track_request_handler_(download_track_request_handler),
-        upload_track_request_handler_(upload_track_request_handler)
+        upload_track_request_handler_(upload_track_request_handler),
+        album_cover_request_handler_(album_cover_request_handler),
+        event_stream_listener_(event_stream_listener),
+        compression_level_( compressionLevelFromSettings() ),
+        compression_min_size_( compressionMinSizeFromSettings() ),
+        compression_stats_(new CompressionStats())
     {}
 
     /*
@@ -52,10 +72,54 @@ public:
     */
     bool handle_request(const Request& req, Reply& rep, ICometDelayedConnection_ptr connection);
 
+    /*
+        Handle JSON-RPC request received as WebSocket message.
+        Return true if response should be sent immediately, false if it will be sent by connection->sendResponse().
+    */
+    bool handle_websocket_message(const std::string& message, std::string* response, ICometDelayedConnection_ptr connection);
+
+    /// Counters of RPC responses compression. Connections count compressed chunked replies there.
+    const CompressionStats_ptr& compression_stats() const
+        { return compression_stats_; }
+
+    /*
+        Replace content of RPC reply with its gzip encoded version if content is large enough and update Content-Length header.
+        Called by connections in I/O threads, so compression does not block player thread.
+    */
+    void compressReplyContent(Reply& rep);
+
+    /*
+        Set gzip level of reply content which is produced by portions(Reply::content_producer) and add Content-Encoding header,
+        nothing is done if compression is disabled. Called in player thread, connection compresses portions in I/O thread.
+    */
+    void setProducedContentCompression(Reply& rep) const;
+
+    /// Cache of static files, it must be used in player thread only.
+    const StaticFileCache& static_file_cache() const
+        { return static_file_cache_; }
+
+    /// Limits of connections and requests, it is used by connections in I/O threads.
+    /// Connections keep reference to it since they can outlive request handler on plugin unload.
+    const AdmissionControl_ptr& admission_control() const
+        { return admission_control_; }
+
+    /// Authentication of requests, it is shared with upload parser factory which checks credentials in I/O threads.
+    const Authentication::AuthManager_ptr& auth_manager() const
+        { return auth_manager_; }
+
 private:
 
     void handle_file_request(const Request& req, Reply& rep);
 
+    // Start stream of server-sent events. Return false if stream was started and reply must not be sent.
+    bool handle_event_stream_request(const Request& req, Reply& rep, ICometDelayedConnection_ptr connection);
+
+    // Switch connection to WebSocket protocol. Return false if handshake is valid and reply is sent by WebSocket connection.
+    bool handle_websocket_request(const Request& req, Reply& rep, ICometDelayedConnection_ptr connection);
+
+    // Send file which can not be cached by TransmitFile.
+    void handle_uncached_file_request(const Request& req, const std::string& full_path, const std::string& extension, Reply& rep);
+
     // Perform URL-decoding on a string. \return false if the encoding was invalid.
     static bool url_decode(const std::string& in, std::string& out);
 
@@ -65,18 +129,49 @@ private:
     */
     static void fillReplyWithContent(const std::string& content_type, Reply& rep);
 
-    void fillAuthFailReply(Reply& rep);
+    // Fill headers of reply which content is sent by portions with chunked transfer encoding.
+    static void fillReplyWithProducedContent(const std::string& content_type, Reply& rep);
+
+    /*
+        Add Set-Cookie header of session which was created by this request if reply does not contain it yet.
+        Session is useless for client which does not get the cookie, so it is added to any reply of request: immediate or delayed.
+    */
+    static void addSessionCookie(const std::string& session_cookie, Reply& rep);
+
+    // Handle authenticated request. session_cookie is not empty if session was created by this request.
+    bool dispatch_request(const Request& req, Reply& rep, ICometDelayedConnection_ptr connection, const std::string& session_cookie);
+
+    // Fill 401 reply with Digest challenge. stale_nonce means credentials were valid but nonce is expired.
+    void fillAuthFailReply(bool stale_nonce, Reply& rep);
 
     void trySendInitCookies(const Request& req, Reply& rep);
 
+    static AdmissionControl::Limits admissionLimitsFromSettings();
+    static int compressionLevelFromSettings();
+    static std::size_t compressionMinSizeFromSettings();
+
     // The directory containing the files to be served.
     std::string document_root_;
 
-    Authentication::AuthManager auth_manager_;
+    // Content of files from document root. Whole web interface(~1.5 Mb not optimized, with precompressed copies) fits in it.
+    static const size_t kSTATIC_FILE_CACHE_MEMORY_LIMIT = 8 * 1024 * 1024;
+    StaticFileCache static_file_cache_;
+
+    AdmissionControl_ptr admission_control_;
+
+    Authentication::AuthManager_ptr auth_manager_;
 
     Rpc::RequestHandler& rpc_request_handler_;
     DownloadTrack::RequestHandler& download_track_request_handler_;
     UploadTrack::RequestHandler& upload_track_request_handler_;
+    AlbumCover::RequestHandler* album_cover_request_handler_;
+    EventStreamListener* event_stream_listener_;
+
+    // Compression settings are copied since they are used in I/O threads.
+    const int compression_level_;
+    const std::size_t compression_min_size_;
+
+    CompressionStats_ptr compression_stats_;
 };
 
 
@@ -86,20 +181,49 @@ class DelayedResponseSender : public boost::enable_shared_from_this<DelayedRespo
 {
 public:
     DelayedResponseSender(ICometDelayedConnection_ptr comet_connection,
-                          RequestHandler& http_request_handler)
+                          RequestHandler& http_request_handler,
+                          bool compress_response,
+                          const std::string& session_cookie)
         :
         comet_connection_(comet_connection),
-        http_request_handler_(http_request_handler)
+        http_request_handler_(http_request_handler),
+        admission_control_( http_request_handler.admission_control() ),
+        compress_response_(compress_response),
+        session_cookie_(session_cookie),
+        subscription_rejected_(false)
     {}
 
+    /// Releases subscription slot of client.
+    ~DelayedResponseSender();
+
     void send(const std::string& response, const std::string& response_content_type);
 
+    /// Sends reply which was filled by caller through get_reply().
+    void sendReply();
+
+    /*
+        Called by RPC method which delays response until event occurs(subscription).
+        Return false if client has too many pending subscriptions, method must fail in this case.
+        Sender takes one slot of client however many subscriptions use it(batch request).
+    */
+    bool admitSubscription();
+
+    /// Return true if subscription was rejected, client gets 429 reply then.
+    bool subscriptionRejected() const
+        { return subscription_rejected_; }
+
     const Reply& get_reply() const;
+    Reply& get_reply();
 
 private:
 
     ICometDelayedConnection_ptr comet_connection_;
     RequestHandler& http_request_handler_;
+    AdmissionControl_ptr admission_control_; // sender can be destroyed after http_request_handler_ on plugin unload.
+    bool compress_response_; // client accepts gzip encoding.
+    const std::string session_cookie_; // Set-Cookie of session created by request, reply_ must carry it.
+    SubscriptionSlot_ptr subscription_slot_; // also held by connection which releases it if client closes connection.
+    bool subscription_rejected_;
     Reply reply_; // Reply object is member since it should exist till connection send it to client.
 };
 
@@ -6,19 +6,26 @@
 #ifndef HTTP_REQUEST_PARSER_H
 #define HTTP_REQUEST_PARSER_H
 
+#include <algorithm>
 #include <string>
+#include <vector>
 #include <boost/logic/tribool.hpp>
 #include <boost/tuple/tuple.hpp>
+#include "request.h"
 
 namespace Http {
 
-struct Request;
-struct header;
-
 /// Parser for incoming requests.
 class request_parser
 {
 public:
+    /// Limits which protect server from memory exhaustion by malicious requests. Request which exceeds any of them is bad request.
+    static const std::size_t kMAX_METHOD_LENGTH = 32;
+    static const std::size_t kMAX_URI_LENGTH = 8 * 1024;
+    static const std::size_t kMAX_HEADER_LENGTH = 8 * 1024; ///< name and value of single header.
+    static const std::size_t kMAX_HEADERS_COUNT = 64;
+    static const std::size_t kMAX_CONTENT_LENGTH = 16 * 1024 * 1024; ///< content is kept in memory. Multipart form data is streamed to parser and is not limited.
+
     /// Construct ready to parse the request method.
     request_parser();
 
@@ -39,7 +46,15 @@ public:
             return parse_mpfd(req, begin, end);
         default:
             while (begin != end) {
-                boost::tribool result = consume(req, *begin++);
+                boost::tribool result = consume_run(req, begin, end);
+                if (result || !result) {
+                    return boost::make_tuple(result, begin);
+                }
+                if (begin == end) {
+                    break;
+                }
+
+                result = consume(req, *begin++);
                 if (result || !result) {
                     return boost::make_tuple(result, begin);
                 }
@@ -66,28 +81,85 @@ private:
 
         if (content_consumed_ < content_length_) {   
             assert(begin <= end);
-            const std::size_t length = std::distance(begin, end);
+            // do not consume data after content end, it belongs to next request on persistent connection.
+            const std::size_t length = std::min<std::size_t>( std::distance(begin, end), content_length_ - content_consumed_ );
             assert(req.mpfd_parser);
-            req.mpfd_parser->AcceptSomeData(begin, length);
+            if (length != 0) {
+                try {
+                    req.mpfd_parser->write(&*begin, length);
+                } catch (std::exception&) {
+                    return boost::make_tuple(false, begin); // malformed content or failed to store it.
+                }
+            }
             content_consumed_ += length;
             boost::tribool result = boost::indeterminate;
             if (content_consumed_ == content_length_) {
                 result = true; // all content has been consumed, stop parsing.
             }
-            return boost::make_tuple(result, end);
+            return boost::make_tuple(result, begin + length);
         }
         return boost::make_tuple(false, begin);
     }
 
-    /// The name of the content length header.
-    static std::string content_length_name_;
+    /// Append run of ordinary characters of uri, header name, header value or content at once instead of passing them to consume() one by one.
+    /// Run ends at first character which changes parser state. The tribool return value is the same as of consume().
+    template <typename InputIterator>
+    boost::tribool consume_run(Request& req, InputIterator& begin, InputIterator end)
+    {
+        InputIterator run_end = begin;
+        switch (state_) {
+        case uri:
+            while ( run_end != end && *run_end != ' ' && !is_ctl(*run_end) ) {
+                ++run_end;
+            }
+            break;
+        case header_name:
+            while ( run_end != end && is_char(*run_end) && !is_ctl(*run_end) && !is_tspecial(*run_end) ) {
+                ++run_end;
+            }
+            break;
+        case header_value:
+            while ( run_end != end && *run_end != '\r' && !is_ctl(*run_end) ) {
+                ++run_end;
+            }
+            break;
+        case content: {
+            // do not consume data after content end, it belongs to next request on persistent connection.
+            const std::size_t length = std::min<std::size_t>( std::distance(begin, end), content_length_ - content_consumed_ );
+            std::advance(run_end, length);
+            content_consumed_ += length;
+            break;
+                      }
+        default:
+            return boost::indeterminate;
+        }
+
+        if (begin != run_end) {
+            current_field(req).append(begin, run_end);
+            begin = run_end;
+        }
+        return check_current_field(req);
+    }
 
     /// Content length as decoded from headers. Defaults to 0.
     std::size_t content_length_;
 
+    /// Count of headers of current request. Header objects in Request::headers are reused by subsequent requests
+    /// on persistent connection, so their strings do not allocate memory again.
+    std::size_t headers_count_;
+
     /// Handle the next character of input.
     boost::tribool consume(Request& req, char input);
 
+    /// Returns string which is filled in current state: uri, name or value of last header, or content.
+    std::string& current_field(Request& req) const;
+
+    /// Returns false if current field exceeds its size limit, true if all content has been consumed, indeterminate otherwise.
+    boost::tribool check_current_field(const Request& req) const;
+
+    /// Fill Request::known_headers.
+    static void index_known_headers(Request& req);
+
     /// Check if a byte is an HTTP character.
     static bool is_char(int c);
 
@@ -134,6 +206,9 @@ private:
 
 bool get_header_value(const std::vector<header>& headers, const std::string& header_name, const std::string*& header_value);
 
+/// Fast lookup of header which was indexed by parser.
+bool get_header_value(const Request& req, KnownHeader header_id, const std::string*& header_value);
+
 } // namespace Http
 
 #endif // HTTP_REQUEST_PARSER_H
@@ -56,10 +56,23 @@ struct Endpoint
 
 std::set<Endpoint> getEndpointsFromSettings();
 
-Server::Server( boost::asio::io_service& io_service, RequestHandler& request_handler)
+KeepAliveSettings getKeepAliveSettingsFromSettings()
+{
+    const auto& settings = ControlPlugin::AIMPControlPlugin::settings();
+    KeepAliveSettings keep_alive_settings;
+    keep_alive_settings.timeout = settings.http_server.keep_alive_timeout;
+    keep_alive_settings.max_requests = settings.http_server.keep_alive_max_requests;
+    return keep_alive_settings;
+}
+
+Server::Server( boost::asio::io_service& io_service,
+                RequestHandler& request_handler,
+                ControlPlugin::PlayerThreadDispatcher& player_thread_dispatcher)
     :
     io_service_(io_service),
-    request_handler_(request_handler)
+    request_handler_(request_handler),
+    player_thread_dispatcher_(player_thread_dispatcher),
+    keep_alive_settings_( getKeepAliveSettingsFromSettings() )
 {
     std::set<Endpoint> endpoints = getEndpointsFromSettings();
     for (auto endpoint : endpoints) {
@@ -76,7 +89,7 @@ Server::Server( boost::asio::io_service& io_service, RequestHandler& request_han
     try {
         open_bluetooth_socket();
     } catch(std::exception& e) {
-        BOOST_LOG_SEV(logger(), error) << "Bluetooth control is not available: failed to start bluetooth service. Reason: " << e.what();
+        AIMP_LOG_SEV(logger(), error) << "Bluetooth control is not available: failed to start bluetooth service. Reason: " << e.what();
         // proceed work of ip::tcp server.
     }
 }
@@ -106,9 +119,9 @@ void Server::open_specified_socket(const std::string& address, const std::string
             throw std::exception("no endpoints were resolved");
         }
 
-        BOOST_LOG_SEV(logger(), debug) << "Resolved endpoints for '" << address << ":" << port << "':";
+        AIMP_LOG_SEV(logger(), debug) << "Resolved endpoints for '" << address << ":" << port << "':";
         for (; endpoint_iter != endpoint_iter_end; ++endpoint_iter) {
-            BOOST_LOG_SEV(logger(), debug) << ip::tcp::endpoint(*endpoint_iter);
+            AIMP_LOG_SEV(logger(), debug) << ip::tcp::endpoint(*endpoint_iter);
         }
     } catch(std::exception& e) {
         throw std::runtime_error( MakeString() << "Error in "__FUNCTION__": Failed to resolve endpoint for ip '"
@@ -140,7 +153,7 @@ void Server::start_accept_connections_on(boost::asio::ip::tcp::endpoint endpoint
     acceptor->listen();
 
     // The next connection to be accepted.
-    ConnectionIpTcp_ptr next_connection( new ConnectionIpTcp(io_service_, request_handler_) );
+    ConnectionIpTcp_ptr next_connection( new ConnectionIpTcp(io_service_, request_handler_, player_thread_dispatcher_, keep_alive_settings_) );
     acceptor->async_accept( next_connection->socket(),
                             boost::bind(&Server::handle_accept,
                                         this,
@@ -155,12 +168,15 @@ void Server::handle_accept(IpTcpConnectionAcceptor_ptr acceptor,
                            const boost::system::error_code& e)
 {
     const boost::asio::ip::tcp::socket::endpoint_type& endpoint = accepted_connection->socket().remote_endpoint();
-    BOOST_LOG_SEV(logger(), info) << "Connection accepted from remote host " << endpoint;
+    AIMP_LOG_SEV(logger(), info) << "Connection accepted from remote host " << endpoint;
 
     if (!e) {
+        // each reply is written by single gather write, Nagle's algorithm would only delay replies to pipelined requests until ACK of previous reply.
+        boost::system::error_code ignored_ec;
+        accepted_connection->socket().set_option(boost::asio::ip::tcp::no_delay(true), ignored_ec);
         accepted_connection->start();
-        BOOST_LOG_SEV(logger(), debug) << "Client connection started";
-        ConnectionIpTcp_ptr new_connection( new ConnectionIpTcp(io_service_, request_handler_) );
+        AIMP_LOG_SEV(logger(), debug) << "Client connection started";
+        ConnectionIpTcp_ptr new_connection( new ConnectionIpTcp(io_service_, request_handler_, player_thread_dispatcher_, keep_alive_settings_) );
         acceptor->async_accept(new_connection->socket(),
                                boost::bind(&Server::handle_accept,
                                            this,
@@ -168,9 +184,9 @@ void Server::handle_accept(IpTcpConnectionAcceptor_ptr acceptor,
                                            new_connection,
                                            boost::asio::placeholders::error)
                               );
-        BOOST_LOG_SEV(logger(), debug) << "Continue to waiting client connection";
+        AIMP_LOG_SEV(logger(), debug) << "Continue to waiting client connection";
     } else {
-        BOOST_LOG_SEV(logger(), error) << "Error Server::handle_accept():" << e;
+        AIMP_LOG_SEV(logger(), error) << "Error Server::handle_accept():" << e;
     }
 }
 
@@ -256,7 +272,7 @@ std::set<NetworkInterface> getIPaddressesOfAdaptersSpecifiedByMAC(std::set<Netwo
             pAdapter = pAdapter->Next;
         }
     } else {
-         BOOST_LOG_SEV(logger(), warning) << "GetAdaptersInfo failed with error: " << dwRetVal;
+         AIMP_LOG_SEV(logger(), warning) << "GetAdaptersInfo failed with error: " << dwRetVal;
     }
 
     return interfaces_ip;
@@ -326,7 +342,7 @@ void Server::open_bluetooth_socket()
     acceptor->bind(endpoint);
     acceptor->listen();
     
-    ConnectionBluetoothRfcomm_ptr new_connection( new ConnectionBluetoothRfcomm(io_service_, request_handler_) );
+    ConnectionBluetoothRfcomm_ptr new_connection( new ConnectionBluetoothRfcomm(io_service_, request_handler_, player_thread_dispatcher_, keep_alive_settings_) );
     acceptor->async_accept( new_connection->socket(),
                             boost::bind(&Server::handle_accept_bluetooth,
                                         this,
@@ -343,12 +359,12 @@ void Server::handle_accept_bluetooth(BluetoothConnectionAcceptor_ptr acceptor,
                                      const boost::system::error_code& e)
 {
     const boost::asio::bluetooth::rfcomm::socket::endpoint_type& endpoint = accepted_connection->socket().remote_endpoint();
-    BOOST_LOG_SEV(logger(), info) << "Connection accepted from remote host " << endpoint;
+    AIMP_LOG_SEV(logger(), info) << "Connection accepted from remote host " << endpoint;
 
     if (!e) {
         accepted_connection->start();
-        BOOST_LOG_SEV(logger(), debug) << "Client connection started";
-        ConnectionBluetoothRfcomm_ptr new_connection( new ConnectionBluetoothRfcomm(io_service_, request_handler_) );
+        AIMP_LOG_SEV(logger(), debug) << "Client connection started";
+        ConnectionBluetoothRfcomm_ptr new_connection( new ConnectionBluetoothRfcomm(io_service_, request_handler_, player_thread_dispatcher_, keep_alive_settings_) );
         acceptor->async_accept( new_connection->socket(),
                                 boost::bind(&Server::handle_accept_bluetooth,
                                             this,
@@ -356,9 +372,9 @@ void Server::handle_accept_bluetooth(BluetoothConnectionAcceptor_ptr acceptor,
                                             new_connection,
                                             boost::asio::placeholders::error)
                               );
-        BOOST_LOG_SEV(logger(), debug) << "Continue to waiting client connection";
+        AIMP_LOG_SEV(logger(), debug) << "Continue to waiting client connection";
     } else {
-        BOOST_LOG_SEV(logger(), error) << "Error Server::handle_accept():" << e;
+        AIMP_LOG_SEV(logger(), error) << "Error Server::handle_accept():" << e;
     }
 }
 
@@ -389,8 +405,8 @@ void Server::register_bluetooth_service(BluetoothConnectionAcceptor_ptr acceptor
     if ( 0 != WSASetService(&service, RNRSERVICE_REGISTER, 0) ) {
         throw std::runtime_error( MakeString() << "Service registration failed. Last error code: %d" << GetLastError() ); // GetLastErrorMessage
     } else {
-        BOOST_LOG_SEV(logger(), debug) << "Bluetooth service registration successful";
-        BOOST_LOG_SEV(logger(), info) << "Bluetooth service UUID: " << service.lpServiceClassId;
+        AIMP_LOG_SEV(logger(), debug) << "Bluetooth service registration successful";
+        AIMP_LOG_SEV(logger(), info) << "Bluetooth service UUID: " << service.lpServiceClassId;
     }
 }
 
@@ -37,7 +37,9 @@ public:
     /*
         Construct the server to listen on the specified TCP address and port.
     */
-    Server(boost::asio::io_service& io_service, RequestHandler& request_handler); // throws std::runtime_error.
+    Server(boost::asio::io_service& io_service,
+           RequestHandler& request_handler,
+           ControlPlugin::PlayerThreadDispatcher& player_thread_dispatcher); // throws std::runtime_error.
 
     ~Server();
 
@@ -66,6 +68,12 @@ private:
 
     // The handler for all incoming requests.
     RequestHandler& request_handler_;
+
+    // Executes request handler in player thread.
+    ControlPlugin::PlayerThreadDispatcher& player_thread_dispatcher_;
+
+    // Settings of persistent connections, passed to each accepted connection.
+    const KeepAliveSettings keep_alive_settings_;
 };
 
 } // namespace Http
@@ -0,0 +1,124 @@
+// Copyright (c) 2014, Alexey Ivanov
+
+#include "stdafx.h"
+#include "static_file_cache.h"
+#include "utils/util.h"
+#include <boost/filesystem.hpp>
+#include <cstdio>
+#include <fstream>
+
+namespace Http
+{
+
+namespace
+{
+const char kGZIP_EXTENSION[] = ".gz";
+}
+
+StaticFileCache::StaticFileCache(size_t memory_limit_bytes)
+    :
+    memory_limit_(memory_limit_bytes),
+    memory_usage_(0),
+    hits_(0),
+    misses_(0)
+{
+}
+
+StaticFileCache::FileStatus StaticFileCache::getFileStatus(const std::string& path)
+{
+    namespace fs = boost::filesystem;
+
+    FileStatus status = { false, 0, 0 };
+    boost::system::error_code ec;
+    if ( fs::is_regular_file(path, ec) ) {
+        status.size = fs::file_size(path, ec);
+        if (!ec) {
+            status.last_write_time = fs::last_write_time(path, ec);
+            status.exists = !ec;
+        }
+    }
+    return status;
+}
+
+StaticFileCache::Content StaticFileCache::loadContent(const std::string& path, boost::uintmax_t size)
+{
+    std::ifstream is(path.c_str(), std::ios::in | std::ios::binary);
+    if (!is) {
+        return Content();
+    }
+
+    std::shared_ptr<std::string> content = std::make_shared<std::string>();
+    content->resize( static_cast<size_t>(size) ); // cast is safe here since size is limited by kMAX_FILE_SIZE.
+    if ( !content->empty() ) {
+        is.read( &(*content)[0], content->size() );
+        content->resize( static_cast<size_t>( is.gcount() ) ); // file could be truncated since status was taken.
+    }
+    return content;
+}
+
+std::string StaticFileCache::makeETag(const std::string& content, const char* suffix)
+{
+    char etag[64];
+    sprintf_s(etag, sizeof(etag), "\"%08lx-%x%s\"", Utilities::crc32(content), static_cast<unsigned int>( content.size() ), suffix);
+    return etag;
+}
+
+size_t StaticFileCache::memoryUsage(const File& file)
+{
+    return sizeof(Item) + sizeof(File)
+           + file.content->size()
+           + (file.gzip_content ? file.gzip_content->size() : 0);
+}
+
+StaticFileCache::File_ptr StaticFileCache::getFile(const std::string& path)
+{
+    const FileStatus status = getFileStatus(path);
+    const std::string gzip_path = path + kGZIP_EXTENSION;
+    const FileStatus gzip_status = getFileStatus(gzip_path);
+
+    auto it = items_.find(path);
+    if (it != items_.end()) {
+        if (it->second.status == status && it->second.gzip_status == gzip_status) {
+            ++hits_;
+            return it->second.file;
+        }
+        // file was changed on disk, reload it.
+        memory_usage_ -= memoryUsage(*it->second.file);
+        items_.erase(it);
+    }
+    ++misses_;
+
+    if (!status.exists || status.size > kMAX_FILE_SIZE) {
+        return File_ptr();
+    }
+
+    std::shared_ptr<File> file = std::make_shared<File>();
+    file->content = loadContent(path, status.size);
+    if (!file->content) {
+        return File_ptr();
+    }
+    file->etag = makeETag(*file->content, "");
+
+    // copy which is older than file is stale(file was edited after build), client must get actual content.
+    if (   gzip_status.exists && gzip_status.size <= kMAX_FILE_SIZE
+        && gzip_status.last_write_time >= status.last_write_time
+        )
+    {
+        file->gzip_content = loadContent(gzip_path, gzip_status.size);
+        if (file->gzip_content) {
+            file->gzip_etag = makeETag(*file->gzip_content, "-gz");
+        }
+    }
+
+    const size_t file_memory_usage = memoryUsage(*file);
+    if (memory_usage_ + file_memory_usage <= memory_limit_) {
+        Item& item = items_[path];
+        item.file = file;
+        item.status = status;
+        item.gzip_status = gzip_status;
+        memory_usage_ += file_memory_usage;
+    }
+    return file;
+}
+
+} // namespace Http
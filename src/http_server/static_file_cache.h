@@ -0,0 +1,91 @@
+// Copyright (c) 2014, Alexey Ivanov
+
+#pragma once
+
+#include <boost/cstdint.hpp>
+#include <boost/noncopyable.hpp>
+#include <ctime>
+#include <map>
+#include <memory>
+#include <string>
+
+namespace Http
+{
+
+/*!
+    \brief Cache of static files of web interface.
+           File is read from disk on first request only, then its content is shared by all replies without copying.
+           Cached file is reloaded if its modification time or size was changed on disk.
+           Precompressed copy of file(<file>.gz, it is generated at build time) is cached along with file
+           if it is not older than file.
+           Cache is used only from player thread, so it is not synchronized.
+*/
+class StaticFileCache : boost::noncopyable
+{
+public:
+    typedef std::shared_ptr<const std::string> Content;
+
+    struct File
+    {
+        Content content;
+        std::string etag; //!< strong entity tag of content, it is quoted.
+        Content gzip_content; //!< null if there is no precompressed copy.
+        std::string gzip_etag; //!< strong entity tag of gzip_content, it is quoted.
+    };
+    typedef std::shared_ptr<const File> File_ptr;
+
+    //! Files larger than this size are not cached, they should be sent by TransmitFile.
+    static const boost::uintmax_t kMAX_FILE_SIZE = 1024 * 1024;
+
+    explicit StaticFileCache(size_t memory_limit_bytes);
+
+    /*!
+        \brief Returns file with up to date content.
+        \return null if file does not exist, can not be read or is larger than kMAX_FILE_SIZE.
+        \remark Files which do not fit in memory limit are returned but not cached.
+    */
+    File_ptr getFile(const std::string& path);
+
+    //! Counters of cache usage, they are reported by GetServerStatus RPC method.
+    size_t hits() const
+        { return hits_; }
+    size_t misses() const
+        { return misses_; }
+    size_t memoryUsage() const
+        { return memory_usage_; }
+
+private:
+
+    struct FileStatus
+    {
+        bool exists;
+        std::time_t last_write_time;
+        boost::uintmax_t size;
+
+        bool operator==(const FileStatus& rhs) const
+            { return exists == rhs.exists && last_write_time == rhs.last_write_time && size == rhs.size; }
+    };
+
+    struct Item
+    {
+        File_ptr file;
+        FileStatus status,
+                   gzip_status;
+    };
+    typedef std::map<std::string, Item> Items;
+
+    static FileStatus getFileStatus(const std::string& path);
+    static Content loadContent(const std::string& path, boost::uintmax_t size);
+    static std::string makeETag(const std::string& content, const char* suffix);
+    static size_t memoryUsage(const File& file);
+
+    Items items_;
+
+    const size_t memory_limit_;
+    size_t memory_usage_;
+
+    size_t hits_,
+           misses_;
+};
+
+} // namespace Http
@@ -0,0 +1,336 @@
+// Copyright (c) 2014, Alexey Ivanov
+
+#include "stdafx.h"
+#include "http_server/websocket.h"
+#include "http_server/reply.h"
+#include "http_server/request.h"
+#include "http_server/request_parser.h"
+#include "utils/base64.h"
+#include "utils/deflate_decoder.h"
+#include "utils/gzip_encoder.h"
+#include <boost/algorithm/string.hpp>
+#include <boost/uuid/sha1.hpp>
+#include <algorithm>
+#include <iterator>
+#include <vector>
+
+namespace Http
+{
+namespace WebSocket
+{
+
+namespace
+{
+
+const char kACCEPT_KEY_GUID[] = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"; // RFC 6455, 1.3.
+const char kPERMESSAGE_DEFLATE[] = "permessage-deflate";
+const size_t kMAX_CONTROL_PAYLOAD_SIZE = 125;
+
+//! Returns true if comma separated list like "keep-alive, Upgrade" contains token.
+bool containsToken(const std::string& list, const char* token)
+{
+    std::vector<std::string> tokens;
+    boost::split( tokens, list, boost::is_any_of(",") );
+    for (auto it = tokens.begin(), end = tokens.end(); it != end; ++it) {
+        if ( boost::iequals(boost::trim_copy(*it), token) ) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*!
+    \brief Returns true if client offers per-message deflate with parameters we support.
+           Offer which limits window of server(server_max_window_bits) is declined since encoder always uses 32Kb window.
+*/
+bool deflateOffered(const std::string& extensions)
+{
+    std::vector<std::string> offers;
+    boost::split( offers, extensions, boost::is_any_of(",") );
+    for (auto it = offers.begin(), end = offers.end(); it != end; ++it) {
+        std::vector<std::string> params;
+        boost::split( params, *it, boost::is_any_of(";") );
+        if ( !boost::iequals(boost::trim_copy(params[0]), kPERMESSAGE_DEFLATE) ) {
+            continue;
+        }
+        const bool limits_server_window = params.end() != std::find_if(params.begin() + 1, params.end(),
+                                                                       [](const std::string& param) { return boost::istarts_with(boost::trim_copy(param), "server_max_window_bits"); }
+                                                                       );
+        if (!limits_server_window) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void pushHeader(const char* name, const std::string& value, Reply& rep)
+{
+    rep.headers.push_back(header());
+    rep.headers.back().name = name;
+    rep.headers.back().value = value;
+}
+
+bool isControl(Opcode opcode)
+{
+    return (opcode & 0x8) != 0;
+}
+
+} // namespace
+
+bool isUpgradeRequest(const Request& req)
+{
+    const std::string* upgrade;
+    const std::string* connection;
+    return req.method == "GET"
+           && get_header_value(req.headers, "Upgrade", upgrade) && boost::iequals(*upgrade, "websocket")
+           && get_header_value(req, HEADER_CONNECTION, connection) && containsToken(*connection, "upgrade");
+}
+
+bool fillHandshakeReply(const Request& req, bool offer_deflate, Reply& rep, bool* deflate_negotiated)
+{
+    const std::string* version;
+    const std::string* key;
+    if (   !get_header_value(req.headers, "Sec-WebSocket-Version", version) || *version != "13"
+        || !get_header_value(req.headers, "Sec-WebSocket-Key", key) || key->empty()
+        )
+    {
+        return false;
+    }
+
+    const std::string* extensions;
+    *deflate_negotiated = offer_deflate
+                          && get_header_value(req.headers, "Sec-WebSocket-Extensions", extensions)
+                          && deflateOffered(*extensions);
+
+    // reply can already contain headers like Set-Cookie, keep them.
+    rep.status = Reply::switching_protocols;
+    rep.content.clear();
+    pushHeader("Upgrade", "websocket", rep);
+    pushHeader("Connection", "Upgrade", rep);
+    pushHeader("Sec-WebSocket-Accept", acceptKey(*key), rep);
+    if (*deflate_negotiated) {
+        // client does not keep context as well, so we do not need to keep 32Kb window per connection for decompression.
+        pushHeader("Sec-WebSocket-Extensions", std::string(kPERMESSAGE_DEFLATE) + "; server_no_context_takeover; client_no_context_takeover", rep);
+    }
+    return true;
+}
+
+std::string acceptKey(const std::string& key)
+{
+    boost::uuids::detail::sha1 sha1;
+    sha1.process_bytes( key.data(), key.size() );
+    sha1.process_bytes(kACCEPT_KEY_GUID, sizeof(kACCEPT_KEY_GUID) - 1);
+    unsigned int digest[5];
+    sha1.get_digest(digest);
+
+    unsigned char digest_bytes[20];
+    for (size_t i = 0; i != 5; ++i) {
+        digest_bytes[i * 4 + 0] = static_cast<unsigned char>(digest[i] >> 24);
+        digest_bytes[i * 4 + 1] = static_cast<unsigned char>(digest[i] >> 16);
+        digest_bytes[i * 4 + 2] = static_cast<unsigned char>(digest[i] >> 8);
+        digest_bytes[i * 4 + 3] = static_cast<unsigned char>(digest[i]);
+    }
+
+    using namespace Base64Utils;
+    std::string accept_key;
+    int iostatus = 0;
+    base64<char> encoder;
+    encoder.put(digest_bytes, digest_bytes + sizeof(digest_bytes), std::back_inserter(accept_key), iostatus, base64<>::noline());
+    return accept_key;
+}
+
+std::shared_ptr<const std::string> makeFrame(Opcode opcode, const std::string& payload, int compression_level)
+{
+    std::string compressed;
+    bool is_compressed = false;
+    if ( compression_level != 0 && !isControl(opcode) ) {
+        Utilities::GzipEncoder encoder(compression_level, &compressed, Utilities::GzipEncoder::DEFLATE_MESSAGE);
+        encoder.write( payload.data(), payload.size() );
+        encoder.finish();
+        is_compressed = compressed.size() < payload.size();
+    }
+    const std::string& data = is_compressed ? compressed : payload;
+    const boost::uint64_t size = data.size();
+
+    std::shared_ptr<std::string> frame = std::make_shared<std::string>();
+    frame->reserve(data.size() + 10);
+    frame->push_back( static_cast<char>(0x80 | (is_compressed ? 0x40 : 0) | opcode) ); // FIN, RSV1 marks compressed message.
+    if (size < 126) {
+        frame->push_back( static_cast<char>(size) );
+    } else if (size <= 0xFFFF) {
+        frame->push_back( static_cast<char>(126) );
+        frame->push_back( static_cast<char>(size >> 8) );
+        frame->push_back( static_cast<char>(size) );
+    } else {
+        frame->push_back( static_cast<char>(127) );
+        for (int shift = 56; shift >= 0; shift -= 8) {
+            frame->push_back( static_cast<char>(size >> shift) );
+        }
+    }
+    frame->append(data);
+    return frame;
+}
+
+std::shared_ptr<const std::string> makeCloseFrame(CloseStatus status)
+{
+    const char payload[2] = { static_cast<char>(status >> 8), static_cast<char>(status) };
+    return makeFrame( OPCODE_CLOSE, std::string( payload, sizeof(payload) ), 0 );
+}
+
+FrameParser::FrameParser(bool deflate)
+    :
+    deflate_(deflate),
+    reading_header_(true),
+    fin_(false),
+    frame_opcode_(OPCODE_CONTINUATION),
+    frame_remaining_(0),
+    mask_index_(0),
+    in_message_(false),
+    message_opcode_(OPCODE_TEXT),
+    message_compressed_(false)
+{
+    message_.opcode = OPCODE_TEXT;
+}
+
+bool FrameParser::parse(const char*& begin, const char* end)
+{
+    while (begin != end) {
+        if (reading_header_) {
+            header_.push_back(*begin++);
+            if ( header_.size() < headerSize() ) {
+                continue;
+            }
+            startFrame();
+        } else {
+            // unmask payload portion.
+            const size_t portion_size = static_cast<size_t>( std::min<boost::uint64_t>(frame_remaining_, end - begin) );
+            std::string& data = isControl(frame_opcode_) ? control_data_ : message_data_;
+            const size_t old_size = data.size();
+            data.resize(old_size + portion_size);
+            for (size_t i = 0; i != portion_size; ++i, ++mask_index_) {
+                data[old_size + i] = static_cast<char>(begin[i] ^ mask_[mask_index_ & 3]);
+            }
+            begin += portion_size;
+            frame_remaining_ -= portion_size;
+        }
+
+        if ( !reading_header_ && frame_remaining_ == 0 && finishFrame() ) {
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t FrameParser::headerSize() const
+{
+    if (header_.size() < 2) {
+        return 2;
+    }
+    const unsigned char second_byte = static_cast<unsigned char>(header_[1]);
+    const unsigned char length = second_byte & 0x7F;
+    return 2 + (length == 126 ? 2 : length == 127 ? 8 : 0)
+             + ( (second_byte & 0x80) ? 4 : 0 );
+}
+
+void FrameParser::startFrame()
+{
+    const unsigned char first_byte = static_cast<unsigned char>(header_[0]),
+                        second_byte = static_cast<unsigned char>(header_[1]);
+    fin_ = (first_byte & 0x80) != 0;
+    const bool rsv1 = (first_byte & 0x40) != 0;
+    if ( (first_byte & 0x30) != 0 ) {
+        throw ProtocolError("Reserved bits of frame are set", CLOSE_PROTOCOL_ERROR);
+    }
+    if ( (second_byte & 0x80) == 0 ) {
+        throw ProtocolError("Client frame is not masked", CLOSE_PROTOCOL_ERROR);
+    }
+    frame_opcode_ = static_cast<Opcode>(first_byte & 0x0F);
+
+    size_t pos = 2;
+    boost::uint64_t length = second_byte & 0x7F;
+    if (length >= 126) {
+        const size_t length_size = length == 126 ? 2 : 8;
+        length = 0;
+        for (size_t i = 0; i != length_size; ++i) {
+            length = (length << 8) | static_cast<unsigned char>(header_[pos++]);
+        }
+    }
+    for (size_t i = 0; i != 4; ++i) {
+        mask_[i] = static_cast<unsigned char>(header_[pos++]);
+    }
+    mask_index_ = 0;
+
+    switch (frame_opcode_) {
+    case OPCODE_CLOSE:
+    case OPCODE_PING:
+    case OPCODE_PONG:
+        if (!fin_ || rsv1 || length > kMAX_CONTROL_PAYLOAD_SIZE) {
+            throw ProtocolError("Invalid control frame", CLOSE_PROTOCOL_ERROR);
+        }
+        control_data_.clear();
+        break;
+    case OPCODE_TEXT:
+    case OPCODE_BINARY:
+        if (in_message_) {
+            throw ProtocolError("New message starts before previous one is finished", CLOSE_PROTOCOL_ERROR);
+        }
+        if (rsv1 && !deflate_) {
+            throw ProtocolError("Compressed message was received but compression was not negotiated", CLOSE_PROTOCOL_ERROR);
+        }
+        in_message_ = true;
+        message_opcode_ = frame_opcode_;
+        message_compressed_ = rsv1;
+        message_data_.clear();
+        break;
+    case OPCODE_CONTINUATION:
+        if (!in_message_ || rsv1) {
+            throw ProtocolError("Unexpected continuation frame", CLOSE_PROTOCOL_ERROR);
+        }
+        break;
+    default:
+        throw ProtocolError("Unknown opcode of frame", CLOSE_PROTOCOL_ERROR);
+    }
+
+    if ( !isControl(frame_opcode_) && length > kMAX_MESSAGE_SIZE - message_data_.size() ) {
+        throw ProtocolError("Message is too big", CLOSE_MESSAGE_TOO_BIG);
+    }
+
+    header_.clear();
+    reading_header_ = false;
+    frame_remaining_ = length;
+}
+
+bool FrameParser::finishFrame()
+{
+    reading_header_ = true;
+
+    if ( isControl(frame_opcode_) ) {
+        message_.opcode = frame_opcode_;
+        message_.payload.swap(control_data_);
+        return true;
+    }
+
+    if (!fin_) {
+        return false;
+    }
+
+    in_message_ = false;
+    message_.opcode = message_opcode_;
+    message_.payload.clear();
+    if (message_compressed_) {
+        // sender removed tail of sync flush, restore it.
+        message_data_.append("\x00\x00\xff\xff", 4);
+        try {
+            Utilities::decodeDeflate(message_data_.data(), message_data_.size(), kMAX_MESSAGE_SIZE, &message_.payload);
+        } catch (std::runtime_error& e) {
+            throw ProtocolError(std::string("Failed to decompress message: ") + e.what(), CLOSE_PROTOCOL_ERROR);
+        }
+        message_data_.clear();
+    } else {
+        message_.payload.swap(message_data_);
+    }
+    return true;
+}
+
+} // namespace WebSocket
+} // namespace Http
@@ -0,0 +1,146 @@
+// Copyright (c) 2014, Alexey Ivanov
+
+#pragma once
+
+#include <boost/cstdint.hpp>
+#include <boost/noncopyable.hpp>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+namespace Http
+{
+
+struct Reply;
+struct Request;
+
+//! WebSocket protocol(RFC 6455) with per-message deflate extension(RFC 7692).
+namespace WebSocket
+{
+
+enum Opcode { OPCODE_CONTINUATION = 0x0,
+              OPCODE_TEXT = 0x1,
+              OPCODE_BINARY = 0x2,
+              OPCODE_CLOSE = 0x8,
+              OPCODE_PING = 0x9,
+              OPCODE_PONG = 0xA
+};
+
+//! Status codes of close frame.
+enum CloseStatus { CLOSE_NORMAL = 1000,
+                   CLOSE_PROTOCOL_ERROR = 1002,
+                   CLOSE_UNSUPPORTED_DATA = 1003,
+                   CLOSE_MESSAGE_TOO_BIG = 1009
+};
+
+//! Max size of message received from client, it is checked after decompression as well.
+const size_t kMAX_MESSAGE_SIZE = 1024 * 1024;
+
+struct Settings
+{
+    bool deflate; //!< per-message deflate was negotiated in handshake.
+    int compression_level; //!< [1, 9], level of compression of messages sent to client.
+    size_t compression_min_size; //!< smaller messages are sent uncompressed.
+};
+
+//! Violation of protocol by client. Connection is closed with status.
+class ProtocolError : public std::runtime_error
+{
+public:
+    ProtocolError(const std::string& message, CloseStatus status)
+        :
+        std::runtime_error(message),
+        status_(status)
+    {}
+
+    CloseStatus status() const
+        { return status_; }
+
+private:
+
+    CloseStatus status_;
+};
+
+//! Returns true if client asks to switch connection to WebSocket protocol.
+bool isUpgradeRequest(const Request& req);
+
+/*!
+    \brief Fills 101 reply which completes opening handshake.
+    \param offer_deflate - accept per-message deflate if client offers it.
+                           Both sides do not keep compression context between messages, so connection does not keep deflate window.
+    \param deflate_negotiated - receives true if per-message deflate is accepted.
+    \return false if request is not valid handshake.
+*/
+bool fillHandshakeReply(const Request& req, bool offer_deflate, Reply& rep, bool* deflate_negotiated);
+
+//! Returns value of Sec-WebSocket-Accept header for Sec-WebSocket-Key value.
+std::string acceptKey(const std::string& key);
+
+/*!
+    \brief Returns unmasked server frame which contains whole message.
+    \param compression_level - zero disables compression. Compressed payload is used only if it is smaller than original one.
+*/
+std::shared_ptr<const std::string> makeFrame(Opcode opcode, const std::string& payload, int compression_level);
+
+std::shared_ptr<const std::string> makeCloseFrame(CloseStatus status);
+
+/*!
+    \brief Incremental parser of frames sent by client.
+           Fragmented messages are assembled, compressed messages are decompressed.
+           Control frames which arrive between fragments of message are returned as separate messages.
+*/
+class FrameParser : boost::noncopyable
+{
+public:
+
+    struct Message
+    {
+        Opcode opcode; //!< OPCODE_TEXT, OPCODE_BINARY or control frame opcode.
+        std::string payload;
+    };
+
+    //! \param deflate - per-message deflate was negotiated.
+    explicit FrameParser(bool deflate);
+
+    /*!
+        \brief Parses data in range [begin, end), data can be split at any point.
+        \param begin - moved to first byte which was not parsed.
+        \return true if message is complete, it is available by message() till next parse() call.
+    */
+    bool parse(const char*& begin, const char* end); // throws ProtocolError
+
+    const Message& message() const
+        { return message_; }
+
+private:
+
+    size_t headerSize() const;
+    void startFrame(); // throws ProtocolError
+    bool finishFrame(); // throws ProtocolError
+
+    const bool deflate_;
+
+    bool reading_header_;
+    std::string header_;
+
+    // current frame.
+    bool fin_;
+    Opcode frame_opcode_;
+    boost::uint64_t frame_remaining_;
+    unsigned char mask_[4];
+    size_t mask_index_;
+
+    // current data message which can consist of several frames.
+    bool in_message_;
+    Opcode message_opcode_;
+    bool message_compressed_;
+    std::string message_data_;
+
+    std::string control_data_;
+
+    Message message_;
+};
+
+} // namespace WebSocket
+
+} // namespace Http
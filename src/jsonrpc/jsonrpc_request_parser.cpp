@@ -2,16 +2,456 @@
 
 #include "stdafx.h"
 #include "jsonrpc/request_parser.h"
-#include "jsonrpc/value.h"
 #include "rpc/value.h"
 #include "rpc/exception.h"
-#include "jsonrpc/reader.h"
+#include <cassert>
+#include <climits>
+#include <cstdlib>
 
 namespace JsonRpc
 {
 
+namespace
+{
+
+const size_t kMAX_REQUEST_SIZE = 1024 * 1024; // RPC requests are small, reject oversized payload before parsing.
+const size_t kMAX_NESTING_DEPTH = 64; // protects parser's stack from deeply nested arrays/objects.
+
+/*!
+    \brief Single pass JSON reader which builds Rpc::Value directly, without intermediate Json::Value tree.
+           Numbers are decoded like Json::Reader does: integers which fit in int become TYPE_INT,
+           bigger positive integers become TYPE_UINT, others become TYPE_DOUBLE.
+           Strings must be valid UTF-8.
+*/
+class Reader
+{
+public:
+
+    bool parse(const std::string& document, Rpc::Value* root)
+    {
+        assert(root);
+
+        current_ = document.c_str();
+        end_ = current_ + document.size();
+        depth_ = 0;
+
+        if ( !readValue(root) ) {
+            return false;
+        }
+        skipSpaces();
+        return current_ == end_;
+    }
+
+private:
+
+    void skipSpaces()
+    {
+        while (current_ != end_) {
+            const char c = *current_;
+            if (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+                ++current_;
+            } else {
+                break;
+            }
+        }
+    }
+
+    bool match(const char* pattern, size_t pattern_length)
+    {
+        if ( static_cast<size_t>(end_ - current_) < pattern_length ) {
+            return false;
+        }
+        for (size_t i = 0; i != pattern_length; ++i) {
+            if (current_[i] != pattern[i]) {
+                return false;
+            }
+        }
+        current_ += pattern_length;
+        return true;
+    }
+
+    bool readValue(Rpc::Value* value)
+    {
+        skipSpaces();
+        if (current_ == end_) {
+            return false;
+        }
+
+        switch (*current_) {
+        case '{':
+            return readObject(value);
+        case '[':
+            return readArray(value);
+        case '"':
+            value->reset(); // value can be filled already if object has duplicate member names.
+            return readString( &static_cast<std::string&>(*value) );
+        case 't':
+            if ( match("true", 4) ) {
+                *value = true;
+                return true;
+            }
+            return false;
+        case 'f':
+            if ( match("false", 5) ) {
+                *value = false;
+                return true;
+            }
+            return false;
+        case 'n':
+            if ( match("null", 4) ) {
+                *value = Rpc::Value::Null();
+                return true;
+            }
+            return false;
+        default:
+            return readNumber(value);
+        }
+    }
+
+    bool readObject(Rpc::Value* value)
+    {
+        if (++depth_ > kMAX_NESTING_DEPTH) {
+            return false;
+        }
+
+        ++current_; // skip '{'
+        *value = Rpc::Value::Object();
+
+        skipSpaces();
+        if (current_ != end_ && *current_ == '}') {
+            ++current_;
+            --depth_;
+            return true;
+        }
+
+        std::string name;
+        for (;;) {
+            skipSpaces();
+            if (current_ == end_ || *current_ != '"') {
+                return false;
+            }
+            name.clear();
+            if ( !readString(&name) ) {
+                return false;
+            }
+
+            skipSpaces();
+            if (current_ == end_ || *current_ != ':') {
+                return false;
+            }
+            ++current_;
+
+            if ( !readValue( &(*value)[name] ) ) {
+                return false;
+            }
+
+            skipSpaces();
+            if (current_ == end_) {
+                return false;
+            }
+            const char c = *current_++;
+            if (c == '}') {
+                break;
+            } else if (c != ',') {
+                return false;
+            }
+        }
+
+        --depth_;
+        return true;
+    }
+
+    bool readArray(Rpc::Value* value)
+    {
+        if (++depth_ > kMAX_NESTING_DEPTH) {
+            return false;
+        }
+
+        ++current_; // skip '['
+        value->reset();
+        value->setSize(0);
+
+        skipSpaces();
+        if (current_ != end_ && *current_ == ']') {
+            ++current_;
+            --depth_;
+            return true;
+        }
+
+        for (;;) {
+            const size_t index = value->size();
+            value->setSize(index + 1);
+            if ( !readValue( &(*value)[index] ) ) {
+                return false;
+            }
+
+            skipSpaces();
+            if (current_ == end_) {
+                return false;
+            }
+            const char c = *current_++;
+            if (c == ']') {
+                break;
+            } else if (c != ',') {
+                return false;
+            }
+        }
+
+        --depth_;
+        return true;
+    }
+
+    bool readDigits()
+    {
+        const char* const start = current_;
+        while (current_ != end_ && *current_ >= '0' && *current_ <= '9') {
+            ++current_;
+        }
+        return current_ != start;
+    }
+
+    //! Number must follow JSON grammar: -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?
+    bool readNumber(Rpc::Value* value)
+    {
+        const char* const start = current_;
+        const bool negative = current_ != end_ && *current_ == '-';
+        if (negative) {
+            ++current_;
+        }
+
+        const char* const int_start = current_;
+        if ( !readDigits() ) {
+            return false;
+        }
+        if (*int_start == '0' && current_ - int_start > 1) {
+            return false; // leading zeros are not allowed.
+        }
+        const char* const int_end = current_;
+
+        bool is_double = false;
+        if (current_ != end_ && *current_ == '.') {
+            ++current_;
+            if ( !readDigits() ) {
+                return false;
+            }
+            is_double = true;
+        }
+        if ( current_ != end_ && (*current_ == 'e' || *current_ == 'E') ) {
+            ++current_;
+            if ( current_ != end_ && (*current_ == '+' || *current_ == '-') ) {
+                ++current_;
+            }
+            if ( !readDigits() ) {
+                return false;
+            }
+            is_double = true;
+        }
+
+        if (!is_double) {
+            const unsigned int limit = negative ? 0x80000000U : 0xFFFFFFFFU;
+            unsigned int number = 0;
+            for (const char* c = int_start; c != int_end; ++c) {
+                const unsigned int digit = static_cast<unsigned int>(*c - '0');
+                if ( number > (limit - digit) / 10 ) {
+                    is_double = true; // integer overflow.
+                    break;
+                }
+                number = number * 10 + digit;
+            }
+
+            if (!is_double) {
+                if (negative) {
+                    *value = number == 0x80000000U ? INT_MIN : -static_cast<int>(number);
+                } else if (number <= INT_MAX) {
+                    *value = static_cast<int>(number);
+                } else {
+                    *value = number;
+                }
+                return true;
+            }
+        }
+
+        const std::string number_string(start, current_); // document is not null-terminated after number.
+        char* number_end = nullptr;
+        const double number = strtod(number_string.c_str(), &number_end);
+        if ( number_end != number_string.c_str() + number_string.size() ) {
+            return false;
+        }
+        *value = number;
+        return true;
+    }
+
+    static void appendUTF8(unsigned int code_point, std::string* out)
+    {
+        if (code_point <= 0x7F) {
+            *out += static_cast<char>(code_point);
+        } else if (code_point <= 0x7FF) {
+            *out += static_cast<char>( 0xC0 | (code_point >> 6) );
+            *out += static_cast<char>( 0x80 | (code_point & 0x3F) );
+        } else if (code_point <= 0xFFFF) {
+            *out += static_cast<char>( 0xE0 | (code_point >> 12) );
+            *out += static_cast<char>( 0x80 | ((code_point >> 6) & 0x3F) );
+            *out += static_cast<char>( 0x80 | (code_point & 0x3F) );
+        } else {
+            *out += static_cast<char>( 0xF0 | (code_point >> 18) );
+            *out += static_cast<char>( 0x80 | ((code_point >> 12) & 0x3F) );
+            *out += static_cast<char>( 0x80 | ((code_point >> 6) & 0x3F) );
+            *out += static_cast<char>( 0x80 | (code_point & 0x3F) );
+        }
+    }
+
+    bool readHex4(unsigned int* code_unit)
+    {
+        if (end_ - current_ < 4) {
+            return false;
+        }
+        unsigned int result = 0;
+        for (int i = 0; i != 4; ++i) {
+            const char c = *current_++;
+            result <<= 4;
+            if (c >= '0' && c <= '9') {
+                result += c - '0';
+            } else if (c >= 'a' && c <= 'f') {
+                result += c - 'a' + 10;
+            } else if (c >= 'A' && c <= 'F') {
+                result += c - 'A' + 10;
+            } else {
+                return false;
+            }
+        }
+        *code_unit = result;
+        return true;
+    }
+
+    bool readEscapedCodePoint(std::string* out)
+    {
+        unsigned int code_point;
+        if ( !readHex4(&code_point) ) {
+            return false;
+        }
+
+        if (code_point >= 0xD800 && code_point <= 0xDBFF) { // surrogate pair.
+            unsigned int low_surrogate;
+            if (   !match("\\u", 2)
+                || !readHex4(&low_surrogate)
+                || low_surrogate < 0xDC00 || low_surrogate > 0xDFFF
+                )
+            {
+                return false;
+            }
+            code_point = 0x10000 + ( (code_point & 0x3FF) << 10 ) + (low_surrogate & 0x3FF);
+        } else if (code_point >= 0xDC00 && code_point <= 0xDFFF) { // unpaired low surrogate.
+            return false;
+        }
+
+        appendUTF8(code_point, out);
+        return true;
+    }
+
+    //! Validates UTF-8 sequence which starts with lead byte and copies it to out.
+    bool readUTF8Sequence(unsigned char lead, std::string* out)
+    {
+        size_t trail_count;
+        unsigned int code_point;
+        if (lead >= 0xC2 && lead <= 0xDF) {
+            trail_count = 1;
+            code_point = lead & 0x1F;
+        } else if (lead >= 0xE0 && lead <= 0xEF) {
+            trail_count = 2;
+            code_point = lead & 0x0F;
+        } else if (lead >= 0xF0 && lead <= 0xF4) {
+            trail_count = 3;
+            code_point = lead & 0x07;
+        } else {
+            return false; // continuation byte, overlong 2 byte sequence or out of Unicode range.
+        }
+
+        if ( static_cast<size_t>(end_ - current_) < trail_count ) {
+            return false;
+        }
+
+        const char* const sequence_start = current_ - 1;
+        for (size_t i = 0; i != trail_count; ++i) {
+            const unsigned char c = static_cast<unsigned char>(*current_++);
+            if ( (c & 0xC0) != 0x80 ) {
+                return false;
+            }
+            code_point = (code_point << 6) | (c & 0x3F);
+        }
+
+        if (   (trail_count == 2 && code_point < 0x800)   // overlong
+            || (trail_count == 3 && code_point < 0x10000) // overlong
+            || code_point > 0x10FFFF
+            || (code_point >= 0xD800 && code_point <= 0xDFFF) // surrogates are not allowed in UTF-8.
+            )
+        {
+            return false;
+        }
+
+        out->append(sequence_start, current_);
+        return true;
+    }
+
+    bool readString(std::string* out)
+    {
+        ++current_; // skip '"'
+        for (;;) {
+            // copy run of plain characters at once.
+            const char* run_start = current_;
+            while (current_ != end_) {
+                const unsigned char c = static_cast<unsigned char>(*current_);
+                if (c == '"' || c == '\\' || c < 0x20 || c >= 0x80) {
+                    break;
+                }
+                ++current_;
+            }
+            out->append(run_start, current_);
+
+            if (current_ == end_) {
+                return false;
+            }
+
+            const unsigned char c = static_cast<unsigned char>(*current_++);
+            if (c == '"') {
+                return true;
+            } else if (c == '\\') {
+                if (current_ == end_) {
+                    return false;
+                }
+                switch (*current_++) {
+                case '"':  *out += '"';  break;
+                case '/':  *out += '/';  break;
+                case '\\': *out += '\\'; break;
+                case 'b':  *out += '\b'; break;
+                case 'f':  *out += '\f'; break;
+                case 'n':  *out += '\n'; break;
+                case 'r':  *out += '\r'; break;
+                case 't':  *out += '\t'; break;
+                case 'u':
+                    if ( !readEscapedCodePoint(out) ) {
+                        return false;
+                    }
+                    break;
+                default:
+                    return false;
+                }
+            } else if (c < 0x20) {
+                return false; // control characters must be escaped.
+            } else if ( !readUTF8Sequence(c, out) ) {
+                return false;
+            }
+        }
+    }
+
+    const char* current_;
+    const char* end_;
+    size_t depth_;
+};
+
+} // namespace anonymous
+
 struct RequestParserImpl {
-    Json::Reader reader;
+    Reader reader;
 };
 
 RequestParser::RequestParser()
@@ -24,66 +464,22 @@ RequestParser::~RequestParser()
     delete impl_;
 }
 
-void convertJsonRpcValueToRpcValue(const Json::Value& json_rpc_value, Rpc::Value* rpc_value); // throws Rpc::Exception
-
 bool RequestParser::parse_(const std::string& /*request_uri*/,
                            const std::string& request_content,
                            Rpc::Value* root)
 {
-    Json::Value json_root;
-
-    if ( impl_->reader.parse(request_content, json_root) ) {
-        convertJsonRpcValueToRpcValue(json_root, root);
-        return true;
+    if (request_content.size() > kMAX_REQUEST_SIZE) {
+        return false;
     }
-    return false;
-}
-
-void convertJsonRpcValueToRpcValue(const Json::Value& json_rpc_value, Rpc::Value* rpc_value) // throws Rpc::Exception
-{
-    assert(rpc_value);
-
-    switch ( json_rpc_value.type() ) {
-    case Json::nullValue:
-        Rpc::Value( Rpc::Value::Null() ).swap(*rpc_value);
-        break;
-    case Json::booleanValue:
-        *rpc_value = json_rpc_value.asBool();
-        break;
-    case Json::uintValue:
-        *rpc_value = json_rpc_value.asUInt();
-        break;
-    case Json::intValue:
-        *rpc_value = json_rpc_value.asInt();
-        break;
-    case Json::realValue:
-        *rpc_value = json_rpc_value.asDouble();
-        break;
-    case Json::stringValue:
-        *rpc_value = json_rpc_value.asString();
-        break;
-    case Json::arrayValue:
-        rpc_value->setSize( json_rpc_value.size() );
-        for (size_t i = 0, size = rpc_value->size(); i != size; ++i) {
-            convertJsonRpcValueToRpcValue(json_rpc_value[i], &((*rpc_value)[i]));
-        }
-        break;
-    case Json::objectValue:
-        {
-        Rpc::Value::Object object;
 
-        const Json::Value::Members& member_names = json_rpc_value.getMemberNames();
-        auto member_name_it = member_names.begin(),
-             end            = member_names.end();
-        for (; member_name_it != end; ++member_name_it) {
-            const std::string& member_name = *member_name_it;
-            convertJsonRpcValueToRpcValue(json_rpc_value[member_name], &object[member_name]);
-        }
-        *rpc_value = object;
+    try {
+        if ( !impl_->reader.parse(request_content, root) ) {
+            return false;
         }
-        break;
-    default:
-        throw Rpc::Exception("unknown type", Rpc::TYPE_ERROR);
+        // batch request(JSON-RPC 2.0) is array of calls, it must not be empty.
+        return root->type() != Rpc::Value::TYPE_ARRAY || root->size() != 0;
+    } catch (const Rpc::Exception&) { // Rpc::Value type errors can not occur since values are filled by reader itself, but do not let them out anyway.
+        return false;
     }
 }
 
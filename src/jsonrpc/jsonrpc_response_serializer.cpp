@@ -7,6 +7,7 @@
 #include "rpc/value.h"
 #include "rpc/exception.h"
 #include <cassert>
+#include <cstdio>
 
 namespace JsonRpc
 {
@@ -28,14 +29,164 @@ ResponseSerializer::~ResponseSerializer()
 }
 
 void convertRpcValueToJsonRpcValue(const Rpc::Value& rpc_value, Json::Value* json_rpc_value); // throws Rpc::Exception
+void writeRpcValue(const Rpc::Value& rpc_value, std::string* out); // throws Rpc::Exception
+
+namespace
+{
+
+bool isControlCharacter(char ch)
+{
+    return ch >= 0 && ch <= 0x1F;
+}
+
+//! Appends string in json format. Escaping is the same as Json::valueToQuotedString() does.
+void writeQuotedString(const std::string& value, std::string* out)
+{
+    *out += '"';
+    for (auto it = value.begin(), end = value.end(); it != end; ++it) {
+        const char c = *it;
+        switch (c) {
+        case '"':
+            *out += "\\\"";
+            break;
+        case '\\':
+            *out += "\\\\";
+            break;
+        case '\b':
+            *out += "\\b";
+            break;
+        case '\f':
+            *out += "\\f";
+            break;
+        case '\n':
+            *out += "\\n";
+            break;
+        case '\r':
+            *out += "\\r";
+            break;
+        case '\t':
+            *out += "\\t";
+            break;
+        default:
+            if ( isControlCharacter(c) ) {
+                char buf[8];
+                sprintf_s(buf, "\\u%04X", static_cast<int>(c));
+                *out += buf;
+            } else {
+                *out += c;
+            }
+        }
+    }
+    *out += '"';
+}
+
+//! Writes result object like writeRpcValue() does, but array member is left open: head ends after '[', tail starts with ']'.
+void writeResultWithStreamedArray(const Rpc::Value& result, const std::string& array_member, std::string* head, std::string* tail) // throws Rpc::Exception
+{
+    assert( result.type() == Rpc::Value::TYPE_OBJECT && result.isMember(array_member) );
+
+    std::string* out = head;
+    *out += '{';
+    auto member_it = result.getObjectMembersBegin(),
+         end       = result.getObjectMembersEnd();
+    for (bool first = true; member_it != end; ++member_it, first = false) {
+        if (!first) {
+            *out += ',';
+        }
+        writeQuotedString(member_it->first, out);
+        *out += ':';
+        if (member_it->first == array_member) {
+            *out += '[';
+            out = tail;
+            *out += ']';
+        } else {
+            writeRpcValue(member_it->second, out);
+        }
+    }
+    *out += '}';
+}
+
+/*!
+    \brief Writes response directly from Rpc::Value without intermediate Json::Value tree.
+           Output is the same as Json::FastWriter produces: members in sorted order, new line at the end.
+           If streamed_array_member is not null, output is split at this array of result: see serializeStreamedSuccess().
+*/
+void writeSuccess(const Rpc::Value& root_response, const std::string* streamed_array_member, std::string* head, std::string* tail) // throws Rpc::Exception
+{
+    static const std::string kJSONRPC_MEMBER = "jsonrpc";
+    static const std::string kRESULT_MEMBER = "result";
+    static const char kJSONRPC_MEMBER_VALUE[] = "\"jsonrpc\":\"2.0\"";
+
+    std::string* out = head;
+    *out += '{';
+
+    bool jsonrpc_member_written = false;
+    bool first_member = true;
+    if (root_response.type() == Rpc::Value::TYPE_OBJECT) {
+        auto member_it = root_response.getObjectMembersBegin(),
+             end       = root_response.getObjectMembersEnd();
+        for (; member_it != end; ++member_it) {
+            if (!jsonrpc_member_written && kJSONRPC_MEMBER <= member_it->first) { // keep members sorted.
+                if (!first_member) {
+                    *out += ',';
+                }
+                *out += kJSONRPC_MEMBER_VALUE;
+                jsonrpc_member_written = true;
+                first_member = false;
+                if (kJSONRPC_MEMBER == member_it->first) {
+                    continue;
+                }
+            }
+
+            if (!first_member) {
+                *out += ',';
+            }
+            writeQuotedString(member_it->first, out);
+            *out += ':';
+            if (streamed_array_member && kRESULT_MEMBER == member_it->first) {
+                writeResultWithStreamedArray(member_it->second, *streamed_array_member, out, tail);
+                out = tail;
+            } else {
+                writeRpcValue(member_it->second, out);
+            }
+            first_member = false;
+        }
+    }
+
+    if (!jsonrpc_member_written) {
+        if (!first_member) {
+            *out += ',';
+        }
+        *out += kJSONRPC_MEMBER_VALUE;
+    }
+
+    *out += "}\n";
+}
+
+} // namespace anonymous
 
 void ResponseSerializer::serializeSuccess(const Rpc::Value& root_response, std::string* response) const
 {
-    Json::Value jsonrpc_response;
-    convertRpcValueToJsonRpcValue(root_response, &jsonrpc_response);
-    jsonrpc_response["jsonrpc"] = "2.0";
+    assert(response);
+    response->clear();
+    writeSuccess(root_response, nullptr, response, nullptr);
+}
 
-    *response = impl_->writer.write(jsonrpc_response);
+void ResponseSerializer::serializeStreamedSuccess(const Rpc::Value& root_response, const std::string& array_member, std::string* head, std::string* tail) const
+{
+    assert(head && tail);
+    head->clear();
+    tail->clear();
+    writeSuccess(root_response, &array_member, head, tail);
+}
+
+void ResponseSerializer::serializeStreamedArrayItem(const Rpc::Value& item, size_t index, std::string* out) const
+{
+    assert(out);
+    if (index != 0) {
+        *out += ',';
+    }
+    writeRpcValue(item, out);
 }
 
 void ResponseSerializer::serializeFault(const Rpc::Value& root_request, const std::string& error_msg, int error_code, std::string* response) const
@@ -57,6 +208,53 @@ void ResponseSerializer::serializeFault(const Rpc::Value& root_request, const st
     *response = impl_->writer.write(response_value);
 }
 
+void ResponseSerializer::serializeResult(const Rpc::Value& result, std::string* serialized_result) const
+{
+    assert(serialized_result);
+    serialized_result->clear();
+    writeRpcValue(result, serialized_result);
+}
+
+//! Output is the same as serializeSuccess() produces for response with id of request and the same result.
+void ResponseSerializer::serializeSuccessWithResult(const Rpc::Value& root_request, const std::string& serialized_result, std::string* response) const
+{
+    assert(response);
+
+    *response = "{\"id\":";
+    if ( root_request.isMember("id") ) {
+        writeRpcValue(root_request["id"], response);
+    } else {
+        *response += "null";
+    }
+    *response += ",\"jsonrpc\":\"2.0\",\"result\":";
+    *response += serialized_result;
+    *response += "}\n";
+}
+
+//! Writes array of responses(JSON-RPC 2.0 batch). New line which ends each response is moved to the end of array.
+void ResponseSerializer::serializeBatch(const std::vector<std::string>& responses, std::string* response) const
+{
+    assert(response);
+
+    size_t size = 3;
+    for (auto it = responses.begin(), end = responses.end(); it != end; ++it) {
+        size += it->size() + 1;
+    }
+    response->clear();
+    response->reserve(size);
+
+    *response += '[';
+    for (auto it = responses.begin(), end = responses.end(); it != end; ++it) {
+        if ( it != responses.begin() ) {
+            *response += ',';
+        }
+        const size_t length = !it->empty() && (*it)[it->size() - 1] == '\n' ? it->size() - 1
+                                                                             : it->size();
+        response->append(*it, 0, length);
+    }
+    *response += "]\n";
+}
+
 const std::string& ResponseSerializer::mimeType() const
 {
     return kMIME_TYPE;
@@ -79,7 +277,7 @@ void convertRpcValueToJsonRpcValue(const Rpc::Value& rpc_value, Json::Value* jso
         *json_rpc_value = int(rpc_value);
         break;
     case Rpc::Value::TYPE_UINT:
-        *json_rpc_value = unsigned int(rpc_value);
+        *json_rpc_value = static_cast<unsigned int>(rpc_value);
         break;
     case Rpc::Value::TYPE_DOUBLE:
         *json_rpc_value = double(rpc_value);
@@ -108,4 +306,68 @@ void convertRpcValueToJsonRpcValue(const Rpc::Value& rpc_value, Json::Value* jso
     }
 }
 
+void writeRpcValue(const Rpc::Value& rpc_value, std::string* out) // throws Rpc::Exception
+{
+    assert(out);
+
+    switch ( rpc_value.type() ) {
+    case Rpc::Value::TYPE_NONE:
+        // treat none rpc value as null json value. ///???
+    case Rpc::Value::TYPE_NULL:
+        *out += "null";
+        break;
+    case Rpc::Value::TYPE_BOOL:
+        *out += bool(rpc_value) ? "true" : "false";
+        break;
+    case Rpc::Value::TYPE_INT:
+        {
+        char buf[16];
+        sprintf_s(buf, "%d", int(rpc_value));
+        *out += buf;
+        }
+        break;
+    case Rpc::Value::TYPE_UINT:
+        {
+        char buf[16];
+        sprintf_s( buf, "%u", static_cast<unsigned int>(rpc_value) );
+        *out += buf;
+        }
+        break;
+    case Rpc::Value::TYPE_DOUBLE:
+        *out += Json::valueToString( double(rpc_value) ); // rare case, reuse JsonCpp formatting.
+        break;
+    case Rpc::Value::TYPE_STRING:
+        writeQuotedString(static_cast<const std::string&>(rpc_value), out);
+        break;
+    case Rpc::Value::TYPE_ARRAY:
+        *out += '[';
+        for (size_t i = 0, size = rpc_value.size(); i != size; ++i) {
+            if (i != 0) {
+                *out += ',';
+            }
+            writeRpcValue(rpc_value[i], out);
+        }
+        *out += ']';
+        break;
+    case Rpc::Value::TYPE_OBJECT:
+        {
+        *out += '{';
+        auto member_it = rpc_value.getObjectMembersBegin(),
+             end       = rpc_value.getObjectMembersEnd();
+        for (bool first = true; member_it != end; ++member_it, first = false) {
+            if (!first) {
+                *out += ',';
+            }
+            writeQuotedString(member_it->first, out);
+            *out += ':';
+            writeRpcValue(member_it->second, out);
+        }
+        *out += '}';
+        }
+        break;
+    default:
+        throw Rpc::Exception("unknown type", Rpc::TYPE_ERROR);
+    }
+}
+
 } // namespace JsonRpc
@@ -0,0 +1,181 @@
+// Copyright (c) 2014, Alexey Ivanov
+
+#include "stdafx.h"
+#include "plugin/async_log_backend.h"
+#include <cassert>
+#include <sstream>
+
+namespace ControlPlugin { namespace PluginLogger {
+
+namespace
+{
+
+const unsigned int kFLUSH_INTERVAL_MS = 100; //!< max time between message queuing and its writing if flusher missed wake up.
+
+size_t roundUpToPowerOfTwo(size_t value)
+{
+    size_t result = 2;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+} // namespace
+
+LogMessageQueue::LogMessageQueue(size_t capacity)
+    :
+    cells_( new Cell[roundUpToPowerOfTwo(capacity)] ),
+    mask_(roundUpToPowerOfTwo(capacity) - 1),
+    enqueue_position_(0),
+    dequeue_position_(0)
+{
+    for (size_t i = 0; i <= mask_; ++i) {
+        cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+bool LogMessageQueue::push(const std::string& message)
+{
+    Cell* cell;
+    size_t position = enqueue_position_.load(std::memory_order_relaxed);
+    for (;;) {
+        cell = &cells_[position & mask_];
+        const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+        const ptrdiff_t difference = static_cast<ptrdiff_t>(sequence) - static_cast<ptrdiff_t>(position);
+        if (difference == 0) {
+            if ( enqueue_position_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed) ) {
+                break;
+            }
+        } else if (difference < 0) {
+            return false; // consumer has not freed cell yet.
+        } else {
+            position = enqueue_position_.load(std::memory_order_relaxed); // other producer took the cell.
+        }
+    }
+
+    cell->message.assign(message);
+    cell->sequence.store(position + 1, std::memory_order_release);
+    return true;
+}
+
+bool LogMessageQueue::pop(std::string& message)
+{
+    Cell& cell = cells_[dequeue_position_ & mask_];
+    const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+    if (sequence != dequeue_position_ + 1) {
+        return false;
+    }
+
+    message.swap(cell.message);
+    cell.sequence.store(dequeue_position_ + mask_ + 1, std::memory_order_release);
+    ++dequeue_position_;
+    return true;
+}
+
+AsyncLogBackend::AsyncLogBackend(boost::shared_ptr<sinks::text_file_backend> file_backend, size_t queue_capacity)
+    :
+    file_backend_(file_backend),
+    queue_(queue_capacity),
+    dropped_count_(0),
+    reported_dropped_count_(0),
+    stopping_(false),
+    flusher_waiting_(false)
+{
+    flusher_ = boost::thread( boost::bind(&AsyncLogBackend::run, this) );
+}
+
+AsyncLogBackend::~AsyncLogBackend()
+{
+    stop();
+}
+
+void AsyncLogBackend::push(const std::string& message)
+{
+    if ( !queue_.push(message) ) {
+        ++dropped_count_;
+        return;
+    }
+
+    // flusher can miss notification if it is going to wait right now, it will wake up by timeout in this case.
+    if (flusher_waiting_) {
+        wakeup_.notify_one();
+    }
+}
+
+void AsyncLogBackend::stop()
+{
+    if ( !flusher_.joinable() ) {
+        return;
+    }
+
+    {
+    boost::mutex::scoped_lock lock(wakeup_mutex_);
+    stopping_ = true;
+    }
+    wakeup_.notify_one();
+    flusher_.join();
+}
+
+void AsyncLogBackend::run()
+{
+    for (;;) {
+        const bool stopping = stopping_; // messages queued before stop() are written in this iteration.
+
+        if ( writeQueuedMessages() ) {
+            continue;
+        }
+
+        if (stopping) {
+            break;
+        }
+
+        boost::mutex::scoped_lock lock(wakeup_mutex_);
+        if (!stopping_) {
+            flusher_waiting_ = true;
+            wakeup_.timed_wait( lock, boost::posix_time::milliseconds(kFLUSH_INTERVAL_MS) );
+            flusher_waiting_ = false;
+        }
+    }
+}
+
+bool AsyncLogBackend::writeQueuedMessages()
+{
+    std::string message;
+    bool written = false;
+    while ( queue_.pop(message) ) {
+        write(message);
+        written = true;
+    }
+
+    const unsigned long dropped_count = dropped_count_;
+    if (dropped_count != reported_dropped_count_) {
+        std::ostringstream notice;
+        notice << "Log queue overflow: " << dropped_count - reported_dropped_count_ << " messages were dropped.";
+        write( notice.str() );
+        reported_dropped_count_ = dropped_count;
+        written = true;
+    }
+
+    if (written) {
+        try {
+            file_backend_->flush(); // one flush per batch instead of flush after each message.
+        } catch (std::exception&) {
+            assert(!"Log file flush failed.");
+        }
+    }
+    return written;
+}
+
+void AsyncLogBackend::write(const std::string& message)
+{
+    try {
+        // text_file_backend uses only formatted message, record is needed for signature only.
+        file_backend_->consume(sinks::text_file_backend::record_type(), message);
+    } catch (std::exception&) {
+        // there is nobody to report file error to, just suppress in non debug build like BoostLogExceptionHandler does.
+        assert(!"Log file write failed.");
+    }
+}
+
+} } // namespace ControlPlugin::PluginLogger
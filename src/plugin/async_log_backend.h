@@ -0,0 +1,99 @@
+// Copyright (c) 2014, Alexey Ivanov
+
+#pragma once
+
+#pragma warning (push, 3)
+#include <boost/log/sinks/basic_sink_backend.hpp>
+#include <boost/log/sinks/text_file_backend.hpp>
+#pragma warning (pop)
+
+#include <boost/noncopyable.hpp>
+#include <boost/thread.hpp>
+#include <atomic>
+#include <memory>
+#include <string>
+
+namespace ControlPlugin { namespace PluginLogger {
+
+namespace sinks = boost::log::sinks;
+
+/*!
+    \brief Bounded multiple producers/single consumer queue of formatted log messages.
+           Lock-free: producers reserve cell by compare-and-swap of enqueue position, so logging threads never wait each other or consumer.
+           Messages are not removed from cells, consumer swaps them with its buffer, so memory of strings is reused after warm up.
+*/
+class LogMessageQueue : boost::noncopyable
+{
+public:
+    //! \param capacity - max count of messages in queue, rounded up to power of two.
+    explicit LogMessageQueue(size_t capacity);
+
+    //! Returns false if queue is full, message is not added in this case.
+    bool push(const std::string& message);
+
+    //! Moves the oldest message to message parameter. Returns false if queue is empty. Must be called from one thread only.
+    bool pop(std::string& message);
+
+private:
+
+    struct Cell {
+        std::atomic<size_t> sequence; //!< equals to position of cell if cell is free for producer, position + 1 if cell contains message for consumer.
+        std::string message;
+    };
+
+    std::unique_ptr<Cell[]> cells_;
+    const size_t mask_;
+    std::atomic<size_t> enqueue_position_;
+    size_t dequeue_position_;
+};
+
+/*!
+    \brief Sink backend which queues formatted messages, they are written to file by text_file_backend in separate flusher thread.
+           Logging thread only copies message to LogMessageQueue, file writes and flushes do not block it.
+           If queue is full message is dropped and counted, count of dropped messages is written to log by flusher.
+*/
+class AsyncLogBackend : public sinks::basic_formatted_sink_backend<char, sinks::concurrent_feeding>
+{
+public:
+    AsyncLogBackend(boost::shared_ptr<sinks::text_file_backend> file_backend, size_t queue_capacity);
+
+    //! Stops flusher thread, all queued messages are written to file before exit.
+    ~AsyncLogBackend();
+
+    //! Called by sink frontend, record attributes are already formatted in message.
+    template <typename RecordT>
+    void consume(const RecordT& /*record*/, const std::string& message)
+        { push(message); }
+
+    //! Waits until flusher writes all queued messages and stops it.
+    void stop();
+
+    //! Returns count of messages which were dropped since queue was full.
+    unsigned long droppedCount() const
+        { return dropped_count_; }
+
+private:
+
+    void push(const std::string& message);
+
+    //! Flusher thread function.
+    void run();
+
+    //! Writes all queued messages to file, returns false if queue was empty.
+    bool writeQueuedMessages();
+
+    void write(const std::string& message);
+
+    boost::shared_ptr<sinks::text_file_backend> file_backend_;
+    LogMessageQueue queue_;
+    std::atomic<unsigned long> dropped_count_;
+    unsigned long reported_dropped_count_; //!< used by flusher only.
+
+    std::atomic<bool> stopping_;
+    std::atomic<bool> flusher_waiting_;
+    boost::mutex wakeup_mutex_;
+    boost::condition_variable wakeup_;
+    boost::thread flusher_;
+};
+
+} } // namespace ControlPlugin::PluginLogger
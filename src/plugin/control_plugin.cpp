@@ -7,6 +7,7 @@
 #include "aimp/manager3.1.h"
 #include "logger.h"
 #include "settings.h"
+#include "player_thread_dispatcher.h"
 #include "rpc/methods.h"
 #include "rpc/frontend.h"
 #include "rpc/request_handler.h"
@@ -18,6 +19,9 @@
 #include "http_server/server.h"
 #include "http_server/mpfd_parser_factory.h"
 #include "download_track/request_handler.h"
+#include "album_cover/cover_provider.h"
+#include "album_cover/request_handler.h"
+#include "upload_track/form_data_writer.h"
 #include "upload_track/request_handler.h"
 #include "utils/string_encoding.h"
 
@@ -105,6 +109,7 @@ boost::filesystem::wpath AIMPControlPlugin::getPluginDirectoryPath()
 AIMPControlPlugin::AIMPControlPlugin()
     :
     free_image_dll_is_available_(false),
+    event_stream_listener_(nullptr),
     tick_timer_id_(0)
 {
     plugin_instance = this;
@@ -135,11 +140,11 @@ std::wstring AIMPControlPlugin::getAimpPath(int path_id) const
                 return std::wstring(buffer, buffer + buffer_length);
             } else {
                 // Do nothing here because of logger is not initialized at this point. Default value will be returned.
-                //BOOST_LOG_SEV(logger(), error) << "Failed to get path to plugin configuration directory. AIMP_GetPath() returned " << buffer_length;
+                //AIMP_LOG_SEV(logger(), error) << "Failed to get path to plugin configuration directory. AIMP_GetPath() returned " << buffer_length;
             }
         } else {
             // Do nothing here because of logger is not initialized at this point. Default value will be returned.
-            //BOOST_LOG_SEV(logger(), error) << "Failed to get path to plugin configuration directory. Failed to get IAIMP2ExtendedID object.
+            //AIMP_LOG_SEV(logger(), error) << "Failed to get path to plugin configuration directory. Failed to get IAIMP2ExtendedID object.
         }
     }
 
@@ -251,7 +256,7 @@ void AIMPControlPlugin::ensureWorkDirectoryExists()
         using namespace StringEncoding;
         // work directory is not accessible for writing or does not exist.
         // TODO: send log to aimp internal logger.
-        BOOST_LOG_SEV(logger(), error) << "Neither \""
+        AIMP_LOG_SEV(logger(), error) << "Neither \""
                                        << utf16_to_system_ansi_encoding_safe( plugins_subdirectory.native() )
                                        << "\", nor \"" 
                                        << utf16_to_system_ansi_encoding_safe( profile_subdirectory.native() )
@@ -314,7 +319,7 @@ void AIMPControlPlugin::initializeLogger()
             // file log is impossible.
             assert(!"File log was not initializated.");
             // Send msg to other log backends.
-            BOOST_LOG_SEV(logger(), error)  << "File log was not initializated, "
+            AIMP_LOG_SEV(logger(), error)  << "File log was not initializated, "
                                             << "log directory "
                                             << StringEncoding::utf16_to_system_ansi_encoding_safe( log_directory.native() )
                                             << ". Reason: "
@@ -342,7 +347,7 @@ int getAIMPVersion(AIMP3SDK::IAIMPCoreUnit* aimp3_core_unit)
     HRESULT r = aimp3_core_unit->GetVersion(&version_info);
 
     if (S_OK != r) {
-        BOOST_LOG_SEV(logger(), error) << "IAIMPCoreUnit::GetVersion returned " << r;
+        AIMP_LOG_SEV(logger(), error) << "IAIMPCoreUnit::GetVersion returned " << r;
         throw std::runtime_error("Unable to extract AIMP version. "__FUNCTION__);
     }
     
@@ -353,7 +358,7 @@ boost::shared_ptr<AIMPPlayer::AIMPManager> AIMPControlPlugin::CreateAIMPManager(
 {
     boost::shared_ptr<AIMPPlayer::AIMPManager> result;
     if (aimp2_controller_) {
-        result.reset( new AIMPPlayer::AIMPManager26(aimp2_controller_, *server_io_service_) );
+        result.reset( new AIMPPlayer::AIMPManager26(aimp2_controller_, *player_io_service_) );
     } else if (aimp3_core_unit_) {
         const int version = getAIMPVersion(aimp3_core_unit_.get());
         if (version >= 3100) {
@@ -376,7 +381,7 @@ HRESULT AIMPControlPlugin::initialize()
     loadSettings(); // If file does not exist tries to save default settings.
     initializeLogger();
 
-    BOOST_LOG_SEV(logger(), info) << "Plugin initialization is started";
+    AIMP_LOG_SEV(logger(), info) << "Plugin initialization is started";
 
     // freeimage DLL loading
     appendPathToPathEnvironmentVariable( getPluginDirectoryPath( getAimpPluginsPath() ) ); // make possible to load FreeImage dll from plugin directory.
@@ -385,12 +390,14 @@ HRESULT AIMPControlPlugin::initialize()
     // create plugin core
     try {
         server_io_service_ = boost::make_shared<boost::asio::io_service>();
+        player_io_service_ = boost::make_shared<boost::asio::io_service>();
+        player_thread_dispatcher_ = boost::make_shared<PlayerThreadDispatcher>(*player_io_service_);
 
         // create AIMP manager.
         aimp_manager_ = CreateAIMPManager();
 
-        BOOST_LOG_SEV(logger(), info) << "AIMP version: " << aimp_manager_->getAIMPVersion();
-        BOOST_LOG_SEV(logger(), info) << "Plugin version: " << StringEncoding::utf16_to_utf8( Utilities::getPluginVersion() );
+        AIMP_LOG_SEV(logger(), info) << "AIMP version: " << aimp_manager_->getAIMPVersion();
+        AIMP_LOG_SEV(logger(), info) << "Plugin version: " << StringEncoding::utf16_to_utf8( Utilities::getPluginVersion() );
 
         // create RPC request handler.
         rpc_request_handler_.reset( new Rpc::RequestHandler() );
@@ -399,78 +406,108 @@ HRESULT AIMPControlPlugin::initialize()
 
         download_track_request_handler_.reset( new DownloadTrack::RequestHandler(*aimp_manager_) );
 
-        {
-            if (settings().misc.enable_track_upload) {
-                // Use custom tmp dir path getter to avoid issue with junction point as tmp dir.
-                const fs::wpath temp_dir_to_store_tracks_being_added = Utilities::temp_directory_path() / kPLUGIN_SHORT_NAME;
-            
-                fs::create_directories(temp_dir_to_store_tracks_being_added);
-
-                Http::MPFD::ParserFactory::instance(Http::MPFD::ParserFactory::ParserFactoryPtr(new Http::MPFD::ParserFactoryImpl(temp_dir_to_store_tracks_being_added))
-                                                    );
-            }
-
-            upload_track_request_handler_.reset( new UploadTrack::RequestHandler(*aimp_manager_,
-                                                                                 settings().misc.enable_track_upload
-                                                                                 )
-                                                );
+        if (album_cover_provider_) {
+            album_cover_request_handler_.reset( new AlbumCover::RequestHandler(*aimp_manager_, *album_cover_provider_) );
         }
 
+        upload_track_request_handler_.reset( new UploadTrack::RequestHandler(*aimp_manager_,
+                                                                             settings().misc.enable_track_upload
+                                                                             )
+                                            );
+
         using namespace StringEncoding;
         // create HTTP request handler.
         http_request_handler_.reset( new Http::RequestHandler( utf16_to_system_ansi_encoding( getWebServerDocumentRoot().native() ),
                                                                *rpc_request_handler_,
                                                                *download_track_request_handler_,
-                                                               *upload_track_request_handler_
+                                                               *upload_track_request_handler_,
+                                                               album_cover_request_handler_.get(),
+                                                               event_stream_listener_
                                                               )
                                     );
+
+        if (settings().misc.enable_track_upload) {
+            // Use custom tmp dir path getter to avoid issue with junction point as tmp dir.
+            const fs::wpath temp_dir_to_store_tracks_being_added = Utilities::temp_directory_path() / kPLUGIN_SHORT_NAME;
+            
+            fs::create_directories(temp_dir_to_store_tracks_being_added);
+
+            // uploaded tracks are written to this directory directly while they are received, factory checks credentials of request before it.
+            Http::MPFD::ParserFactory::instance(Http::MPFD::ParserFactory::ParserFactoryPtr(new UploadTrack::FormDataWriterFactory(settings().misc.enable_track_upload,
+                                                                                                                                   temp_dir_to_store_tracks_being_added,
+                                                                                                                                   UploadTrack::getSupportedExtensions(*aimp_manager_),
+                                                                                                                                   http_request_handler_->auth_manager()
+                                                                                                                                   )
+                                                                                            )
+                                                );
+        }
+        // status method reads counters of HTTP request handler, so it is registered after handler creation.
+        rpc_request_handler_->addMethod( std::auto_ptr<Rpc::Method>(
+                                                new AimpRpcMethods::GetServerStatus(*aimp_manager_,
+                                                                                    *rpc_request_handler_,
+                                                                                    *http_request_handler_
+                                                                                    )
+                                                                    )
+                                        );
         // create XMLRPC server.
         server_.reset(new Http::Server( *server_io_service_,
-                                        *http_request_handler_
+                                        *http_request_handler_,
+                                        *player_thread_dispatcher_
                                        )
                       );
 
+        startServerIOThreads();
         startTickTimer();
     } catch (boost::thread_resource_error& e) {
-        BOOST_LOG_SEV(logger(), critical) << "Plugin initialization failed. Reason: create main server thread failed. Reason: " << e.what();
+        AIMP_LOG_SEV(logger(), critical) << "Plugin initialization failed. Reason: create main server thread failed. Reason: " << e.what();
         result = E_FAIL;
     } catch (std::runtime_error& e) {
-        BOOST_LOG_SEV(logger(), critical) << "Plugin initialization failed. Reason: " << e.what();
+        AIMP_LOG_SEV(logger(), critical) << "Plugin initialization failed. Reason: " << e.what();
         result = E_FAIL;
     } catch (...) {
-        BOOST_LOG_SEV(logger(), critical) << "Plugin initialization failed. Reason is unknown";
+        AIMP_LOG_SEV(logger(), critical) << "Plugin initialization failed. Reason is unknown";
         result = E_FAIL;
     }
 
-    BOOST_LOG_SEV(logger(), info) << "Plugin initialization is finished";
+    AIMP_LOG_SEV(logger(), info) << "Plugin initialization is finished";
 
     return result;
 }
 
 HRESULT AIMPControlPlugin::Finalize()
 {
-    BOOST_LOG_SEV(logger(), info) << "Plugin finalization is started";
+    AIMP_LOG_SEV(logger(), info) << "Plugin finalization is started";
 
     stopTickTimer();
 
-    server_io_service_->stop();
+    stopServerIOThreads();
+    if (player_io_service_) {
+        player_io_service_->stop();
+    }
     
     if (server_) {
         // stop the server.
-        BOOST_LOG_SEV(logger(), info) << "Stopping server.";
+        AIMP_LOG_SEV(logger(), info) << "Stopping server.";
 
         // destroy the server.
         server_.reset();
     }
 
+    Http::MPFD::ParserFactory::instance( Http::MPFD::ParserFactory::ParserFactoryPtr() ); // factory of previous initialization must not accept uploads.
+
     http_request_handler_.reset();
 
     download_track_request_handler_.reset();
 
     upload_track_request_handler_.reset();
 
+    album_cover_request_handler_.reset();
+
+    event_stream_listener_ = nullptr;
     rpc_request_handler_.reset();
 
+    album_cover_provider_.reset(); // after GetCover method which uses it.
+
     aimp_manager_.reset();
 
     aimp2_controller_.reset();
@@ -478,7 +515,10 @@ HRESULT AIMPControlPlugin::Finalize()
 
     server_io_service_.reset();
 
-    BOOST_LOG_SEV(logger(), info) << "Plugin finalization is finished";
+    player_thread_dispatcher_.reset();
+    player_io_service_.reset();
+
+    AIMP_LOG_SEV(logger(), info) << "Plugin finalization is finished";
 
     plugin_logger_.stopLog();
 
@@ -505,13 +545,13 @@ HRESULT AIMPControlPlugin::ShowSettingsDialog(HWND AParentWindow)
                                     &pi             // Pointer to PROCESS_INFORMATION structure
                                 );
     if (success) {
-        BOOST_LOG_SEV(logger(), debug) << "SettingsManager has been launched";
+        AIMP_LOG_SEV(logger(), debug) << "SettingsManager has been launched";
     } else {
-        BOOST_LOG_SEV(logger(), error) << "SettingsManager launch failed. Error " << GetLastError();
+        AIMP_LOG_SEV(logger(), error) << "SettingsManager launch failed. Error " << GetLastError();
 
         char currentDir[MAX_PATH];
         GetCurrentDirectoryA(MAX_PATH, currentDir);
-        BOOST_LOG_SEV(logger(), debug) << "currentDir: " << currentDir;
+        AIMP_LOG_SEV(logger(), debug) << "currentDir: " << currentDir;
 
         std::wostringstream message_body;
         message_body << L"AIMP Control plugin settings can be found in configuration file " << plugin_settings_filepath_;
@@ -572,13 +612,13 @@ void AIMPControlPlugin::createRpcMethods()
     rpc_request_handler_->addMethod( std::auto_ptr<Rpc::Method>(
                                             new RemoveTrack(*aimp_manager_,
                                                             *rpc_request_handler_,
-                                                            *server_io_service_
+                                                            *player_io_service_
                                                             )
                                                                 )
                                     );
     }
 
-    { // register this way since GetEntryPositionInDataTable and GetQueuedEntries depend on GetPlaylistEntries.
+    { // register this way since GetEntryPositionInDataTable, GetQueuedEntries and GetPlaylistEntriesQueryPlan depend on GetPlaylistEntries.
     std::auto_ptr<GetPlaylistEntries> method_getplaylistentries(new GetPlaylistEntries(*aimp_manager_,
                                                                                        *rpc_request_handler_
                                                                                        )
@@ -594,12 +634,18 @@ void AIMPControlPlugin::createRpcMethods()
                                                                             *method_getplaylistentries
                                                                             )
                                                         );
+    std::auto_ptr<Rpc::Method> method_getplaylistentriesqueryplan(new GetPlaylistEntriesQueryPlan(*aimp_manager_,
+                                                                                                  *rpc_request_handler_,
+                                                                                                  *method_getplaylistentries
+                                                                                                  )
+                                                                  );
     { // auto_ptr can not be implicitly casted to ptr to object of base class.
     std::auto_ptr<Rpc::Method> method( method_getplaylistentries.release() );
     rpc_request_handler_->addMethod(method);
     }
     rpc_request_handler_->addMethod(method_getentrypositionindatatable);
     rpc_request_handler_->addMethod(method_getqueuedentries);
+    rpc_request_handler_->addMethod(method_getplaylistentriesqueryplan);
     }
 
     REGISTER_AIMP_RPC_METHOD(GetPlaylistEntriesCount);
@@ -613,24 +659,40 @@ void AIMPControlPlugin::createRpcMethods()
             throw std::runtime_error("FreeImage DLL is not available and AIMP2 does not support direct access to album covers.");
         }
 
-        // add document root and path to directory for storing album covers in GetCover method.
+        const boost::filesystem::wpath cover_directory(L"album_covers_cache"); // directory in document root to store cached album covers.
+        album_cover_provider_.reset( new AlbumCover::CoverProvider(*aimp_manager_,
+                                                                   *player_thread_dispatcher_,
+                                                                   (getWebServerDocumentRoot() / cover_directory).normalize(),
+                                                                   free_image_dll_is_available_
+                                                                   )
+                                    );
+
+        // add path to directory of album covers in document root to GetCover method.
         rpc_request_handler_->addMethod( std::auto_ptr<Rpc::Method>(
                                                 new GetCover(*aimp_manager_,
                                                              *rpc_request_handler_,
-                                                             getWebServerDocumentRoot(),
-                                                             L"album_covers_cache", // directory in document root to store temp image files.
-                                                             free_image_dll_is_available_
+                                                             *album_cover_provider_,
+                                                             cover_directory
                                                              )
                                                                     )
                                         );
     } catch(std::exception& e) {
-        BOOST_LOG_SEV(logger(), info) << "Album cover processing was disabled. Reason: " << e.what();
+        AIMP_LOG_SEV(logger(), info) << "Album cover processing was disabled. Reason: " << e.what();
     } catch (...) {
-        BOOST_LOG_SEV(logger(), info) << "Album cover processing was disabled. Reason unknown.";
+        AIMP_LOG_SEV(logger(), info) << "Album cover processing was disabled. Reason unknown.";
     }
 
-    // Comet technique, "subscribe" method.
-    REGISTER_AIMP_RPC_METHOD(SubscribeOnAIMPStateUpdateEvent);
+    {
+    // Comet technique, "subscribe" method. It also sends events to streams of HTTP server, notifications are delayed by timer of io service.
+    std::auto_ptr<SubscribeOnAIMPStateUpdateEvent> method_subscribe(new SubscribeOnAIMPStateUpdateEvent(*aimp_manager_,
+                                                                                                         *rpc_request_handler_,
+                                                                                                         *player_io_service_
+                                                                                                         )
+                                                                    );
+    event_stream_listener_ = method_subscribe.get();
+    std::auto_ptr<Rpc::Method> method( method_subscribe.release() );
+    rpc_request_handler_->addMethod(method);
+    }
     // add file name for rating store file to SetTrackRating() method.
     rpc_request_handler_->addMethod( std::auto_ptr<Rpc::Method>(
                                                     new SetTrackRating( *aimp_manager_,
@@ -648,7 +710,7 @@ void AIMPControlPlugin::createRpcMethods()
     rpc_request_handler_->addMethod( std::auto_ptr<Rpc::Method>(
                                                   new Scheduler(*aimp_manager_,
                                                                 *rpc_request_handler_,
-                                                                *server_io_service_
+                                                                *player_io_service_
                                                                 )
                                                                 )
                                     );
@@ -676,15 +738,15 @@ LONG WINAPI DelayLoadDllExceptionFilter(PEXCEPTION_POINTERS pep)
     {
     case VcppException(ERROR_SEVERITY_ERROR, ERROR_MOD_NOT_FOUND):
         // The DLL module was not found at runtime
-        BOOST_LOG_SEV(logger(), warning) << "Dll " << pdli->szDll << " not found.";
+        AIMP_LOG_SEV(logger(), warning) << "Dll " << pdli->szDll << " not found.";
         break;
 
     case VcppException(ERROR_SEVERITY_ERROR, ERROR_PROC_NOT_FOUND):
         // The DLL module was found, but it doesn't contain the function
         if (pdli->dlp.fImportByName) {
-            BOOST_LOG_SEV(logger(), warning) << "Function " << pdli->dlp.szProcName << " was not found in " << pdli->szDll;
+            AIMP_LOG_SEV(logger(), warning) << "Function " << pdli->dlp.szProcName << " was not found in " << pdli->szDll;
         } else {
-            BOOST_LOG_SEV(logger(), warning) << "Function ordinal " << pdli->dlp.dwOrdinal << " was not found in " << pdli->szDll;
+            AIMP_LOG_SEV(logger(), warning) << "Function ordinal " << pdli->dlp.dwOrdinal << " was not found in " << pdli->szDll;
         }
         break;
 
@@ -738,7 +800,7 @@ void AIMPControlPlugin::startTickTimer()
 {
     tick_timer_id_ = ::SetTimer(NULL, kTickTimerEventID, kTickTimerElapse, &AIMPControlPlugin::onTickTimerProc);
     if (tick_timer_id_ == 0) {
-        BOOST_LOG_SEV(logger(), critical) << "Plugin's service interrupted: SetTimer failed with error: " << GetLastError();
+        AIMP_LOG_SEV(logger(), critical) << "Plugin's service interrupted: SetTimer failed with error: " << GetLastError();
     }
 }
 
@@ -746,7 +808,7 @@ void AIMPControlPlugin::stopTickTimer()
 {
     if (tick_timer_id_ != 0) {
         if (::KillTimer(NULL, tick_timer_id_) == 0) {
-            BOOST_LOG_SEV(logger(), warning) << "KillTimer failed with error: " << GetLastError();
+            AIMP_LOG_SEV(logger(), warning) << "KillTimer failed with error: " << GetLastError();
         }
     }
 }
@@ -759,10 +821,50 @@ void CALLBACK AIMPControlPlugin::onTickTimerProc(HWND /*hwnd*/,
     plugin_instance->onTick();
 }
 
+void AIMPControlPlugin::startServerIOThreads()
+{
+    const unsigned int threads_count = settings().http_server.io_threads_count;
+    if (threads_count == 0) {
+        AIMP_LOG_SEV(logger(), info) << "Network I/O is done in AIMP thread.";
+        return;
+    }
+
+    server_io_service_work_.reset( new boost::asio::io_service::work(*server_io_service_) );
+    for (unsigned int i = 0; i != threads_count; ++i) {
+        server_io_threads_.create_thread( boost::bind(&AIMPControlPlugin::runServerIOService, this) );
+    }
+    AIMP_LOG_SEV(logger(), info) << "Network I/O threads started: " << threads_count;
+}
+
+void AIMPControlPlugin::stopServerIOThreads()
+{
+    server_io_service_work_.reset();
+    if (server_io_service_) {
+        server_io_service_->stop();
+    }
+    server_io_threads_.join_all();
+}
+
+void AIMPControlPlugin::runServerIOService()
+{
+    for (;;) {
+        try {
+            server_io_service_->run();
+            break; // io_service was stopped.
+        } catch (std::exception& e) {
+            // Just send error in log and continue processing of other connections.
+            AIMP_LOG_SEV(logger(), error) << "Unhandled exception inside network I/O thread: " << e.what();
+        }
+    }
+}
+
 void AIMPControlPlugin::onTick()
 {
     try {
-        server_io_service_->poll();
+        if (server_io_threads_.size() == 0) {
+            server_io_service_->poll();
+        }
+        player_thread_dispatcher_->poll();
         { // for tests
             using namespace AIMPPlayer;
             if (aimp_manager_) {
@@ -771,10 +873,11 @@ void AIMPControlPlugin::onTick()
         }
     } catch (std::exception& e) {
         // Just send error in log and stop processing.
-        BOOST_LOG_SEV(logger(), critical) << "Unhandled exception inside ControlPlugin::onTick(): " << e.what();
-        server_io_service_->stop();
+        AIMP_LOG_SEV(logger(), critical) << "Unhandled exception inside ControlPlugin::onTick(): " << e.what();
+        stopServerIOThreads();
+        player_io_service_->stop();
         stopTickTimer();
-        BOOST_LOG_SEV(logger(), info) << "Service was stopped.";
+        AIMP_LOG_SEV(logger(), info) << "Service was stopped.";
     }
 }
 
@@ -6,14 +6,16 @@
 #include "aimp/aimp3_sdk/aimp3_sdk.h"
 #include "settings.h"
 #include "logger.h"
+#include "player_thread_dispatcher.h"
 #include "utils/iunknown_impl.h"
 #include <boost/thread.hpp>
 #include <boost/asio.hpp>
 
-namespace Http          { class RequestHandler; }
+namespace Http          { class RequestHandler; class EventStreamListener; }
 namespace Rpc           { class RequestHandler; }
 namespace DownloadTrack { class RequestHandler; }
 namespace UploadTrack   { class RequestHandler; }
+namespace AlbumCover    { class CoverProvider; class RequestHandler; }
 namespace AIMP2SDK { class IAIMP2Controller; }
 
 //! contains class which implements AIMP SDK interfaces and interacts with AIMP player.
@@ -52,9 +54,18 @@ private:
 
     HRESULT initialize();
 
-    // Runs the server's io_service loop.
+    // Runs handlers queued for player thread and the server's io_service loop if network I/O threads are not used.
     void onTick();
 
+    //! Starts network I/O threads if they are enabled in settings.
+    void startServerIOThreads(); // throws boost::thread_resource_error
+
+    //! Stops network I/O threads and waits for their completion.
+    void stopServerIOThreads();
+
+    //! Network I/O thread function.
+    void runServerIOService();
+
     static void CALLBACK onTickTimerProc(HWND hwnd,
                                          UINT uMsg,
                                          UINT_PTR idEvent,
@@ -142,10 +153,18 @@ private:
     boost::shared_ptr<Rpc::RequestHandler> rpc_request_handler_; //!< XML/Json RPC request handler. Used by Http::RequestHandler object.
     boost::shared_ptr<DownloadTrack::RequestHandler> download_track_request_handler_; //!< Download track request handler. Used by Http::RequestHandler object.
     boost::shared_ptr<UploadTrack::RequestHandler> upload_track_request_handler_; //!< Upload track request handler. Used by Http::RequestHandler object.
+    boost::shared_ptr<AlbumCover::CoverProvider> album_cover_provider_; //!< Album covers cache. Used by GetCover method and album_cover_request_handler_. Null if album covers are not available.
+    boost::shared_ptr<AlbumCover::RequestHandler> album_cover_request_handler_; //!< Album cover request handler. Used by Http::RequestHandler object.
     boost::shared_ptr<Http::RequestHandler> http_request_handler_; //!< Http request handler, used by Http::Server object.
-    boost::shared_ptr<boost::asio::io_service> server_io_service_;
+    Http::EventStreamListener* event_stream_listener_; //!< SubscribeOnAIMPStateUpdateEvent method which sends events to streams of Http::RequestHandler. Owned by rpc_request_handler_.
+    boost::shared_ptr<boost::asio::io_service> server_io_service_; //!< network I/O, executed by server_io_threads_ or by tick timer if there are no threads.
+    std::unique_ptr<boost::asio::io_service::work> server_io_service_work_; //!< prevents exit of server_io_service_ run() in network I/O threads.
+    boost::thread_group server_io_threads_;
     boost::shared_ptr<Http::Server> server_; //!< Simple Http server.
 
+    boost::shared_ptr<boost::asio::io_service> player_io_service_; //!< executed only in player thread. All work which touches AIMP is done here.
+    boost::shared_ptr<PlayerThreadDispatcher> player_thread_dispatcher_; //!< queues work from network I/O threads to player thread.
+
     boost::shared_ptr<AIMPPlayer::AIMPManager> aimp_manager_; //!< AIMP player manager.
 
     boost::filesystem::wpath plugin_work_directory_; //!< path to plugin work directory. It is initialized in getPluginWorkDirectoryPathInAimpPluginsDirectory() function.
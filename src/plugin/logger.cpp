@@ -5,6 +5,7 @@
 #include "utils/string_encoding.h"
 #include "utils/util.h"
 #include <boost/filesystem.hpp>
+#include <boost/foreach.hpp>
 
 #pragma warning (push, 3)
 #include <boost/log/utility/exception_handler.hpp>
@@ -20,12 +21,27 @@ const std::string LogManager::kHTTP_SERVER_MODULE_NAME =  "http_server";
 const std::string LogManager::kAIMP_MANAGER_MODULE_NAME = "aimp_manager";
 const std::string LogManager::kPLUGIN_MODULE_NAME =       "plugin";
 
+namespace
+{
+
+const size_t kLOG_QUEUE_CAPACITY = 4096; //!< max count of messages waiting for writing to file.
+
+enum MODULE_BITS {
+    PLUGIN_MODULE_BIT       = 1 << 0,
+    AIMP_MANAGER_MODULE_BIT = 1 << 1,
+    RPC_SERVER_MODULE_BIT   = 1 << 2,
+    HTTP_SERVER_MODULE_BIT  = 1 << 3
+};
+
+} // namespace
+
 LogManager::LogManager()
     : severity_(severity_levels_count),
       plugin_lg_(keywords::channel = kPLUGIN_MODULE_NAME),
       aimp_manager_lg_(keywords::channel = kAIMP_MANAGER_MODULE_NAME),
       rpc_server_lg_(keywords::channel = kRPC_SERVER_MODULE_NAME),
-      http_server_lg_(keywords::channel = kHTTP_SERVER_MODULE_NAME)
+      http_server_lg_(keywords::channel = kHTTP_SERVER_MODULE_NAME),
+      modules_to_log_mask_(0)
 {}
 
 LogManager::~LogManager()
@@ -33,9 +49,24 @@ LogManager::~LogManager()
     stopLog();
 }
 
-bool LogManager::logInModuleEnabled(const std::string& module_name) const
+unsigned int LogManager::moduleBit(const std::string& module_name)
 {
-    return modules_to_log_.find(module_name) != modules_to_log_.end();
+    // module names have different first letters, so only one comparison is needed.
+    if ( module_name.empty() ) {
+        return 0;
+    }
+    switch (module_name[0]) {
+    case 'p':
+        return module_name == kPLUGIN_MODULE_NAME ? PLUGIN_MODULE_BIT : 0;
+    case 'a':
+        return module_name == kAIMP_MANAGER_MODULE_NAME ? AIMP_MANAGER_MODULE_BIT : 0;
+    case 'r':
+        return module_name == kRPC_SERVER_MODULE_NAME ? RPC_SERVER_MODULE_BIT : 0;
+    case 'h':
+        return module_name == kHTTP_SERVER_MODULE_NAME ? HTTP_SERVER_MODULE_BIT : 0;
+    default:
+        return 0;
+    }
 }
 
 /*
@@ -94,7 +125,10 @@ void LogManager::startLog(const fs::wpath& log_directory,
     namespace fmt = boost::log::formatters;
     namespace flt = boost::log::filters;
 
-    modules_to_log_ = modules_to_log;
+    modules_to_log_mask_ = 0;
+    BOOST_FOREACH(const std::string& module_name, modules_to_log) {
+        modules_to_log_mask_ |= moduleBit(module_name);
+    }
 
     boost::shared_ptr<log::core> core = log::core::get();
 
@@ -171,10 +205,11 @@ void LogManager::startLog(const fs::wpath& log_directory,
         // Look for files that may have left from previous runs of the application
         backend_file->scan_for_files();
 
-        // Enable auto-flushing after each log record written
-        backend_file->auto_flush(true);
+        // AsyncLogBackend flushes file after each batch of records, not after each record.
+        backend_file->auto_flush(false);
 
-        sink_file_ = boost::make_shared<sink_file_t>(backend_file);
+        file_backend_ = boost::make_shared<AsyncLogBackend>(backend_file, kLOG_QUEUE_CAPACITY);
+        sink_file_ = boost::make_shared<sink_file_t>(file_backend_);
 
         sink_file_->set_formatter(AIMP_FORMATTER);
 
@@ -196,6 +231,8 @@ void LogManager::stopLog()
     // remove sinks.
     if (sink_file_) {
         core->remove_sink(sink_file_);
+        // write queued messages. AsyncLogBackend::stop() is thread safe, message logged concurrently is just not written.
+        file_backend_->stop();
     }
     if (sink_dbg_) {
         core->remove_sink(sink_dbg_);
@@ -216,6 +253,11 @@ SEVERITY_LEVELS LogManager::getSeverity() const
     return severity_;
 }
 
+unsigned long LogManager::droppedMessagesCount() const
+{
+    return file_backend_ ? file_backend_->droppedCount() : 0;
+}
+
 // The formatting logic for the severity level
 template <typename CharT, typename TraitsT>
 inline std::basic_ostream< CharT, TraitsT >& operator<< (
@@ -5,14 +5,30 @@
 #pragma warning (push, 3)
 #include <boost/log/common.hpp>
 #include <boost/log/sinks/sync_frontend.hpp>
-#include <boost/log/sinks/text_file_backend.hpp>
+#include <boost/log/sinks/unlocked_frontend.hpp>
 #include <boost/log/sinks/debug_output_backend.hpp>
 #include <boost/log/sources/severity_channel_logger.hpp>
 #pragma warning (pop)
 
+#include "plugin/async_log_backend.h"
 #include <boost/static_assert.hpp>
 #include <set>
 
+/*!
+    Minimal severity of log messages compiled into plugin, messages with lower constant severity are removed by compiler.
+    For example define AIMP_LOG_MIN_SEVERITY=1 in project settings to exclude debug messages from build.
+*/
+#ifndef AIMP_LOG_MIN_SEVERITY
+#   define AIMP_LOG_MIN_SEVERITY 0
+#endif
+
+/*!
+    Use it instead of BOOST_LOG_SEV(logger, severity).
+    Message is neither formatted nor passed to Boost.Log core if its severity is less than compile time or current runtime minimal severity.
+*/
+#define AIMP_LOG_SEV(logger, severity) \
+    if ( (severity) < AIMP_LOG_MIN_SEVERITY || !::ControlPlugin::PluginLogger::getLogManager().severityEnabled(severity) ) {} else BOOST_LOG_SEV(logger, severity)
+
 namespace ControlPlugin {
 
 //! contains logger utils.
@@ -34,12 +50,14 @@ namespace fs = boost::filesystem;
 
 /*! logger source type for using by entire application.
     Add severity and module(or channel in terms of Boost.Log) name attributes.
+    Thread safe version is used since HTTP server works in separate network I/O threads.
 */
-typedef log::sources::severity_channel_logger<SEVERITY_LEVELS> ModuleLoggerType;
+typedef log::sources::severity_channel_logger_mt<SEVERITY_LEVELS> ModuleLoggerType;
 
 /*!
     \brief Provides log output functionality for entire application.
-           Current implementation uses Boost.Log library, so macroses BOOST_LOG_SEV(logger(), severity) are used for log msg writing.
+           Current implementation uses Boost.Log library, so macroses AIMP_LOG_SEV(logger(), severity) are used for log msg writing.
+           File output is asynchronous: messages are written by AsyncLogBackend flusher thread.
            Each module should use his own getModuleLogger() function specialization to logger access.<br>
            Function logger() is implemented by following example code in each module:
            <PRE>
@@ -83,6 +101,13 @@ public:
     //! Returns current minimal severity level of log messages.
     SEVERITY_LEVELS getSeverity() const;
 
+    //! Returns true if messages with specified severity are written.
+    bool severityEnabled(SEVERITY_LEVELS severity) const
+        { return severity >= severity_; }
+
+    //! Returns count of messages which were not written to file since log queue was full.
+    unsigned long droppedMessagesCount() const;
+
 private:
 
     /*!
@@ -93,13 +118,16 @@ private:
     */
     void checkDirectoryAccess(const fs::wpath& log_directory) const; // throws FileLogError
 
+    //! Returns bit of module in modules mask, 0 for unknown module.
+    static unsigned int moduleBit(const std::string& module_name);
+
     /*!
         \brief Used for filter log messages of concrete modules.
-               List of modules where log is enabled passed in startLog() method.
-               Function tries to find specified module name string in that list.
+               List of modules where log is enabled passed in startLog() method, it is converted to modules_to_log_mask_.
         \return true if log is enabled for specified module, false otherwise.
     */
-    bool logInModuleEnabled(const std::string& module_name) const;
+    bool logInModuleEnabled(const std::string& module_name) const
+        { return (moduleBit(module_name) & modules_to_log_mask_) != 0; }
 
     //!< Messages with lower severity will not be written.
     SEVERITY_LEVELS severity_;
@@ -112,16 +140,21 @@ private:
                      rpc_server_lg_,
                      http_server_lg_;
 
-    typedef sinks::synchronous_sink< sinks::text_file_backend > sink_file_t;
-    boost::shared_ptr< sink_file_t > sink_file_; //!< sink for file output.
+    /*! Sink for file output. Unlocked frontend formats message in logging thread with thread specific formatting context
+        and passes it to backend without locking, so logging threads do not serialize on sink mutex.
+        Backend is lock-free, it queues message for writing in flusher thread.
+    */
+    typedef sinks::unlocked_sink< AsyncLogBackend > sink_file_t;
+    boost::shared_ptr< sink_file_t > sink_file_;
+    boost::shared_ptr< AsyncLogBackend > file_backend_; //!< accessed directly since unlocked frontend has no locked_backend().
 
     typedef sinks::synchronous_sink< sinks::debug_output_backend > debug_sink;
     boost::shared_ptr< debug_sink > sink_dbg_; //!< sink for debugger output.
 
-    /*! List of module names where log is enabled.
-         Initialized in startLog() method. Used in moduleFilter() method.
+    /*! Bits of modules where log is enabled.
+         Initialized in startLog() method. Used in logInModuleEnabled() method.
     */
-    std::set<std::string> modules_to_log_;
+    unsigned int modules_to_log_mask_;
 };
 
 //! provide global access to LogManager object.
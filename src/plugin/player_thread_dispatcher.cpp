@@ -0,0 +1,87 @@
+// Copyright (c) 2014, Alexey Ivanov
+
+#include "stdafx.h"
+#include "player_thread_dispatcher.h"
+#include "plugin/logger.h"
+#include "utils/util.h"
+
+namespace {
+using namespace ControlPlugin::PluginLogger;
+ModuleLoggerType& logger()
+    { return getLogManager().getModuleLogger<ControlPlugin::AIMPControlPlugin>(); }
+
+const wchar_t * const kWINDOW_CLASS_NAME = L"AIMPControlPluginPlayerThreadDispatcher";
+const UINT kWM_RUN_QUEUED_HANDLERS = WM_APP + 1;
+}
+
+namespace ControlPlugin
+{
+
+PlayerThreadDispatcher::PlayerThreadDispatcher(boost::asio::io_service& io_service)
+    :
+    io_service_(io_service),
+    io_service_work_(io_service),
+    window_(NULL),
+    wake_up_pending_(0)
+{
+    HINSTANCE instance = ::GetModuleHandle(NULL);
+
+    WNDCLASSEX wc = { 0 };
+    wc.cbSize = sizeof(wc);
+    wc.lpfnWndProc = &PlayerThreadDispatcher::windowProc;
+    wc.hInstance = instance;
+    wc.lpszClassName = kWINDOW_CLASS_NAME;
+    if ( ::RegisterClassEx(&wc) == 0 && ::GetLastError() != ERROR_CLASS_ALREADY_EXISTS ) {
+        throw std::runtime_error(Utilities::MakeString() << "RegisterClassEx failed with error: " << ::GetLastError() << ". "__FUNCTION__);
+    }
+
+    window_ = ::CreateWindowEx(0, kWINDOW_CLASS_NAME, L"", 0, 0, 0, 0, 0, HWND_MESSAGE, NULL, instance, NULL);
+    if (window_ == NULL) {
+        throw std::runtime_error(Utilities::MakeString() << "CreateWindowEx failed with error: " << ::GetLastError() << ". "__FUNCTION__);
+    }
+
+    ::SetWindowLongPtr( window_, GWLP_USERDATA, reinterpret_cast<LONG_PTR>(this) );
+}
+
+PlayerThreadDispatcher::~PlayerThreadDispatcher()
+{
+    if (window_ != NULL) {
+        ::SetWindowLongPtr(window_, GWLP_USERDATA, 0);
+        ::DestroyWindow(window_);
+    }
+    ::UnregisterClass( kWINDOW_CLASS_NAME, ::GetModuleHandle(NULL) ); // plugin DLL can be unloaded, so do not leave window procedure registered.
+}
+
+void PlayerThreadDispatcher::wakeUp()
+{
+    if (::InterlockedCompareExchange(&wake_up_pending_, 1, 0) == 0) {
+        if ( !::PostMessage(window_, kWM_RUN_QUEUED_HANDLERS, 0, 0) ) {
+            // handlers will be executed on next tick.
+            ::InterlockedExchange(&wake_up_pending_, 0);
+        }
+    }
+}
+
+void PlayerThreadDispatcher::poll()
+{
+    ::InterlockedExchange(&wake_up_pending_, 0);
+    io_service_.poll();
+}
+
+LRESULT CALLBACK PlayerThreadDispatcher::windowProc(HWND hwnd, UINT msg, WPARAM wparam, LPARAM lparam)
+{
+    if (msg == kWM_RUN_QUEUED_HANDLERS) {
+        PlayerThreadDispatcher* dispatcher = reinterpret_cast<PlayerThreadDispatcher*>( ::GetWindowLongPtr(hwnd, GWLP_USERDATA) );
+        if (dispatcher) {
+            try {
+                dispatcher->poll();
+            } catch (std::exception& e) {
+                AIMP_LOG_SEV(logger(), critical) << "Unhandled exception inside "__FUNCTION__": " << e.what();
+            }
+        }
+        return 0;
+    }
+    return ::DefWindowProc(hwnd, msg, wparam, lparam);
+}
+
+} // namespace ControlPlugin
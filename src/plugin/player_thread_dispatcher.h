@@ -0,0 +1,60 @@
+// Copyright (c) 2014, Alexey Ivanov
+
+#pragma once
+
+#include <boost/asio.hpp>
+#include <boost/noncopyable.hpp>
+
+namespace ControlPlugin
+{
+
+/*!
+    \brief Marshals handlers into AIMP (player) thread.
+
+    All calls of AIMP SDK and all access to playlists DB must be done in thread where plugin was initialized.
+    Network I/O threads post such work here, it is queued into player io_service and
+    executed by the message-only window which belongs to player thread.
+    Posting from any thread is safe, execution is always done in player thread.
+    Dispatcher keeps io_service busy while it exists: otherwise first poll() with empty queue
+    would stop io_service and all handlers posted later would never be executed.
+*/
+class PlayerThreadDispatcher : boost::noncopyable
+{
+public:
+    /*!
+        \param io_service - io_service which is polled only in player thread.
+        Must be created in player thread.
+    */
+    explicit PlayerThreadDispatcher(boost::asio::io_service& io_service); // throws std::runtime_error
+
+    ~PlayerThreadDispatcher();
+
+    //! Queues handler for execution in player thread and wakes player thread up. Thread safe.
+    template <typename Handler>
+    void post(Handler handler)
+    {
+        io_service_.post(handler);
+        wakeUp();
+    }
+
+    //! Executes all queued handlers. Must be called from player thread only.
+    void poll();
+
+    boost::asio::io_service& get_io_service()
+        { return io_service_; }
+
+private:
+
+    void wakeUp();
+
+    static LRESULT CALLBACK windowProc(HWND hwnd, UINT msg, WPARAM wparam, LPARAM lparam);
+
+    boost::asio::io_service& io_service_;
+    boost::asio::io_service::work io_service_work_; //!< prevents stop of io_service_ by poll() when there are no queued handlers.
+
+    HWND window_; //!< message-only window, owned by player thread.
+
+    volatile LONG wake_up_pending_; //!< prevents flooding of player thread message queue by wake up messages.
+};
+
+} // namespace ControlPlugin
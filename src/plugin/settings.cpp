@@ -9,6 +9,9 @@
 #include <boost/foreach.hpp>
 #include <boost/numeric/conversion/cast.hpp>
 #include <boost/assign/std.hpp>
+#include <boost/algorithm/string.hpp>
+#include <boost/lexical_cast.hpp>
+#include <sstream>
 #include <libs/serialization/src/utf8_codecvt_facet.cpp>
 
 namespace ControlPlugin { namespace PluginSettings {
@@ -18,11 +21,25 @@ using boost::property_tree::wptree;
 
 static std::wstring kDEFAULT_REALM = L"AIMP Control plugin";
 static std::wstring kDEFAULT_PORT = L"3333";
+static const unsigned int kDEFAULT_IO_THREADS_COUNT = 2;
+static const unsigned int kDEFAULT_KEEP_ALIVE_TIMEOUT = 15;
+static const unsigned int kDEFAULT_KEEP_ALIVE_MAX_REQUESTS = 100;
+static const unsigned int kDEFAULT_RPC_COMPRESSION_LEVEL = 6;
+static const unsigned int kDEFAULT_RPC_COMPRESSION_MIN_SIZE = 1024;
+static const unsigned int kDEFAULT_MAX_CONNECTIONS = 256;
+static const unsigned int kDEFAULT_MAX_SUBSCRIPTIONS_PER_CLIENT = 32;
+static const unsigned int kDEFAULT_MAX_REQUESTS_PER_SECOND = 100;
+static const unsigned int kDEFAULT_COVERS_MEMORY_CACHE_SIZE = 16 * 1024 * 1024;
+static const unsigned int kDEFAULT_COVERS_DISK_CACHE_SIZE = 64 * 1024 * 1024;
+static const unsigned int kDEFAULT_COVERS_RESIZE_THREADS_COUNT = 2;
+static const unsigned int kDEFAULT_COVERS_JPEG_QUALITY = 85;
+static std::wstring kDEFAULT_COVERS_PREGENERATED_SIZES = L"100x100;300x300";
 
 Manager::Manager()
 {
     setDefaultLoggerSettings();
     setDefaultHttpServerSettings();
+    setDefaultAlbumCoversSettings();
 }
 
 void Manager::setDefaultLoggerSettings()
@@ -50,6 +67,28 @@ void Manager::setDefaultHttpServerSettings()
     s.interfaces.insert(Settings::HttpServer::NetworkInterface("", "localhost", StringEncoding::utf16_to_system_ansi_encoding_safe(kDEFAULT_PORT)));
     s.document_root = L"htdocs";
     s.realm = kDEFAULT_REALM;
+    s.io_threads_count = kDEFAULT_IO_THREADS_COUNT;
+    s.keep_alive_timeout = kDEFAULT_KEEP_ALIVE_TIMEOUT;
+    s.keep_alive_max_requests = kDEFAULT_KEEP_ALIVE_MAX_REQUESTS;
+    s.rpc_compression_level = kDEFAULT_RPC_COMPRESSION_LEVEL;
+    s.rpc_compression_min_size = kDEFAULT_RPC_COMPRESSION_MIN_SIZE;
+    s.max_connections = kDEFAULT_MAX_CONNECTIONS;
+    s.max_subscriptions_per_client = kDEFAULT_MAX_SUBSCRIPTIONS_PER_CLIENT;
+    s.max_requests_per_second = kDEFAULT_MAX_REQUESTS_PER_SECOND;
+}
+
+std::vector<Settings::AlbumCovers::Size> coverSizesFromString(const std::wstring& sizes);
+
+void Manager::setDefaultAlbumCoversSettings()
+{
+    Settings::AlbumCovers& s = settings_.album_covers;
+    s.memory_cache_size = kDEFAULT_COVERS_MEMORY_CACHE_SIZE;
+    s.disk_cache_size = kDEFAULT_COVERS_DISK_CACHE_SIZE;
+    s.resize_threads_count = kDEFAULT_COVERS_RESIZE_THREADS_COUNT;
+    s.jpeg_quality = kDEFAULT_COVERS_JPEG_QUALITY;
+    s.progressive_jpeg = true;
+    s.fast_downscaling = true;
+    s.pregenerated_sizes = coverSizesFromString(kDEFAULT_COVERS_PREGENERATED_SIZES);
 }
 
 void loadPropertyTreeFromFile(wptree& pt, const boost::filesystem::wpath& filename) // throws std::exception
@@ -140,6 +179,15 @@ void loadSettingsFromPropertyTree(Settings& settings, const wptree& pt) // throw
     
     std::wstring realm = pt.get<std::wstring>(L"settings.httpserver.realm", kDEFAULT_REALM);
 
+    const unsigned int io_threads_count = pt.get<unsigned int>(L"settings.httpserver.io_threads_count", kDEFAULT_IO_THREADS_COUNT);
+    const unsigned int keep_alive_timeout = pt.get<unsigned int>(L"settings.httpserver.keep_alive_timeout", kDEFAULT_KEEP_ALIVE_TIMEOUT);
+    const unsigned int keep_alive_max_requests = pt.get<unsigned int>(L"settings.httpserver.keep_alive_max_requests", kDEFAULT_KEEP_ALIVE_MAX_REQUESTS);
+    const unsigned int rpc_compression_level = std::min( pt.get<unsigned int>(L"settings.httpserver.rpc_compression_level", kDEFAULT_RPC_COMPRESSION_LEVEL), 9u );
+    const unsigned int rpc_compression_min_size = pt.get<unsigned int>(L"settings.httpserver.rpc_compression_min_size", kDEFAULT_RPC_COMPRESSION_MIN_SIZE);
+    const unsigned int max_connections = pt.get<unsigned int>(L"settings.httpserver.max_connections", kDEFAULT_MAX_CONNECTIONS);
+    const unsigned int max_subscriptions_per_client = pt.get<unsigned int>(L"settings.httpserver.max_subscriptions_per_client", kDEFAULT_MAX_SUBSCRIPTIONS_PER_CLIENT);
+    const unsigned int max_requests_per_second = pt.get<unsigned int>(L"settings.httpserver.max_requests_per_second", kDEFAULT_MAX_REQUESTS_PER_SECOND);
+
     std::set<std::string> init_cookies;
     try {
         for ( const auto& v : pt.get_child(L"settings.httpserver.init_cookies") ) {
@@ -161,6 +209,18 @@ void loadSettingsFromPropertyTree(Settings& settings, const wptree& pt) // throw
     tmp = pt.get<std::wstring>(L"settings.misc.enable_scheduler", L"false");
     std::transform(tmp.begin(), tmp.end(), tmp.begin(), ::tolower);
     bool enable_scheduler = tmp == L"true" || tmp == L"1";
+
+    const unsigned int covers_memory_cache_size = pt.get<unsigned int>(L"settings.album_covers.memory_cache_size", kDEFAULT_COVERS_MEMORY_CACHE_SIZE);
+    const unsigned int covers_disk_cache_size = pt.get<unsigned int>(L"settings.album_covers.disk_cache_size", kDEFAULT_COVERS_DISK_CACHE_SIZE);
+    const unsigned int covers_resize_threads_count = std::max( pt.get<unsigned int>(L"settings.album_covers.resize_threads_count", kDEFAULT_COVERS_RESIZE_THREADS_COUNT), 1u );
+    const unsigned int covers_jpeg_quality = std::max( std::min( pt.get<unsigned int>(L"settings.album_covers.jpeg_quality", kDEFAULT_COVERS_JPEG_QUALITY), 100u ), 1u );
+    tmp = pt.get<std::wstring>(L"settings.album_covers.progressive_jpeg", L"true");
+    std::transform(tmp.begin(), tmp.end(), tmp.begin(), ::tolower);
+    const bool covers_progressive_jpeg = tmp == L"true" || tmp == L"1";
+    tmp = pt.get<std::wstring>(L"settings.album_covers.fast_downscaling", L"true");
+    std::transform(tmp.begin(), tmp.end(), tmp.begin(), ::tolower);
+    const bool covers_fast_downscaling = tmp == L"true" || tmp == L"1";
+    std::vector<Settings::AlbumCovers::Size> covers_pregenerated_sizes = coverSizesFromString( pt.get<std::wstring>(L"settings.album_covers.pregenerated_sizes", kDEFAULT_COVERS_PREGENERATED_SIZES) );
     
     // all work has been done, save result.
     using std::swap;
@@ -169,6 +229,14 @@ void loadSettingsFromPropertyTree(Settings& settings, const wptree& pt) // throw
     settings.http_server.document_root.swap(server_document_root);
     settings.http_server.init_cookies.swap(init_cookies);
     settings.http_server.realm.swap(realm);
+    settings.http_server.io_threads_count = io_threads_count;
+    settings.http_server.keep_alive_timeout = keep_alive_timeout;
+    settings.http_server.keep_alive_max_requests = keep_alive_max_requests;
+    settings.http_server.rpc_compression_level = rpc_compression_level;
+    settings.http_server.rpc_compression_min_size = rpc_compression_min_size;
+    settings.http_server.max_connections = max_connections;
+    settings.http_server.max_subscriptions_per_client = max_subscriptions_per_client;
+    settings.http_server.max_requests_per_second = max_requests_per_second;
 
     settings.logger.severity_level = log_severity_level;
     settings.logger.directory.swap(log_directory);
@@ -177,6 +245,14 @@ void loadSettingsFromPropertyTree(Settings& settings, const wptree& pt) // throw
     settings.misc.enable_track_upload = enable_track_upload;
     settings.misc.enable_physical_track_deletion = enable_physical_track_deletion;
     settings.misc.enable_scheduler = enable_scheduler;
+
+    settings.album_covers.memory_cache_size = covers_memory_cache_size;
+    settings.album_covers.disk_cache_size = covers_disk_cache_size;
+    settings.album_covers.resize_threads_count = covers_resize_threads_count;
+    settings.album_covers.jpeg_quality = covers_jpeg_quality;
+    settings.album_covers.progressive_jpeg = covers_progressive_jpeg;
+    settings.album_covers.fast_downscaling = covers_fast_downscaling;
+    settings.album_covers.pregenerated_sizes.swap(covers_pregenerated_sizes);
 }
 
 void Manager::load(const boost::filesystem::wpath& filename)
@@ -212,6 +288,7 @@ void savePropertyTreeToFile(const wptree& pt, const boost::filesystem::wpath& fi
 }
 
 const wchar_t* severityToString(int level);
+std::wstring coverSizesToString(const std::vector<Settings::AlbumCovers::Size>& sizes);
 
 void saveSettingsToPropertyTree(const Settings& settings, wptree& pt) // throws std::exception
 {
@@ -237,11 +314,27 @@ void saveSettingsToPropertyTree(const Settings& settings, wptree& pt) // throws
 
     pt.put( L"settings.httpserver.document_root", settings.http_server.document_root );
     pt.put( L"settings.httpserver.realm", settings.http_server.realm );
+    pt.put( L"settings.httpserver.io_threads_count", settings.http_server.io_threads_count );
+    pt.put( L"settings.httpserver.keep_alive_timeout", settings.http_server.keep_alive_timeout );
+    pt.put( L"settings.httpserver.keep_alive_max_requests", settings.http_server.keep_alive_max_requests );
+    pt.put( L"settings.httpserver.rpc_compression_level", settings.http_server.rpc_compression_level );
+    pt.put( L"settings.httpserver.rpc_compression_min_size", settings.http_server.rpc_compression_min_size );
+    pt.put( L"settings.httpserver.max_connections", settings.http_server.max_connections );
+    pt.put( L"settings.httpserver.max_subscriptions_per_client", settings.http_server.max_subscriptions_per_client );
+    pt.put( L"settings.httpserver.max_requests_per_second", settings.http_server.max_requests_per_second );
 
     pt.put(L"settings.misc.enable_track_upload", settings.misc.enable_track_upload);
     pt.put(L"settings.misc.enable_physical_track_deletion", settings.misc.enable_physical_track_deletion);
     pt.put(L"settings.misc.enable_scheduler", settings.misc.enable_scheduler);
 
+    pt.put( L"settings.album_covers.memory_cache_size", settings.album_covers.memory_cache_size );
+    pt.put( L"settings.album_covers.disk_cache_size", settings.album_covers.disk_cache_size );
+    pt.put( L"settings.album_covers.resize_threads_count", settings.album_covers.resize_threads_count );
+    pt.put( L"settings.album_covers.jpeg_quality", settings.album_covers.jpeg_quality );
+    pt.put( L"settings.album_covers.progressive_jpeg", settings.album_covers.progressive_jpeg );
+    pt.put( L"settings.album_covers.fast_downscaling", settings.album_covers.fast_downscaling );
+    pt.put( L"settings.album_covers.pregenerated_sizes", coverSizesToString(settings.album_covers.pregenerated_sizes) );
+
     // Put log directory in property tree
     pt.put(L"settings.logging.directory", settings.logger.directory);
 
@@ -294,4 +387,40 @@ const wchar_t* severityToString(int level)
     return severity_levels[severity_levels_count];
 }
 
+//! Parses list of sizes like "100x100;300x0", invalid items are skipped.
+std::vector<Settings::AlbumCovers::Size> coverSizesFromString(const std::wstring& sizes)
+{
+    std::vector<std::wstring> items;
+    boost::split( items, sizes, boost::is_any_of(L";, ") );
+
+    std::vector<Settings::AlbumCovers::Size> result;
+    BOOST_FOREACH(const std::wstring& item, items) {
+        const size_t delimiter_pos = item.find(L'x');
+        if (delimiter_pos == std::wstring::npos) {
+            continue;
+        }
+        try {
+            result.push_back( Settings::AlbumCovers::Size( boost::lexical_cast<unsigned int>( item.substr(0, delimiter_pos) ),
+                                                           boost::lexical_cast<unsigned int>( item.substr(delimiter_pos + 1) )
+                                                          )
+                             );
+        } catch (boost::bad_lexical_cast&) {
+            // skip invalid size.
+        }
+    }
+    return result;
+}
+
+std::wstring coverSizesToString(const std::vector<Settings::AlbumCovers::Size>& sizes)
+{
+    std::wostringstream result;
+    BOOST_FOREACH(const Settings::AlbumCovers::Size& size, sizes) {
+        if ( result.tellp() != std::streampos(0) ) {
+            result << L';';
+        }
+        result << size.width << L'x' << size.height;
+    }
+    return result.str();
+}
+
 } } // namespace ControlPlugin::PluginSettings
@@ -4,6 +4,7 @@
 
 #include <exception>
 #include <set>
+#include <vector>
 #include <boost/noncopyable.hpp>
 #include <boost/filesystem.hpp>
 
@@ -15,6 +16,14 @@ struct Settings
         std::wstring document_root; //!< Path to directory.
         std::set<std::string> init_cookies; //! Cookies which server sends to client on page first load.
         std::wstring realm; 
+        unsigned int io_threads_count; //!< count of network I/O threads. Zero means that network I/O is done in AIMP thread by timer.
+        unsigned int keep_alive_timeout; //!< idle time in seconds after which persistent connection is closed. Zero disables persistent connections.
+        unsigned int keep_alive_max_requests; //!< max count of requests served by one persistent connection.
+        unsigned int rpc_compression_level; //!< gzip level [1, 9] of RPC responses. Zero disables compression.
+        unsigned int rpc_compression_min_size; //!< RPC responses smaller than this size in bytes are not compressed.
+        unsigned int max_connections; //!< max count of open connections, clients over limit get 503 reply. Zero disables limit.
+        unsigned int max_subscriptions_per_client; //!< max count of pending comet requests(event subscriptions) of one client IP, excess ones get 429 reply. Zero disables limit.
+        unsigned int max_requests_per_second; //!< max average rate of requests of one client IP, excess ones get 429 reply. Zero disables limit.
 
         struct AllNetworkInterfaces
         {
@@ -52,6 +61,21 @@ struct Settings
         bool enable_physical_track_deletion;
         bool enable_scheduler;
     } misc;
+
+    struct AlbumCovers {
+        unsigned int memory_cache_size; //!< max total size in bytes of encoded covers kept in memory.
+        unsigned int disk_cache_size; //!< max total size in bytes of cover files in cache directory.
+        unsigned int resize_threads_count; //!< count of threads which scale and encode covers.
+        unsigned int jpeg_quality; //!< quality [1, 100] of JPEG encoding of scaled covers.
+        bool progressive_jpeg; //!< scaled covers are encoded as progressive JPEG.
+        bool fast_downscaling; //!< covers are downscaled by vectorized area averaging instead of FreeImage bicubic filter.
+
+        struct Size {
+            unsigned int width, height;
+            Size(unsigned int width, unsigned int height) : width(width), height(height) {}
+        };
+        std::vector<Size> pregenerated_sizes; //!< sizes of cover of playing track which are generated before clients request them.
+    } album_covers;
 };
 
 
@@ -80,6 +104,7 @@ private:
 
     void setDefaultLoggerSettings();
     void setDefaultHttpServerSettings();
+    void setDefaultAlbumCoversSettings();
 
     Settings settings_;
 };
@@ -0,0 +1,77 @@
+// Copyright (c) 2014, Alexey Ivanov
+
+#include "stdafx.h"
+#include "entry_ids_cache.h"
+
+namespace AimpRpcMethods
+{
+
+EntryIdsCache::EntryIdsCache(size_t memory_limit_bytes)
+    :
+    memory_limit_(memory_limit_bytes),
+    memory_usage_(0),
+    hits_(0),
+    misses_(0)
+{
+}
+
+size_t EntryIdsCache::memoryUsage(const std::string& key, const Representation& representation)
+{
+    return sizeof(Item) + key.size() * 2 // key is stored in map and in usage list.
+           + representation.rowids->capacity() * sizeof(RowIDs::value_type);
+}
+
+const EntryIdsCache::Representation* EntryIdsCache::find(const std::string& key, crc32_t playlist_crc32)
+{
+    auto it = items_.find(key);
+    if (it == items_.end()) {
+        ++misses_;
+        return nullptr;
+    }
+
+    if (it->second.representation.playlist_crc32 != playlist_crc32) { // playlist was changed, representation is obsolete.
+        erase(it);
+        ++misses_;
+        return nullptr;
+    }
+
+    usage_list_.splice(usage_list_.begin(), usage_list_, it->second.usage_it);
+    ++hits_;
+    return &it->second.representation;
+}
+
+const EntryIdsCache::Representation& EntryIdsCache::insert(const std::string& key, const Representation& representation)
+{
+    erase(key);
+
+    const size_t item_memory_usage = memoryUsage(key, representation);
+    // evict least recently used items to fit in memory limit.
+    while ( !usage_list_.empty() && memory_usage_ + item_memory_usage > memory_limit_ ) {
+        erase( items_.find( usage_list_.back() ) );
+    }
+
+    Item& item = items_[key];
+    item.representation = representation;
+    usage_list_.push_front(key);
+    item.usage_it = usage_list_.begin();
+    memory_usage_ += item_memory_usage;
+    // Note: item which does not fit in memory limit is stored anyway since it is used right now, it will be evicted by next insert().
+    return item.representation;
+}
+
+void EntryIdsCache::erase(const std::string& key)
+{
+    auto it = items_.find(key);
+    if (it != items_.end()) {
+        erase(it);
+    }
+}
+
+void EntryIdsCache::erase(Items::iterator it)
+{
+    memory_usage_ -= memoryUsage(it->first, it->second.representation);
+    usage_list_.erase(it->second.usage_it);
+    items_.erase(it);
+}
+
+} // namespace AimpRpcMethods
@@ -0,0 +1,85 @@
+// Copyright (c) 2014, Alexey Ivanov
+
+#pragma once
+
+#include "utils/util.h"
+#include "sqlite/sqlite.h"
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+#include <list>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace AimpRpcMethods
+{
+
+/*!
+    \brief LRU cache of GetPlaylistEntries representations(filtered and ordered lists of entries).
+           Representation is stored as list of PlaylistsEntries rowids, so paging through it requires only fetching of requested rows.
+           Cached representation is valid while CRC32 of playlist is not changed.
+           Total size of cached representations is limited by memory budget, least recently used ones are evicted first.
+*/
+class EntryIdsCache : boost::noncopyable
+{
+public:
+    typedef std::vector<sqlite3_int64> RowIDs;
+    typedef boost::shared_ptr<const RowIDs> RowIDs_ptr;
+
+    struct Representation
+    {
+        crc32_t playlist_crc32;
+        size_t total_entries_count; //!< count of entries in playlist before filtering.
+        RowIDs_ptr rowids; //!< rowids of found entries in order of representation. Streamed response keeps them after eviction.
+    };
+
+    explicit EntryIdsCache(size_t memory_limit_bytes);
+
+    /*!
+        \brief Returns cached representation or nullptr if it is not cached or was cached for other playlist CRC32.
+        \remark Returned pointer is valid until next insert() or erase() call.
+    */
+    const Representation* find(const std::string& key, crc32_t playlist_crc32);
+
+    //! Caches representation. Rowids are shared, not copied.
+    const Representation& insert(const std::string& key, const Representation& representation);
+
+    void erase(const std::string& key);
+
+    size_t hits() const
+        { return hits_; }
+    size_t misses() const
+        { return misses_; }
+    size_t memoryUsage() const
+        { return memory_usage_; }
+    size_t memoryLimit() const
+        { return memory_limit_; }
+    size_t size() const
+        { return items_.size(); }
+
+private:
+
+    typedef std::list<std::string> UsageList; // most recently used key is first.
+
+    struct Item
+    {
+        Representation representation;
+        UsageList::iterator usage_it;
+    };
+    typedef std::map<std::string, Item> Items;
+
+    static size_t memoryUsage(const std::string& key, const Representation& representation);
+
+    void erase(Items::iterator it);
+
+    Items items_;
+    UsageList usage_list_;
+
+    const size_t memory_limit_;
+    size_t memory_usage_;
+
+    size_t hits_,
+           misses_;
+};
+
+} // namespace AimpRpcMethods
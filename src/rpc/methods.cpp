@@ -13,23 +13,74 @@
 #include "rpc/exception.h"
 #include "rpc/value.h"
 #include "rpc/request_handler.h"
+#include "rpc/response_serializer.h"
+#include "rpc/entry_ids_cache.h"
 #include "utils/util.h"
 #include "utils/scope_guard.h"
 #include "utils/string_encoding.h"
 #include "utils/image.h"
 #include "utils/power_management.h"
+#include "album_cover/cover_provider.h"
+#include "http_server/request_handler.h"
+#include <algorithm>
 #include <fstream>
+#include <iterator>
+#include <limits>
+#include <sstream>
+#include <cctype>
+#include <memory>
 #include <boost/range.hpp>
 #include <boost/bind.hpp>
 #include <boost/assign/std.hpp>
 #include <boost/foreach.hpp>
 #include <boost/assign/std/vector.hpp>
+#include <boost/filesystem/fstream.hpp>
 #include <string.h>
 
 namespace {
 using namespace ControlPlugin::PluginLogger;
 ModuleLoggerType& logger()
     { return getLogManager().getModuleLogger<Rpc::RequestHandler>(); }
+
+const size_t kORDER_INDEX_CREATION_THRESHOLD = 3; // count of requests with the same order after which index for this order is created.
+const size_t kMAX_ORDER_INDEXES_COUNT = 8; // each index slows down entries loading, so limit count of on demand indexes.
+const size_t kENTRY_IDS_CACHE_MEMORY_LIMIT = 4 * 1024 * 1024; // 4 MB is enough for about 100 representations of playlist with 5000 entries.
+const size_t kMIN_STREAMED_ENTRIES_COUNT = 500; // less entries take few dozens Kb, they are sent in one piece with Content-Length.
+
+// Fills plan with 'detail' column of EXPLAIN QUERY PLAN output.
+void fillQueryPlan(sqlite3* db, const std::string& query, const Utilities::QueryArgSetters& query_arg_setters, Rpc::Value& plan) // throws std::runtime_error
+{
+    using namespace Utilities;
+
+    const std::string explain_query = "EXPLAIN QUERY PLAN " + query;
+    sqlite3_stmt* stmt = createStmt(db, explain_query);
+    ON_BLOCK_EXIT(&sqlite3_finalize, stmt);
+
+    size_t bind_index = 1;
+    BOOST_FOREACH(auto& setter, query_arg_setters) {
+        setter(stmt, bind_index++);
+    }
+
+    plan.setSize(0);
+    for(;;) {
+        const int rc_db = sqlite3_step(stmt);
+        if (SQLITE_ROW == rc_db) {
+            const size_t step_index = plan.size();
+            plan.setSize(step_index + 1);
+            const int kDETAIL_COLUMN_INDEX = 3;
+            const unsigned char* detail = sqlite3_column_text(stmt, kDETAIL_COLUMN_INDEX);
+            plan[step_index] = std::string( detail ? reinterpret_cast<const char*>(detail) : "" );
+        } else if (SQLITE_DONE == rc_db) {
+            break;
+        } else {
+            const std::string msg = MakeString() << "sqlite3_step() error "
+                                                 << rc_db << ": " << sqlite3_errmsg(db)
+                                                 << ". Query: " << explain_query;
+            throw std::runtime_error(msg);
+        }
+    }
+}
+
 }
 
 namespace AimpRpcMethods
@@ -406,12 +457,110 @@ struct Formatter {
     }
 };
 
+/*!
+    \brief Reads entries of representation row by row for streamed response of GetPlaylistEntries.
+           Method object serves other requests while response is sent, so source keeps its own copy of field setters and format string.
+*/
+class StreamedEntries : public Rpc::ArrayItemsSource
+{
+public:
+    typedef RpcValueSetHelpers::HelperFillRpcFields<PlaylistEntry>::RpcValueSetter RpcValueSetter;
+
+    //! \param query - selects columns of requested fields from PlaylistsEntries by rowid.
+    StreamedEntries(sqlite3* playlists_db, const std::string& query,
+                    EntryIdsCache::RowIDs_ptr rowids, size_t begin, size_t end,
+                    EntryIdsCache& entry_ids_cache, const std::string& cache_key
+                    ) // throws std::runtime_error
+        :
+        playlists_db_(playlists_db),
+        query_(query),
+        stmt_( Utilities::createStmt(playlists_db, query) ),
+        rowids_(rowids),
+        next_(begin),
+        end_(end),
+        entry_ids_cache_(entry_ids_cache),
+        cache_key_(cache_key)
+    {}
+
+    ~StreamedEntries()
+        { sqlite3_finalize(stmt_); }
+
+    //! Adds setter of next column of query.
+    void addSetter(const RpcValueSetter& setter)
+        { setters_.push_back(setter); }
+
+    //! Entry is filled by title formatted by AIMP instead of fields. Query must select playlist_id and entry_id.
+    void setFormatString(const AIMPManager& aimp_manager, const std::string& format_string)
+    {
+        format_string_ = format_string;
+        setters_.assign( 1, boost::bind<void>(Formatter(&aimp_manager, &format_string_), _1, _2, _3) );
+    }
+
+    bool next(Rpc::Value* entry) // throws std::runtime_error
+    {
+        using namespace Utilities;
+
+        while (next_ < end_) {
+            sqlite3_reset(stmt_);
+            const int rc_bind = sqlite3_bind_int64(stmt_, 1, (*rowids_)[next_++]);
+            if (SQLITE_OK != rc_bind) {
+                throw std::runtime_error(MakeString() << "Error sqlite3_bind_int64: " << rc_bind);
+            }
+
+            const int rc_db = sqlite3_step(stmt_);
+            if (SQLITE_ROW == rc_db) {
+                fillEntry(entry);
+                sqlite3_reset(stmt_); // do not keep read transaction open till next portion of response.
+                return true;
+            } else if (SQLITE_DONE == rc_db) {
+                // entry was deleted while response is sent or representation is obsolete(see GetPlaylistEntries::execute()).
+                // Part of response is already sent, so skip entry and let next request rebuild representation.
+                entry_ids_cache_.erase(cache_key_);
+            } else {
+                const std::string msg = MakeString() << "sqlite3_step() error "
+                                                     << rc_db << ": " << sqlite3_errmsg(playlists_db_)
+                                                     << ". Query: " << query_;
+                throw std::runtime_error(msg);
+            }
+        }
+        return false;
+    }
+
+private:
+
+    //! The same as HelperFillRpcFields::fillRpcArrayOfArrays() does.
+    void fillEntry(Rpc::Value* entry)
+    {
+        entry->setSize( setters_.size() );
+        for (size_t index = 0; index != setters_.size(); ++index) {
+            try {
+                setters_[index](stmt_, static_cast<int>(index), (*entry)[index]);
+            } catch (std::exception& e) {
+                AIMP_LOG_SEV(logger(), error) << "Error occured while filling AIMP entry field index " << index << ". Reason: " << e.what();
+                (*entry)[index] = std::string();
+            }
+        }
+    }
+
+    sqlite3* playlists_db_;
+    const std::string query_;
+    sqlite3_stmt* stmt_;
+    EntryIdsCache::RowIDs_ptr rowids_; // shared with cache, so representation is not copied.
+    size_t next_,
+           end_;
+    std::vector<RpcValueSetter> setters_;
+    std::string format_string_;
+    EntryIdsCache& entry_ids_cache_; // belongs to method object which lives as long as plugin.
+    const std::string cache_key_;
+};
+
 GetPlaylistEntries::GetPlaylistEntries(AIMPManager& aimp_manager,
                                        Rpc::RequestHandler& rpc_request_handler
                                        )
     :
     AIMPRPCMethod("GetPlaylistEntries", aimp_manager, rpc_request_handler),
     entry_fields_filler_("entry"),
+    order_indexes_count_(0),
     kRQST_KEY_FORMAT_STRING("format_string"),
     kRQST_KEY_FIELDS("fields"),
     kRQST_KEY_START_INDEX("start_index"),
@@ -428,7 +577,9 @@ GetPlaylistEntries::GetPlaylistEntries(AIMPManager& aimp_manager,
     kRSLT_KEY_FIELD_QUEUE_INDEX("queue_index"),
     kRQST_KEY_FIELD_FOLDER_NAME("foldername"),
     pagination_info_(nullptr),
-    queued_entries_mode_(false)
+    queued_entries_mode_(false),
+    query_plan_mode_(false),
+    entry_ids_cache_(kENTRY_IDS_CACHE_MEMORY_LIMIT)
 {
     using namespace RpcValueSetHelpers;
     using namespace RpcResultUtils;
@@ -540,9 +691,9 @@ void GetPlaylistEntries::initEntriesFiller(const Rpc::Value& params)
     }
 }
 
-std::string GetPlaylistEntries::getOrderString(const Rpc::Value& params) const
+GetPlaylistEntries::OrderFields GetPlaylistEntries::getOrderFields(const Rpc::Value& params) const
 {
-    std::string result;
+    OrderFields result;
     if (!queuedEntriesMode()) {
 	    if ( params.isMember(kRQST_KEY_ORDER_FIELDS) ) {        
             const Rpc::Value& entry_fields_to_order = params[kRQST_KEY_ORDER_FIELDS];
@@ -552,44 +703,64 @@ std::string GetPlaylistEntries::getOrderString(const Rpc::Value& params) const
                 const std::string& field_to_order = field_desc[kRQST_KEY_FIELD];
                 const auto supported_field_it = std::find(fields_to_order_.begin(), fields_to_order_.end(), field_to_order);
                 if ( supported_field_it != fields_to_order_.end() ) {
-                    if ( result.empty() ) {
-                        result = "ORDER BY ";
-                    }
-                    result += field_to_order;
-                    result += (field_desc[kRQST_KEY_ORDER_DIRECTION] == kDESCENDING_ORDER_STRING) ? " DESC," 
-                                                                                                  : " ASC,";
+                    OrderField order_field;
+                    order_field.column = fieldnames_rpc_to_db_.find(field_to_order)->second; // fieldnames_rpc_to_db_ contains all fields_to_order_.
+                    order_field.descending = field_desc[kRQST_KEY_ORDER_DIRECTION] == kDESCENDING_ORDER_STRING;
+                    result.push_back(order_field);
                 }
             }
-
-            if (!result.empty() && result.back() == ',') {
-                result.pop_back();
-            }
         }
 
         // by default order by index to have AIMP playlist's order.
-        if (result.empty()) {
-            result = "ORDER BY entry_index ASC";
-        }
+        // Index is also used as last order field: it is unique inside playlist, so order of entries is always strict. getEntryRank() relies on it.
+        OrderField order_field;
+        order_field.column = "entry_index";
+        order_field.descending = false;
+        result.push_back(order_field);
     } else {
-        result = "ORDER BY queue_index ASC";
+        OrderField order_field;
+        order_field.column = "queue_index";
+        order_field.descending = false;
+        result.push_back(order_field);
     }
     return result;
 }
 
-std::string GetPlaylistEntries::getLimitString(const Rpc::Value& params) const
+std::string GetPlaylistEntries::getOrderString(const OrderFields& order_fields)
 {
-    std::ostringstream os;
+    std::string result;
+    BOOST_FOREACH(const OrderField& order_field, order_fields) {
+        result += result.empty() ? "ORDER BY " : ",";
+        result += order_field.column;
+        result += order_field.descending ? " DESC" : " ASC";
+    }
+    return result;
+}
+
+GetPlaylistEntries::RowsRange GetPlaylistEntries::getRowsRange(const Rpc::Value& params) const
+{
+    RowsRange range = { 0, std::numeric_limits<size_t>::max() };
 	if ( params.isMember(kRQST_KEY_START_INDEX) && params.isMember(kRQST_KEY_ENTRIES_COUNT) ) {
         const int entries_count = params[kRQST_KEY_ENTRIES_COUNT];
         if (entries_count != -1) { // -1 is special value which means "all available items". Included to support jQuery Datatables 1.7.6.
             const int start_entry_index = params[kRQST_KEY_START_INDEX];
-	        os << "LIMIT " << start_entry_index << ',' << entries_count;
+            range.begin = static_cast<size_t>( std::max(start_entry_index, 0) );
+            range.end   = range.begin + static_cast<size_t>( std::max(entries_count, 0) );
         }
 
         if ( entryLocationDeterminationMode() ) {
             pagination_info_->entries_on_page_ = entries_count;
         }
     }
+    return range;
+}
+
+std::string GetPlaylistEntries::getLimitString(const RowsRange& rows_range) const
+{
+    std::ostringstream os;
+    if ( rows_range.end != std::numeric_limits<size_t>::max() ) {
+        os << "LIMIT " << rows_range.end - rows_range.begin << " OFFSET " << rows_range.begin;
+    }
     return os.str();
 }
 
@@ -597,15 +768,15 @@ std::string GetPlaylistEntries::getWhereString(const Rpc::Value& params, const i
 {
     using namespace Utilities;
 
-    struct LikeArgSetter : public std::binary_function<sqlite3_stmt*, int, void>
+    struct TextArgSetter : public std::binary_function<sqlite3_stmt*, int, void>
     {
         typedef std::string StringT;
-        StringT like_arg_;
-        LikeArgSetter(const StringT& like_arg) : like_arg_(like_arg) {}
+        StringT arg_;
+        TextArgSetter(const StringT& arg) : arg_(arg) {}
         void operator()(sqlite3_stmt* stmt, int bind_index) const {
             const int rc_db = sqlite3_bind_text(stmt, bind_index,
-                                                like_arg_.c_str(),
-                                                like_arg_.size() * sizeof(StringT::value_type),
+                                                arg_.c_str(),
+                                                arg_.size() * sizeof(StringT::value_type),
                                                 SQLITE_TRANSIENT);
             if (SQLITE_OK != rc_db) {
                 const std::string msg = MakeString() << "Error sqlite3_bind_text: " << rc_db;
@@ -622,9 +793,20 @@ std::string GetPlaylistEntries::getWhereString(const Rpc::Value& params, const i
 
 	if ( params.isMember(kRQST_KEY_SEARCH_STRING) ) {
         const std::string& search_string = params[kRQST_KEY_SEARCH_STRING];
-        if ( !search_string.empty() && !fields_to_filter_.empty() ) { ///??? search in all fields or only in requested ones.
+        if (   !queuedEntriesMode()
+            && AIMPPlayer::isEntriesSearchIndexAvailable(aimp_manager_)
+            )
+        {
+            // search by full text index: fields_to_filter_ are indexed by AIMPPlayer::createEntriesSearchIndex().
+            const std::string match_arg = AIMPPlayer::makeEntriesSearchIndexQuery(search_string);
+            if ( !match_arg.empty() ) {
+                query_arg_setters_.push_back( boost::bind<void>(TextArgSetter(match_arg), _1, _2) );
+                os << " AND PlaylistsEntries.rowid IN (SELECT docid FROM " << AIMPPlayer::kENTRIES_SEARCH_INDEX_TABLE
+                   << " WHERE " << AIMPPlayer::kENTRIES_SEARCH_INDEX_TABLE << " MATCH ?)";
+            }
+        } else if ( !search_string.empty() && !fields_to_filter_.empty() ) { ///??? search in all fields or only in requested ones.
             const std::string like_arg = '%' + search_string + '%';
-            const QueryArgSetter& setter = boost::bind<void>(LikeArgSetter(like_arg), _1, _2);
+            const QueryArgSetter& setter = boost::bind<void>(TextArgSetter(like_arg), _1, _2);
             
             if (!queuedEntriesMode()) {
                 os << " AND (";
@@ -675,10 +857,8 @@ std::string GetPlaylistEntries::getColumnsString() const
     return result;
 }
 
-size_t GetPlaylistEntries::getTotalEntriesCount(sqlite3* playlists_db, const int playlist_id) const
+std::string GetPlaylistEntries::getTotalEntriesCountQuery(const int playlist_id) const
 {
-    using namespace Utilities;
-
     std::ostringstream query;
     query << "SELECT COUNT(*) FROM ";
     if (!queuedEntriesMode()) {
@@ -686,10 +866,15 @@ size_t GetPlaylistEntries::getTotalEntriesCount(sqlite3* playlists_db, const int
     } else {
         query << "QueuedEntries";
     }
+    return query.str();
+}
 
-    sqlite3_stmt* stmt = createStmt( playlists_db,
-                                     query.str()
-                                    );
+size_t GetPlaylistEntries::getTotalEntriesCount(sqlite3* playlists_db, const int playlist_id) const
+{
+    using namespace Utilities;
+
+    const std::string query = getTotalEntriesCountQuery(playlist_id);
+    sqlite3_stmt* stmt = createStmt(playlists_db, query);
     ON_BLOCK_EXIT(&sqlite3_finalize, stmt);
 
     size_t total_entries_count = 0;
@@ -701,13 +886,170 @@ size_t GetPlaylistEntries::getTotalEntriesCount(sqlite3* playlists_db, const int
     } else {
         const std::string msg = MakeString() << "sqlite3_step() error "
                                              << rc_db << ": " << sqlite3_errmsg(playlists_db)
-                                             << ". Query: " << query.str();
+                                             << ". Query: " << query;
         throw std::runtime_error(msg);
     }
 
     return total_entries_count;
 }
 
+size_t GetPlaylistEntries::getCountOfFoundEntries(sqlite3* playlists_db, const std::string& table, const std::string& where_string) const
+{
+    using namespace Utilities;
+
+    // no ORDER BY and LIMIT: sqlite counts rows without sorting and without returning them.
+    const std::string query = MakeString() << "SELECT COUNT(*) FROM " << table << ' ' << where_string;
+    sqlite3_stmt* stmt = createStmt(playlists_db, query);
+    ON_BLOCK_EXIT(&sqlite3_finalize, stmt);
+
+    size_t bind_index = 1;
+    BOOST_FOREACH(auto& setter, query_arg_setters_) {
+        setter(stmt, bind_index++);
+    }
+
+	const int rc_db = sqlite3_step(stmt);
+    if (SQLITE_ROW != rc_db) {
+        const std::string msg = MakeString() << "sqlite3_step() error "
+                                             << rc_db << ": " << sqlite3_errmsg(playlists_db)
+                                             << ". Query: " << query;
+        throw std::runtime_error(msg);
+    }
+    return static_cast<size_t>( sqlite3_column_int64(stmt, 0) );
+}
+
+void GetPlaylistEntries::createOrderIndexOnDemand(sqlite3* playlists_db, const std::string& order_string)
+{
+    using namespace Utilities;
+
+    const std::string kORDER_BY("ORDER BY ");
+    if ( !boost::algorithm::starts_with(order_string, kORDER_BY) ) {
+        return;
+    }
+    const std::string order_columns = order_string.substr( kORDER_BY.size() );
+    if (order_columns == "entry_index ASC") {
+        return; // served by PlaylistsEntriesPlaylistIndex.
+    }
+
+    if (   ++order_usage_counts_[order_columns] != kORDER_INDEX_CREATION_THRESHOLD
+        || order_indexes_count_ >= kMAX_ORDER_INDEXES_COUNT
+        )
+    {
+        return;
+    }
+
+    // order columns are validated by getOrderString(), so they can be used in query directly.
+    std::string index_name = "PlaylistsEntriesOrder_" + order_columns;
+    BOOST_FOREACH(char& c, index_name) {
+        if ( !isalnum( static_cast<unsigned char>(c) ) ) {
+            c = '_';
+        }
+    }
+    const std::string query = MakeString() << "CREATE INDEX IF NOT EXISTS " << index_name
+                                           << " ON PlaylistsEntries (playlist_id," << order_columns << ")";
+
+    char* errmsg = nullptr;
+    const int rc_db = sqlite3_exec(playlists_db, query.c_str(), nullptr, nullptr, &errmsg);
+    if (SQLITE_OK != rc_db) {
+        AIMP_LOG_SEV(logger(), error) << "Order index creation failed in "__FUNCTION__". Reason: sqlite3_exec() error "
+                                       << rc_db << ": " << (errmsg ? errmsg : "")
+                                       << ". Query: " << query;
+        sqlite3_free(errmsg);
+        return;
+    }
+
+    ++order_indexes_count_;
+    AIMPPlayer::onPlaylistsDBSchemaChanged(aimp_manager_); // cached statements of manager are compiled for old schema.
+    AIMP_LOG_SEV(logger(), debug) << "Order index " << index_name << " is created";
+}
+
+namespace {
+std::string appendCondition(const std::string& where_string, const std::string& condition)
+{
+    return where_string.empty() ? "WHERE " + condition
+                                : where_string + " AND " + condition;
+}
+
+size_t selectCount(sqlite3* db, const std::string& query, const Utilities::QueryArgSetters& query_arg_setters) // throws std::runtime_error
+{
+    using namespace Utilities;
+
+    sqlite3_stmt* stmt = createStmt(db, query);
+    ON_BLOCK_EXIT(&sqlite3_finalize, stmt);
+
+    size_t bind_index = 1;
+    BOOST_FOREACH(auto& setter, query_arg_setters) {
+        setter(stmt, bind_index++);
+    }
+
+    const int rc_db = sqlite3_step(stmt);
+    if (SQLITE_ROW != rc_db) {
+        const std::string msg = MakeString() << "sqlite3_step() error "
+                                             << rc_db << ": " << sqlite3_errmsg(db)
+                                             << ". Query: " << query;
+        throw std::runtime_error(msg);
+    }
+    return static_cast<size_t>( sqlite3_column_int64(stmt, 0) );
+}
+} // namespace
+
+int GetPlaylistEntries::getEntryRank(sqlite3* playlists_db, const std::string& table, const std::string& where_string,
+                                     const OrderFields& order_fields, int entry_id
+                                     ) const
+{
+    using namespace Utilities;
+
+    struct EntryIdSetter : public std::binary_function<sqlite3_stmt*, int, void>
+    {
+        int entry_id_;
+        EntryIdSetter(int entry_id) : entry_id_(entry_id) {}
+        void operator()(sqlite3_stmt* stmt, int bind_index) const {
+            const int rc_db = sqlite3_bind_int(stmt, bind_index, entry_id_);
+            if (SQLITE_OK != rc_db) {
+                const std::string msg = MakeString() << "Error sqlite3_bind_int: " << rc_db;
+                throw std::runtime_error(msg);
+            }
+        }
+    };
+
+    const std::string target_where_string = appendCondition(where_string, "entry_id=?");
+    QueryArgSetters target_arg_setters = query_arg_setters_;
+    target_arg_setters.push_back( boost::bind<void>(EntryIdSetter(entry_id), _1, _2) );
+
+    // entry is not in current representation(for ex. it does not match search string).
+    if ( selectCount(playlists_db, MakeString() << "SELECT COUNT(*) FROM " << table << ' ' << target_where_string, target_arg_setters) == 0 ) {
+        return -1;
+    }
+
+    // Rank is count of entries which precede target entry in order: (f1 < key1) OR (f1 = key1 AND ((f2 < key2) OR (f2 = key2 AND ...))).
+    // Last order field is unique, see getOrderFields(), so equal keys are impossible.
+    // Cost is linear in rank: sqlite can not count index range without visiting it, see remark in declaration.
+    std::ostringstream keys,
+                       precede_condition;
+    for (size_t i = 0, size = order_fields.size(); i != size; ++i) {
+        const OrderField& field = order_fields[i];
+        keys << (i == 0 ? "" : ",") << field.column << " AS key" << i;
+
+        precede_condition << '(' << field.column << (field.descending ? " > " : " < ") << "target.key" << i;
+        if (i + 1 != size) {
+            precede_condition << " OR (" << field.column << " = target.key" << i << " AND ";
+        }
+    }
+    for (size_t i = 1, size = order_fields.size(); i != size; ++i) {
+        precede_condition << "))";
+    }
+    precede_condition << ')';
+
+    const std::string rank_query = MakeString() << "SELECT COUNT(*) FROM " << table << ", "
+                                                << "(SELECT " << keys.str() << " FROM " << table << ' ' << target_where_string << ") AS target "
+                                                << appendCondition(where_string, precede_condition.str());
+
+    // args of target subquery precede args of outer query in query text.
+    QueryArgSetters rank_arg_setters = target_arg_setters;
+    rank_arg_setters.insert( rank_arg_setters.end(), query_arg_setters_.begin(), query_arg_setters_.end() );
+
+    return static_cast<int>( selectCount(playlists_db, rank_query, rank_arg_setters) );
+}
+
 Rpc::ResponseType GetPlaylistEntries::execute(const Rpc::Value& root_request, Rpc::Value& root_response)
 {
     using namespace Utilities;
@@ -717,6 +1059,7 @@ Rpc::ResponseType GetPlaylistEntries::execute(const Rpc::Value& root_request, Rp
     ON_BLOCK_EXIT_OBJ(*this, &GetPlaylistEntries::deactivateEntryLocationDeterminationMode);
     ON_BLOCK_EXIT_OBJ(*this, &GetPlaylistEntries::deactivateQueuedEntriesMode);
     ON_BLOCK_EXIT_OBJ(*this, &GetPlaylistEntries::removeSpecialFieldsSupport);
+    ON_BLOCK_EXIT_OBJ(*this, &GetPlaylistEntries::deactivateQueryPlanMode);
 
     const Rpc::Value& params = root_request["params"];
 
@@ -739,19 +1082,91 @@ Rpc::ResponseType GetPlaylistEntries::execute(const Rpc::Value& root_request, Rp
 
     query_arg_setters_.clear();
 
-    std::ostringstream query_without_limit,
-                       query_with_limit;
-    query_without_limit << "SELECT " << getColumnsString() << " FROM "
-                        << (!queuedEntriesMode() ? "PlaylistsEntries" : "QueuedEntries")
-                        << ' '   
-                        << getWhereString(params, playlist_id) << ' ' 
-                        << getOrderString(params);
-    query_with_limit << query_without_limit.str() << ' '
-                     << getLimitString(params);
+    sqlite3* playlists_db = AIMPPlayer::getPlaylistsDB(aimp_manager_);
 
-    const std::string query = !entryLocationDeterminationMode() ? query_with_limit.str() : query_without_limit.str();
+    const OrderFields order_fields = getOrderFields(params);
+    const std::string order_string = getOrderString(order_fields);
+    if ( !queuedEntriesMode() && !queryPlanMode() ) {
+        createOrderIndexOnDemand(playlists_db, order_string);
+    }
+
+    // Requested page is selected by LIMIT/OFFSET, so sqlite stops stepping after its last row.
+    // Count of found entries is taken by separate COUNT query.
+    const std::string table = !queuedEntriesMode() ? "PlaylistsEntries" : "QueuedEntries";
+    const std::string where_string = getWhereString(params, playlist_id);
+    const RowsRange rows_range = getRowsRange(params);
+    std::ostringstream query_stream;
+    query_stream << "SELECT " << getColumnsString() << " FROM "
+                 << table
+                 << ' '   
+                 << where_string << ' ' 
+                 << order_string << ' '
+                 << getLimitString(rows_range);
+    const std::string query = query_stream.str();
+
+    if ( entryLocationDeterminationMode() ) {
+        pagination_info_->entry_index_in_current_representation_ = getEntryRank(playlists_db, table, where_string, order_fields, pagination_info_->entry_id);
+        return RESPONSE_IMMEDIATE;
+    }
+
+    if ( queryPlanMode() ) {
+        Rpc::Value& rpc_result = root_response["result"];
+        rpc_result["query"] = query;
+        fillQueryPlan(playlists_db, query, query_arg_setters_, rpc_result["query_plan"]);
+        const std::string total_entries_count_query = getTotalEntriesCountQuery(playlist_id);
+        rpc_result["total_entries_count_query"] = total_entries_count_query;
+        fillQueryPlan(playlists_db, total_entries_count_query, Utilities::QueryArgSetters(), rpc_result["total_entries_count_query_plan"]);
+        Rpc::Value& cache_info = rpc_result["entry_ids_cache"];
+        cache_info["hits"]         = entry_ids_cache_.hits();
+        cache_info["misses"]       = entry_ids_cache_.misses();
+        cache_info["size"]         = entry_ids_cache_.size();
+        cache_info["memory_usage"] = entry_ids_cache_.memoryUsage();
+        cache_info["memory_limit"] = entry_ids_cache_.memoryLimit();
+        return RESPONSE_IMMEDIATE;
+    }
+
+    Rpc::Value& rpc_result = root_response["result"];
+    Rpc::Value& rpcvalue_entries  = rpc_result[kRSLT_KEY_ENTRIES];
+    rpcvalue_entries.setSize(0); // return zero-length array, not null if no entires found.
+
+    if ( !queuedEntriesMode() ) {
+        // Representation does not depend on requested fields, so they are not part of key.
+        std::string cache_key = where_string + '\n' + order_string;
+        if ( params.isMember(kRQST_KEY_SEARCH_STRING) ) {
+            const std::string& search_string = params[kRQST_KEY_SEARCH_STRING];
+            cache_key += '\n';
+            cache_key += search_string;
+        }
+
+        for (int attempt = 0; ; ++attempt) {
+            const EntryIdsCache::Representation& representation = getRepresentation(playlists_db, cache_key, playlist_id, where_string, order_string);
+            const size_t begin = std::min(rows_range.begin, representation.rowids->size()),
+                         end   = std::min(rows_range.end,   representation.rowids->size());
+            if ( end - begin >= kMIN_STREAMED_ENTRIES_COUNT && rpc_request_handler_.streamingAvailable() ) {
+                // entries are read from DB and sent by portions, so memory used by response does not depend on playlist size.
+                rpc_request_handler_.streamArray( kRSLT_KEY_ENTRIES,
+                                                  createStreamedEntries(playlists_db, cache_key, representation.rowids, begin, end, params)
+                                                 );
+                rpc_result[kRSLT_KEY_TOTAL_ENTRIES_COUNT]    = representation.total_entries_count;
+                rpc_result[kRSLT_KEY_COUNT_OF_FOUND_ENTRIES] = representation.rowids->size();
+                break;
+            }
+
+            if ( fillEntries(playlists_db, *representation.rowids, rows_range, rpcvalue_entries) ) {
+                rpc_result[kRSLT_KEY_TOTAL_ENTRIES_COUNT]    = representation.total_entries_count;
+                rpc_result[kRSLT_KEY_COUNT_OF_FOUND_ENTRIES] = representation.rowids->size();
+                break;
+            }
+
+            // entry was replaced by entry with the same content, so playlist crc32 was not changed. Rebuild representation.
+            entry_ids_cache_.erase(cache_key);
+            if (attempt > 0) {
+                throw std::runtime_error(MakeString() << "Entries of just built representation of playlist " << playlist_id << " are not found in "__FUNCTION__);
+            }
+        }
+        return RESPONSE_IMMEDIATE;
+    }
 
-    sqlite3* playlists_db = AIMPPlayer::getPlaylistsDB(aimp_manager_);
     sqlite3_stmt* stmt = createStmt( playlists_db, query.c_str() );
     ON_BLOCK_EXIT(&sqlite3_finalize, stmt);
 
@@ -772,55 +1187,131 @@ Rpc::ResponseType GetPlaylistEntries::execute(const Rpc::Value& root_request, Rp
     }
 #endif
 
-    if ( !entryLocationDeterminationMode() ) {
-        Rpc::Value& rpc_result = root_response["result"];
-        Rpc::Value& rpcvalue_entries  = rpc_result[kRSLT_KEY_ENTRIES];
-        rpcvalue_entries.setSize(0); // return zero-length array, not null if no entires found.
+    size_t entry_index = 0;
+    for(;;) {
+	    int rc_db = sqlite3_step(stmt);
+        if (SQLITE_ROW == rc_db) {
+            rpcvalue_entries.setSize(entry_index + 1); /// TODO: if possible resize array full count of found rows before filling.
+            Rpc::Value& entry_rpcvalue = rpcvalue_entries[entry_index];
+            // fill all requested fields for entry.
+            entry_fields_filler_.fillRpcArrayOfArrays(stmt, entry_rpcvalue);
+            ++entry_index;
+        } else if (SQLITE_DONE == rc_db) {
+            break;
+        } else {
+            const std::string msg = MakeString() << "sqlite3_step() error "
+                                                 << rc_db << ": " << sqlite3_errmsg(playlists_db)
+                                                 << ". Query: " << query;
+            throw std::runtime_error(msg);
+	    }
+    }
 
-        size_t entry_index = 0;
-        for(;;) {
-		    int rc_db = sqlite3_step(stmt);
-            if (SQLITE_ROW == rc_db) {
-                rpcvalue_entries.setSize(entry_index + 1); /// TODO: if possible resize array full count of found rows before filling.
-                Rpc::Value& entry_rpcvalue = rpcvalue_entries[entry_index];
-                // fill all requested fields for entry.
-                entry_fields_filler_.fillRpcArrayOfArrays(stmt, entry_rpcvalue);
-                ++entry_index;
-            } else if (SQLITE_DONE == rc_db) {
-                break;
-            } else {
-                const std::string msg = MakeString() << "sqlite3_step() error "
-                                                     << rc_db << ": " << sqlite3_errmsg(playlists_db)
-                                                     << ". Query: " << query;
-                throw std::runtime_error(msg);
-		    }
+    rpc_result[kRSLT_KEY_TOTAL_ENTRIES_COUNT]    = getTotalEntriesCount(playlists_db, playlist_id);
+    rpc_result[kRSLT_KEY_COUNT_OF_FOUND_ENTRIES] = getCountOfFoundEntries(playlists_db, table, where_string);
+
+    return RESPONSE_IMMEDIATE;
+}
+
+const EntryIdsCache::Representation& GetPlaylistEntries::getRepresentation(sqlite3* playlists_db, const std::string& cache_key, const int playlist_id,
+                                                                          const std::string& where_string, const std::string& order_string
+                                                                          )
+{
+    using namespace Utilities;
+
+    const crc32_t playlist_crc32 = aimp_manager_.getPlaylistCRC32(playlist_id);
+    if ( const EntryIdsCache::Representation* cached_representation = entry_ids_cache_.find(cache_key, playlist_crc32) ) {
+        return *cached_representation;
+    }
+
+    const std::string query = MakeString() << "SELECT PlaylistsEntries.rowid FROM PlaylistsEntries " << where_string << ' ' << order_string;
+    sqlite3_stmt* stmt = createStmt(playlists_db, query);
+    ON_BLOCK_EXIT(&sqlite3_finalize, stmt);
+
+    size_t bind_index = 1;
+    BOOST_FOREACH(auto& setter, query_arg_setters_) {
+        setter(stmt, bind_index++);
+    }
+
+    boost::shared_ptr<EntryIdsCache::RowIDs> rowids = boost::make_shared<EntryIdsCache::RowIDs>();
+    for(;;) {
+        const int rc_db = sqlite3_step(stmt);
+        if (SQLITE_ROW == rc_db) {
+            rowids->push_back( sqlite3_column_int64(stmt, 0) );
+        } else if (SQLITE_DONE == rc_db) {
+            break;
+        } else {
+            const std::string msg = MakeString() << "sqlite3_step() error "
+                                                 << rc_db << ": " << sqlite3_errmsg(playlists_db)
+                                                 << ". Query: " << query;
+            throw std::runtime_error(msg);
         }
+    }
 
-        rpc_result[kRSLT_KEY_TOTAL_ENTRIES_COUNT]    = getTotalEntriesCount(playlists_db, playlist_id);
-        rpc_result[kRSLT_KEY_COUNT_OF_FOUND_ENTRIES] = getRowsCount(playlists_db, query_without_limit.str(), &query_arg_setters_);
-    } else {
-        size_t entry_index = 0;
-        for(;;) {
-		    int rc_db = sqlite3_step(stmt);
-            if (SQLITE_ROW == rc_db) {
-                const int entry_id = sqlite3_column_int(stmt, pagination_info_->id_field_index);
-                if (pagination_info_->entry_id == entry_id) {
-                    pagination_info_->entry_index_in_current_representation_ = entry_index;
-                    break;
-                }                
-                ++entry_index;
-            } else if (SQLITE_DONE == rc_db) {
-                break;
-            } else {
-                const std::string msg = MakeString() << "sqlite3_step() error "
-                                                     << rc_db << ": " << sqlite3_errmsg(playlists_db)
-                                                     << ". Query: " << query;
-                throw std::runtime_error(msg);
-		    }
+    EntryIdsCache::Representation representation;
+    representation.playlist_crc32 = playlist_crc32;
+    representation.total_entries_count = getTotalEntriesCount(playlists_db, playlist_id);
+    representation.rowids = rowids;
+    return entry_ids_cache_.insert(cache_key, representation);
+}
+
+bool GetPlaylistEntries::fillEntries(sqlite3* playlists_db, const EntryIdsCache::RowIDs& rowids, const RowsRange& rows_range, Rpc::Value& rpcvalue_entries)
+{
+    using namespace Utilities;
+
+    const size_t begin = std::min(rows_range.begin, rowids.size()),
+                 end   = std::min(rows_range.end,   rowids.size());
+
+    rpcvalue_entries.setSize(0); // drop entries filled from obsolete representation.
+    rpcvalue_entries.setSize(end - begin);
+    if (begin == end) {
+        return true;
+    }
+
+    const std::string query = MakeString() << "SELECT " << getColumnsString() << " FROM PlaylistsEntries WHERE rowid=?";
+    sqlite3_stmt* stmt = createStmt(playlists_db, query);
+    ON_BLOCK_EXIT(&sqlite3_finalize, stmt);
+
+    for (size_t i = begin; i != end; ++i) {
+        sqlite3_reset(stmt);
+        const int rc_bind = sqlite3_bind_int64(stmt, 1, rowids[i]);
+        if (SQLITE_OK != rc_bind) {
+            throw std::runtime_error(MakeString() << "Error sqlite3_bind_int64: " << rc_bind);
+        }
+
+        const int rc_db = sqlite3_step(stmt);
+        if (SQLITE_ROW == rc_db) {
+            // fill all requested fields for entry.
+            entry_fields_filler_.fillRpcArrayOfArrays(stmt, rpcvalue_entries[i - begin]);
+        } else if (SQLITE_DONE == rc_db) {
+            return false; // entry does not exist anymore.
+        } else {
+            const std::string msg = MakeString() << "sqlite3_step() error "
+                                                 << rc_db << ": " << sqlite3_errmsg(playlists_db)
+                                                 << ". Query: " << query;
+            throw std::runtime_error(msg);
         }
     }
+    return true;
+}
 
-    return RESPONSE_IMMEDIATE;
+boost::shared_ptr<Rpc::ArrayItemsSource> GetPlaylistEntries::createStreamedEntries(sqlite3* playlists_db, const std::string& cache_key,
+                                                                                 EntryIdsCache::RowIDs_ptr rowids, size_t begin, size_t end,
+                                                                                 const Rpc::Value& params
+                                                                                 )
+{
+    using namespace Utilities;
+
+    const std::string query = MakeString() << "SELECT " << getColumnsString() << " FROM PlaylistsEntries WHERE rowid=?";
+    boost::shared_ptr<StreamedEntries> entries( new StreamedEntries(playlists_db, query, rowids, begin, end, entry_ids_cache_, cache_key) );
+    if ( params.isMember(kRQST_KEY_FORMAT_STRING) ) {
+        // setter of format string refers to request params which do not live till response is sent.
+        entries->setFormatString(aimp_manager_, params[kRQST_KEY_FORMAT_STRING]);
+    } else {
+        BOOST_FOREACH(auto& setter_it, entry_fields_filler_.setters_required_) {
+            entries->addSetter(setter_it->second);
+        }
+    }
+    return entries;
 }
 
 GetEntryPositionInDataTable::GetEntryPositionInDataTable(AIMPManager& aimp_manager,
@@ -829,36 +1320,18 @@ GetEntryPositionInDataTable::GetEntryPositionInDataTable(AIMPManager& aimp_manag
                                                          )
     :
     AIMPRPCMethod("GetEntryPositionInDataTable", aimp_manager, rpc_request_handler),
-    getplaylistentries_method_(getplaylistentries_method),
-    kFIELD_ID("id")
+    getplaylistentries_method_(getplaylistentries_method)
 {
 }
 
 Rpc::ResponseType GetEntryPositionInDataTable::execute(const Rpc::Value& root_request, Rpc::Value& root_response)
 {
-    Rpc::Value root_request_copy = root_request;
-
-    Rpc::Value& rpc_params = root_request_copy["params"];
+    const Rpc::Value& rpc_params = root_request["params"];
     const PlaylistEntryID track_id(rpc_params["track_id"]);
 
-    int id_field_index = -1;
-    Rpc::Value& fields = rpc_params["fields"];
-    for (int i = 0, end = fields.size(); i != end; ++i) {
-        const std::string& field = fields[i];
-        if (field == kFIELD_ID) {
-            id_field_index = i;
-            break;
-        }
-    }
-    if (id_field_index < 0) {
-        id_field_index = fields.size();
-        fields.setSize(id_field_index + 1);
-        fields[id_field_index] = kFIELD_ID;
-    }
-
-    PaginationInfo pagination_info(track_id, id_field_index);
+    PaginationInfo pagination_info(track_id);
     getplaylistentries_method_.activateEntryLocationDeterminationMode(&pagination_info);
-    getplaylistentries_method_.execute(root_request_copy, root_response);
+    getplaylistentries_method_.execute(root_request, root_response);
 
     const size_t entries_on_page = pagination_info.entries_on_page_;
     const int entry_index_in_current_representation = pagination_info.entry_index_in_current_representation_;
@@ -896,6 +1369,22 @@ Rpc::ResponseType GetQueuedEntries::execute(const Rpc::Value& root_request, Rpc:
     throw Rpc::Exception("Not supported by this version of AIMP", METHOD_NOT_FOUND_ERROR);
 }
 
+GetPlaylistEntriesQueryPlan::GetPlaylistEntriesQueryPlan(AIMPManager& aimp_manager,
+                                                         Rpc::RequestHandler& rpc_request_handler,
+                                                         GetPlaylistEntries& getplaylistentries_method
+                                                         )
+    :
+    AIMPRPCMethod("GetPlaylistEntriesQueryPlan", aimp_manager, rpc_request_handler),
+    getplaylistentries_method_(getplaylistentries_method)
+{
+}
+
+Rpc::ResponseType GetPlaylistEntriesQueryPlan::execute(const Rpc::Value& root_request, Rpc::Value& root_response)
+{
+    getplaylistentries_method_.activateQueryPlanMode();
+    return getplaylistentries_method_.execute(root_request, root_response);
+}
+
 ResponseType GetPlaylistEntriesCount::execute(const Rpc::Value& root_request, Rpc::Value& root_response)
 {
     const Rpc::Value& params = root_request["params"];
@@ -992,192 +1481,39 @@ ResponseType GetCover::execute(const Rpc::Value& root_request, Rpc::Value& root_
         cover_width = cover_height = 0; // by default request full size cover.
     }
 
-    Cache::SearchResult cache_search_result = cache_.isCoverCachedForCurrentTrack(track_desc, cover_width, cover_height);
-    fs::wpath album_cover_filename;
-    if (!cache_search_result) {
-        if (aimp_manager_.isCoverImageFileExist(track_desc, &album_cover_filename)) {
-            cache_search_result = cache_.isCoverCachedForAnotherTrack(album_cover_filename, cover_width, cover_height);
-            if (cache_search_result) {
-                cache_.cacheBasedOnPreviousResult(track_desc, cache_search_result);    
-            }
-        }
-    }
-    
-    if (cache_search_result) {
-        // picture already exists.
-        try {
-            auto uri_it = cache_search_result.entry->filenames->begin();
-            std::advance(uri_it, cache_search_result.uri_index);
-            root_response["result"]["album_cover_uri"] = StringEncoding::utf16_to_utf8(*uri_it);
-        } catch (StringEncoding::EncodingError&) {
-            throw Rpc::Exception("Getting cover failed. Reason: encoding to UTF-8 failed.", ALBUM_COVER_LOAD_FAILED);
-        }
-        return RESPONSE_IMMEDIATE;
-    }
-
-    // save cover to temp directory with unique filename.
-    boost::filesystem::wpath cover_uri (cover_directory_relative_ / getTempFileNameForAlbumCover(track_desc, cover_width, cover_height));
-    cover_uri.replace_extension(L".jpg");
-
-    boost::filesystem::wpath temp_unique_filename (document_root_ / cover_uri);
-
-    const bool album_cover_image_file_exists = !album_cover_filename.empty();
+    DelayedResponseSender_ptr delayed_response_sender = rpc_request_handler_.getDelayedResponseSender();
+    assert(delayed_response_sender != nullptr);
 
+    std::wstring name;
     try {
-        if (   (cover_width == 0 && cover_height == 0) // use direct copy only if no scaling is requested.
-            && album_cover_image_file_exists
+        if ( !cover_provider_.getCover( track_desc, cover_width, cover_height, &name,
+                                        boost::bind(&GetCover::onCoverRendered, cover_directory_relative_.native(), root_request, delayed_response_sender, _1, _2)
+                                       )
             )
         {
-            cover_uri.replace_extension           (album_cover_filename.extension());
-            temp_unique_filename.replace_extension(album_cover_filename.extension());
-
-            fs::copy_file(album_cover_filename, temp_unique_filename);
-        } else {
-            if (!free_image_dll_is_available_) {
-                Rpc::Exception e("Getting cover failed. Reason: FreeImage DLLs are not available.", ALBUM_COVER_LOAD_FAILED);
-                BOOST_LOG_SEV(logger(), error) << "Getting cover failed in "__FUNCTION__ << ". Reason: " << e.message();
-                throw e;
-            }
-            aimp_manager_.saveCoverToFile(track_desc, temp_unique_filename.native(), cover_width, cover_height);
+            return RESPONSE_DELAYED;
         }
-
-        const std::wstring& cover_uri_generic = cover_uri.generic_wstring();
-        root_response["result"]["album_cover_uri"] = StringEncoding::utf16_to_utf8(cover_uri_generic);
-
-        cache_.cacheNew(track_desc, album_cover_filename, cover_uri_generic);
-
-    } catch (fs::filesystem_error& e) {
-        BOOST_LOG_SEV(logger(), error) << "Getting cover failed in "__FUNCTION__ << ". Reason: " << e.what();
-        throw Rpc::Exception("Getting cover failed. Reason: bad temporary directory for store covers.", ALBUM_COVER_LOAD_FAILED);
     } catch (std::exception& e) {
-        BOOST_LOG_SEV(logger(), error) << "Getting cover failed in "__FUNCTION__ << ". Reason: " << e.what();
+        AIMP_LOG_SEV(logger(), error) << "Getting cover failed in "__FUNCTION__ << ". Reason: " << e.what();
         throw Rpc::Exception("Getting cover failed. Reason: album cover extraction or saving error.", ALBUM_COVER_LOAD_FAILED);
     }
-    return RESPONSE_IMMEDIATE;
-}
-
-void remove_read_only_attribute(const fs::wpath& path);
-
-void GetCover::prepare_cover_directory() // throws runtime_error
-{
-    namespace fs = boost::filesystem;
-    using namespace Utilities;
-
-    try {
-        // cleare cache before using.
-        const fs::wpath& cover_dir = cover_directory();
-
-        if (fs::exists(cover_dir)) {
-            remove_read_only_attribute(cover_dir);
-            fs::remove_all(cover_dir);
-        }
-    
-        // create cache directory
-        fs::create_directory(cover_dir);
-    } catch (fs::filesystem_error& e) {
-        throw std::runtime_error( MakeString() << "album cover cache directory preparation failure. Reason: " << e.what() );
-    }
-}
 
-void remove_read_only_attribute(const fs::wpath& path)
-{
-    const auto path_native = path.native();
-    if (!SetFileAttributes(path_native.c_str(), GetFileAttributes(path_native.c_str()) & ~FILE_ATTRIBUTE_READONLY)) {
-        throw std::runtime_error(Utilities::MakeString() << "Fail to remove read-only attribute from file " << path_native.c_str() << ". Reason: " << GetLastError());
-    }
-}
-
-void GetCover::Cache::cacheNew(TrackDescription track_desc, const fs::wpath& album_cover_filename, const std::wstring& cover_uri_generic)
-{
-    Entry& entry = entries_[track_desc];
-    if (!album_cover_filename.empty()) {
-        path_track_map_.insert( std::make_pair(album_cover_filename, track_desc) );
-    }
-
-    if (!entry.filenames) {
-        entry.filenames = boost::make_shared<Entry::Filenames>();
-    }
-    entry.filenames->push_back(cover_uri_generic); 
-}
-
-void GetCover::Cache::cacheBasedOnPreviousResult(TrackDescription track_desc, GetCover::Cache::SearchResult search_result)
-{
-    Entry& entry = entries_[track_desc];
-    entry.filenames = search_result.entry->filenames;
-}
-
-GetCover::Cache::SearchResult GetCover::Cache::isCoverCachedForCurrentTrack(TrackDescription track_desc, std::size_t width, std::size_t height) const
-{
-    // search in map current file covers of different sizes.
-    const auto entry_it = entries_.find(track_desc);
-    if (entries_.end() != entry_it) {
-        if ( Cache::SearchResult r = findInEntryBySize(entry_it->second, width, height) ) {
-            return r;
-        }
-    }
-
-    return Cache::SearchResult();
-}
-
-GetCover::Cache::SearchResult GetCover::Cache::isCoverCachedForAnotherTrack(const boost::filesystem::wpath& cover_path, std::size_t width, std::size_t height) const
-{
-    // search in other cached track covers.
-    assert(!cover_path.empty());
-
-    auto track_it = path_track_map_.find(cover_path);
-    if (path_track_map_.end() != track_it) {
-        return isCoverCachedForCurrentTrack(track_it->second, width, height);
-    } 
-
-    return Cache::SearchResult();
+    root_response["result"]["album_cover_uri"] = StringEncoding::utf16_to_utf8( (cover_directory_relative_ / name).generic_wstring() );
+    return RESPONSE_IMMEDIATE;
 }
 
-GetCover::Cache::SearchResult GetCover::Cache::findInEntryBySize(const Entry& cache_info, std::size_t width, std::size_t height) const
+void GetCover::onCoverRendered(const std::wstring& cover_directory_uri, const Rpc::Value& root_request, DelayedResponseSender_ptr sender,
+                               const std::wstring& name, const std::string& error)
 {
-    //! search first entry of string "widthxheight" in filename string.
-    struct MatchSize {
-        MatchSize(std::size_t width, std::size_t height) {
-            std::wostringstream s;
-            s << width << "x" << height;
-            string_to_find_ = s.str();
-        }
-
-        bool operator()(const std::wstring& filename) const
-            { return filename.find(string_to_find_) != std::wstring::npos; }
-
-        std::wstring string_to_find_;
-    };
-
-    const Entry::Filenames& names = *cache_info.filenames;
-    // search in filenames.
-    const auto filename_iter = std::find_if( names.begin(), names.end(), MatchSize(width, height) );
-    if (names.end() != filename_iter) {
-        // return pointer to found filename.
-        return SearchResult(&cache_info, std::distance(names.begin(), filename_iter));
+    if ( !error.empty() ) {
+        sender->sendResponseFault(root_request, "Getting cover failed. Reason: album cover extraction or saving error.", ALBUM_COVER_LOAD_FAILED);
+        return;
     }
 
-    return SearchResult();
-}
-
-std::wstring GetCover::getTempFileNameForAlbumCover(TrackDescription track_desc, std::size_t width, std::size_t height)
-{
-    struct RandomDigitCharGenerator {
-        RandomNumbersGenerator* gen_;
-
-        RandomDigitCharGenerator(RandomNumbersGenerator* gen)
-            : gen_(gen)
-        {}
-
-        wchar_t operator()() const
-            { return static_cast<wchar_t>( L'0' + (*gen_)() ); }
-    };
-
-    // generate random part;
-    std::generate(random_file_part_.begin(), random_file_part_.end(), RandomDigitCharGenerator(&die_) );
-
-    std::wostringstream filename;
-    filename << L"cover_" << track_desc.playlist_id << "_" << track_desc.track_id << L"_" << width << "x" << height << "_" << random_file_part_;
-    return filename.str();
+    Rpc::Value response;
+    response["result"]["album_cover_uri"] = StringEncoding::utf16_to_utf8( ( fs::wpath(cover_directory_uri) / name ).generic_wstring() );
+    response["id"] = root_request["id"];
+    sender->sendResponseSuccess(response);
 }
 
 SubscribeOnAIMPStateUpdateEvent::EVENTS SubscribeOnAIMPStateUpdateEvent::getEventFromRpcParams(const Rpc::Value& params) const
@@ -1200,6 +1536,9 @@ ResponseType SubscribeOnAIMPStateUpdateEvent::execute(const Rpc::Value& root_req
 
     DelayedResponseSender_ptr comet_delayed_response_sender = rpc_request_handler_.getDelayedResponseSender();
     assert(comet_delayed_response_sender != nullptr);
+    if ( !comet_delayed_response_sender->admitSubscription() ) {
+        throw Rpc::Exception("Too many pending subscriptions", TOO_MANY_SUBSCRIPTIONS);
+    }
     delayed_response_sender_descriptors_.insert( std::make_pair(event_id,
                                                                 ResponseSenderDescriptor(root_request, comet_delayed_response_sender)
                                                                 )
@@ -1208,6 +1547,27 @@ ResponseType SubscribeOnAIMPStateUpdateEvent::execute(const Rpc::Value& root_req
     return RESPONSE_DELAYED;
 }
 
+bool SubscribeOnAIMPStateUpdateEvent::addEventStream(const std::vector<std::string>& events, Http::IEventStream_ptr stream)
+{
+    removeClosedEventStreams(); // events may not occur for long time, so descriptors of disconnected clients are dropped here too.
+
+    EventStreamDescriptor descriptor = { stream, 0 };
+    BOOST_FOREACH(const std::string& event, events) {
+        const auto iter = event_types_.find(event);
+        if ( iter == event_types_.end() ) {
+            return false;
+        }
+        descriptor.events_mask |= 1 << iter->second;
+    }
+
+    if (descriptor.events_mask == 0) {
+        return false;
+    }
+
+    event_streams_.push_back(descriptor);
+    return true;
+}
+
 void SubscribeOnAIMPStateUpdateEvent::prepareResponse(EVENTS event_id, Rpc::Value& result) const
 {
     switch (event_id)
@@ -1231,7 +1591,7 @@ void SubscribeOnAIMPStateUpdateEvent::prepareResponse(EVENTS event_id, Rpc::Valu
         break;
     default:
         assert(!"Unsupported event ID in "__FUNCTION__);
-        BOOST_LOG_SEV(logger(), error) << "Unsupported event ID " << event_id << " in "__FUNCTION__;
+        AIMP_LOG_SEV(logger(), error) << "Unsupported event ID " << event_id << " in "__FUNCTION__;
     }
 }
 
@@ -1240,68 +1600,167 @@ void SubscribeOnAIMPStateUpdateEvent::aimpEventHandler(AIMPManager::EVENTS event
     switch (event)
     {
     case AIMPManager::EVENT_TRACK_POS_CHANGED: // it's sent with period 1 second in AIMP2, useless.
-        sendNotifications(CONTROL_PANEL_STATE_CHANGE_EVENT);
+        scheduleNotifications(CONTROL_PANEL_STATE_CHANGE_EVENT);
         break;
     case AIMPManager::EVENT_PLAY_FILE: // it's sent when playback started.
-        sendNotifications(CURRENT_TRACK_CHANGE_EVENT);
-        sendNotifications(CONTROL_PANEL_STATE_CHANGE_EVENT);
+        scheduleNotifications(CURRENT_TRACK_CHANGE_EVENT);
+        scheduleNotifications(CONTROL_PANEL_STATE_CHANGE_EVENT);
         break;
     case AIMPManager::EVENT_PLAYER_STATE:
-        sendNotifications(PLAYBACK_STATE_CHANGE_EVENT);
-        sendNotifications(CONTROL_PANEL_STATE_CHANGE_EVENT);
+        scheduleNotifications(PLAYBACK_STATE_CHANGE_EVENT);
+        scheduleNotifications(CONTROL_PANEL_STATE_CHANGE_EVENT);
         break;
     case AIMPManager::EVENT_PLAYLISTS_CONTENT_CHANGE:
-        sendNotifications(PLAYLISTS_CONTENT_CHANGE_EVENT);
+        scheduleNotifications(PLAYLISTS_CONTENT_CHANGE_EVENT);
         // if internet radio is playing and track is changed we must notify about it.
         if (   aimp_manager_.getPlaybackState() != AIMPManager::STOPPED
             && aimp_manager_.getStatus(AIMPManager::STATUS_LENGTH) == 0
             ) 
         {
-            sendNotifications(CURRENT_TRACK_CHANGE_EVENT);
-            sendNotifications(CONTROL_PANEL_STATE_CHANGE_EVENT); // send notification about more general event than CURRENT_TRACK_CHANGE_EVENT, since web-client do not use CURRENT_TRACK_CHANGE_EVENT.
+            scheduleNotifications(CURRENT_TRACK_CHANGE_EVENT);
+            scheduleNotifications(CONTROL_PANEL_STATE_CHANGE_EVENT); // send notification about more general event than CURRENT_TRACK_CHANGE_EVENT, since web-client do not use CURRENT_TRACK_CHANGE_EVENT.
         }
         break;
     case AIMPManager::EVENT_TRACK_PROGRESS_CHANGED_DIRECTLY:
-        sendNotifications(PLAYBACK_STATE_CHANGE_EVENT);
+        scheduleNotifications(PLAYBACK_STATE_CHANGE_EVENT);
         break;
     
     case AIMPManager::EVENT_AIMP_QUIT:
         aimp_app_is_exiting_ = true;
+        scheduleNotifications(CONTROL_PANEL_STATE_CHANGE_EVENT);
+        // player thread will not run timers anymore, notify immediately.
+        {
+        boost::system::error_code ignored_ec;
+        notifications_timer_.cancel(ignored_ec);
+        }
+        sendPendingNotifications();
+        break;
     case AIMPManager::EVENT_VOLUME:
     case AIMPManager::EVENT_MUTE:
     case AIMPManager::EVENT_SHUFFLE:
     case AIMPManager::EVENT_REPEAT:
     case AIMPManager::EVENT_RADIO_CAPTURE:
-        sendNotifications(CONTROL_PANEL_STATE_CHANGE_EVENT);
+        scheduleNotifications(CONTROL_PANEL_STATE_CHANGE_EVENT);
         break;
     default:
         break;
     }
 }
 
-void SubscribeOnAIMPStateUpdateEvent::sendNotifications(EVENTS event_id)
+void SubscribeOnAIMPStateUpdateEvent::scheduleNotifications(EVENTS event_id)
 {
-    std::pair<DelayedResponseSenderDescriptors::iterator, DelayedResponseSenderDescriptors::iterator> it_pair = delayed_response_sender_descriptors_.equal_range(event_id);
-    //auto it_pair = delayed_response_sender_descriptors_.equal_range(event_id);
-    for (DelayedResponseSenderDescriptors::iterator sender_it = it_pair.first,
-                                                    end       = it_pair.second;
-                                                    sender_it != end;
-                                                    ++sender_it
-         )
-    {
-        ResponseSenderDescriptor& sender_descriptor = sender_it->second;
-        sendEventNotificationToSubscriber(event_id, sender_descriptor);
+    const bool timer_is_active = pending_events_ != 0;
+    pending_events_ |= 1 << event_id;
+    if (!timer_is_active) {
+        notifications_timer_.expires_from_now( boost::posix_time::milliseconds(kNOTIFICATIONS_DELAY_MS) );
+        notifications_timer_.async_wait( boost::bind(&SubscribeOnAIMPStateUpdateEvent::onNotificationsTimer, this, _1) );
     }
+}
 
-    delayed_response_sender_descriptors_.erase(it_pair.first, it_pair.second);
+void SubscribeOnAIMPStateUpdateEvent::onNotificationsTimer(const boost::system::error_code& e)
+{
+    if (e == boost::asio::error::operation_aborted) { // timer is cancelled, this object can be already destroyed.
+        return;
+    }
+    sendPendingNotifications();
 }
 
-void SubscribeOnAIMPStateUpdateEvent::sendEventNotificationToSubscriber(EVENTS event_id, ResponseSenderDescriptor& response_sender_descriptor)
+void SubscribeOnAIMPStateUpdateEvent::sendPendingNotifications()
 {
-    Rpc::Value response;
-    prepareResponse(event_id, response["result"]); // TODO: catch errors here.
-    response["id"] = response_sender_descriptor.root_request["id"];
-    response_sender_descriptor.sender->sendResponseSuccess(response);
+    const unsigned int events = pending_events_;
+    pending_events_ = 0;
+    for (int event_id = PLAYBACK_STATE_CHANGE_EVENT; event_id <= PLAYLISTS_CONTENT_CHANGE_EVENT; ++event_id) {
+        if ( events & (1 << event_id) ) {
+            sendNotifications( static_cast<EVENTS>(event_id) );
+        }
+    }
+}
+
+namespace {
+
+typedef std::vector< std::pair<const Rpc::ResponseSerializer*, std::string> > SerializedResults;
+
+//! Returns result serialized by serializer. Result is serialized only once for each serializer.
+const std::string& getSerializedResult(const Rpc::Value& result, const Rpc::ResponseSerializer& serializer, SerializedResults& serialized_results)
+{
+    BOOST_FOREACH(auto& serialized_result, serialized_results) {
+        if (serialized_result.first == &serializer) {
+            return serialized_result.second;
+        }
+    }
+
+    serialized_results.push_back( std::make_pair( &serializer, std::string() ) );
+    serializer.serializeResult(result, &serialized_results.back().second);
+    return serialized_results.back().second;
+}
+
+} // namespace anonymous
+
+void SubscribeOnAIMPStateUpdateEvent::removeClosedEventStreams()
+{
+    auto streams_end = std::remove_if(event_streams_.begin(), event_streams_.end(),
+                                      [](const EventStreamDescriptor& d) { return d.stream.expired(); }
+                                      );
+    event_streams_.erase( streams_end, event_streams_.end() );
+}
+
+void SubscribeOnAIMPStateUpdateEvent::sendNotifications(EVENTS event_id)
+{
+    removeClosedEventStreams();
+
+    const unsigned int event_mask = 1 << event_id;
+    const auto it_pair = delayed_response_sender_descriptors_.equal_range(event_id);
+    const bool has_event_streams = event_streams_.end() != std::find_if(event_streams_.begin(), event_streams_.end(),
+                                                                        [event_mask](const EventStreamDescriptor& d) { return (d.events_mask & event_mask) != 0; }
+                                                                        );
+    if (it_pair.first == it_pair.second && !has_event_streams) {
+        return; // nobody waits for event, do not query AIMP.
+    }
+
+    Rpc::Value result;
+    SerializedResults serialized_results; // there are few serializers(one per RPC frontend), so vector is fine.
+    std::shared_ptr<const std::string> stream_event;
+    try {
+        prepareResponse(event_id, result);
+
+        if (has_event_streams) {
+            const std::string& data = getSerializedResult(result, event_stream_serializer_, serialized_results);
+            const auto event_type = std::find_if(event_types_.begin(), event_types_.end(),
+                                                 [event_id](const EventTypesMap::value_type& v) { return v.second == event_id; }
+                                                 );
+            assert( event_type != event_types_.end() );
+            stream_event = std::make_shared<const std::string>( std::string("event: ") + event_type->first + "\ndata: " + data + "\n\n" );
+        }
+
+        for (auto sender_it = it_pair.first; sender_it != it_pair.second; ++sender_it) {
+            getSerializedResult(result, sender_it->second.sender->serializer(), serialized_results);
+        }
+    } catch (std::exception& e) {
+        // nothing is sent yet, keep subscribers, they will be notified on next event.
+        AIMP_LOG_SEV(logger(), error) << "Notification about event " << event_id << " failed in "__FUNCTION__". Reason: " << e.what();
+        return;
+    }
+
+    for (auto sender_it = it_pair.first; sender_it != it_pair.second; ++sender_it) {
+        ResponseSenderDescriptor& sender_descriptor = sender_it->second;
+        const std::string& serialized_result = getSerializedResult(result, sender_descriptor.sender->serializer(), serialized_results); // already serialized.
+        sender_descriptor.sender->sendSerializedResult(sender_descriptor.root_request, serialized_result);
+    }
+    delayed_response_sender_descriptors_.erase(it_pair.first, it_pair.second);
+
+    if (stream_event) {
+        // drop streams of disconnected clients.
+        auto streams_end = std::remove_if(event_streams_.begin(), event_streams_.end(),
+                                          [event_mask, &stream_event](const EventStreamDescriptor& d) -> bool {
+                                              if ( (d.events_mask & event_mask) == 0 ) {
+                                                  return false;
+                                              }
+                                              const Http::IEventStream_ptr stream = d.stream.lock();
+                                              return !stream || !stream->sendEvent(stream_event);
+                                          }
+                                          );
+        event_streams_.erase( streams_end, event_streams_.end() );
+    }
 }
 
 ResponseType GetPlayerControlPanelState::execute(const Rpc::Value& /*root_request*/, Rpc::Value& root_response)
@@ -1322,7 +1781,7 @@ ResponseType SetTrackRating::execute(const Rpc::Value& root_request, Rpc::Value&
         try {
             aimp3_manager->trackRating(track_desc, rating);
         } catch (std::exception& e) {
-            BOOST_LOG_SEV(logger(), error) << "Error saving rating in "__FUNCTION__". Reason: " << e.what();
+            AIMP_LOG_SEV(logger(), error) << "Error saving rating in "__FUNCTION__". Reason: " << e.what();
             throw Rpc::Exception("Error saving rating.", RATING_SET_FAILED);
         }
     } else {
@@ -1338,7 +1797,7 @@ ResponseType SetTrackRating::execute(const Rpc::Value& root_request, Rpc::Value&
                 throw std::exception("Ratings file can not be opened.");
             }
         } catch (std::exception& e) {
-            BOOST_LOG_SEV(logger(), error) << "Error saving rating to text file in "__FUNCTION__". Reason: " << e.what();
+            AIMP_LOG_SEV(logger(), error) << "Error saving rating to text file in "__FUNCTION__". Reason: " << e.what();
             throw Rpc::Exception("Error saving rating to text file.", RATING_SET_FAILED);
         }
     }
@@ -1372,6 +1831,34 @@ ResponseType PluginCapabilities::execute(const Rpc::Value& /*root_request*/, Rpc
     return RESPONSE_IMMEDIATE;
 }
 
+ResponseType GetServerStatus::execute(const Rpc::Value& /*root_request*/, Rpc::Value& root_response)
+{
+    Rpc::Value& result = root_response["result"];
+
+    const Http::StaticFileCache& static_file_cache = http_request_handler_.static_file_cache();
+    Rpc::Value& cache_info = result["static_file_cache"];
+    cache_info["hits"]         = static_file_cache.hits();
+    cache_info["misses"]       = static_file_cache.misses();
+    cache_info["memory_usage"] = static_file_cache.memoryUsage();
+
+    const Http::CompressionStats::Counters compression = http_request_handler_.compression_stats()->counters();
+    Rpc::Value& compression_info = result["compression"];
+    compression_info["responses_count"]         = compression.responses_count;
+    compression_info["chunked_responses_count"] = compression.chunked_responses_count;
+    compression_info["original_bytes"]          = static_cast<double>(compression.original_bytes); // Rpc::Value has no 64-bit integers.
+    compression_info["compressed_bytes"]        = static_cast<double>(compression.compressed_bytes);
+    compression_info["milliseconds"]            = compression.seconds * 1000;
+
+    const Http::AdmissionControl::Stats admission = http_request_handler_.admission_control()->stats();
+    Rpc::Value& admission_info = result["admission_control"];
+    admission_info["connections_count"]      = admission.connections_count;
+    admission_info["connections_accepted"]   = static_cast<double>(admission.connections_accepted);
+    admission_info["connections_rejected"]   = static_cast<double>(admission.connections_rejected);
+    admission_info["requests_rejected"]      = static_cast<double>(admission.requests_rejected);
+    admission_info["subscriptions_rejected"] = static_cast<double>(admission.subscriptions_rejected);
+    return RESPONSE_IMMEDIATE;
+}
+
 ResponseType AddURLToPlaylist::execute(const Rpc::Value& root_request, Rpc::Value& root_response)
 {
     const Rpc::Value& params = root_request["params"];
@@ -1453,9 +1940,9 @@ void RemoveTrack::onTimerDeleteTrack(const fs::path& filename, RemoveTrack::Resp
             return;
         }
 
-        BOOST_LOG_SEV(logger(), error) << "Error of fs::remove in "__FUNCTION__". File: " << StringEncoding::utf16_to_utf8(filename.native()) << ". Reason: " << ec;
+        AIMP_LOG_SEV(logger(), error) << "Error of fs::remove in "__FUNCTION__". File: " << StringEncoding::utf16_to_utf8(filename.native()) << ". Reason: " << ec;
     } else if (e != boost::asio::error::operation_aborted) { // "operation_aborted" error code is sent when timer is cancelled.
-        BOOST_LOG_SEV(logger(), error) << "err:"__FUNCTION__" timer error:" << e;
+        AIMP_LOG_SEV(logger(), error) << "err:"__FUNCTION__" timer error:" << e;
     }
 
     response_sender_descriptor.sender->sendResponseFault(response_sender_descriptor.root_request, "Removing track failed", REMOVE_TRACK_FAILED);
@@ -1551,11 +2038,11 @@ void Scheduler::onTimerStopPlayback(const boost::system::error_code& e)
     if (!e) { // Timer expired normally.
         aimp_manager_.stopPlayback();
 
-        BOOST_LOG_SEV(logger(), info) << "playback has been stopped by timer. "__FUNCTION__;
+        AIMP_LOG_SEV(logger(), info) << "playback has been stopped by timer. "__FUNCTION__;
 
         timer_.reset();
     } else if (e != boost::asio::error::operation_aborted) { // "operation_aborted" error code is sent when timer is cancelled.
-        BOOST_LOG_SEV(logger(), error) << "err:"__FUNCTION__" timer error:" << e;
+        AIMP_LOG_SEV(logger(), error) << "err:"__FUNCTION__" timer error:" << e;
     }
 }
 
@@ -1563,12 +2050,12 @@ void Scheduler::onTimerMachineShutdown(const boost::system::error_code& e)
 {
     if (!e) { // Timer expired normally.
         if (PowerManagement::SystemShutdown()) {
-            BOOST_LOG_SEV(logger(), info) << "Machine has been shut down by timer. "__FUNCTION__;
+            AIMP_LOG_SEV(logger(), info) << "Machine has been shut down by timer. "__FUNCTION__;
         }
 
         timer_.reset();
     } else if (e != boost::asio::error::operation_aborted) { // "operation_aborted" error code is sent when timer is cancelled.
-        BOOST_LOG_SEV(logger(), error) << "err:"__FUNCTION__" timer error:" << e;
+        AIMP_LOG_SEV(logger(), error) << "err:"__FUNCTION__" timer error:" << e;
     }
 }
 
@@ -1576,12 +2063,12 @@ void Scheduler::onTimerMachineHibernate(const boost::system::error_code& e)
 {
     if (!e) { // Timer expired normally.
         if (PowerManagement::SystemHibernate()) {
-            BOOST_LOG_SEV(logger(), info) << "Machine has been hibernated by timer. "__FUNCTION__;
+            AIMP_LOG_SEV(logger(), info) << "Machine has been hibernated by timer. "__FUNCTION__;
         }
 
         timer_.reset();
     } else if (e != boost::asio::error::operation_aborted) { // "operation_aborted" error code is sent when timer is cancelled.
-        BOOST_LOG_SEV(logger(), error) << "err:"__FUNCTION__" timer error:" << e;
+        AIMP_LOG_SEV(logger(), error) << "err:"__FUNCTION__" timer error:" << e;
     }
 }
 
@@ -1589,12 +2076,12 @@ void Scheduler::onTimerMachineSleep(const boost::system::error_code& e)
 {
     if (!e) { // Timer expired normally.
         if (PowerManagement::SystemSleep()) {
-            BOOST_LOG_SEV(logger(), info) << "Machine has been set to sleep mode by timer. "__FUNCTION__;
+            AIMP_LOG_SEV(logger(), info) << "Machine has been set to sleep mode by timer. "__FUNCTION__;
         }
 
         timer_.reset();
     } else if (e != boost::asio::error::operation_aborted) { // "operation_aborted" error code is sent when timer is cancelled.
-        BOOST_LOG_SEV(logger(), error) << "err:"__FUNCTION__" timer error:" << e;
+        AIMP_LOG_SEV(logger(), error) << "err:"__FUNCTION__" timer error:" << e;
     }
 }
 
@@ -2191,7 +2678,7 @@ ResponseType EmulationOfWebCtlPlugin::execute(const Rpc::Value& root_request, Rp
 
         root_response["result"] = out.str(); // result is simple string.
     } catch (std::runtime_error& e) { // catch all exceptions of aimp manager here.
-        BOOST_LOG_SEV(logger(), error) << "Error in "__FUNCTION__". Reason: " << e.what();
+        AIMP_LOG_SEV(logger(), error) << "Error in "__FUNCTION__". Reason: " << e.what();
 
         root_response["result"] = "";
     }
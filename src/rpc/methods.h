@@ -10,10 +10,10 @@
 #include "value.h"
 #include "utils.h"
 #include "utils/sqlite_util.h"
+#include "entry_ids_cache.h"
+#include "http_server/event_stream.h"
+#include "jsonrpc/response_serializer.h"
 
-#include <boost/random/mersenne_twister.hpp>
-#include <boost/random/uniform_int.hpp>
-#include <boost/random/variate_generator.hpp>
 #include <boost/assign/list_of.hpp>
 #include <boost/assign/std.hpp>
 #include <boost/bind.hpp>
@@ -22,7 +22,11 @@
 
 namespace MultiUserMode { class MultiUserModeManager; }
 
-namespace Rpc { class DelayedResponseSender; }
+namespace Rpc { class DelayedResponseSender; class ArrayItemsSource; }
+
+namespace AlbumCover { class CoverProvider; }
+
+namespace Http { class RequestHandler; }
 
 /*! contains RPC methods definitions.
 
@@ -75,7 +79,8 @@ enum ERROR_CODES {
                    REMOVE_TRACK_FAILED = 28, /*!< can't remove track from playlist. Possible reason: track was not found. */
                    REMOVE_TRACK_PHYSICAL_DELETION_DISABLED = 29, /*!< can't remove track physically. Reason: user has disabled it in plugin settings. */
                    SCHEDULER_DISABLED = 30, /*!< can't shutdown/hibernate machine or stop playback by timer. Reason: user has disabled it in plugin settings. */
-                   SCHEDULER_UNSUPPORTED_ACTION = 31 /*!< can't schedule specified action. Reason: machine does not support action. For example, hibernation/shutdown/sleep can be disabled. */
+                   SCHEDULER_UNSUPPORTED_ACTION = 31, /*!< can't schedule specified action. Reason: machine does not support action. For example, hibernation/shutdown/sleep can be disabled. */
+                   TOO_MANY_SUBSCRIPTIONS = 32 /*!< can't subscribe on event. Reason: client has too many pending subscriptions(settings.httpserver.max_subscriptions_per_client). */
 };
 
 using namespace AIMPPlayer;
@@ -646,15 +651,13 @@ typedef std::vector<SupportedFieldNames::const_iterator> RequiredFieldNames;
 }
 
 struct PaginationInfo : boost::noncopyable {
-    PaginationInfo(int entry_id, size_t id_field_index)
+    explicit PaginationInfo(int entry_id)
         : entry_id(entry_id),
-          id_field_index(id_field_index),
           entries_on_page_(0),
           entry_index_in_current_representation_(-1)
     {}
 
     const int entry_id;
-    const size_t id_field_index;
     size_t entries_on_page_;
     int entry_index_in_current_representation_; // index of entry in representation(concrete filtering and sorting) of playlist entries.
 };
@@ -691,10 +694,14 @@ struct PaginationInfo : boost::noncopyable {
                                                 - album
                                                 - data
                                                 - genre
+                                             If full text search is supported by AIMP's sqlite library each word of 'search_string'
+                                             is matched as beginning of word in those fields, all words must be found.
 
     \return object which describes playlist entries.
             Example:\code{"count_of_found_entries":1,"entries":[[1,"Looks Like Chaplin"]],"total_entries_count":3}\endcode
             If params were \code{"playlist_id": 2136855360, "search_string":"Like"}}\endcode
+    \remark Large result(500 entries or more) of single HTTP/1.1 request is sent with chunked transfer encoding:
+            entries are read from DB row by row while response is sent.
 */
 class GetPlaylistEntries : public AIMPRPCMethod
 {
@@ -719,6 +726,8 @@ public:
         { pagination_info_ = pagination_info; }
     void activateQueuedEntriesMode()
         { queued_entries_mode_ = true; }
+    void activateQueryPlanMode()
+        { query_plan_mode_ = true; }
 
 private:
 
@@ -732,6 +741,11 @@ private:
     void deactivateQueuedEntriesMode()
         { queued_entries_mode_ = false; }
 
+    bool queryPlanMode() const
+        { return query_plan_mode_; }
+    void deactivateQueryPlanMode()
+        { query_plan_mode_ = false; }
+
     void addSpecialFieldsSupport();
     void removeSpecialFieldsSupport();
 
@@ -742,7 +756,15 @@ private:
     typedef std::vector<std::string> FieldNames;
 
     FieldNames fields_to_order_;
-    std::string getOrderString(const Rpc::Value& params) const;
+
+    struct OrderField
+    {
+        std::string column; //!< db field name.
+        bool descending;
+    };
+    typedef std::vector<OrderField> OrderFields;
+    OrderFields getOrderFields(const Rpc::Value& params) const;
+    static std::string getOrderString(const OrderFields& order_fields);
 
     FieldNames fields_to_filter_;
 
@@ -751,10 +773,38 @@ private:
 
     mutable Utilities::QueryArgSetters query_arg_setters_;
 
-    std::string getLimitString(const Rpc::Value& params) const;
+    //! Range [begin, end) of found rows which must be returned to client.
+    struct RowsRange
+    {
+        size_t begin, end;
+    };
+    RowsRange getRowsRange(const Rpc::Value& params) const;
+    std::string getLimitString(const RowsRange& rows_range) const;
     std::string getWhereString(const Rpc::Value& params, const int playlist_id) const;
     std::string getColumnsString() const;
+    std::string getTotalEntriesCountQuery(const int playlist_id) const;
     size_t getTotalEntriesCount(sqlite3* playlists_db, const int playlist_id) const; // throws std::runtime_error
+    size_t getCountOfFoundEntries(sqlite3* playlists_db, const std::string& table, const std::string& where_string) const; // throws std::runtime_error
+
+    /*!
+        \brief Creates index for ORDER BY clause after it was requested several times, so sort does not require temp B-tree.
+               Default order is served by index which is created with playlists DB.
+    */
+    void createOrderIndexOnDemand(sqlite3* playlists_db, const std::string& order_string);
+
+    /*!
+        \brief Returns position of entry in representation determined by where and order clauses, or -1 if entry is not found.
+               Position is calculated by count of preceding entries, so no entries are returned from DB and no sort is required.
+        \remark Known limitation: it is O(n), not O(log n). sqlite B-trees do not store subtree sizes, so COUNT(*) visits
+                each preceding entry(of order index if it exists, of table otherwise). Entries after target are not visited.
+    */
+    int getEntryRank(sqlite3* playlists_db, const std::string& table, const std::string& where_string,
+                     const OrderFields& order_fields, int entry_id
+                     ) const; // throws std::runtime_error
+
+    typedef std::map<std::string, size_t> OrderUsageCounts;
+    OrderUsageCounts order_usage_counts_; //!< count of requests for each ORDER BY clause.
+    size_t order_indexes_count_;
 
     const std::string kRQST_KEY_FORMAT_STRING,
                       kRQST_KEY_FIELDS;
@@ -779,6 +829,23 @@ private:
 
     PaginationInfo* pagination_info_;
     bool queued_entries_mode_;
+    bool query_plan_mode_;
+
+    //! Returns cached representation of playlist or builds and caches it. Query args must be set by getWhereString() before call.
+    const EntryIdsCache::Representation& getRepresentation(sqlite3* playlists_db, const std::string& cache_key, const int playlist_id,
+                                                           const std::string& where_string, const std::string& order_string
+                                                           ); // throws std::runtime_error
+
+    //! Fills entries of representation from rows range. Returns false if some entry was not found in DB, it means representation is obsolete.
+    bool fillEntries(sqlite3* playlists_db, const EntryIdsCache::RowIDs& rowids, const RowsRange& rows_range, Rpc::Value& rpcvalue_entries); // throws std::runtime_error
+
+    //! Returns source of entries in range [begin, end) of representation which reads them from DB one by one while response is sent.
+    boost::shared_ptr<Rpc::ArrayItemsSource> createStreamedEntries(sqlite3* playlists_db, const std::string& cache_key,
+                                                                   EntryIdsCache::RowIDs_ptr rowids, size_t begin, size_t end,
+                                                                   const Rpc::Value& params
+                                                                   ); // throws std::runtime_error
+
+    EntryIdsCache entry_ids_cache_;
 };
 
 /*! 
@@ -818,7 +885,6 @@ public:
 private:
 
     GetPlaylistEntries& getplaylistentries_method_;
-    const std::string kFIELD_ID;
 };
 
 /*! 
@@ -899,6 +965,40 @@ private:
     GetPlaylistEntries& getplaylistentries_method_;
 };
 
+/*! 
+    \brief Diagnostic method. Returns query plans(EXPLAIN QUERY PLAN output) of queries which GetPlaylistEntries executes for the same params.
+           Used to check that entries queries are served by indexes.
+    \return object with members:
+        - 'query' - string, entries query.
+        - 'query_plan' - array of strings, plan of entries query.
+        - 'total_entries_count_query' - string.
+        - 'total_entries_count_query_plan' - array of strings.
+            Example:\code{"query":"SELECT entry_id,title FROM PlaylistsEntries WHERE playlist_id=1 ORDER BY entry_index ASC","query_plan":["SEARCH TABLE PlaylistsEntries USING INDEX PlaylistsEntriesPlaylistIndex (playlist_id=?)"], ...}\endcode
+*/
+class GetPlaylistEntriesQueryPlan : public AIMPRPCMethod
+{
+public:
+
+    // Note: we pass GetPlaylistEntries object by reference here, so we need to guarantee that it's lifetime is longer than lifetime of this object.
+    GetPlaylistEntriesQueryPlan(AIMPManager& aimp_manager,
+                                Rpc::RequestHandler& rpc_request_handler,
+                                GetPlaylistEntries& getplaylistentries_method
+                                );
+
+    std::string help()
+    {
+        return "GetPlaylistEntriesQueryPlan() requires the same args as get_playlist_entries() method. "
+               "Returns query plans of queries used by get_playlist_entries()."
+        ;
+    }
+
+    Rpc::ResponseType execute(const Rpc::Value& root_request, Rpc::Value& root_response);
+
+private:
+
+    GetPlaylistEntries& getplaylistentries_method_;
+};
+
 /*! 
     \brief Returns URI of album cover.
     \param playlist_id - int. \ref ids_info "More"
@@ -907,23 +1007,23 @@ private:
     \param cover_height - int, optional.
     
     \return URI of cover.
-            Example:\code{"album_cover_uri":"tmp/cover_35_2136855104_0x0_99263.png"}\endcode 
+            Example:\code{"album_cover_uri":"album_covers_cache/3f786850e387550fdab836ed7e6dc881de23001b_100x100.jpg"}\endcode 
     \remark Function is available only if FreeImage.dll and FreeImagePlus.dll are available for loading by AIMP.
+             Covers are stored in content-addressed cache: name of file is hash of source image and size,
+             so tracks with the same album cover get the same file. Covers are scaled by background workers,
+             response is sent when cover is ready. Covers of configured sizes are generated when track starts playing.
+             Cover can also be requested directly without this call: GET /cover/<playlist_id>/<track_id>/<width>x<height>.
 */
 class GetCover : public AIMPRPCMethod
 {
 public:
-    GetCover(AIMPManager& aimp_manager, Rpc::RequestHandler& rpc_request_handler, const boost::filesystem::wpath& document_root, const boost::filesystem::wpath& cover_directory, bool free_image_dll_is_available)
+    //! \param cover_directory - directory of cover files relative to document root.
+    GetCover(AIMPManager& aimp_manager, Rpc::RequestHandler& rpc_request_handler, AlbumCover::CoverProvider& cover_provider, const boost::filesystem::wpath& cover_directory)
         :
         AIMPRPCMethod("GetCover", aimp_manager, rpc_request_handler),
-        document_root_(document_root),
-        free_image_dll_is_available_(free_image_dll_is_available),
-        die_( rng_engine_, random_range_ ) // init generator by range[0, 9]
-    {
-        random_file_part_.resize(kRANDOM_FILENAME_PART_LENGTH);
-        cover_directory_relative_ = cover_directory;
-        prepare_cover_directory();
-    }
+        cover_provider_(cover_provider),
+        cover_directory_relative_(cover_directory)
+    {}
 
     std::string help()
     {
@@ -936,61 +1036,12 @@ public:
 
 private:
 
-    /*
-        Generate filename in format cover_playlistID_trackID_widthxheight_random. Ex: cover_2222222_01_100x100_45730.
-    */
-    std::wstring getTempFileNameForAlbumCover(TrackDescription track_desc, std::size_t width, std::size_t height);
-
-    void prepare_cover_directory(); // throws runtime_error
+    //! Called in player thread when cover is rendered.
+    static void onCoverRendered(const std::wstring& cover_directory_uri, const Rpc::Value& root_request, boost::shared_ptr<Rpc::DelayedResponseSender> sender,
+                                const std::wstring& name, const std::string& error);
 
-    boost::filesystem::wpath document_root_,
-                             cover_directory_relative_;
-
-    boost::filesystem::wpath cover_directory() const
-        { return (document_root_ / cover_directory_relative_).normalize(); }
-
-    bool free_image_dll_is_available_;
-
-    //  random utils
-    typedef boost::variate_generator<boost::mt19937&, boost::uniform_int<> > RandomNumbersGenerator;
-    static const int kRANDOM_FILENAME_PART_LENGTH = 5;
-    boost::uniform_int<> random_range_;
-    boost::mt19937 rng_engine_;
-    RandomNumbersGenerator die_;
-    std::wstring random_file_part_;
-
-    class Cache {
-    public:
-        struct Entry {
-            typedef std::list<std::wstring> Filenames;
-            boost::shared_ptr<Filenames> filenames;
-        };
-
-        struct SearchResult {
-            const Entry* entry;
-            std::size_t uri_index;
-            SearchResult(const Entry* entry = nullptr, std::size_t uri_index = 0) : entry(entry), uri_index(uri_index) {}
-            operator bool() { return entry != nullptr; }
-        };
-
-        void cacheNew(TrackDescription track_desc, const boost::filesystem::wpath& album_cover_filename, const std::wstring& cover_uri_generic);
-        void cacheBasedOnPreviousResult(TrackDescription track_desc, GetCover::Cache::SearchResult search_result);
-
-        SearchResult isCoverCachedForCurrentTrack(TrackDescription track_desc, std::size_t width, std::size_t height) const;
-        
-        SearchResult isCoverCachedForAnotherTrack(const boost::filesystem::wpath& cover_path, std::size_t width, std::size_t height) const;
-
-    private:
-        SearchResult findInEntryBySize(const Entry& info, std::size_t width, std::size_t height) const;
-
-        typedef std::map<TrackDescription, Entry> EntryMap;
-        EntryMap entries_;
-
-        typedef std::map<boost::filesystem::wpath, TrackDescription> PathTrackMap;
-        PathTrackMap path_track_map_;
-    };
-
-    Cache cache_;
+    AlbumCover::CoverProvider& cover_provider_;
+    const boost::filesystem::wpath cover_directory_relative_;
 };
 
 /*! 
@@ -1044,12 +1095,22 @@ public:
                     - playlist count
                   Response example:\code{"playlists_changed":true, "playlists":[{"crc32":-1169477297,"id":38609376},{"crc32":358339139,"id":38609520},{"crc32":-1895027311,"id":38609664}]}\endcode
                   Note: 'playlists' array contains all playlists.
+
+    Bursts of AIMP events(volume slider dragging, playlist updates) are merged: notifications are sent once per short interval.
+
+    Count of pending subscriptions of one client IP is limited. Over the limit HTTP client gets 429 reply with Retry-After header,
+    WebSocket client gets error TOO_MANY_SUBSCRIPTIONS.
+
+    Events are also available as persistent stream of server-sent events: GET /events?event=<event ID>&event=<event ID>.
+    Each notification is sent as "event: <event ID>\ndata: <JSON result>\n\n", result is the same as described above.
 */
-class SubscribeOnAIMPStateUpdateEvent : public AIMPRPCMethod
+class SubscribeOnAIMPStateUpdateEvent : public AIMPRPCMethod, public Http::EventStreamListener
 {
 public:
-    SubscribeOnAIMPStateUpdateEvent(AIMPManager& aimp_manager, Rpc::RequestHandler& rpc_request_handler)
+    SubscribeOnAIMPStateUpdateEvent(AIMPManager& aimp_manager, Rpc::RequestHandler& rpc_request_handler, boost::asio::io_service& io_service)
         : AIMPRPCMethod("SubscribeOnAIMPStateUpdateEvent", aimp_manager, rpc_request_handler),
+          notifications_timer_(io_service),
+          pending_events_(0),
           aimp_app_is_exiting_(false)
     {
         using namespace boost::assign;
@@ -1068,7 +1129,11 @@ public:
     }
 
     virtual ~SubscribeOnAIMPStateUpdateEvent()
-        { aimp_manager_.unRegisterListener(aimp_events_listener_id_); }
+    {
+        aimp_manager_.unRegisterListener(aimp_events_listener_id_);
+        boost::system::error_code ignored_ec;
+        notifications_timer_.cancel(ignored_ec);
+    }
 
     std::string help()
     {
@@ -1094,6 +1159,8 @@ public:
 
     Rpc::ResponseType execute(const Rpc::Value& root_request, Rpc::Value& root_response);
 
+    virtual bool addEventStream(const std::vector<std::string>& events, Http::IEventStream_ptr stream);
+
 private:
 
     //! types of events(AIMPManager state changes events), used for register/unregister notifiers.
@@ -1103,20 +1170,23 @@ private:
                   PLAYLISTS_CONTENT_CHANGE_EVENT
     };
 
-    //! Converts AIMPManager::EVENTS to our EVENTS and calls sendNotifications() for them.
+    //! Converts AIMPManager::EVENTS to our EVENTS and schedules notifications for them.
     void aimpEventHandler(AIMPManager::EVENTS event);
 
-    //! Sends notification to all subscribers for specified event.
+    //! Marks event as pending, notifications are sent when notifications_timer_ expires.
+    void scheduleNotifications(EVENTS event_id);
+
+    void onNotificationsTimer(const boost::system::error_code& e);
+
+    //! Sends notifications for all pending events.
+    void sendPendingNotifications();
+
+    //! Sends notification to all subscribers for specified event. Result is built and serialized once for all subscribers.
     void sendNotifications(EVENTS event_id);
 
     //! Formats result Rpc value according to specified event.
     void prepareResponse(EVENTS event_id, Rpc::Value& result) const;
 
-    struct ResponseSenderDescriptor;
-    //! Sends notification to concrete subscriber(delayed_response_sender) for specified event.
-    void sendEventNotificationToSubscriber(EVENTS event_id,
-                                           ResponseSenderDescriptor& response_sender_descriptor);
-
     /* Gets event from Rpc argument(string) in format of EVENTS. */
     EVENTS getEventFromRpcParams(const Rpc::Value& params) const;
 
@@ -1138,6 +1208,22 @@ private:
     typedef std::multimap<EVENTS, ResponseSenderDescriptor> DelayedResponseSenderDescriptors;
     DelayedResponseSenderDescriptors delayed_response_sender_descriptors_;
 
+    //! Drops descriptors of streams which were closed and destroyed.
+    void removeClosedEventStreams();
+
+    // event stream with bitmask of events it is subscribed to. Stream is destroyed when client disconnects.
+    struct EventStreamDescriptor {
+        boost::weak_ptr<Http::IEventStream> stream;
+        unsigned int events_mask;
+    };
+    typedef std::vector<EventStreamDescriptor> EventStreamDescriptors;
+    EventStreamDescriptors event_streams_;
+    JsonRpc::ResponseSerializer event_stream_serializer_; //!< event data of streams is JSON.
+
+    static const int kNOTIFICATIONS_DELAY_MS = 100; //!< AIMP events which occur during this time after first one are sent in single notification.
+    boost::asio::deadline_timer notifications_timer_;
+    unsigned int pending_events_; //!< bitmask of EVENTS which wait for notifications_timer_.
+
     bool aimp_app_is_exiting_;
 };
 
@@ -1215,6 +1301,34 @@ public:
     Rpc::ResponseType execute(const Rpc::Value& root_request, Rpc::Value& root_response);
 };
 
+/*! 
+    \brief Returns counters of HTTP server which help to tune its settings.
+    \return object with counters of server parts:
+            Example: \code {"admission_control":{"connections_accepted":1207,"connections_count":3,"connections_rejected":0,"requests_rejected":12,"subscriptions_rejected":1},
+                             "compression":{"chunked_responses_count":2,"compressed_bytes":81234,"milliseconds":41.5,"original_bytes":702311,"responses_count":57},
+                             "static_file_cache":{"hits":412,"memory_usage":1563427,"misses":38}} \endcode
+*/
+class GetServerStatus : public AIMPRPCMethod
+{
+public:
+    GetServerStatus(AIMPManager& aimp_manager, Rpc::RequestHandler& rpc_request_handler, const Http::RequestHandler& http_request_handler)
+        :
+        AIMPRPCMethod("GetServerStatus", aimp_manager, rpc_request_handler),
+        http_request_handler_(http_request_handler)
+    {}
+
+    std::string help()
+    {
+        return "object GetServerStatus() returns counters of HTTP server: usage of static file cache, compression of RPC responses, rejected load.";
+    }
+
+    Rpc::ResponseType execute(const Rpc::Value& root_request, Rpc::Value& root_response);
+
+private:
+
+    const Http::RequestHandler& http_request_handler_;
+};
+
 /*! 
     \brief Adds URL to specified playlist.
     \param playlist_id - int. \ref special_ids_sec "More"
@@ -7,11 +7,13 @@
 #include <boost/ptr_container/ptr_vector.hpp>
 #include <boost/shared_ptr.hpp>
 #include <boost/weak_ptr.hpp>
+#include <string>
+#include <vector>
 
 // headers of DelayedResponseSender class
 #include <boost/enable_shared_from_this.hpp>
 
-namespace Http { class DelayedResponseSender; }
+namespace Http { class DelayedResponseSender; class ContentProducer; }
 
 namespace Rpc
 {
@@ -20,7 +22,24 @@ class Method;
 class Value;
 class RpcCallerDescription;
 class Frontend;
+class StreamedResponse;
 class ResponseSerializer;
+class BatchResponse;
+
+/*!
+    \brief Source of items of large array in method result. Items are read one by one while response is sent,
+           so memory used by response does not depend on count of items. Used in player thread only.
+*/
+class ArrayItemsSource : boost::noncopyable
+{
+public:
+    virtual ~ArrayItemsSource() {}
+
+    //! Fills next item. Returns false if there are no more items.
+    virtual bool next(Value* item) = 0; // throws std::runtime_error
+};
+
+typedef boost::shared_ptr<ArrayItemsSource> ArrayItemsSource_ptr;
 
 class RequestHandler : boost::noncopyable
 {
@@ -28,6 +47,15 @@ class RequestHandler : boost::noncopyable
 
 public:
 
+    RequestHandler()
+        :
+        active_response_serializer_(nullptr),
+        active_batch_index_(0),
+        active_streamed_response_(nullptr)
+    {}
+
+    ~RequestHandler();
+
     void addFrontend(std::auto_ptr<Frontend> frontend);
 
     /*!
@@ -40,16 +68,45 @@ public:
 
     Frontend* getFrontEnd(const std::string& uri);
 
+    /*!
+        \brief Handles request which contains single call or batch of calls(JSON-RPC 2.0 array).
+               Calls of batch are executed in order one after another in player thread, so read-only calls
+               see the same playlists DB state unless batch contains call which changes it.
+        \param streamed_response - not null if caller can send response by portions. Method result with large array
+                                   is returned here instead of response then, see streamArray().
+        \return true or false if response is ready, indeterminate if response will be sent by delayed response sender.
+    */
     boost::tribool handleRequest(const std::string& request_uri,
                                  const std::string& request_content,
                                  boost::shared_ptr<Http::DelayedResponseSender> delayed_response_sender,
                                  Frontend& frontend,
                                  std::string* response,
-                                 std::string* response_content_type
+                                 std::string* response_content_type,
+                                 boost::shared_ptr<Http::ContentProducer>* streamed_response
                                  );
 
+    /*!
+        \brief Returns true if result of executed method can be streamed: call is not part of batch,
+               caller can send response by portions and protocol serializer supports it.
+    */
+    bool streamingAvailable() const
+        { return active_streamed_response_ != nullptr; }
+
+    /*!
+        \brief Called by method during execution if streamingAvailable() returns true.
+               Member array_member of result object is serialized from items of source while response is sent.
+               Method must put empty array to this member, all other members of result are serialized as usual.
+    */
+    void streamArray(const std::string& array_member, ArrayItemsSource_ptr items);
+
 private:
 
+    boost::tribool callBatch(Value& batch,
+                             boost::shared_ptr<Http::DelayedResponseSender> delayed_response_sender,
+                             ResponseSerializer& response_serializer,
+                             std::string* response
+                             );
+
     boost::tribool callMethod(const Value& root,
                               boost::shared_ptr<Http::DelayedResponseSender> delayed_response_sender,
                               ResponseSerializer& response_serializer,
@@ -67,30 +124,89 @@ private:
 
     boost::weak_ptr<Http::DelayedResponseSender> active_delayed_response_sender_; // stores response sender while Rpc method is executed. Allows not to pass this handler in Method::execute() as argument since only comet method needs it.
     ResponseSerializer* active_response_serializer_; // work in pair with active_delayed_response_sender_ member.
+    boost::shared_ptr<BatchResponse> active_batch_response_; // set while call of batch is executed, delayed response of call goes to its slot in batch.
+    size_t active_batch_index_;
+    boost::shared_ptr<Http::ContentProducer>* active_streamed_response_; // set while single call is executed if its result can be streamed.
+    std::string active_streamed_array_member_; // set by streamArray() during execution of method.
+    ArrayItemsSource_ptr active_streamed_array_items_;
+    std::vector< boost::weak_ptr<StreamedResponse> > streamed_responses_; // responses being sent by connections, they are aborted on destruction of handler.
 };
 
+/*!
+    \brief Collects responses of batch calls. Array of responses is sent to client when response of each call is ready,
+           so delayed calls(subscriptions) hold whole batch response till their events occur.
+*/
+class BatchResponse : boost::noncopyable
+{
+public:
+
+    BatchResponse(size_t calls_count,
+                  boost::shared_ptr<Http::DelayedResponseSender> comet_http_response_sender,
+                  const ResponseSerializer& response_serializer
+                  );
+
+    //! Sets response of call, sends batch response if all calls are executed and it was the last missing response.
+    void setResponse(size_t index, const std::string& response);
+
+    /*!
+        \brief Called after all calls of batch were executed.
+        \return true if all responses are ready and batch response was written to response, false if some calls are delayed.
+    */
+    bool finishExecution(std::string* response);
+
+private:
+
+    std::vector<std::string> responses_;
+    std::vector<bool> response_ready_;
+    size_t missing_responses_count_;
+    bool executed_;
+
+    boost::shared_ptr<Http::DelayedResponseSender> comet_http_response_sender_;
+    const ResponseSerializer& response_serializer_;
+};
+
+typedef boost::shared_ptr<BatchResponse> BatchResponse_ptr;
+
 
 //! Adaptor for Connection class, provide only one method: sendResponse().
 class DelayedResponseSender : public boost::enable_shared_from_this<DelayedResponseSender>, boost::noncopyable
 {
 public:
 
+    //! \param batch_response - batch which contains delayed call, response is passed to batch instead of client. Null for single call.
     DelayedResponseSender(boost::shared_ptr<Http::DelayedResponseSender> comet_http_response_sender,
-                          const ResponseSerializer& response_serializer
+                          const ResponseSerializer& response_serializer,
+                          BatchResponse_ptr batch_response = BatchResponse_ptr(),
+                          size_t batch_index = 0
                           )
         :
         comet_http_response_sender_(comet_http_response_sender),
-        response_serializer_(response_serializer)
+        response_serializer_(response_serializer),
+        batch_response_(batch_response),
+        batch_index_(batch_index)
     {}
 
     void sendResponseSuccess(const Value& root_response);
 
     void sendResponseFault(const Value& root_request, const std::string& error_msg, int error_code);
 
+    //! Sends result which was serialized by serializer() beforehand. Allows to serialize result once for many senders.
+    void sendSerializedResult(const Value& root_request, const std::string& serialized_result);
+
+    const ResponseSerializer& serializer() const
+        { return response_serializer_; }
+
+    //! Returns false if client has too many pending subscriptions, subscription method must fail then.
+    bool admitSubscription();
+
 private:
 
+    void send(const std::string& response);
+
     boost::shared_ptr<Http::DelayedResponseSender> comet_http_response_sender_;
     const ResponseSerializer& response_serializer_;
+    BatchResponse_ptr batch_response_;
+    size_t batch_index_;
 };
 
 typedef boost::shared_ptr<DelayedResponseSender> DelayedResponseSender_ptr;
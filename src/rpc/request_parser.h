@@ -15,6 +15,7 @@ class RequestParser
 public:
 
     /// root value must contain following members: method, params. Optional members are: id.
+    /// Parser of protocol which supports batch requests can return array of such values.
     bool parse(const std::string& request_uri,
                const std::string& request_content,
                Rpc::Value* root)
@@ -2,7 +2,9 @@
 
 #pragma once
 
+#include <cassert>
 #include <string>
+#include <vector>
 
 namespace Rpc
 {
@@ -18,6 +20,30 @@ public:
 
     virtual void serializeFault(const Rpc::Value& root_request, const std::string& error_msg, int error_code, std::string* response) const = 0;
 
+    // Two step serialization of success response for result which is sent to many clients(event notifications):
+    // result is serialized once by serializeResult(), then serializeSuccessWithResult() only wraps it for concrete request.
+    virtual void serializeResult(const Rpc::Value& result, std::string* serialized_result) const = 0;
+
+    virtual void serializeSuccessWithResult(const Rpc::Value& root_request, const std::string& serialized_result, std::string* response) const = 0;
+
+    // Joins serialized responses of batch calls into one response. Only protocols which parse batch requests support it.
+    virtual void serializeBatch(const std::vector<std::string>& responses, std::string* response) const = 0;
+
+    // Streamed serialization of success response which result object contains large array(entries of playlist).
+    // serializeStreamedSuccess() writes response around the array: head ends right before its first item, tail starts right after the last one.
+    // Items are written between them by serializeStreamedArrayItem() while response is sent, so the array is never in memory as a whole.
+    // Output of head + items + tail is the same as serializeSuccess() produces for response with filled array.
+    // Only protocols which return true from streamingSupported() implement it.
+    virtual bool streamingSupported() const
+        { return false; }
+
+    virtual void serializeStreamedSuccess(const Rpc::Value& /*root_response*/, const std::string& /*array_member*/, std::string* /*head*/, std::string* /*tail*/) const
+        { assert(!"streamed serialization is not supported"); }
+
+    // Appends item with separator from previous one if protocol needs it.
+    virtual void serializeStreamedArrayItem(const Rpc::Value& /*item*/, size_t /*index*/, std::string* /*out*/) const
+        { assert(!"streamed serialization is not supported"); }
+
     virtual const std::string& mimeType() const = 0;
 
 protected:
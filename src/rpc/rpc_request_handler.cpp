@@ -10,7 +10,9 @@
 #include "rpc/request_parser.h"
 #include "rpc/response_serializer.h"
 #include "utils/util.h"
+#include <boost/bind.hpp>
 #include <boost/foreach.hpp>
+#include <algorithm>
 #include "plugin/logger.h"
 
 namespace Rpc
@@ -23,6 +25,78 @@ ModuleLoggerType& logger()
 }
 
 const int kGENERAL_ERROR_CODE = -1;
+const size_t kMAX_BATCH_SIZE = 100; // web interface needs few calls at once, bigger batches are rejected to not block player thread for long.
+
+/*!
+    \brief Response which array member of result is serialized portion by portion from items source.
+           Connection calls produce() in player thread each time previous portion was sent,
+           so only one portion of response is in memory at once.
+*/
+class StreamedResponse : public Http::ContentProducer
+{
+public:
+
+    StreamedResponse(const Value& root_response, const std::string& array_member, ArrayItemsSource_ptr items, const ResponseSerializer& response_serializer)
+        :
+        items_(items),
+        response_serializer_(response_serializer),
+        items_count_(0),
+        head_sent_(false)
+    {
+        response_serializer_.serializeStreamedSuccess(root_response, array_member, &head_, &tail_);
+    }
+
+    //! Releases items source. Response can not be produced after that.
+    void abort()
+        { items_.reset(); }
+
+    bool produce(std::string* out, std::size_t max_size) // throws std::runtime_error
+    {
+        if (!items_) {
+            throw std::runtime_error("Streamed response was aborted"); // connection closes socket.
+        }
+
+        if (!head_sent_) {
+            *out += head_;
+            std::string().swap(head_);
+            head_sent_ = true;
+        }
+
+        while (out->size() < max_size) {
+            if ( !items_->next(&item_) ) {
+                *out += tail_;
+                return false;
+            }
+            try {
+                response_serializer_.serializeStreamedArrayItem(item_, items_count_++, out);
+            } catch (const Exception& e) {
+                throw std::runtime_error( e.message() ); // connection handles std::exception only.
+            }
+        }
+        return true;
+    }
+
+private:
+
+    ArrayItemsSource_ptr items_;
+    const ResponseSerializer& response_serializer_; // serializer belongs to frontend which lives as long as request handler.
+    std::string head_,
+                tail_;
+    Value item_; // reused for each item, so its members keep allocated memory.
+    size_t items_count_;
+    bool head_sent_;
+};
+
+RequestHandler::~RequestHandler()
+{
+    // Connection can hold streamed response after handler is destroyed on plugin unload: its handlers are destroyed with io_service.
+    // Items source uses methods and playlists DB which are destroyed before that, so release it now.
+    BOOST_FOREACH(const boost::weak_ptr<StreamedResponse>& streamed_response, streamed_responses_) {
+        if ( boost::shared_ptr<StreamedResponse> response = streamed_response.lock() ) {
+            response->abort();
+        }
+    }
+}
 
 void RequestHandler::addFrontend(std::auto_ptr<Frontend> frontend)
 {
@@ -61,7 +135,8 @@ boost::tribool RequestHandler::handleRequest(const std::string& request_uri,
                                              Http::DelayedResponseSender_ptr delayed_response_sender,
                                              Frontend& frontend,
                                              std::string* response,
-                                             std::string* response_content_type
+                                             std::string* response_content_type,
+                                             boost::shared_ptr<Http::ContentProducer>* streamed_response
                                              )
 {
     assert(response);
@@ -72,21 +147,69 @@ boost::tribool RequestHandler::handleRequest(const std::string& request_uri,
     Value root_request;
     if ( frontend.requestParser().parse(request_uri, request_content, &root_request) ) {
 
+        if (root_request.type() == Value::TYPE_ARRAY) {
+            return callBatch(root_request,
+                             delayed_response_sender,
+                             frontend.responseSerializer(),
+                             response
+                             );
+        }
+
         if ( !root_request.isMember("id") ) { // for example xmlrpc does not use request id, so add null value since Rpc methods rely on it.
             root_request["id"] = Value::Null();
         }
 
-        return callMethod(root_request,
-                          delayed_response_sender,
-                          frontend.responseSerializer(),
-                          response
-                          );
+        active_streamed_response_ = frontend.responseSerializer().streamingSupported() ? streamed_response : nullptr;
+        const boost::tribool result = callMethod(root_request,
+                                                 delayed_response_sender,
+                                                 frontend.responseSerializer(),
+                                                 response
+                                                 );
+        active_streamed_response_ = nullptr;
+        active_streamed_array_items_.reset(); // method failed after it passed items source.
+        return result;
     } else {
         frontend.responseSerializer().serializeFault(root_request, "Request parsing error", Rpc::REQUEST_PARSING_ERROR, response);
         return false;
     }
 }
 
+boost::tribool RequestHandler::callBatch(Value& batch,
+                                         Http::DelayedResponseSender_ptr delayed_response_sender,
+                                         ResponseSerializer& response_serializer,
+                                         std::string* response
+                                         )
+{
+    assert(response);
+
+    if (batch.size() > kMAX_BATCH_SIZE) {
+        response_serializer.serializeFault(batch, Utilities::MakeString() << "Batch contains more than " << kMAX_BATCH_SIZE << " calls", REQUEST_PARSING_ERROR, response);
+        return false;
+    }
+
+    BatchResponse_ptr batch_response( new BatchResponse(batch.size(), delayed_response_sender, response_serializer) );
+    std::string call_response;
+    for (size_t i = 0, size = batch.size(); i != size; ++i) {
+        Value& call = batch[i];
+        if ( call.type() == Value::TYPE_OBJECT && !call.isMember("id") ) {
+            call["id"] = Value::Null();
+        }
+
+        active_batch_response_ = batch_response;
+        active_batch_index_ = i;
+        call_response.clear();
+        const boost::tribool result = callMethod(call, delayed_response_sender, response_serializer, &call_response);
+        active_batch_response_.reset();
+
+        if (result || !result) {
+            batch_response->setResponse(i, call_response);
+        }
+    }
+
+    return batch_response->finishExecution(response) ? true
+                                                     : boost::tribool(boost::indeterminate);
+}
+
 boost::tribool RequestHandler::callMethod(const Value& root_request,
                                           Http::DelayedResponseSender_ptr delayed_response_sender,
                                           ResponseSerializer& response_serializer,
@@ -120,6 +243,23 @@ boost::tribool RequestHandler::callMethod(const Value& root_request,
                 root_response = "";
             }
 
+            if (active_streamed_array_items_) {
+                // response is serialized while it is sent.
+                assert(active_streamed_response_);
+                boost::shared_ptr<StreamedResponse> streamed_response( new StreamedResponse(root_response, active_streamed_array_member_, active_streamed_array_items_, response_serializer) );
+                *active_streamed_response_ = streamed_response;
+                active_streamed_array_items_.reset();
+
+                streamed_responses_.erase( std::remove_if( streamed_responses_.begin(), streamed_responses_.end(),
+                                                           boost::bind(&boost::weak_ptr<StreamedResponse>::expired, _1)
+                                                          ),
+                                           streamed_responses_.end()
+                                          );
+                streamed_responses_.push_back(streamed_response);
+                response->clear();
+                return true;
+            }
+
             response_serializer.serializeSuccess(root_response, response);
             return true;
         }
@@ -131,17 +271,24 @@ boost::tribool RequestHandler::callMethod(const Value& root_request,
         const char* method_name =    root_request.isMember("method") 
                                   && root_request["method"].type() == Rpc::Value::TYPE_STRING ? static_cast<const std::string&>(root_request["method"]).c_str()
                                                                                               : "unknown";
-        BOOST_LOG_SEV(logger(), error) << "RequestHandler::callMethod: call " << method_name << " method error. Reason: " << e.what();
+        AIMP_LOG_SEV(logger(), error) << "RequestHandler::callMethod: call " << method_name << " method error. Reason: " << e.what();
         response_serializer.serializeFault(root_request, "internal error", Rpc::INTERNAL_ERROR, response);
         return false;
     }
 }
 
+void RequestHandler::streamArray(const std::string& array_member, ArrayItemsSource_ptr items)
+{
+    assert( streamingAvailable() );
+    active_streamed_array_member_ = array_member;
+    active_streamed_array_items_ = items;
+}
+
 boost::shared_ptr<DelayedResponseSender> RequestHandler::getDelayedResponseSender() const
 {
     boost::shared_ptr<Http::DelayedResponseSender> ptr = active_delayed_response_sender_.lock();
     if (ptr) {
-        return boost::make_shared<DelayedResponseSender>(ptr, *active_response_serializer_);
+        return boost::make_shared<DelayedResponseSender>(ptr, *active_response_serializer_, active_batch_response_, active_batch_index_);
     } else {
         return boost::shared_ptr<DelayedResponseSender>();
     }
@@ -152,18 +299,82 @@ void DelayedResponseSender::sendResponseSuccess(const Value& root_response)
 {
     std::string response;
     response_serializer_.serializeSuccess(root_response, &response);
-    comet_http_response_sender_->send(response,
-                                      response_serializer_.mimeType()
-                                      );
+    send(response);
 }
 
 void DelayedResponseSender::sendResponseFault(const Value& root_request, const std::string& error_msg, int error_code)
 {
     std::string response_string;
     response_serializer_.serializeFault(root_request, error_msg, error_code, &response_string);
-    comet_http_response_sender_->send(response_string,
-                                      response_serializer_.mimeType()
-                                      );
+    send(response_string);
+}
+
+void DelayedResponseSender::sendSerializedResult(const Value& root_request, const std::string& serialized_result)
+{
+    std::string response;
+    response_serializer_.serializeSuccessWithResult(root_request, serialized_result, &response);
+    send(response);
+}
+
+bool DelayedResponseSender::admitSubscription()
+{
+    return comet_http_response_sender_->admitSubscription();
+}
+
+void DelayedResponseSender::send(const std::string& response)
+{
+    if (batch_response_) {
+        batch_response_->setResponse(batch_index_, response);
+    } else {
+        comet_http_response_sender_->send(response,
+                                          response_serializer_.mimeType()
+                                          );
+    }
+}
+
+BatchResponse::BatchResponse(size_t calls_count,
+                             Http::DelayedResponseSender_ptr comet_http_response_sender,
+                             const ResponseSerializer& response_serializer
+                             )
+    :
+    responses_(calls_count),
+    response_ready_(calls_count, false),
+    missing_responses_count_(calls_count),
+    executed_(false),
+    comet_http_response_sender_(comet_http_response_sender),
+    response_serializer_(response_serializer)
+{}
+
+void BatchResponse::setResponse(size_t index, const std::string& response)
+{
+    assert( index < responses_.size() );
+    if (response_ready_[index]) {
+        return;
+    }
+
+    responses_[index] = response;
+    response_ready_[index] = true;
+    --missing_responses_count_;
+
+    if (executed_ && missing_responses_count_ == 0) {
+        // last delayed call is complete.
+        std::string batch_response;
+        response_serializer_.serializeBatch(responses_, &batch_response);
+        comet_http_response_sender_->send(batch_response,
+                                          response_serializer_.mimeType()
+                                          );
+    }
+}
+
+bool BatchResponse::finishExecution(std::string* response)
+{
+    assert(response);
+    executed_ = true;
+    if (missing_responses_count_ != 0) {
+        return false;
+    }
+    response_serializer_.serializeBatch(responses_, response);
+    return true;
 }
 
 } // namespace XmlRpc
@@ -4,6 +4,7 @@
 #include "rpc/value.h"
 #include "rpc/exception.h"
 #include <cassert>
+#include <new>
 #include <sstream>
 
 namespace Rpc
@@ -111,46 +112,28 @@ Value::Value(const char* value)
     :
     type_(TYPE_STRING)
 {
-    value_.string_ = new String(value);
+    new (value_.storage_) String(value);
 }
 
 Value::Value(const String& value)
     :
     type_(TYPE_STRING)
 {
-    value_.string_ = new String(value);
+    new (value_.storage_) String(value);
 }
 
 Value::Value(const Value::Array& value)
     :
     type_(TYPE_ARRAY)
 {
-    value_.array_ = new Array(value);
+    new (value_.storage_) Array(value);
 }
 
 Value::Value(const Value::Object& value)
     :
     type_(TYPE_OBJECT)
 {
-    value_.object_ = new Object(value);
-}
-
-Value::String* copyString(const Value::String* rhs)
-{
-    assert(rhs);
-    return new Value::String(*rhs);
-}
-
-Value::Array* copyArray(const Value::Array* rhs)
-{
-    assert(rhs);
-    return new Value::Array(*rhs);
-}
-
-Value::Object* copyObject(const Value::Object* rhs)
-{
-    assert(rhs);
-    return new Value::Object(*rhs);
+    new (value_.storage_) Object(value);
 }
 
 Value::Value(const Value& rhs)
@@ -174,18 +157,63 @@ Value::Value(const Value& rhs)
         value_.double_ = rhs.value_.double_;
         break;
     case TYPE_STRING:
-        value_.string_ = copyString(rhs.value_.string_);
+        new (value_.storage_) String( rhs.string() );
+        break;
+    case TYPE_ARRAY:
+        new (value_.storage_) Array( rhs.array() );
+        break;
+    case TYPE_OBJECT:
+        new (value_.storage_) Object( rhs.object() );
+        break;
+    default:
+        handleUnknownType();
+        break;
+    }
+}
+
+Value::Value(Value&& rhs)
+    :
+    type_(TYPE_NONE)
+{
+    moveFrom(rhs);
+}
+
+Value::~Value()
+{
+    reset();
+}
+
+void Value::moveFrom(Value& rhs)
+{
+    static_assert(sizeof(String) <= kSTORAGE_SIZE, "Value storage is too small for String");
+    static_assert(sizeof(Array)  <= kSTORAGE_SIZE, "Value storage is too small for Array");
+    static_assert(sizeof(Object) <= kSTORAGE_SIZE, "Value storage is too small for Object");
+
+    switch (rhs.type_) {
+    case TYPE_NONE:
+    case TYPE_NULL:
+    case TYPE_BOOL:
+    case TYPE_INT:
+    case TYPE_UINT:
+    case TYPE_DOUBLE:
+        value_ = rhs.value_;
+        break;
+    case TYPE_STRING:
+        new (value_.storage_) String( std::move( rhs.string() ) );
         break;
     case TYPE_ARRAY:
-        value_.array_ = copyArray(rhs.value_.array_);
+        new (value_.storage_) Array( std::move( rhs.array() ) );
         break;
     case TYPE_OBJECT:
-        value_.object_ = copyObject(rhs.value_.object_);
+        new (value_.storage_) Object( std::move( rhs.object() ) );
         break;
     default:
         handleUnknownType();
         break;
     }
+
+    type_ = rhs.type_;
+    rhs.reset(); // destroys moved-out container.
 }
 
 void Value::reset()
@@ -199,13 +227,13 @@ void Value::reset()
     case TYPE_DOUBLE:
         break;
     case TYPE_STRING:
-        delete value_.string_;
+        string().~String();
         break;
     case TYPE_ARRAY:
-        delete value_.array_;
+        array().~Array();
         break;
     case TYPE_OBJECT:
-        delete value_.object_;
+        object().~Object();
         break;
     default:
         handleUnknownType();
@@ -217,9 +245,10 @@ void Value::reset()
 
 void Value::swap(Value& rhs)
 {
-    using std::swap;
-    swap(type_, rhs.type_);
-    swap(value_, rhs.value_);
+    // containers are stored in place and can not be swapped bitwise, so move them.
+    Value tmp( std::move(rhs) );
+    rhs.moveFrom(*this);
+    moveFrom(tmp);
 }
 
 Value& Value::operator=(const Value& rhs)
@@ -228,6 +257,16 @@ Value& Value::operator=(const Value& rhs)
     return *this;
 }
 
+Value& Value::operator=(Value&& rhs)
+{
+    if (this != &rhs) {
+        Value tmp( std::move(rhs) ); // rhs can be a part of this value, so move it out before destroying.
+        reset();
+        moveFrom(tmp);
+    }
+    return *this;
+}
+
 Value& Value::operator=(const Value::Null& value)
 {
     Value(value).swap(*this);
@@ -380,22 +419,19 @@ Value::operator double() const
 Value::operator String&()
 {
     ensureTypeIsNoneOrEquals(TYPE_STRING);
-    assert(value_.string_);
-    return *value_.string_;
+    return string();
 }
 
 Value::operator String const&() const
 {
     assertTypeEquals(TYPE_STRING);
-    assert(value_.string_);
-    return *value_.string_;
+    return string();
 }
 
 bool Value::operator==(const char* value) const
 {
     if (type_ == TYPE_STRING) {
-        assert(value_.string_);
-        return *value_.string_ == value;
+        return string() == value;
     }
     return false;
 }
@@ -403,8 +439,7 @@ bool Value::operator==(const char* value) const
 bool Value::operator==(const String& value) const
 {
     if (type_ == TYPE_STRING) {
-        assert(value_.string_);
-        return *value_.string_ == value;
+        return string() == value;
     }
     return false;
 }
@@ -412,8 +447,7 @@ bool Value::operator==(const String& value) const
 void Value::assertIndexIsInRange(int index) const
 {
     assertTypeEquals(TYPE_ARRAY);
-    assert(value_.array_);
-    const Array& array = *value_.array_;
+    const Array& array = this->array();
     if (index < 0 || (size_t)index >= array.size() ) {
         std::ostringstream os;
         os << "array index out of bound: array size " << array.size() << ", index " << index;
@@ -429,22 +463,22 @@ Value& Value::operator[](int index)
         setSize(1);
     }
     assertIndexIsInRange(index);
-    return (*value_.array_)[index];
+    return array()[index];
 }
 
 const Value& Value::operator[](int index) const
 {
     assertIndexIsInRange(index);
-    return (*value_.array_)[index];
+    return array()[index];
 }
 
 const size_t Value::size() const
 {
     switch (type_) {
     case TYPE_ARRAY:
-        return value_.array_->size();
+        return array().size();
     case TYPE_OBJECT:
-        return value_.object_->size();
+        return object().size();
     default:
         break;
     }
@@ -457,16 +491,14 @@ const size_t Value::size() const
 void Value::setSize(size_t size)
 {
     ensureTypeIsNoneOrEquals(TYPE_ARRAY);
-    assert(value_.array_);
-    Array& array = *value_.array_;
-    array.resize(size);
+    array().resize(size);
 }
 
 const Value* Value::lookup(const Value::String& name) const
 {
     assert(type_ == TYPE_OBJECT);
 
-    const Object& object = *value_.object_;
+    const Object& object = this->object();
     const auto it = object.find(name);
     if ( it != object.end() ) {
         return &it->second;
@@ -477,8 +509,7 @@ const Value* Value::lookup(const Value::String& name) const
 Value& Value::operator[](const String& name)
 {
     ensureTypeIsNoneOrEquals(TYPE_OBJECT);
-    Object& object = *value_.object_;
-    return object[name];
+    return object()[name];
 }
 
 const Value& Value::operator[](const String& name) const
@@ -506,13 +537,13 @@ const Value& Value::operator[](const char* name) const
 Value::Object::const_iterator Value::getObjectMembersBegin() const
 {
     assertTypeEquals(TYPE_OBJECT);
-    return value_.object_->begin();
+    return object().begin();
 }
 
 Value::Object::const_iterator Value::getObjectMembersEnd() const
 {
     assertTypeEquals(TYPE_OBJECT);
-    return value_.object_->end();
+    return object().end();
 }
 
 bool Value::isMember(const String& name) const
@@ -552,12 +583,12 @@ std::ostream& Value::toStream(std::ostream& os) const
         os << value_.double_;
         break;
     case TYPE_STRING:
-        os << *value_.string_;
+        os << string();
         break;
     case TYPE_ARRAY:
         {
         os << '[';
-        const Array& array = *value_.array_;
+        const Array& array = this->array();
         for (auto begin = array.begin(), end = array.end(),
                   it = begin;
                   it != end;
@@ -575,7 +606,7 @@ std::ostream& Value::toStream(std::ostream& os) const
     case TYPE_OBJECT:
         {
         os << '{';
-        const Object& object = *value_.object_;
+        const Object& object = this->object();
         for (auto begin = object.begin(), end = object.end(),
                   it = begin;
                   it != end;
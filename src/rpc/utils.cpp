@@ -40,7 +40,7 @@ void setCurrentPlaybackState(AIMPManager::PLAYBACK_STATE playback_state, Rpc::Va
         }
     }
 
-    BOOST_LOG_SEV(logger(), error) << "Unknown playback state " << playback_state << " in "__FUNCTION__;
+    AIMP_LOG_SEV(logger(), error) << "Unknown playback state " << playback_state << " in "__FUNCTION__;
     assert(!"Unknown playback state in "__FUNCTION__);
     result["playback_state"] = "unknown";
 }
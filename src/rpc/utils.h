@@ -160,7 +160,7 @@ struct HelperFillRpcFields
             try {
                 setter->second(stmt, index, fields[field_id]); // invoke functor, that will assign value to fields[field_id].
             } catch (std::exception& e) {
-                BOOST_LOG_SEV(logger(), error) << "Error occured while filling AIMP " << logger_msg_id_ << " field " << field_id << ". Reason: " << e.what();
+                AIMP_LOG_SEV(logger(), error) << "Error occured while filling AIMP " << logger_msg_id_ << " field " << field_id << ". Reason: " << e.what();
                 assert(!"Error occured while filling field in"__FUNCTION__);
                 fields[field_id] = std::string();
             }
@@ -178,7 +178,7 @@ struct HelperFillRpcFields
             try {
                 setter->second(stmt, index, fields[index]); // invoke functor, that will assign value to fields[field_id].
             } catch (std::exception& e) {
-                BOOST_LOG_SEV(logger(), error) << "Error occured while filling AIMP " << logger_msg_id_
+                AIMP_LOG_SEV(logger(), error) << "Error occured while filling AIMP " << logger_msg_id_
                                                << " field " << setter->first << ", field index " << index
                                                << ". Reason: " << e.what();
                 assert(!"Error occured while filling field in"__FUNCTION__);
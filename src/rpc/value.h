@@ -13,6 +13,9 @@ namespace Rpc
 
 /*  Represents "interception" of XmlRpc value and JsonRpc value.
     This means that we can not use Base64 and DateTime types from XmlRpc.
+    String, Array and Object are stored inside value itself(not in separate heap block),
+    so short string(which fits in std::string internal buffer) does not require any allocation.
+    Value is movable, so growing of Array does not copy elements.
 */
 class Value
 {
@@ -37,6 +40,8 @@ public:
 
     Value();
     Value(const Value& rhs);
+    Value(Value&& rhs);
+    ~Value();
     explicit Value(const Null&);
     explicit Value(bool value);
     explicit Value(int value);
@@ -48,6 +53,7 @@ public:
     explicit Value(const Object& value);
 
     Value& operator=(const Value& rhs);
+    Value& operator=(Value&& rhs);
     Value& operator=(const Null&);
     Value& operator=(bool value);
     Value& operator=(int value);
@@ -107,19 +113,39 @@ private:
     void assertTypeEquals(TYPE type) const;     // throws Exception
     void ensureTypeIsNoneOrEquals(TYPE type);   // throws Exception
     void assertIndexIsInRange(int index) const; // throws Exception
+    // moves content of rhs to this value, rhs becomes TYPE_NONE. Current content of this value must be already destroyed.
+    void moveFrom(Value& rhs);
     // does not perform check that current type is Object, caller must check it otself.
     const Value* lookup(const String& name) const;
 
+    String& string()
+        { return *reinterpret_cast<String*>(value_.storage_); }
+    const String& string() const
+        { return *reinterpret_cast<const String*>(value_.storage_); }
+    Array& array()
+        { return *reinterpret_cast<Array*>(value_.storage_); }
+    const Array& array() const
+        { return *reinterpret_cast<const Array*>(value_.storage_); }
+    Object& object()
+        { return *reinterpret_cast<Object*>(value_.storage_); }
+    const Object& object() const
+        { return *reinterpret_cast<const Object*>(value_.storage_); }
+
     TYPE type_;
 
+    // Value is incomplete here, so sizes of containers are taken from same containers of other types. Checked by static_assert in rpc_value.cpp.
+    static const size_t kARRAY_SIZE = sizeof(std::vector<int>);
+    static const size_t kOBJECT_SIZE = sizeof(std::map<std::string, int>);
+    static const size_t kSTORAGE_SIZE_ = sizeof(String) > kARRAY_SIZE ? sizeof(String) : kARRAY_SIZE;
+    static const size_t kSTORAGE_SIZE = kSTORAGE_SIZE_ > kOBJECT_SIZE ? kSTORAGE_SIZE_ : kOBJECT_SIZE;
+
     union Value_ {
         bool bool_;
         int int_;
         unsigned int uint_;
         double double_;
-        String* string_;
-        Array* array_;
-        Object* object_;
+        void* align_;
+        char storage_[kSTORAGE_SIZE]; // String, Array or Object constructed in place.
     };
 
     Value_ value_;
@@ -61,6 +61,7 @@
 #include <boost/log/filters.hpp>
 #include <boost/log/formatters.hpp>
 #include <boost/log/sinks/sync_frontend.hpp>
+#include <boost/log/sinks/unlocked_frontend.hpp>
 #include <boost/log/sinks/text_file_backend.hpp>
 #include <boost/log/sinks/debug_output_backend.hpp>
 #include <boost/log/sources/severity_channel_logger.hpp>
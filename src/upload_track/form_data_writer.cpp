@@ -0,0 +1,164 @@
+// Copyright (c) 2014, Alexey Ivanov
+
+#include "stdafx.h"
+#include "form_data_writer.h"
+#include "http_server/request.h"
+#include "plugin/logger.h"
+#include "utils/string_encoding.h"
+#include "utils/util.h"
+#include <boost/algorithm/string.hpp>
+
+namespace {
+using namespace ControlPlugin::PluginLogger;
+ModuleLoggerType& logger()
+    { return getLogManager().getModuleLogger<Http::Server>(); }
+}
+
+namespace UploadTrack
+{
+
+namespace fs = boost::filesystem;
+
+const std::string kUPLOAD_TRACK_TAG("/uploadTrack");
+
+FormDataWriter::FormDataWriter(const fs::wpath& target_dir, const std::vector<std::wstring>& supported_extensions)
+    :
+    target_dir_(target_dir),
+    supported_extensions_(supported_extensions),
+    part_type_(SKIPPED_PART),
+    written_size_(0)
+{
+    current_entry_.is_file = false;
+}
+
+FormDataWriter::~FormDataWriter()
+{
+    boost::system::error_code ignored_ec;
+    if ( file_.is_open() ) {
+        // content was interrupted, do not leave truncated track.
+        file_.close();
+        fs::remove(current_entry_.temp_path, ignored_ec);
+    }
+
+    // request was rejected: unauthenticated, invalid or incomplete.
+    for (const Entry& entry : entries_) {
+        if ( entry.is_file && !entry.temp_path.empty() ) {
+            fs::remove(entry.temp_path, ignored_ec);
+        }
+    }
+}
+
+void FormDataWriter::commit()
+{
+    for (Entry& entry : entries_) {
+        if ( entry.is_file && !entry.temp_path.empty() ) {
+            fs::rename(entry.temp_path, entry.path); // existing file is replaced as it was before.
+            entry.temp_path.clear();
+        }
+    }
+}
+
+bool FormDataWriter::fileTypeSupported(const fs::wpath& path) const
+{
+    const std::wstring ext = path.extension().native();
+    return supported_extensions_.end() != std::find_if(supported_extensions_.begin(), supported_extensions_.end(),
+                                                       [&ext](const std::wstring& supported_ext) { return boost::iequals(supported_ext, ext); }
+                                                       );
+}
+
+void FormDataWriter::partBegin(const Http::MultipartFormDataParser::Part& part)
+{
+    using namespace Utilities;
+
+    current_entry_ = Entry();
+    current_entry_.is_file = part.is_file;
+    part_type_ = SKIPPED_PART;
+
+    if (part.is_file) {
+        // use only name of file, client must not be able to write outside of target directory.
+        const fs::wpath filename = fs::wpath( StringEncoding::utf8_to_utf16(part.filename) ).filename();
+        if ( filename.empty() || filename == L"." || filename == L".." ) {
+            return; // file input of form was left empty.
+        }
+        if ( !fileTypeSupported(filename) ) {
+            AIMP_LOG_SEV(logger(), info) << "Uploaded file " << part.filename << " is skipped since its type is not supported.";
+            return;
+        }
+
+        current_entry_.path = target_dir_ / filename;
+        // temp file is in the same directory, so commit is just rename on the same volume.
+        current_entry_.temp_path = target_dir_ / fs::unique_path(L"upload-%%%%-%%%%-%%%%-%%%%.part");
+        file_.open(current_entry_.temp_path, std::ios::out | std::ios::binary | std::ios::trunc);
+        if ( !file_.is_open() ) {
+            throw std::runtime_error(MakeString() << "Failed to create file " << StringEncoding::utf16_to_utf8( current_entry_.temp_path.native() ));
+        }
+        part_type_ = FILE_PART;
+    } else {
+        part_type_ = TEXT_PART;
+    }
+}
+
+void FormDataWriter::partData(const char* data, size_t size)
+{
+    switch (part_type_) {
+    case FILE_PART:
+        written_size_ += size;
+        if (written_size_ > kMAX_UPLOAD_SIZE) {
+            throw std::runtime_error("Uploaded files are too large"); // destructor removes written part.
+        }
+        if ( !file_.write(data, size) ) {
+            throw std::runtime_error(Utilities::MakeString() << "Failed to write file " << StringEncoding::utf16_to_utf8( current_entry_.temp_path.native() ));
+        }
+        break;
+    case TEXT_PART:
+        if (current_entry_.url.size() + size > kMAX_TEXT_SIZE) {
+            throw std::runtime_error("Text field of uploaded form is too large");
+        }
+        current_entry_.url.append(data, size);
+        break;
+    default:
+        break;
+    }
+}
+
+void FormDataWriter::partEnd()
+{
+    switch (part_type_) {
+    case FILE_PART:
+        file_.close();
+        if ( file_.fail() ) {
+            boost::system::error_code ignored_ec;
+            fs::remove(current_entry_.temp_path, ignored_ec);
+            throw std::runtime_error(Utilities::MakeString() << "Failed to write file " << StringEncoding::utf16_to_utf8( current_entry_.temp_path.native() ));
+        }
+        entries_.push_back(current_entry_);
+        break;
+    case TEXT_PART:
+        entries_.push_back(current_entry_);
+        break;
+    default:
+        break;
+    }
+    part_type_ = SKIPPED_PART;
+}
+
+std::unique_ptr<Http::MultipartFormDataParser> FormDataWriterFactory::createParser(const Http::Request& req, const std::string& content_type)
+{
+    if ( !Utilities::stringStartsWith(req.uri, kUPLOAD_TRACK_TAG) ) {
+        return std::unique_ptr<Http::MultipartFormDataParser>(); // other requests must not write anything to disk.
+    }
+
+    if (!enabled_) {
+        return std::unique_ptr<Http::MultipartFormDataParser>();
+    }
+
+    if ( auth_manager_->enabled() && !auth_manager_->isAuthenticated(req) ) {
+        AIMP_LOG_SEV(logger(), debug) << "Upload request is not authenticated, its files are not written.";
+        return std::unique_ptr<Http::MultipartFormDataParser>(); // client gets 401 from request handler.
+    }
+
+    std::unique_ptr<Http::MultipartFormDataParser::Handler> writer( new FormDataWriter(target_dir_, supported_extensions_) );
+    return std::unique_ptr<Http::MultipartFormDataParser>( new Http::MultipartFormDataParser( content_type, std::move(writer) ) );
+}
+
+} // namespace UploadTrack
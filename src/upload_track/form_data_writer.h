@@ -0,0 +1,111 @@
+// Copyright (c) 2014, Alexey Ivanov
+
+#pragma once
+
+#include "http_server/multipart_form_data_parser.h"
+#include "http_server/mpfd_parser_factory.h"
+#include "http_server/auth_manager.h"
+#include <boost/cstdint.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <vector>
+
+namespace UploadTrack
+{
+
+/*!
+    \brief Receives uploaded form data: each file part is written to file with unique temporary name in target directory
+           as its data arrives, text parts(track URLs) are collected in memory.
+           Writer is created only for authenticated request, but request handler checks it again with the rest of request,
+           so files get their final names only by commit() which is called by upload request handler after checks. Files which were not committed are removed in destructor.
+           Extension of file is checked when part headers are received, parts of unsupported types are skipped
+           before their data is written anywhere.
+           Works in connection I/O thread, so it must not call AIMP.
+*/
+class FormDataWriter : public Http::MultipartFormDataParser::Handler
+{
+public:
+
+    struct Entry
+    {
+        bool is_file;
+        boost::filesystem::wpath path; //!< final location of file.
+        boost::filesystem::wpath temp_path; //!< file where data is received, empty after commit.
+        std::string url; //!< content of text field.
+    };
+    typedef std::vector<Entry> Entries;
+
+    //! Max size of text field.
+    static const size_t kMAX_TEXT_SIZE = 8 * 1024;
+
+    //! Max total size of files of one request, content is rejected as soon as it is exceeded.
+    static const boost::uint64_t kMAX_UPLOAD_SIZE = 1024 * 1024 * 1024;
+
+    FormDataWriter(const boost::filesystem::wpath& target_dir, const std::vector<std::wstring>& supported_extensions);
+
+    //! Removes files which were not written completely or were not committed.
+    ~FormDataWriter();
+
+    virtual void partBegin(const Http::MultipartFormDataParser::Part& part); // throws std::runtime_error
+    virtual void partData(const char* data, size_t size); // throws std::runtime_error
+    virtual void partEnd(); // throws std::runtime_error
+
+    //! Returns completely received files and text fields in order of their arrival.
+    const Entries& entries() const
+        { return entries_; }
+
+    //! Renames received files to their final names. Must be called only for authenticated and validated request.
+    void commit(); // throws boost::filesystem::filesystem_error
+
+private:
+
+    bool fileTypeSupported(const boost::filesystem::wpath& path) const;
+
+    const boost::filesystem::wpath target_dir_;
+    const std::vector<std::wstring> supported_extensions_;
+
+    enum PartType { SKIPPED_PART, FILE_PART, TEXT_PART };
+    PartType part_type_;
+    Entry current_entry_;
+    boost::filesystem::ofstream file_;
+    boost::uint64_t written_size_; //!< total size of file parts of request.
+
+    Entries entries_;
+};
+
+//! Creates parsers which write uploaded tracks to target directory.
+class FormDataWriterFactory : public Http::MPFD::ParserFactory, boost::noncopyable
+{
+public:
+
+    /*!
+        \param enabled - track upload setting, nothing is written to disk if it is false.
+        \param supported_extensions - extensions with leading dot which AIMP can play, they are taken in player thread since AIMP can not be called from I/O threads.
+        \param auth_manager - authentication of HTTP request handler, credentials are checked before any file is created.
+    */
+    FormDataWriterFactory(bool enabled,
+                          const boost::filesystem::wpath& target_dir,
+                          const std::vector<std::wstring>& supported_extensions,
+                          Http::Authentication::AuthManager_ptr auth_manager)
+        :
+        enabled_(enabled),
+        target_dir_(target_dir),
+        supported_extensions_(supported_extensions),
+        auth_manager_(auth_manager)
+    {}
+
+    /*!
+        Returns null for all requests except upload track ones, for upload requests when upload is disabled and for unauthenticated ones.
+        Content of such request is received as usual(its size is limited by request parser) and the request handler rejects it.
+    */
+    virtual std::unique_ptr<Http::MultipartFormDataParser> createParser(const Http::Request& req, const std::string& content_type); // throws std::runtime_error
+
+private:
+
+    const bool enabled_;
+    const boost::filesystem::wpath target_dir_;
+    const std::vector<std::wstring> supported_extensions_;
+    Http::Authentication::AuthManager_ptr auth_manager_;
+};
+
+} // namespace UploadTrack
@@ -2,6 +2,9 @@
 
 #pragma once
 
+#include <string>
+#include <vector>
+
 namespace AIMPPlayer { class AIMPManager; }
 namespace Http {
     struct Request; 
@@ -30,4 +33,7 @@ private:
     bool enabled_;
 };
 
+//! Returns extensions(with leading dot) of tracks which AIMP can play. Must be called in player thread.
+std::vector<std::wstring> getSupportedExtensions(AIMPPlayer::AIMPManager& aimp_manager);
+
 } // namespace UploadTrack
@@ -2,6 +2,7 @@
 
 #include "stdafx.h"
 #include "request_handler.h"
+#include "form_data_writer.h"
 #include "../aimp/manager.h"
 #include "../aimp/manager3.0.h"
 #include "../aimp/manager_impl_common.h"
@@ -23,7 +24,6 @@ namespace fs = boost::filesystem;
 
 void fill_reply_disabled(Http::Reply& rep);
 PlaylistID getPlaylistID(const std::string& uri);
-bool fileTypeSupported(const std::wstring& ext_to_check, AIMPPlayer::AIMPManager& aimp_manager);
 
 const std::string kPlaylistIDTag("/playlist_id/");
 
@@ -36,6 +36,14 @@ bool RequestHandler::handle_request(const Http::Request& req, Http::Reply& rep)
         return true;
     }
 
+    // tracks were written to temp files by FormDataWriter while request content was received.
+    FormDataWriter* form_data = req.mpfd_parser ? dynamic_cast<FormDataWriter*>( &req.mpfd_parser->handler() )
+                                                : nullptr;
+    if (!form_data || !req.mpfd_parser->finished()) {
+        rep = Reply::stock_reply(Reply::bad_request);
+        return true;
+    }
+
     try {
         const PlaylistID playlist_id = getPlaylistID(req.uri);
 
@@ -49,37 +57,18 @@ bool RequestHandler::handle_request(const Http::Request& req, Http::Reply& rep)
         };
         ON_BLOCK_EXIT(unlock_playlist, playlist_id);
 
-        for (auto field_it : req.mpfd_parser->GetFieldsMap()) {
-            const MPFD::Field& field_const = *field_it.second;
-            MPFD::Field& field = const_cast<MPFD::Field&>(field_const);
-
-            switch (field.GetType()) {
-            case MPFD::Field::FileType:
-                {
-                const std::wstring filename = StringEncoding::utf8_to_utf16( field.GetFileName() );
-                const fs::wpath path = fs::path(field.GetTempFileName()).parent_path() / filename;
-                if (!fileTypeSupported(path.extension().native(), aimp_manager_)) {
-                    continue;
-                }
-                fs::copy_file(field.GetTempFileName(), path, fs::copy_option::overwrite_if_exists); // can't use rename here since parser will close file in Field's dtor.
-                aimp_manager_.addFileToPlaylist(path, playlist_id);
-                // we should not erase file since AIMP will use it.
-                //fs::remove(path);
-                break;
-                }
-            case MPFD::Field::TextType:
-                {
-                aimp_manager_.addURLToPlaylist(field.GetTextTypeContent(), playlist_id);
-                break;
-                }
-            default:
-                assert(!"unexpected type");
-                break;
+        // request is authenticated and valid, files can take their final names. Otherwise FormDataWriter removes them.
+        form_data->commit();
+
+        for (const FormDataWriter::Entry& entry : form_data->entries()) {
+            if (entry.is_file) {
+                // file was written to its final location while content was received. We should not erase it since AIMP will use it.
+                aimp_manager_.addFileToPlaylist(entry.path, playlist_id);
+            } else {
+                aimp_manager_.addURLToPlaylist(entry.url, playlist_id);
             }
         }
         rep = Reply::stock_reply(Reply::ok);
-    } catch (MPFD::Exception&) {
-        rep = Reply::stock_reply(Reply::bad_request);
     } catch (std::exception& e) {
         (void)e;
         rep = Reply::stock_reply(Reply::forbidden);
@@ -87,30 +76,30 @@ bool RequestHandler::handle_request(const Http::Request& req, Http::Reply& rep)
     return true;
 }
 
-bool fileTypeSupported(const std::wstring& ext_to_check, AIMPPlayer::AIMPManager& aimp_manager)
+std::vector<std::wstring> getSupportedExtensions(AIMPPlayer::AIMPManager& aimp_manager)
 {
-    static std::vector<std::wstring> exts;
-
-    if (exts.empty()) {
-    #pragma warning (push, 3)
-        std::wstring exts_str;
-        if (AIMPManager30* aimp3_manager = dynamic_cast<AIMPManager30*>(&aimp_manager)) {
-            exts_str = aimp3_manager->supportedTrackExtentions();
-        } else {
-            exts_str = L"*.aiff;*.aif;*.mp3;*.mp2;*.mp1;*.ogg;*.oga;*.wav;*.umx;*.mod;*.mo3;*.it;*.s3m;*.mtm;*.xm;*.aac;*.m4a;*.m4b;*.mp4;*.ac3;*.ape;*.mac;*.flac;*.fla;*.midi;*.mid;*.rmi;*.kar;*.mpc;*.mp+;*.mpp;*.opus;*.spx;*.tta;*.wma;*.wv;*.ofr;*.ofs;*.tak;*.cda;"; // got from aimp3.
-        }
-        
-        boost::split(exts, exts_str,
-                     [](std::wstring::value_type c) { return c == L';'; }
-                     );
-    #pragma warning (pop)
-        for (auto& ext : exts) {
-            ext.erase(0, 1); // remove '*'
-        }
+    std::vector<std::wstring> exts;
+#pragma warning (push, 3)
+    std::wstring exts_str;
+    if (AIMPManager30* aimp3_manager = dynamic_cast<AIMPManager30*>(&aimp_manager)) {
+        exts_str = aimp3_manager->supportedTrackExtentions();
+    } else {
+        exts_str = L"*.aiff;*.aif;*.mp3;*.mp2;*.mp1;*.ogg;*.oga;*.wav;*.umx;*.mod;*.mo3;*.it;*.s3m;*.mtm;*.xm;*.aac;*.m4a;*.m4b;*.mp4;*.ac3;*.ape;*.mac;*.flac;*.fla;*.midi;*.mid;*.rmi;*.kar;*.mpc;*.mp+;*.mpp;*.opus;*.spx;*.tta;*.wma;*.wv;*.ofr;*.ofs;*.tak;*.cda;"; // got from aimp3.
+    }
+
+    boost::split(exts, exts_str,
+                 [](std::wstring::value_type c) { return c == L';'; }
+                 );
+#pragma warning (pop)
+    for (auto& ext : exts) {
+        ext.erase(0, 1); // remove '*'
     }
-    return exts.end() != std::find_if(exts.begin(), exts.end(),
-                                      [ext_to_check](const std::wstring& ext) { return ext == ext_to_check; }
-                                      );
+    exts.erase(std::remove_if(exts.begin(), exts.end(),
+                              [](const std::wstring& ext) { return ext.empty(); }
+                              ),
+               exts.end()
+               ); // trailing ';' gives empty item which would allow files without extension.
+    return exts;
 }
 
 void fill_reply_disabled(Http::Reply& rep)
@@ -0,0 +1,304 @@
+// Copyright (c) 2014, Alexey Ivanov
+
+#include "stdafx.h"
+#include "deflate_decoder.h"
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+namespace Utilities
+{
+
+namespace
+{
+
+const unsigned int kMAX_BITS = 15;
+const size_t kMAX_LITLEN_CODES = 288;
+const size_t kMAX_DISTANCE_CODES = 30;
+const size_t kCODELEN_CODES = 19;
+const unsigned int kEND_OF_BLOCK = 256;
+const unsigned int kFIRST_LENGTH_CODE = 257;
+
+const unsigned short kLENGTH_BASE[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                          35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+const unsigned char kLENGTH_EXTRA_BITS[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                               3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+const unsigned short kDISTANCE_BASE[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+                                            257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+const unsigned char kDISTANCE_EXTRA_BITS[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+                                                 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+const unsigned char kCODELEN_ORDER[kCODELEN_CODES] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+//! Reads bits starting from least significant bit of byte as deflate packs them.
+class BitReader
+{
+public:
+    BitReader(const char* data, size_t size)
+        :
+        data_( reinterpret_cast<const unsigned char*>(data) ),
+        size_(size),
+        pos_(0),
+        bit_buffer_(0),
+        bit_count_(0)
+    {}
+
+    unsigned int bits(unsigned int count) // throws std::runtime_error
+    {
+        while (bit_count_ < count) {
+            if (pos_ == size_) {
+                throw std::runtime_error("Unexpected end of deflate data");
+            }
+            bit_buffer_ |= static_cast<unsigned int>(data_[pos_++]) << bit_count_;
+            bit_count_ += 8;
+        }
+        const unsigned int value = bit_buffer_ & ( (1u << count) - 1 );
+        bit_buffer_ >>= count;
+        bit_count_ -= count;
+        return value;
+    }
+
+    //! Skips rest of bits of current byte. Bytes are read one by one, so buffer never contains whole byte here.
+    void alignToByte()
+    {
+        bit_buffer_ = 0;
+        bit_count_ = 0;
+    }
+
+    //! Returns pointer to size bytes and skips them. Reader must be aligned to byte.
+    const unsigned char* bytes(size_t size) // throws std::runtime_error
+    {
+        assert(bit_count_ == 0);
+        if (size_ - pos_ < size) {
+            throw std::runtime_error("Unexpected end of deflate data");
+        }
+        const unsigned char* result = data_ + pos_;
+        pos_ += size;
+        return result;
+    }
+
+    bool atEnd() const
+        { return pos_ == size_; }
+
+private:
+
+    const unsigned char* data_;
+    size_t size_,
+           pos_;
+    unsigned int bit_buffer_,
+                 bit_count_;
+};
+
+//! Canonical Huffman code: count of codes of each length and symbols ordered by code.
+struct Huffman
+{
+    unsigned short count[kMAX_BITS + 1];
+    unsigned short symbol[kMAX_LITLEN_CODES];
+};
+
+void buildHuffman(const unsigned char* lengths, size_t count, Huffman* huffman) // throws std::runtime_error
+{
+    std::fill(huffman->count, huffman->count + kMAX_BITS + 1, 0);
+    for (size_t i = 0; i != count; ++i) {
+        ++huffman->count[ lengths[i] ];
+    }
+
+    // incomplete code is allowed(single distance code for example), over-subscribed is not.
+    int left = 1;
+    for (unsigned int length = 1; length <= kMAX_BITS; ++length) {
+        left <<= 1;
+        left -= huffman->count[length];
+        if (left < 0) {
+            throw std::runtime_error("Over-subscribed Huffman code in deflate data");
+        }
+    }
+
+    unsigned short offsets[kMAX_BITS + 1];
+    offsets[1] = 0;
+    for (unsigned int length = 1; length < kMAX_BITS; ++length) {
+        offsets[length + 1] = offsets[length] + huffman->count[length];
+    }
+    for (size_t i = 0; i != count; ++i) {
+        if (lengths[i] != 0) {
+            huffman->symbol[ offsets[ lengths[i] ]++ ] = static_cast<unsigned short>(i);
+        }
+    }
+}
+
+unsigned int decodeSymbol(BitReader& in, const Huffman& huffman) // throws std::runtime_error
+{
+    // codes are written starting from most significant bit, so read them bit by bit.
+    int code = 0,
+        first = 0,
+        index = 0;
+    for (unsigned int length = 1; length <= kMAX_BITS; ++length) {
+        code |= in.bits(1);
+        const int count = huffman.count[length];
+        if (code - first < count) {
+            return huffman.symbol[index + code - first];
+        }
+        index += count;
+        first = (first + count) << 1;
+        code <<= 1;
+    }
+    throw std::runtime_error("Invalid Huffman code in deflate data");
+}
+
+void decodeCodes(BitReader& in, const Huffman& litlen, const Huffman& distance, size_t start, size_t max_size, std::string* out) // throws std::runtime_error
+{
+    for (;;) {
+        const unsigned int symbol = decodeSymbol(in, litlen);
+        if (symbol < kEND_OF_BLOCK) {
+            if (out->size() - start >= max_size) {
+                throw std::runtime_error("Deflate data is too large");
+            }
+            out->push_back( static_cast<char>(symbol) );
+        } else if (symbol == kEND_OF_BLOCK) {
+            return;
+        } else {
+            const unsigned int length_index = symbol - kFIRST_LENGTH_CODE;
+            if (length_index >= 29) {
+                throw std::runtime_error("Invalid length code in deflate data");
+            }
+            const size_t length = kLENGTH_BASE[length_index] + in.bits(kLENGTH_EXTRA_BITS[length_index]);
+
+            const unsigned int distance_index = decodeSymbol(in, distance);
+            if (distance_index >= kMAX_DISTANCE_CODES) {
+                throw std::runtime_error("Invalid distance code in deflate data");
+            }
+            const size_t dist = kDISTANCE_BASE[distance_index] + in.bits(kDISTANCE_EXTRA_BITS[distance_index]);
+            if (dist > out->size() - start) {
+                throw std::runtime_error("Distance is too far back in deflate data");
+            }
+            if (out->size() - start + length > max_size) {
+                throw std::runtime_error("Deflate data is too large");
+            }
+
+            // source and destination can overlap, copy byte by byte.
+            for (size_t from = out->size() - dist, i = 0; i != length; ++i) {
+                out->push_back( (*out)[from + i] );
+            }
+        }
+    }
+}
+
+void decodeStoredBlock(BitReader& in, size_t start, size_t max_size, std::string* out) // throws std::runtime_error
+{
+    in.alignToByte();
+    const unsigned int length = in.bits(16),
+                       length_complement = in.bits(16);
+    if ( length != (~length_complement & 0xFFFF) ) {
+        throw std::runtime_error("Invalid stored block length in deflate data");
+    }
+    if (out->size() - start + length > max_size) {
+        throw std::runtime_error("Deflate data is too large");
+    }
+    out->append( reinterpret_cast<const char*>( in.bytes(length) ), length );
+}
+
+void decodeFixedBlock(BitReader& in, size_t start, size_t max_size, std::string* out) // throws std::runtime_error
+{
+    unsigned char lengths[kMAX_LITLEN_CODES];
+    for (size_t i = 0; i != kMAX_LITLEN_CODES; ++i) {
+        lengths[i] = i < 144 ? 8
+                             : i < 256 ? 9
+                                       : i < 280 ? 7
+                                                 : 8;
+    }
+    Huffman litlen;
+    buildHuffman(lengths, kMAX_LITLEN_CODES, &litlen);
+
+    std::fill(lengths, lengths + kMAX_DISTANCE_CODES, 5);
+    Huffman distance;
+    buildHuffman(lengths, kMAX_DISTANCE_CODES, &distance);
+
+    decodeCodes(in, litlen, distance, start, max_size, out);
+}
+
+void decodeDynamicBlock(BitReader& in, size_t start, size_t max_size, std::string* out) // throws std::runtime_error
+{
+    const size_t litlen_count = in.bits(5) + kFIRST_LENGTH_CODE,
+                 distance_count = in.bits(5) + 1,
+                 codelen_count = in.bits(4) + 4;
+    if (litlen_count > 286 || distance_count > kMAX_DISTANCE_CODES) {
+        throw std::runtime_error("Invalid code counts in deflate data");
+    }
+
+    unsigned char lengths[kMAX_LITLEN_CODES + kMAX_DISTANCE_CODES] = {0};
+    for (size_t i = 0; i != codelen_count; ++i) {
+        lengths[ kCODELEN_ORDER[i] ] = static_cast<unsigned char>( in.bits(3) );
+    }
+    Huffman codelen;
+    buildHuffman(lengths, kCODELEN_CODES, &codelen);
+
+    // code lengths of both codes are run-length encoded as single sequence.
+    const size_t all_lengths_count = litlen_count + distance_count;
+    for (size_t i = 0; i != all_lengths_count; ) {
+        const unsigned int symbol = decodeSymbol(in, codelen);
+        if (symbol < 16) {
+            lengths[i++] = static_cast<unsigned char>(symbol);
+            continue;
+        }
+
+        unsigned char length = 0;
+        size_t repeat;
+        if (symbol == 16) {
+            if (i == 0) {
+                throw std::runtime_error("Repeat of missing code length in deflate data");
+            }
+            length = lengths[i - 1];
+            repeat = 3 + in.bits(2);
+        } else if (symbol == 17) {
+            repeat = 3 + in.bits(3);
+        } else {
+            repeat = 11 + in.bits(7);
+        }
+        if (i + repeat > all_lengths_count) {
+            throw std::runtime_error("Too many code lengths in deflate data");
+        }
+        std::fill(lengths + i, lengths + i + repeat, length);
+        i += repeat;
+    }
+
+    if (lengths[kEND_OF_BLOCK] == 0) {
+        throw std::runtime_error("Missing end of block code in deflate data");
+    }
+
+    Huffman litlen, distance;
+    buildHuffman(lengths, litlen_count, &litlen);
+    buildHuffman(lengths + litlen_count, distance_count, &distance);
+
+    decodeCodes(in, litlen, distance, start, max_size, out);
+}
+
+} // namespace anonymous
+
+void decodeDeflate(const char* data, size_t size, size_t max_size, std::string* out)
+{
+    assert(out);
+
+    BitReader in(data, size);
+    const size_t start = out->size();
+    bool last_block;
+    do {
+        last_block = in.bits(1) != 0;
+        switch ( in.bits(2) ) {
+        case 0:
+            in.alignToByte();
+            if ( !last_block && in.atEnd() ) {
+                break; // empty stored block of sync flush: its LEN and NLEN(00 00 FF FF) are removed from WebSocket message(RFC 7692).
+            }
+            decodeStoredBlock(in, start, max_size, out);
+            break;
+        case 1:
+            decodeFixedBlock(in, start, max_size, out);
+            break;
+        case 2:
+            decodeDynamicBlock(in, start, max_size, out);
+            break;
+        default:
+            throw std::runtime_error("Invalid block type in deflate data");
+        }
+    } while ( !last_block && !in.atEnd() );
+}
+
+} // namespace Utilities
@@ -0,0 +1,18 @@
+// Copyright (c) 2014, Alexey Ivanov
+
+#pragma once
+
+#include <string>
+
+namespace Utilities
+{
+
+/*!
+    \brief Decodes raw deflate data(RFC 1951) and appends it to out.
+           Decoding stops after final block or at the end of input if it ends on block boundary,
+           so data which ends with sync flush(per-message deflate of WebSocket) is accepted as well.
+    \param max_size - max size of decoded data, decoding fails if data is larger.
+*/
+void decodeDeflate(const char* data, size_t size, size_t max_size, std::string* out); // throws std::runtime_error
+
+} // namespace Utilities
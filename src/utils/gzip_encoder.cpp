@@ -0,0 +1,548 @@
+// Copyright (c) 2014, Alexey Ivanov
+
+#include "stdafx.h"
+#include "gzip_encoder.h"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <functional>
+#include <queue>
+
+namespace Utilities
+{
+
+namespace
+{
+
+const size_t kWINDOW_SIZE = 32768;
+const size_t kWINDOW_MASK = kWINDOW_SIZE - 1;
+const size_t kBUFFER_SIZE = 2 * kWINDOW_SIZE; // window and lookahead, window is slid when buffer is full.
+const size_t kMIN_MATCH = 3;
+const size_t kMAX_MATCH = 258;
+const size_t kHASH_SIZE = 1 << 15;
+const size_t kMAX_BLOCK_SYMBOLS = 16384;
+const int kNIL = -1;
+
+const size_t kLITLEN_CODES = 286;
+const size_t kFIXED_LITLEN_CODES = 288;
+const size_t kDISTANCE_CODES = 30;
+const size_t kCODELEN_CODES = 19;
+const unsigned int kEND_OF_BLOCK = 256;
+const unsigned int kFIRST_LENGTH_CODE = 257;
+const unsigned int kMAX_BITS = 15;
+const unsigned int kMAX_CODELEN_BITS = 7;
+
+const unsigned short kLENGTH_BASE[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                          35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+const unsigned char kLENGTH_EXTRA_BITS[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                               3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+const unsigned short kDISTANCE_BASE[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+                                            257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+const unsigned char kDISTANCE_EXTRA_BITS[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+                                                 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+const unsigned char kCODELEN_ORDER[kCODELEN_CODES] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+const unsigned char kCODELEN_EXTRA_BITS[kCODELEN_CODES] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 3, 7 };
+
+struct LevelConfig
+{
+    size_t max_chain; //!< max count of checked hash chain entries.
+    size_t nice_length; //!< stop search if match of this length is found.
+};
+
+const LevelConfig kLEVELS[9] = { {4, 8}, {8, 16}, {16, 32}, {32, 32}, {64, 64},
+                                 {128, 128}, {256, 128}, {1024, kMAX_MATCH}, {4096, kMAX_MATCH} };
+
+unsigned int lengthIndex(size_t length)
+{
+    return static_cast<unsigned int>( std::upper_bound(kLENGTH_BASE, kLENGTH_BASE + 29, length) - kLENGTH_BASE ) - 1;
+}
+
+unsigned int distanceIndex(size_t distance)
+{
+    return static_cast<unsigned int>( std::upper_bound(kDISTANCE_BASE, kDISTANCE_BASE + 30, distance) - kDISTANCE_BASE ) - 1;
+}
+
+unsigned short reverseBits(unsigned int code, unsigned int length)
+{
+    unsigned int result = 0;
+    for (unsigned int i = 0; i != length; ++i) {
+        result = (result << 1) | (code & 1);
+        code >>= 1;
+    }
+    return static_cast<unsigned short>(result);
+}
+
+/*!
+    \brief Builds Huffman code lengths which do not exceed max_bits.
+           If tree is too deep frequencies are halved and tree is rebuilt.
+           Single used symbol gets a pair since some decoders reject incomplete codes.
+*/
+void buildCodeLengths(const unsigned int* freqs, size_t count, unsigned int max_bits, unsigned char* lengths)
+{
+    struct Node
+    {
+        unsigned int weight;
+        int left, right; // leaf has left == kNIL and symbol in right.
+    };
+    typedef std::pair<unsigned int, int> QueueItem; // weight, node index.
+
+    std::vector<unsigned int> weights(freqs, freqs + count);
+    for (;;) {
+        std::fill(lengths, lengths + count, 0);
+
+        std::vector<Node> nodes;
+        std::priority_queue< QueueItem, std::vector<QueueItem>, std::greater<QueueItem> > queue;
+        for (size_t i = 0; i != count; ++i) {
+            if (weights[i] != 0) {
+                const Node leaf = { weights[i], kNIL, static_cast<int>(i) };
+                nodes.push_back(leaf);
+                queue.push( QueueItem( leaf.weight, static_cast<int>(nodes.size() - 1) ) );
+            }
+        }
+
+        if (nodes.empty()) {
+            return;
+        } else if (nodes.size() == 1) {
+            lengths[nodes[0].right] = 1;
+            lengths[nodes[0].right == 0 ? 1 : 0] = 1;
+            return;
+        }
+
+        while (queue.size() > 1) {
+            const QueueItem a = queue.top();
+            queue.pop();
+            const QueueItem b = queue.top();
+            queue.pop();
+            const Node parent = { a.first + b.first, a.second, b.second };
+            nodes.push_back(parent);
+            queue.push( QueueItem( parent.weight, static_cast<int>(nodes.size() - 1) ) );
+        }
+
+        // parent is always placed after its children, so walk from root to leaves.
+        std::vector<unsigned int> depths(nodes.size(), 0);
+        unsigned int max_depth = 0;
+        for (size_t i = nodes.size(); i-- != 0; ) {
+            const Node& node = nodes[i];
+            if (node.left == kNIL) {
+                lengths[node.right] = static_cast<unsigned char>(depths[i]);
+                max_depth = std::max(max_depth, depths[i]);
+            } else {
+                depths[node.left] = depths[node.right] = depths[i] + 1;
+            }
+        }
+
+        if (max_depth <= max_bits) {
+            return;
+        }
+
+        for (auto& weight : weights) {
+            if (weight != 0) {
+                weight = (weight >> 1) | 1;
+            }
+        }
+    }
+}
+
+//! Assigns canonical Huffman codes. Codes are bit reversed since deflate writes them starting from most significant bit.
+void makeCodes(const unsigned char* lengths, size_t count, unsigned short* codes)
+{
+    unsigned int length_count[kMAX_BITS + 1] = {0};
+    for (size_t i = 0; i != count; ++i) {
+        ++length_count[ lengths[i] ];
+    }
+    length_count[0] = 0;
+
+    unsigned int next_code[kMAX_BITS + 1] = {0};
+    unsigned int code = 0;
+    for (unsigned int bits = 1; bits <= kMAX_BITS; ++bits) {
+        code = (code + length_count[bits - 1]) << 1;
+        next_code[bits] = code;
+    }
+
+    for (size_t i = 0; i != count; ++i) {
+        const unsigned int length = lengths[i];
+        codes[i] = length != 0 ? reverseBits(next_code[length]++, length) : 0;
+    }
+}
+
+//! Codes of block type 1 defined by RFC 1951.
+struct FixedCodes
+{
+    unsigned char litlen_lengths[kFIXED_LITLEN_CODES];
+    unsigned short litlen_codes[kFIXED_LITLEN_CODES];
+    unsigned char distance_lengths[kDISTANCE_CODES];
+    unsigned short distance_codes[kDISTANCE_CODES];
+
+    FixedCodes()
+    {
+        for (size_t i = 0; i != kFIXED_LITLEN_CODES; ++i) {
+            litlen_lengths[i] = i < 144 ? 8
+                                        : i < 256 ? 9
+                                                  : i < 280 ? 7
+                                                            : 8;
+        }
+        std::fill(distance_lengths, distance_lengths + kDISTANCE_CODES, 5);
+        makeCodes(litlen_lengths, kFIXED_LITLEN_CODES, litlen_codes);
+        makeCodes(distance_lengths, kDISTANCE_CODES, distance_codes);
+    }
+};
+
+const FixedCodes kFIXED_CODES; // initialized on module load to avoid race on first use from several threads.
+
+} // namespace anonymous
+
+GzipEncoder::GzipEncoder(int level, std::string* out, Format format)
+    :
+    out_(out),
+    format_(format),
+    window_(kBUFFER_SIZE),
+    pos_(0),
+    end_(0),
+    head_(kHASH_SIZE, kNIL),
+    prev_(kWINDOW_SIZE, kNIL),
+    litlen_freqs_(kLITLEN_CODES, 0),
+    distance_freqs_(kDISTANCE_CODES, 0),
+    bit_buffer_(0),
+    bit_count_(0),
+    input_size_(0)
+{
+    assert(out_);
+
+    level = std::max( 1, std::min(level, 9) );
+    max_chain_ = kLEVELS[level - 1].max_chain;
+    nice_length_ = kLEVELS[level - 1].nice_length;
+
+    symbols_.reserve(kMAX_BLOCK_SYMBOLS);
+
+    if (format_ != GZIP) {
+        return;
+    }
+
+    // gzip header: magic, deflate method, no flags, no modification time, extra flags, unknown OS.
+    const char header[10] = { '\x1F', '\x8B', 8, 0, 0, 0, 0, 0, static_cast<char>(level == 9 ? 2 : level == 1 ? 4 : 0), '\xFF' };
+    out_->append( header, sizeof(header) );
+}
+
+void GzipEncoder::write(const char* data, size_t size)
+{
+    if (format_ == GZIP) {
+        crc_.process_bytes(data, size);
+        input_size_ += static_cast<unsigned int>(size);
+    }
+
+    while (size != 0) {
+        const size_t portion = std::min(size, kBUFFER_SIZE - end_);
+        memcpy(&window_[end_], data, portion);
+        end_ += portion;
+        data += portion;
+        size -= portion;
+
+        if (end_ == kBUFFER_SIZE) {
+            deflate(false);
+            slideWindow();
+        }
+    }
+}
+
+void GzipEncoder::finish()
+{
+    deflate(true);
+
+    if (format_ == DEFLATE_MESSAGE) {
+        // sync flush: last data block is not final, empty stored block aligns data to byte boundary.
+        // LEN and NLEN of stored block(00 00 FF FF) are not written, receiver appends them itself.
+        flushBlock(false);
+        putBits(0, 3);
+        flushBits();
+        return;
+    }
+
+    flushBlock(true);
+    flushBits();
+
+    const unsigned int trailer[2] = { crc_.checksum(), input_size_ };
+    for (size_t i = 0; i != 2; ++i) {
+        for (unsigned int shift = 0; shift != 32; shift += 8) {
+            out_->push_back( static_cast<char>( (trailer[i] >> shift) & 0xFF ) );
+        }
+    }
+}
+
+void GzipEncoder::deflate(bool flush)
+{
+    // keep lookahead of max match length unless input is finished.
+    const size_t limit = flush ? end_
+                               : end_ > kMAX_MATCH ? end_ - kMAX_MATCH : 0;
+    while (pos_ < limit) {
+        size_t length = 0,
+               distance = 0;
+        if (end_ - pos_ >= kMIN_MATCH) {
+            length = findMatch(pos_, end_ - pos_, &distance);
+            insertHash(pos_);
+        }
+
+        if (length != 0) {
+            addMatch(length, distance);
+            for (const size_t match_end = pos_ + length; ++pos_ != match_end; ) {
+                if (end_ - pos_ >= kMIN_MATCH) {
+                    insertHash(pos_);
+                }
+            }
+        } else {
+            addLiteral(window_[pos_]);
+            ++pos_;
+        }
+    }
+}
+
+void GzipEncoder::insertHash(size_t pos)
+{
+    const size_t hash = ( (window_[pos] << 10) ^ (window_[pos + 1] << 5) ^ window_[pos + 2] ) & (kHASH_SIZE - 1);
+    prev_[pos & kWINDOW_MASK] = head_[hash];
+    head_[hash] = static_cast<int>(pos);
+}
+
+size_t GzipEncoder::findMatch(size_t pos, size_t lookahead, size_t* distance)
+{
+    const size_t hash = ( (window_[pos] << 10) ^ (window_[pos + 1] << 5) ^ window_[pos + 2] ) & (kHASH_SIZE - 1);
+    const size_t max_length = std::min(lookahead, kMAX_MATCH);
+    const unsigned char* const current = &window_[pos];
+    size_t best_length = kMIN_MATCH - 1;
+
+    int candidate = head_[hash];
+    for (size_t chain = max_chain_; candidate != kNIL && chain != 0; --chain) {
+        const size_t candidate_pos = static_cast<size_t>(candidate);
+        if (pos - candidate_pos >= kWINDOW_SIZE) {
+            break; // prev_ entries of older positions are already overwritten.
+        }
+
+        const unsigned char* const match = &window_[candidate_pos];
+        if (match[best_length] == current[best_length] && match[0] == current[0]) {
+            size_t length = 0;
+            while (length < max_length && match[length] == current[length]) {
+                ++length;
+            }
+            if (length > best_length) {
+                best_length = length;
+                *distance = pos - candidate_pos;
+                if (length >= nice_length_ || length == max_length) {
+                    break;
+                }
+            }
+        }
+
+        const int next = prev_[candidate_pos & kWINDOW_MASK];
+        if (next >= candidate) {
+            break;
+        }
+        candidate = next;
+    }
+
+    return best_length >= kMIN_MATCH ? best_length : 0;
+}
+
+void GzipEncoder::slideWindow()
+{
+    assert(pos_ >= kWINDOW_SIZE);
+
+    memmove(&window_[0], &window_[kWINDOW_SIZE], end_ - kWINDOW_SIZE);
+    pos_ -= kWINDOW_SIZE;
+    end_ -= kWINDOW_SIZE;
+
+    const int offset = static_cast<int>(kWINDOW_SIZE);
+    for (auto& position : head_) {
+        position = position >= offset ? position - offset : kNIL;
+    }
+    for (auto& position : prev_) {
+        position = position >= offset ? position - offset : kNIL;
+    }
+}
+
+void GzipEncoder::addLiteral(unsigned char c)
+{
+    const Symbol symbol = { c, 0 };
+    symbols_.push_back(symbol);
+    ++litlen_freqs_[c];
+
+    if (symbols_.size() == kMAX_BLOCK_SYMBOLS) {
+        flushBlock(false);
+    }
+}
+
+void GzipEncoder::addMatch(size_t length, size_t distance)
+{
+    const Symbol symbol = { static_cast<unsigned short>(length), static_cast<unsigned short>(distance) };
+    symbols_.push_back(symbol);
+    ++litlen_freqs_[kFIRST_LENGTH_CODE + lengthIndex(length)];
+    ++distance_freqs_[ distanceIndex(distance) ];
+
+    if (symbols_.size() == kMAX_BLOCK_SYMBOLS) {
+        flushBlock(false);
+    }
+}
+
+void GzipEncoder::flushBlock(bool last)
+{
+    ++litlen_freqs_[kEND_OF_BLOCK];
+
+    unsigned char litlen_lengths[kLITLEN_CODES],
+                  distance_lengths[kDISTANCE_CODES];
+    buildCodeLengths(&litlen_freqs_[0], kLITLEN_CODES, kMAX_BITS, litlen_lengths);
+    buildCodeLengths(&distance_freqs_[0], kDISTANCE_CODES, kMAX_BITS, distance_lengths);
+
+    // trailing zero lengths are not transmitted.
+    size_t litlen_count = kLITLEN_CODES;
+    while (litlen_count > kFIRST_LENGTH_CODE && litlen_lengths[litlen_count - 1] == 0) {
+        --litlen_count;
+    }
+    size_t distance_count = kDISTANCE_CODES;
+    while (distance_count > 1 && distance_lengths[distance_count - 1] == 0) {
+        --distance_count;
+    }
+
+    // run-length encoding of code lengths: 16 - repeat previous length 3-6 times, 17 - repeat zero 3-10 times, 18 - repeat zero 11-138 times.
+    unsigned char all_lengths[kLITLEN_CODES + kDISTANCE_CODES];
+    std::copy(litlen_lengths, litlen_lengths + litlen_count, all_lengths);
+    std::copy(distance_lengths, distance_lengths + distance_count, all_lengths + litlen_count);
+    const size_t all_lengths_count = litlen_count + distance_count;
+
+    std::vector< std::pair<unsigned char, unsigned char> > codelen_symbols; // symbol, value of extra bits.
+    unsigned int codelen_freqs[kCODELEN_CODES] = {0};
+    auto addCodelenSymbol = [&](size_t symbol, size_t extra) {
+        codelen_symbols.push_back( std::make_pair( static_cast<unsigned char>(symbol), static_cast<unsigned char>(extra) ) );
+        ++codelen_freqs[symbol];
+    };
+    for (size_t i = 0; i != all_lengths_count; ) {
+        const unsigned char length = all_lengths[i];
+        size_t run = 1;
+        while (i + run != all_lengths_count && all_lengths[i + run] == length) {
+            ++run;
+        }
+        i += run;
+
+        if (length == 0) {
+            while (run >= 11) {
+                const size_t portion = std::min<size_t>(run, 138);
+                addCodelenSymbol(18, portion - 11);
+                run -= portion;
+            }
+            if (run >= 3) {
+                addCodelenSymbol(17, run - 3);
+                run = 0;
+            }
+        } else {
+            addCodelenSymbol(length, 0);
+            --run;
+            while (run >= 3) {
+                const size_t portion = std::min<size_t>(run, 6);
+                addCodelenSymbol(16, portion - 3);
+                run -= portion;
+            }
+        }
+        for (; run != 0; --run) {
+            addCodelenSymbol(length, 0);
+        }
+    }
+
+    unsigned char codelen_lengths[kCODELEN_CODES];
+    buildCodeLengths(codelen_freqs, kCODELEN_CODES, kMAX_CODELEN_BITS, codelen_lengths);
+    size_t codelen_count = kCODELEN_CODES;
+    while (codelen_count > 4 && codelen_lengths[ kCODELEN_ORDER[codelen_count - 1] ] == 0) {
+        --codelen_count;
+    }
+
+    // choose coding which gives shorter block. Extra bits of lengths and distances are the same for both.
+    size_t dynamic_bits = 5 + 5 + 4 + codelen_count * 3,
+           fixed_bits = 0;
+    for (size_t i = 0; i != kCODELEN_CODES; ++i) {
+        dynamic_bits += codelen_freqs[i] * (codelen_lengths[i] + kCODELEN_EXTRA_BITS[i]);
+    }
+    for (size_t i = 0; i != kLITLEN_CODES; ++i) {
+        dynamic_bits += litlen_freqs_[i] * litlen_lengths[i];
+        fixed_bits += litlen_freqs_[i] * kFIXED_CODES.litlen_lengths[i];
+    }
+    for (size_t i = 0; i != kDISTANCE_CODES; ++i) {
+        dynamic_bits += distance_freqs_[i] * distance_lengths[i];
+        fixed_bits += distance_freqs_[i] * kFIXED_CODES.distance_lengths[i];
+    }
+    const bool use_fixed_codes = fixed_bits <= dynamic_bits;
+
+    unsigned short dynamic_litlen_codes[kLITLEN_CODES],
+                   dynamic_distance_codes[kDISTANCE_CODES];
+    const unsigned char* litlen_code_lengths = kFIXED_CODES.litlen_lengths;
+    const unsigned short* litlen_codes = kFIXED_CODES.litlen_codes;
+    const unsigned char* distance_code_lengths = kFIXED_CODES.distance_lengths;
+    const unsigned short* distance_codes = kFIXED_CODES.distance_codes;
+
+    putBits(last ? 1 : 0, 1);
+    if (use_fixed_codes) {
+        putBits(1, 2);
+    } else {
+        putBits(2, 2);
+
+        unsigned short codelen_codes[kCODELEN_CODES];
+        makeCodes(codelen_lengths, kCODELEN_CODES, codelen_codes);
+        makeCodes(litlen_lengths, kLITLEN_CODES, dynamic_litlen_codes);
+        makeCodes(distance_lengths, kDISTANCE_CODES, dynamic_distance_codes);
+
+        putBits(static_cast<unsigned int>(litlen_count - kFIRST_LENGTH_CODE), 5);
+        putBits(static_cast<unsigned int>(distance_count - 1), 5);
+        putBits(static_cast<unsigned int>(codelen_count - 4), 4);
+        for (size_t i = 0; i != codelen_count; ++i) {
+            putBits(codelen_lengths[ kCODELEN_ORDER[i] ], 3);
+        }
+        for (const auto& codelen_symbol : codelen_symbols) {
+            const unsigned char symbol = codelen_symbol.first;
+            putBits(codelen_codes[symbol], codelen_lengths[symbol]);
+            putBits(codelen_symbol.second, kCODELEN_EXTRA_BITS[symbol]);
+        }
+
+        litlen_code_lengths = litlen_lengths;
+        litlen_codes = dynamic_litlen_codes;
+        distance_code_lengths = distance_lengths;
+        distance_codes = dynamic_distance_codes;
+    }
+
+    for (const Symbol& symbol : symbols_) {
+        if (symbol.distance == 0) {
+            putBits(litlen_codes[symbol.litlen], litlen_code_lengths[symbol.litlen]);
+        } else {
+            const unsigned int length_index = lengthIndex(symbol.litlen);
+            const unsigned int length_code = kFIRST_LENGTH_CODE + length_index;
+            putBits(litlen_codes[length_code], litlen_code_lengths[length_code]);
+            putBits(symbol.litlen - kLENGTH_BASE[length_index], kLENGTH_EXTRA_BITS[length_index]);
+
+            const unsigned int distance_index = distanceIndex(symbol.distance);
+            putBits(distance_codes[distance_index], distance_code_lengths[distance_index]);
+            putBits(symbol.distance - kDISTANCE_BASE[distance_index], kDISTANCE_EXTRA_BITS[distance_index]);
+        }
+    }
+    putBits(litlen_codes[kEND_OF_BLOCK], litlen_code_lengths[kEND_OF_BLOCK]);
+
+    symbols_.clear();
+    std::fill(litlen_freqs_.begin(), litlen_freqs_.end(), 0);
+    std::fill(distance_freqs_.begin(), distance_freqs_.end(), 0);
+}
+
+void GzipEncoder::putBits(unsigned int value, unsigned int count)
+{
+    // deflate packs bits starting from least significant bit of byte.
+    bit_buffer_ |= value << bit_count_;
+    bit_count_ += count;
+    while (bit_count_ >= 8) {
+        out_->push_back( static_cast<char>(bit_buffer_ & 0xFF) );
+        bit_buffer_ >>= 8;
+        bit_count_ -= 8;
+    }
+}
+
+void GzipEncoder::flushBits()
+{
+    if (bit_count_ != 0) {
+        out_->push_back( static_cast<char>(bit_buffer_ & 0xFF) );
+    }
+    bit_buffer_ = 0;
+    bit_count_ = 0;
+}
+
+} // namespace Utilities
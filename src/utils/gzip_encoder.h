@@ -0,0 +1,83 @@
+// Copyright (c) 2014, Alexey Ivanov
+
+#pragma once
+
+#include <boost/crc.hpp>
+#include <boost/noncopyable.hpp>
+#include <string>
+#include <vector>
+
+namespace Utilities
+{
+
+/*!
+    \brief Streaming gzip(RFC 1952) encoder.
+           Data is compressed by deflate(RFC 1951): LZ77 with hash chains over 32Kb window, each block is coded
+           by dynamic or fixed Huffman codes whichever is shorter.
+           Input can be passed by portions of any size, only 64Kb of input is buffered.
+           Compressed data is appended to output string as soon as block is complete.
+*/
+class GzipEncoder : boost::noncopyable
+{
+public:
+
+    enum Format {
+        GZIP, //!< gzip header, deflate data and gzip trailer.
+        DEFLATE_MESSAGE //!< deflate data only, it ends with sync flush without last 4 bytes as per-message deflate of WebSocket(RFC 7692) requires.
+    };
+
+    /*!
+        \param level - compression level [1, 9], bigger level gives better compression ratio and costs more CPU time.
+        \param out - output string, must exist till finish() call.
+    */
+    GzipEncoder(int level, std::string* out, Format format = GZIP);
+
+    void write(const char* data, size_t size);
+
+    //! Writes rest of compressed data and gzip trailer.
+    void finish();
+
+private:
+
+    struct Symbol
+    {
+        unsigned short litlen; //!< literal byte or match length.
+        unsigned short distance; //!< zero for literal.
+    };
+
+    void deflate(bool flush);
+    void insertHash(size_t pos);
+    size_t findMatch(size_t pos, size_t lookahead, size_t* distance);
+    void slideWindow();
+
+    void addLiteral(unsigned char c);
+    void addMatch(size_t length, size_t distance);
+    void flushBlock(bool last);
+
+    void putBits(unsigned int value, unsigned int count);
+    void flushBits();
+
+    std::string* out_;
+    const Format format_;
+
+    size_t max_chain_,
+           nice_length_;
+
+    std::vector<unsigned char> window_;
+    size_t pos_, //!< current position in window_.
+           end_; //!< end of data in window_.
+    std::vector<int> head_, //!< last position for each hash value.
+                     prev_; //!< previous position with the same hash, indexed by position & window mask.
+
+    std::vector<Symbol> symbols_; //!< symbols of current block.
+    std::vector<unsigned int> litlen_freqs_,
+                              distance_freqs_;
+
+    unsigned int bit_buffer_,
+                 bit_count_;
+
+    boost::crc_32_type crc_;
+    unsigned int input_size_; //!< input size modulo 2^32 as gzip trailer requires.
+};
+
+} // namespace Utilities
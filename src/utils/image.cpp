@@ -2,8 +2,10 @@
 
 #include "stdafx.h"
 #include "image.h"
+#include "image_scaler.h"
 #include <boost/noncopyable.hpp>
 #include "utils/util.h"
+#include <algorithm>
 
 namespace ImageUtils
 {
@@ -223,7 +225,58 @@ AIMPCoverImage::AIMPCoverImage(HBITMAP cover_bitmap_handle, unsigned width, unsi
     }
 }
 
-void AIMPCoverImage::saveToVector(IMAGEFORMAT image_format, std::vector<BYTE>& image_data) const // throws std::runtime_error
+std::auto_ptr<AIMPCoverImage> AIMPCoverImage::scaled(unsigned width, unsigned height, SCALINGFILTER filter) const // throws std::runtime_error
+{
+    const unsigned original_width = getWidth(),
+                   original_height = getHeight();
+    if (original_width == 0 || original_height == 0) {
+        throw std::runtime_error("Error occured while scaling empty image.");
+    }
+
+    if (width == 0 && height == 0) {
+        width = original_width;
+        height = original_height;
+    } else if (height == 0) {
+        height = std::max( 1u, unsigned( float(original_height) * float(width) / float(original_width) ) );
+    } else if (width == 0) {
+        width = std::max( 1u, unsigned( float(original_width) * float(height) / float(original_height) ) );
+    }
+
+    std::auto_ptr<AIMPCoverImage> image(new AIMPCoverImage());
+
+    const unsigned bpp = getBitsPerPixel();
+    if (   filter == AREA_FILTER
+        && width <= original_width && height <= original_height
+        && getImageType() == FIT_BITMAP && (bpp == 24 || bpp == 32)
+        )
+    {
+        // source is read directly, so copy of full size bitmap is not needed.
+        if ( FALSE == image->setSize(FIT_BITMAP, width, height, bpp) ) {
+            throw std::runtime_error("Error occured while allocating scaled AIMPCoverImage.");
+        }
+        downscaleArea( accessPixels(), original_width, original_height, getScanWidth(),
+                       image->accessPixels(), width, height, image->getScanWidth(),
+                       bpp / 8
+                      );
+        return image;
+    }
+
+    static_cast<fipWinImage&>(*image) = static_cast<const fipImage&>(*this); // deep copy of bitmap, fipWinImage copy constructor does not copy it.
+    if ( !image->isValid() ) {
+        throw std::runtime_error("Error occured while copying AIMPCoverImage.");
+    }
+
+    if (   (width != original_width || height != original_height)
+        && FALSE == image->rescale(width, height, FREE_IMAGE_FILTER::FILTER_BICUBIC)
+        )
+    {
+        using namespace Utilities;
+        throw std::runtime_error(MakeString() << "Error occured while rescaling image to (" << width << ", " << height << ").");
+    }
+    return image;
+}
+
+void AIMPCoverImage::saveToVector(IMAGEFORMAT image_format, std::vector<BYTE>& image_data, const EncodingOptions& options) const // throws std::runtime_error
 {
     using namespace FreeImage;
 
@@ -231,8 +284,16 @@ void AIMPCoverImage::saveToVector(IMAGEFORMAT image_format, std::vector<BYTE>& i
     FreeImageIO io;
     memory_handle.InitFreeImageIO(&io);
 
+    int flags = 0;
+    if (image_format == JPEG_IMAGE) {
+        flags |= std::min(options.jpeg_quality, 100u); // FreeImage takes quality as number in lowest bits of flags.
+        if (options.progressive_jpeg) {
+            flags |= JPEG_PROGRESSIVE;
+        }
+    }
+
     //FreeImage_SetOutputMessage(FreeImage::FreeImageErrorHandler); // set handler that fill FreeImage::free_library_last_error_message string in case of error.
-    BOOL result = saveToHandle(cast<FREE_IMAGE_FORMAT>(image_format), &io, &memory_handle);
+    BOOL result = saveToHandle(cast<FREE_IMAGE_FORMAT>(image_format), &io, &memory_handle, flags);
     //FreeImage_SetOutputMessage(nullptr); // remove error handler.
     if (FALSE == result) {
         using namespace Utilities;
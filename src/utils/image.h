@@ -3,6 +3,7 @@
 #pragma once
 
 #include <FreeImagePlus.h>
+#include <memory>
 #include <vector>
 
 namespace ImageUtils
@@ -10,6 +11,22 @@ namespace ImageUtils
 
 enum IMAGEFORMAT { PNG_IMAGE = 0, JPEG_IMAGE, BMP_IMAGE, IMAGE_FORMATS_COUNT };
 
+enum SCALINGFILTER {
+    BICUBIC_FILTER = 0, //!< FreeImage bicubic filter.
+    AREA_FILTER //!< area averaging of downscaleArea(), it is much faster on big covers. Upscaling is done by bicubic filter anyway.
+};
+
+//! Options of image encoding, they are ignored by formats which do not support them.
+struct EncodingOptions
+{
+    unsigned int jpeg_quality; //!< [1, 100], zero means default quality.
+    bool progressive_jpeg; //!< progressive JPEG is displayed by browser while it is being loaded.
+
+    EncodingOptions()
+        : jpeg_quality(0), progressive_jpeg(false)
+    {}
+};
+
 /*!
    \brief Image class that loaded from HBITMAP and can be saved to std::vector<BYTE> of to file.
    Delayed DLL load technique is used.
@@ -25,9 +42,10 @@ public:
         \brief Saves image to std::vector<BYTE> container.
         \param image_format ID of required image format. See IMAGEFORMAT for supported formats.
         \param image_data reference to vector for saving.
+        \param options options of encoding.
         \throw std::runtime_error if saving fails.
     */
-    void saveToVector(IMAGEFORMAT image_format, std::vector<BYTE>& image_data) const; // throws std::runtime_error
+    void saveToVector(IMAGEFORMAT image_format, std::vector<BYTE>& image_data, const EncodingOptions& options = EncodingOptions()) const; // throws std::runtime_error
 
     /*!
         \brief Saves image to file. File format is determined by file name extention.
@@ -36,8 +54,21 @@ public:
     */
     void saveToFile(const std::wstring& file_name) const; // throws std::runtime_error
 
+    /*!
+        \brief Returns copy of image scaled to specified size. Source image is not changed, so it can be scaled to many sizes.
+        \param width, height - size of result. Zero width or height is calculated proportionally, both zeros mean original size.
+        \param filter - filter of downscaling.
+        \throw std::runtime_error if scaling fails.
+    */
+    std::auto_ptr<AIMPCoverImage> scaled(unsigned width, unsigned height, SCALINGFILTER filter = BICUBIC_FILTER) const; // throws std::runtime_error
+
 private:
 
+    //! Creates empty image, it is filled by copy.
+    AIMPCoverImage()
+        : cover_bitmap_handle_(nullptr)
+    {}
+
     HBITMAP cover_bitmap_handle_;
 };
 
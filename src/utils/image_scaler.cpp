@@ -0,0 +1,246 @@
+// Copyright (c) 2014, Alexey Ivanov
+
+#include "stdafx.h"
+#include "image_scaler.h"
+#include <boost/cstdint.hpp>
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#   define IMAGE_SCALER_USE_SSE2
+#   include <emmintrin.h>
+#endif
+
+namespace ImageUtils
+{
+
+namespace
+{
+
+typedef boost::int16_t Sample; //!< channel value of intermediate image of area filter.
+typedef boost::uint16_t BoxSum; //!< sum of channel values of source pixels in box of power-of-two reduction.
+
+const unsigned int kWEIGHT_BITS = 12; //!< weights are fixed point numbers, weights of each destination pixel sum up to 1 << kWEIGHT_BITS.
+const unsigned int kFRACTION_BITS = 7; //!< fraction bits of intermediate samples, 255 << kFRACTION_BITS fits in Sample.
+const unsigned int kMAX_BOX_AREA = 256; //!< sum of 256 channel values fits in BoxSum.
+
+/*!
+    \brief Weights of source pixels(columns or rows) which are covered by each destination pixel.
+           Destination pixel i is sum of weights[i * taps_count + k] * source[first[i] + k] for k in [0, taps_count).
+           All destination pixels have the same count of taps, so loops have no branches, uncovered taps have zero weights.
+*/
+struct Contributions
+{
+    std::vector<unsigned int> first;
+    std::vector<Sample> weights;
+    unsigned int taps_count;
+};
+
+Contributions areaContributions(unsigned int source_size, unsigned int size)
+{
+    // destination pixel i covers [i * source_size, (i + 1) * source_size) of source measured in 1/size parts of source pixel.
+    Contributions result;
+    result.taps_count = std::min( (source_size + size - 1) / size + 1, source_size );
+    result.first.resize(size);
+    result.weights.assign(size * result.taps_count, 0);
+
+    for (unsigned int i = 0; i != size; ++i) {
+        const boost::uint64_t begin = boost::uint64_t(i) * source_size,
+                              end = begin + source_size;
+        const unsigned int first = std::min( static_cast<unsigned int>(begin / size), source_size - result.taps_count );
+        result.first[i] = first;
+
+        // weight is difference of rounded cumulative coverages, so rounding errors do not accumulate
+        // and weights sum up to 1 << kWEIGHT_BITS exactly(flat color stays flat).
+        Sample* const weights = &result.weights[i * result.taps_count];
+        boost::uint64_t covered = 0;
+        unsigned int weights_sum = 0;
+        for (unsigned int k = 0; k != result.taps_count; ++k) {
+            const boost::uint64_t pixel_begin = boost::uint64_t(first + k) * size,
+                                  pixel_end = pixel_begin + size;
+            if (pixel_end > begin && pixel_begin < end) {
+                covered += std::min(end, pixel_end) - std::max(begin, pixel_begin);
+            }
+            const unsigned int cumulative_weight = static_cast<unsigned int>( ( (covered << kWEIGHT_BITS) + source_size / 2 ) / source_size );
+            weights[k] = static_cast<Sample>(cumulative_weight - weights_sum);
+            weights_sum = cumulative_weight;
+        }
+    }
+    return result;
+}
+
+template <unsigned int kBYTES_PER_PIXEL>
+void scaleRowArea(const unsigned char* source, const Contributions& contributions, unsigned int width, Sample* row)
+{
+    const unsigned int kSHIFT = kWEIGHT_BITS - kFRACTION_BITS;
+    const unsigned int taps_count = contributions.taps_count;
+    for (unsigned int x = 0; x != width; ++x) {
+        const unsigned char* pixel = source + contributions.first[x] * kBYTES_PER_PIXEL;
+        const Sample* const weights = &contributions.weights[x * taps_count];
+
+        unsigned int sums[kBYTES_PER_PIXEL];
+        std::fill(sums, sums + kBYTES_PER_PIXEL, 1u << (kSHIFT - 1));
+        for (unsigned int k = 0; k != taps_count; ++k, pixel += kBYTES_PER_PIXEL) {
+            for (unsigned int c = 0; c != kBYTES_PER_PIXEL; ++c) {
+                sums[c] += weights[k] * pixel[c];
+            }
+        }
+        for (unsigned int c = 0; c != kBYTES_PER_PIXEL; ++c) {
+            *row++ = static_cast<Sample>(sums[c] >> kSHIFT);
+        }
+    }
+}
+
+void scaleColumnsArea(const Sample* rows, unsigned int row_length, const Contributions& contributions, unsigned int height,
+                      unsigned char* destination, unsigned int pitch)
+{
+    const unsigned int kSHIFT = kWEIGHT_BITS + kFRACTION_BITS;
+    const int kROUNDING = 1 << (kSHIFT - 1);
+    const unsigned int taps_count = contributions.taps_count;
+    for (unsigned int y = 0; y != height; ++y, destination += pitch) {
+        const Sample* const first_row = rows + contributions.first[y] * row_length;
+        const Sample* const weights = &contributions.weights[y * taps_count];
+        unsigned int i = 0;
+
+#ifdef IMAGE_SCALER_USE_SSE2
+        // 8 samples per iteration, pairs of rows are interleaved, so _mm_madd_epi16 multiplies and adds two rows at once.
+        for (; i + 8 <= row_length; i += 8) {
+            __m128i sum_low = _mm_set1_epi32(kROUNDING),
+                    sum_high = sum_low;
+            for (unsigned int k = 0; k < taps_count; k += 2) {
+                const Sample* const row0 = first_row + k * row_length + i;
+                const bool has_pair = k + 1 < taps_count;
+                const Sample* const row1 = has_pair ? row0 + row_length : row0;
+                const __m128i weight = _mm_set1_epi32( (has_pair ? int(weights[k + 1]) << 16 : 0) | boost::uint16_t(weights[k]) );
+                const __m128i samples0 = _mm_loadu_si128( reinterpret_cast<const __m128i*>(row0) ),
+                              samples1 = _mm_loadu_si128( reinterpret_cast<const __m128i*>(row1) );
+                sum_low  = _mm_add_epi32( sum_low,  _mm_madd_epi16(_mm_unpacklo_epi16(samples0, samples1), weight) );
+                sum_high = _mm_add_epi32( sum_high, _mm_madd_epi16(_mm_unpackhi_epi16(samples0, samples1), weight) );
+            }
+            const __m128i result = _mm_packs_epi32( _mm_srai_epi32(sum_low, kSHIFT), _mm_srai_epi32(sum_high, kSHIFT) );
+            _mm_storel_epi64( reinterpret_cast<__m128i*>(destination + i), _mm_packus_epi16(result, result) );
+        }
+#endif
+
+        for (; i != row_length; ++i) {
+            int sum = kROUNDING;
+            for (unsigned int k = 0; k != taps_count; ++k) {
+                sum += weights[k] * first_row[k * row_length + i];
+            }
+            destination[i] = static_cast<unsigned char>( std::min(sum >> kSHIFT, 255) );
+        }
+    }
+}
+
+template <unsigned int kBYTES_PER_PIXEL>
+void sumRowBox(const unsigned char* source, unsigned int factor, unsigned int width, BoxSum* row)
+{
+    for (unsigned int x = 0; x != width; ++x) {
+        unsigned int sums[kBYTES_PER_PIXEL] = { 0 };
+        for (unsigned int k = 0; k != factor; ++k, source += kBYTES_PER_PIXEL) {
+            for (unsigned int c = 0; c != kBYTES_PER_PIXEL; ++c) {
+                sums[c] += source[c];
+            }
+        }
+        for (unsigned int c = 0; c != kBYTES_PER_PIXEL; ++c) {
+            *row++ = static_cast<BoxSum>(sums[c]);
+        }
+    }
+}
+
+void sumColumnsBox(const BoxSum* rows, unsigned int row_length, unsigned int factor, unsigned int shift, unsigned int height,
+                   unsigned char* destination, unsigned int pitch)
+{
+    const unsigned int rounding = shift != 0 ? 1u << (shift - 1) : 0;
+    for (unsigned int y = 0; y != height; ++y, destination += pitch) {
+        const BoxSum* const first_row = rows + y * factor * row_length;
+        unsigned int i = 0;
+
+#ifdef IMAGE_SCALER_USE_SSE2
+        // sums do not exceed 16 bits, so 8 samples are added per instruction. Box area is power of two, so average is a shift.
+        const __m128i shift_count = _mm_cvtsi32_si128(shift);
+        for (; i + 8 <= row_length; i += 8) {
+            __m128i sum = _mm_set1_epi16( static_cast<short>(rounding) );
+            for (unsigned int k = 0; k != factor; ++k) {
+                sum = _mm_add_epi16( sum, _mm_loadu_si128( reinterpret_cast<const __m128i*>(first_row + k * row_length + i) ) );
+            }
+            sum = _mm_srl_epi16(sum, shift_count);
+            _mm_storel_epi64( reinterpret_cast<__m128i*>(destination + i), _mm_packus_epi16(sum, sum) );
+        }
+#endif
+
+        for (; i != row_length; ++i) {
+            unsigned int sum = rounding;
+            for (unsigned int k = 0; k != factor; ++k) {
+                sum += first_row[k * row_length + i];
+            }
+            destination[i] = static_cast<unsigned char>(sum >> shift);
+        }
+    }
+}
+
+//! Returns log2(value) if value is power of two, -1 otherwise.
+int powerOfTwo(unsigned int value)
+{
+    if ( value == 0 || (value & (value - 1)) != 0 ) {
+        return -1;
+    }
+    int power = 0;
+    while (value >>= 1) {
+        ++power;
+    }
+    return power;
+}
+
+} // namespace
+
+void downscaleArea(const unsigned char* source, unsigned int source_width, unsigned int source_height, unsigned int source_pitch,
+                   unsigned char* destination, unsigned int width, unsigned int height, unsigned int pitch,
+                   unsigned int bytes_per_pixel) // throws std::runtime_error
+{
+    if (bytes_per_pixel != 3 && bytes_per_pixel != 4) {
+        throw std::runtime_error("Downscaling supports only 24 and 32 bits per pixel images.");
+    }
+    if (width == 0 || height == 0 || width > source_width || height > source_height) {
+        throw std::runtime_error("Downscaling requires non-empty destination which is not bigger than source.");
+    }
+
+    const unsigned int row_length = width * bytes_per_pixel;
+
+    const unsigned int factor_x = source_width / width,
+                       factor_y = source_height / height;
+    const int power_x = powerOfTwo(factor_x),
+              power_y = powerOfTwo(factor_y);
+    if (   source_width == width * factor_x && source_height == height * factor_y
+        && power_x >= 0 && power_y >= 0 && factor_x * factor_y <= kMAX_BOX_AREA
+        )
+    {
+        std::vector<BoxSum> rows(source_height * row_length);
+        for (unsigned int y = 0; y != source_height; ++y) {
+            const unsigned char* const source_row = source + y * source_pitch;
+            if (bytes_per_pixel == 3) {
+                sumRowBox<3>(source_row, factor_x, width, &rows[y * row_length]);
+            } else {
+                sumRowBox<4>(source_row, factor_x, width, &rows[y * row_length]);
+            }
+        }
+        sumColumnsBox(&rows[0], row_length, factor_y, power_x + power_y, height, destination, pitch);
+        return;
+    }
+
+    const Contributions horizontal = areaContributions(source_width, width),
+                        vertical = areaContributions(source_height, height);
+    std::vector<Sample> rows(source_height * row_length);
+    for (unsigned int y = 0; y != source_height; ++y) {
+        const unsigned char* const source_row = source + y * source_pitch;
+        if (bytes_per_pixel == 3) {
+            scaleRowArea<3>(source_row, horizontal, width, &rows[y * row_length]);
+        } else {
+            scaleRowArea<4>(source_row, horizontal, width, &rows[y * row_length]);
+        }
+    }
+    scaleColumnsArea(&rows[0], row_length, vertical, height, destination, pitch);
+}
+
+} // namespace ImageUtils
@@ -0,0 +1,22 @@
+// Copyright (c) 2014, Alexey Ivanov
+
+#pragma once
+
+namespace ImageUtils
+{
+
+/*!
+    \brief Downscales image with 8-bit interleaved channels(24 or 32 bits per pixel) by area averaging:
+           each destination pixel is average of source pixels it covers weighted by covered area.
+           Filter is separable: rows are scaled horizontally to intermediate buffer with 7 fraction bits, then columns are scaled vertically.
+           Vertical pass is vectorized with SSE2 if it is available for target platform.
+           Power-of-two reduction(source size is destination size multiplied by power of two) is done by box sums without multiplications.
+    \param source, destination - first scan line, scan lines follow each other with pitch bytes step.
+    \param bytes_per_pixel - 3 or 4 for both images.
+    \throw std::runtime_error if destination is larger than source or pixel format is not supported.
+*/
+void downscaleArea(const unsigned char* source, unsigned int source_width, unsigned int source_height, unsigned int source_pitch,
+                   unsigned char* destination, unsigned int width, unsigned int height, unsigned int pitch,
+                   unsigned int bytes_per_pixel); // throws std::runtime_error
+
+} // namespace ImageUtils
@@ -16,22 +16,22 @@ bool HibernationEnabled()
 {
     #pragma warning (push, 4)
     #pragma warning( disable : 4800 )
-    BOOST_LOG_SEV(logger(), debug) << "IsPwrHibernateAllowed(): " << (bool)IsPwrHibernateAllowed();
-    BOOST_LOG_SEV(logger(), debug) << "IsPwrShutdownAllowed(): " << (bool)IsPwrShutdownAllowed();
-    BOOST_LOG_SEV(logger(), debug) << "IsPwrSuspendAllowed(): " << (bool)IsPwrSuspendAllowed();
+    AIMP_LOG_SEV(logger(), debug) << "IsPwrHibernateAllowed(): " << (bool)IsPwrHibernateAllowed();
+    AIMP_LOG_SEV(logger(), debug) << "IsPwrShutdownAllowed(): " << (bool)IsPwrShutdownAllowed();
+    AIMP_LOG_SEV(logger(), debug) << "IsPwrSuspendAllowed(): " << (bool)IsPwrSuspendAllowed();
     #pragma warning (pop)
 
     SYSTEM_POWER_CAPABILITIES systemPowerCapabilities = {0};
     if (!GetPwrCapabilities(&systemPowerCapabilities)) {
         DWORD last_error = GetLastError();
         std::string msg = Utilities::MakeString() << "GetPwrCapabilities() failed. Reason: " << last_error;
-        BOOST_LOG_SEV(logger(), error) << msg;
+        AIMP_LOG_SEV(logger(), error) << msg;
         return false;
     }
 
     #pragma warning (push, 4)
     #pragma warning( disable : 4800 )
-    BOOST_LOG_SEV(logger(), debug) << "systemPowerCapabilities.Hiberboot: " << (bool)systemPowerCapabilities.Hiberboot;
+    AIMP_LOG_SEV(logger(), debug) << "systemPowerCapabilities.Hiberboot: " << (bool)systemPowerCapabilities.Hiberboot;
     #pragma warning (pop)
 
     return !!systemPowerCapabilities.Hiberboot;
@@ -53,7 +53,7 @@ bool SystemShutdown()
 {
     if (!GetSeShutdownNamePrivelege()) {
         std::string msg = Utilities::MakeString() << __FUNCTION__": GetSeShutdownNamePrivelege() failed.";
-        BOOST_LOG_SEV(logger(), error) << msg;
+        AIMP_LOG_SEV(logger(), error) << msg;
         return false;
     }
 
@@ -64,7 +64,7 @@ bool SystemShutdown()
     {
         DWORD last_error = GetLastError();
         std::string msg = Utilities::MakeString() << __FUNCTION__": ExitWindowsEx() failed. Reason: " << last_error;
-        BOOST_LOG_SEV(logger(), error) << msg;
+        AIMP_LOG_SEV(logger(), error) << msg;
         return false; 
     }
 
@@ -75,7 +75,7 @@ bool SystemSleep(bool hibernate)
 {
     if (!GetSeShutdownNamePrivelege()) {
         std::string msg = Utilities::MakeString() << __FUNCTION__": GetSeShutdownNamePrivelege() failed.";
-        BOOST_LOG_SEV(logger(), error) << msg;
+        AIMP_LOG_SEV(logger(), error) << msg;
         return false;
     }
 
@@ -87,7 +87,7 @@ bool SystemSleep(bool hibernate)
     {
         DWORD last_error = GetLastError();
         std::string msg = Utilities::MakeString() << __FUNCTION__": SetSuspendState(" << hibernate << ", " << force << ", " << false << ") failed. Reason: " << last_error;
-        BOOST_LOG_SEV(logger(), error) << msg;
+        AIMP_LOG_SEV(logger(), error) << msg;
         return false; 
     }
     return true;
@@ -116,7 +116,7 @@ bool GetSeShutdownNamePrivelege()
     {
         DWORD last_error = GetLastError();
         std::string msg = Utilities::MakeString() << __FUNCTION__": OpenProcessToken() failed. Reason: " << last_error;
-        BOOST_LOG_SEV(logger(), error) << msg;
+        AIMP_LOG_SEV(logger(), error) << msg;
         return false; 
     }
 
@@ -136,7 +136,7 @@ bool GetSeShutdownNamePrivelege()
     DWORD last_error = GetLastError();
     if (last_error != ERROR_SUCCESS) {
         std::string msg = Utilities::MakeString() << __FUNCTION__": AdjustTokenPrivileges() failed. Reason: " << last_error;
-        BOOST_LOG_SEV(logger(), error) << msg;
+        AIMP_LOG_SEV(logger(), error) << msg;
         return false;
     }
 
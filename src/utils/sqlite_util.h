@@ -4,23 +4,26 @@
 #include "util.h"
 #include "scope_guard.h"
 #include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
 #include <list>
+#include <map>
 
 namespace Utilities {
 
 // Note: you should call sqlite3_finalize() after work is done.
+// sqlite3_prepare_v2() is used since statements kept by StatementCache must be recompiled automatically after schema changes.
 inline sqlite3_stmt* createStmt(sqlite3* db, const std::string& query) // throws std::runtime_error
 {
     sqlite3_stmt* stmt = nullptr;
-    int rc_db = sqlite3_prepare( db,
-                                 query.c_str(),
-                                 query.length() + 1, // If the caller knows that the supplied string is nul-terminated, then there is a small performance advantage to be gained by passing an nByte parameter that is equal to the number of bytes in the input string including the nul-terminator bytes as this saves SQLite from having to make a copy of the input string.
-                                 &stmt,
-                                 nullptr  // Pointer to unused portion of stmt
-                                );
+    int rc_db = sqlite3_prepare_v2( db,
+                                    query.c_str(),
+                                    query.length() + 1, // If the caller knows that the supplied string is nul-terminated, then there is a small performance advantage to be gained by passing an nByte parameter that is equal to the number of bytes in the input string including the nul-terminator bytes as this saves SQLite from having to make a copy of the input string.
+                                    &stmt,
+                                    nullptr  // Pointer to unused portion of stmt
+                                   );
     if (SQLITE_OK != rc_db) {
         using namespace Utilities;
-        const std::string msg = MakeString() << "sqlite3_prepare() error "
+        const std::string msg = MakeString() << "sqlite3_prepare_v2() error "
                                              << rc_db << ": " << sqlite3_errmsg(db)
                                              << ". Query: " << query;
         throw std::runtime_error(msg);
@@ -61,4 +64,103 @@ inline size_t getRowsCount(sqlite3* db, const std::string& query, const QueryArg
     return entries_count;
 }
 
+/*!
+    \brief Keeps prepared statements alive between queries. Statements are keyed by query text.
+           Statement returned by get() is reset and has no bound values. Do not finalize it, cache owns it.
+    \remark Call clear() before closing DB.
+*/
+class StatementCache : boost::noncopyable
+{
+public:
+    StatementCache()
+        : db_(nullptr)
+    {}
+
+    ~StatementCache()
+        { clear(); }
+
+    //! Sets DB for which statements will be prepared. Old statements are finalized.
+    void attach(sqlite3* db)
+    {
+        clear();
+        db_ = db;
+    }
+
+    sqlite3_stmt* get(const std::string& query) // throws std::runtime_error
+    {
+        auto it = stmts_.find(query);
+        if (it != stmts_.end()) {
+            sqlite3_reset(it->second);
+            sqlite3_clear_bindings(it->second);
+            return it->second;
+        }
+
+        sqlite3_stmt* stmt = createStmt(db_, query);
+        stmts_.insert( std::make_pair(query, stmt) );
+        return stmt;
+    }
+
+    void clear()
+    {
+        for (auto it = stmts_.begin(), end = stmts_.end(); it != end; ++it) {
+            sqlite3_finalize(it->second);
+        }
+        stmts_.clear();
+    }
+
+private:
+
+    sqlite3* db_;
+
+    typedef std::map<std::string, sqlite3_stmt*> Statements;
+    Statements stmts_;
+};
+
+/*!
+    \brief Explicit transaction. Begins transaction in ctor.
+           Transaction is rolled back in dtor if commit() was not called (for ex. exception was thrown).
+*/
+class Transaction : boost::noncopyable
+{
+public:
+    explicit Transaction(sqlite3* db) // throws std::runtime_error
+        :
+        db_(db),
+        committed_(false)
+    {
+        execute("BEGIN");
+    }
+
+    ~Transaction()
+    {
+        if (!committed_) {
+            sqlite3_exec(db_, "ROLLBACK", nullptr, nullptr, nullptr);
+        }
+    }
+
+    void commit() // throws std::runtime_error
+    {
+        execute("COMMIT");
+        committed_ = true;
+    }
+
+private:
+
+    void execute(const char* query) // throws std::runtime_error
+    {
+        char* errmsg = nullptr;
+        const int rc_db = sqlite3_exec(db_, query, nullptr, nullptr, &errmsg);
+        if (SQLITE_OK != rc_db) {
+            const std::string msg = MakeString() << "sqlite3_exec() error "
+                                                 << rc_db << ": " << (errmsg ? errmsg : "")
+                                                 << ". Query: " << query;
+            sqlite3_free(errmsg);
+            throw std::runtime_error(msg);
+        }
+    }
+
+    sqlite3* db_;
+    bool committed_;
+};
+
 } // namespace Utilities
@@ -31,7 +31,7 @@ Profiler::Profiler(const char * const msg)
 
 Profiler::~Profiler()
 {
-    BOOST_LOG_SEV(logger(), debug) << msg_ << " duration " << timer_.elapsed() << " sec.";
+    AIMP_LOG_SEV(logger(), debug) << msg_ << " duration " << timer_.elapsed() << " sec.";
 }
 
 bool stringStartsWith(const std::string& string, const std::string& search_string)
@@ -98,7 +98,7 @@ void replaceAll(const T* toreplace, size_t toreplace_length,
     assert(string);
     if (toreplace_length > 0) {
         typedef std::basic_string<T> StringT;
-        StringT::size_type begin = 0,
+        typename StringT::size_type begin = 0,
                            found;
         while( ( found = string->find(toreplace, begin, toreplace_length) ) != StringT::npos ) {
             string->replace(found, toreplace_length, replaceby, replaceby_length);
@@ -15,6 +15,12 @@ public:
 
     virtual void serializeFault(const Rpc::Value& root_request, const std::string& error_msg, int error_code, std::string* response) const;
 
+    virtual void serializeResult(const Rpc::Value& result, std::string* serialized_result) const;
+
+    virtual void serializeSuccessWithResult(const Rpc::Value& root_request, const std::string& serialized_result, std::string* response) const;
+
+    virtual void serializeBatch(const std::vector<std::string>& responses, std::string* response) const;
+
     virtual const std::string& mimeType() const;
 
 private:
@@ -21,6 +21,22 @@ void ResponseSerializer::serializeFault(const Rpc::Value& /*root_request*/, cons
     *response = "";
 }
 
+void ResponseSerializer::serializeResult(const Rpc::Value& result, std::string* serialized_result) const
+{
+    *serialized_result = result;
+}
+
+void ResponseSerializer::serializeSuccessWithResult(const Rpc::Value& /*root_request*/, const std::string& serialized_result, std::string* response) const
+{
+    *response = serialized_result;
+}
+
+void ResponseSerializer::serializeBatch(const std::vector<std::string>& /*responses*/, std::string* response) const
+{
+    assert(!"WebCtl request parser does not produce batch requests");
+    response->clear();
+}
+
 const std::string& ResponseSerializer::mimeType() const
 {
     return kMIME_TYPE;
@@ -2,10 +2,12 @@
 #include "xmlrpc/parse_util.h"
 
 #ifndef MAKEDEPEND
+# include <cassert>
 # include <ctype.h>
 # include <iostream>
 # include <stdarg.h>
 # include <stdio.h>
+# include <string.h>
 # include <string>
 #endif
 
@@ -126,60 +128,87 @@ std::string xmlDecode(const std::string& encoded)
         return encoded;
     }
 
-    std::string decoded(encoded, 0, iAmp);
-    std::string::size_type iSize = encoded.size();
-    decoded.reserve(iSize);
+    std::string decoded;
+    decoded.reserve( encoded.size() );
+    xmlDecode(encoded, 0, encoded.size(), &decoded);
+    return decoded;
+}
+
+void xmlDecode(const std::string& xml, std::size_t begin, std::size_t end, std::string* decoded)
+{
+    assert(decoded);
+    assert(begin <= end && end <= xml.size());
+
+    std::string::size_type iAmp = xml.find(AMP, begin);
+    if (iAmp == std::string::npos || iAmp >= end) {
+        decoded->append(xml, begin, end - begin);
+        return;
+    }
+
+    decoded->append(xml, begin, iAmp - begin);
 
-    const char* ens = encoded.c_str();
-    while (iAmp != iSize) {
-        if (encoded[iAmp] == AMP && (iAmp + 1) < iSize) {
+    const char* ens = xml.c_str();
+    while (iAmp != end) {
+        if (xml[iAmp] == AMP && (iAmp + 1) < end) {
             int iEntity;
             for (iEntity = 0; xmlEntity[iEntity] != 0; ++iEntity) {
-                //if (encoded.compare(iAmp+1, xmlEntLen[iEntity], xmlEntity[iEntity]) == 0)
-                if (strncmp(ens + iAmp + 1, xmlEntity[iEntity], xmlEntLen[iEntity]) == 0) {
-                    decoded += rawEntity[iEntity];
+                if ( iAmp + 1 + xmlEntLen[iEntity] <= end
+                     && strncmp(ens + iAmp + 1, xmlEntity[iEntity], xmlEntLen[iEntity]) == 0
+                    )
+                {
+                    *decoded += rawEntity[iEntity];
                     iAmp += xmlEntLen[iEntity] + 1;
                     break;
                 }
             }
             if (xmlEntity[iEntity] == 0) {   // unrecognized sequence
-                decoded += encoded[iAmp++];
+                *decoded += xml[iAmp++];
             }
         } else {
-            decoded += encoded[iAmp++];
+            *decoded += xml[iAmp++];
         }
     }
-
-    return decoded;
 }
 
 // Replace raw text with xml-encoded entities.
 std::string xmlEncode(const std::string& raw)
 {
+    if (raw.find_first_of(rawEntity) == std::string::npos) {
+        return raw;
+    }
+
+    std::string encoded;
+    xmlEncode(raw, &encoded);
+    return encoded;
+}
+
+void xmlEncode(const std::string& raw, std::string* encoded)
+{
+    assert(encoded);
+
     std::string::size_type iRep = raw.find_first_of(rawEntity);
     if (iRep == std::string::npos) {
-        return raw;
+        *encoded += raw;
+        return;
     }
 
-    std::string encoded(raw, 0, iRep);
+    encoded->append(raw, 0, iRep);
     std::string::size_type iSize = raw.size();
 
     while (iRep != iSize) {
         int iEntity;
         for (iEntity=0; rawEntity[iEntity] != 0; ++iEntity) {
             if (raw[iRep] == rawEntity[iEntity]) {
-                encoded += AMP;
-                encoded += xmlEntity[iEntity];
+                *encoded += AMP;
+                *encoded += xmlEntity[iEntity];
                 break;
             }
         }
         if (rawEntity[iEntity] == 0) {
-            encoded += raw[iRep];
+            *encoded += raw[iRep];
         }
         ++iRep;
     }
-
-    return encoded;
 }
 
 } // namespace Util
@@ -45,9 +45,15 @@ bool nextTagIs(const char* tag, std::string const& xml, std::size_t* offset);
 //! Convert raw text to encoded xml.
 std::string xmlEncode(const std::string& raw);
 
+//! Appends encoded xml of raw text to string. Does not create temporary strings.
+void xmlEncode(const std::string& raw, std::string* encoded);
+
 //! Convert encoded xml to raw text
 std::string xmlDecode(const std::string& encoded);
 
+//! Appends raw text of encoded xml in range [begin, end) of xml to string. Does not create temporary strings.
+void xmlDecode(const std::string& xml, std::size_t begin, std::size_t end, std::string* decoded);
+
 } // namespace Util
 } // namespace XmlRpc
 
@@ -15,6 +15,19 @@ public:
 
     virtual void serializeFault(const Rpc::Value& root_request, const std::string& error_msg, int error_code, std::string* response) const;
 
+    virtual void serializeResult(const Rpc::Value& result, std::string* serialized_result) const;
+
+    virtual void serializeSuccessWithResult(const Rpc::Value& root_request, const std::string& serialized_result, std::string* response) const;
+
+    virtual void serializeBatch(const std::vector<std::string>& responses, std::string* response) const;
+
+    virtual bool streamingSupported() const
+        { return true; }
+
+    virtual void serializeStreamedSuccess(const Rpc::Value& root_response, const std::string& array_member, std::string* head, std::string* tail) const;
+
+    virtual void serializeStreamedArrayItem(const Rpc::Value& item, size_t index, std::string* out) const;
+
     virtual const std::string& mimeType() const;
 
 private:
@@ -3,9 +3,10 @@
 #include "stdafx.h"
 #include "xmlrpc/request_parser.h"
 #include "xmlrpc/parse_util.h"
-#include "xmlrpc/value.h"
 #include "rpc/value.h"
 #include "rpc/exception.h"
+#include <cassert>
+#include <cstdlib>
 
 namespace XmlRpc
 {
@@ -20,77 +21,201 @@ const char * const PARAM_ETAG     = "</param>";
 //const std::string METHODNAME = "methodName";
 //const std::string PARAMS     = "params";
 
-void convertXmlRpcValueToRpcValue(const Value& xml_rpc_value, Rpc::Value* rpc_value); // throws Rpc::Exception
+namespace
+{
+
+const char * const VALUE_TAG      = "<value>";
+const char * const VALUE_ETAG     = "</value>";
+const char * const NIL_TAG        = "<nil>";
+const char * const NIL_TAG_FULL   = "<nil/>";
+const char * const BOOLEAN_TAG    = "<boolean>";
+const char * const INT_TAG        = "<int>";
+const char * const I4_TAG         = "<i4>";
+const char * const DOUBLE_TAG     = "<double>";
+const char * const STRING_TAG     = "<string>";
+const char * const DATETIME_TAG   = "<dateTime.iso8601>";
+const char * const BASE64_TAG     = "<base64>";
+const char * const ARRAY_TAG      = "<array>";
+const char * const DATA_TAG       = "<data>";
+const char * const DATA_ETAG      = "</data>";
+const char * const STRUCT_TAG     = "<struct>";
+const char * const MEMBER_TAG     = "<member>";
+const char * const MEMBER_ETAG    = "</member>";
+const char * const NAME_TAG       = "<name>";
+
+const size_t kMAX_REQUEST_SIZE = 1024 * 1024; // RPC requests are small, reject oversized payload before parsing.
+const size_t kMAX_NESTING_DEPTH = 64; // protects parser's stack from deeply nested arrays/structs.
+
+bool parseValue(const std::string& xml, std::size_t* offset, size_t depth, Rpc::Value* value); // throws Rpc::Exception
+
+bool parseBool(const std::string& xml, std::size_t* offset, Rpc::Value* value)
+{
+    const char* value_start = xml.c_str() + *offset;
+    char* value_end;
+    const long ivalue = strtol(value_start, &value_end, 10);
+    if (value_end == value_start || (ivalue != 0 && ivalue != 1)) {
+        return false;
+    }
+    *value = (ivalue == 1);
+    *offset += value_end - value_start;
+    return true;
+}
+
+bool parseInt(const std::string& xml, std::size_t* offset, Rpc::Value* value)
+{
+    const char* value_start = xml.c_str() + *offset;
+    char* value_end;
+    const long ivalue = strtol(value_start, &value_end, 10);
+    if (value_end == value_start) {
+        return false;
+    }
+    *value = int(ivalue);
+    *offset += value_end - value_start;
+    return true;
+}
+
+bool parseDouble(const std::string& xml, std::size_t* offset, Rpc::Value* value)
+{
+    const char* value_start = xml.c_str() + *offset;
+    char* value_end;
+    const double dvalue = strtod(value_start, &value_end);
+    if (value_end == value_start) {
+        return false;
+    }
+    *value = dvalue;
+    *offset += value_end - value_start;
+    return true;
+}
+
+bool parseString(const std::string& xml, std::size_t* offset, Rpc::Value* value)
+{
+    const std::size_t value_end = xml.find('<', *offset);
+    if (value_end == std::string::npos) {
+        return false; // No end tag;
+    }
+
+    value->reset();
+    std::string& string = *value;
+    Util::xmlDecode(xml, *offset, value_end, &string);
+    *offset = value_end;
+    return true;
+}
+
+bool parseArray(const std::string& xml, std::size_t* offset, size_t depth, Rpc::Value* value) // throws Rpc::Exception
+{
+    if ( !Util::nextTagIs(DATA_TAG, xml, offset) ) {
+        return false;
+    }
+
+    value->reset();
+    value->setSize(0);
+    for (;;) {
+        const size_t index = value->size();
+        value->setSize(index + 1);
+        if ( !parseValue(xml, offset, depth + 1, &(*value)[index]) ) {
+            value->setSize(index);
+            break;
+        }
+    }
+
+    // Skip the trailing </data>
+    Util::nextTagIs(DATA_ETAG, xml, offset);
+    return true;
+}
+
+bool parseStruct(const std::string& xml, std::size_t* offset, size_t depth, Rpc::Value* value) // throws Rpc::Exception
+{
+    *value = Rpc::Value::Object();
+    while ( Util::nextTagIs(MEMBER_TAG, xml, offset) ) {
+        const std::string name = Util::parseTag(NAME_TAG, xml, offset);
+        Rpc::Value member;
+        if ( !parseValue(xml, offset, depth + 1, &member) ) {
+            return false;
+        }
+        if ( !value->isMember(name) ) { // first of duplicated members wins.
+            (*value)[name].swap(member);
+        }
+
+        Util::nextTagIs(MEMBER_ETAG, xml, offset);
+    }
+    return true;
+}
+
+/*!
+    \brief Parses xml value which starts at offset directly into Rpc::Value, without intermediate XmlRpc::Value.
+           Follows XmlRpc::Value::fromXml() rules. On failure offset is not changed.
+*/
+bool parseValue(const std::string& xml, std::size_t* offset, size_t depth, Rpc::Value* value) // throws Rpc::Exception
+{
+    if (depth > kMAX_NESTING_DEPTH) {
+        return false;
+    }
+
+    const std::size_t saved_offset = *offset;
+    if ( !Util::nextTagIs(VALUE_TAG, xml, offset) ) {
+        return false; // Not a value, offset not updated
+    }
+
+    const std::size_t after_value_offset = *offset;
+    const std::string type_tag = Util::getNextTag(xml, offset);
+    bool result = false;
+    if (type_tag == NIL_TAG || type_tag == NIL_TAG_FULL) {
+        *value = Rpc::Value::Null();
+        result = true;
+    } else if (type_tag == BOOLEAN_TAG) {
+        result = parseBool(xml, offset, value);
+    } else if (type_tag == I4_TAG || type_tag == INT_TAG) {
+        result = parseInt(xml, offset, value);
+    } else if (type_tag == DOUBLE_TAG) {
+        result = parseDouble(xml, offset, value);
+    } else if ( type_tag.empty() || type_tag == STRING_TAG ) {
+        result = parseString(xml, offset, value);
+    } else if (type_tag == DATETIME_TAG || type_tag == BASE64_TAG) {
+        assert(!"Value's DateTime and Base64 types are not supported.");
+        throw Rpc::Exception("unknown type", Rpc::TYPE_ERROR);
+    } else if (type_tag == ARRAY_TAG) {
+        result = parseArray(xml, offset, depth, value);
+    } else if (type_tag == STRUCT_TAG) {
+        result = parseStruct(xml, offset, depth, value);
+    } else if (type_tag == VALUE_ETAG) { // Watch for empty/blank strings with no <string>tag
+        *offset = after_value_offset; // back up & try again
+        result = parseString(xml, offset, value);
+    }
+
+    if (result) { // Skip over the </value> tag
+        Util::findTag(VALUE_ETAG, xml, offset);
+    } else { // Unrecognized tag after <value>
+        *offset = saved_offset;
+    }
+    return result;
+}
+
+} // namespace anonymous
 
 bool RequestParser::parse_(const std::string& /*request_uri*/,
                            const std::string& request_content,
                            Rpc::Value* root)
 {
+    if (request_content.size() > kMAX_REQUEST_SIZE) {
+        return false;
+    }
+
     std::size_t offset = 0; // Number of chars parsed from the request
     (*root)["method"] = Util::parseTag(METHODNAME_TAG, request_content, &offset);
     const std::string& method_name = (*root)["method"];
     if (  method_name.size() > 0 && Util::findTag(PARAMS_TAG, request_content, &offset) ) {
-        Value params;
+        Rpc::Value& params = (*root)["params"];
         std::size_t argc = 0;
         while ( Util::nextTagIs(PARAM_TAG, request_content, &offset) ) {
-            params[argc++] = Value(request_content, &offset);
+            params.setSize(argc + 1);
+            parseValue(request_content, &offset, 0, &params[argc++]); // param which can not be parsed stays invalid value.
             Util::nextTagIs(PARAM_ETAG, request_content, &offset);
         }
         if ( Util::nextTagIs(PARAMS_ETAG, request_content, &offset) ) {
-            convertXmlRpcValueToRpcValue(params, &(*root)["params"]);
             return true;
         }
     }
     return false;
 }
 
-void convertXmlRpcValueToRpcValue(const Value& xml_rpc_value, Rpc::Value* rpc_value) // throws Rpc::Exception
-{
-    assert(rpc_value);
-
-    switch ( xml_rpc_value.getType() ) {
-    case Value::TypeInvalid:
-        Rpc::Value().swap(*rpc_value);
-        break;
-    case Value::TypeNil:
-        Rpc::Value( Rpc::Value::Null() ).swap(*rpc_value);
-        break;
-    case Value::TypeBoolean:
-        *rpc_value = bool(xml_rpc_value);
-        break;
-    case Value::TypeInt:
-        *rpc_value = int(xml_rpc_value);
-        break;
-    case Value::TypeDouble:
-        *rpc_value = double(xml_rpc_value);
-        break;
-    case Value::TypeString:
-        *rpc_value = static_cast<const std::string&>(xml_rpc_value);
-        break;
-    case Value::TypeArray:
-        rpc_value->setSize( xml_rpc_value.size() );
-        for (size_t i = 0, size = rpc_value->size(); i != size; ++i) {
-            convertXmlRpcValueToRpcValue(xml_rpc_value[i], &((*rpc_value)[i]));
-        }
-        break;
-    case Value::TypeStruct:
-        {
-        Rpc::Value::Object object;
-        auto member_it = xml_rpc_value.getStructMembersBegin(),
-             end       = xml_rpc_value.getStructMembersEnd();
-        for (; member_it != end; ++member_it) {
-            convertXmlRpcValueToRpcValue(member_it->second, &object[member_it->first]);
-        }
-
-        *rpc_value = object;
-        }
-        break;
-    case Value::TypeDateTime:
-    case Value::TypeBase64:
-        assert(!"Value's DateTime and Base64 types are not supported.");
-    default:
-        throw Rpc::Exception("unknown type", Rpc::TYPE_ERROR);
-    }
-}
-
 } // namespace XmlRpc
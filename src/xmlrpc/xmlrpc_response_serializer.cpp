@@ -2,6 +2,7 @@
 
 #include "stdafx.h"
 #include <cassert>
+#include <climits>
 #include "xmlrpc/response_serializer.h"
 #include "xmlrpc/parse_util.h"
 #include "xmlrpc/value.h"
@@ -13,73 +14,96 @@ namespace XmlRpc
 
 const std::string kMIME_TYPE = "text/xml";
 
-void convertRpcValueToXmlRpcValue(const Rpc::Value& rpc_value, Value* xml_rpc_value) // throws Rpc::Exception
+//! Appends xml of value to string. Produces the same xml as XmlRpc::Value::toXml() but without intermediate values and strings.
+void writeRpcValueXml(const Rpc::Value& rpc_value, std::string* xml) // throws Rpc::Exception
 {
-    assert(xml_rpc_value);
+    assert(xml);
 
     switch ( rpc_value.type() ) {
     case Rpc::Value::TYPE_NONE:
-        Value().swap(*xml_rpc_value);
-        break;
+        break; // invalid XmlRpc::Value produces empty xml.
     case Rpc::Value::TYPE_BOOL:
-        *xml_rpc_value = bool(rpc_value);
+        *xml += bool(rpc_value) ? "<value><boolean>1</boolean></value>" : "<value><boolean>0</boolean></value>";
         break;
     case Rpc::Value::TYPE_INT:
-        *xml_rpc_value = int(rpc_value);
+        {
+        char buf[16];
+        sprintf_s(buf, "%d", int(rpc_value));
+        *xml += "<value><i4>";
+        *xml += buf;
+        *xml += "</i4></value>";
+        }
         break;
     case Rpc::Value::TYPE_UINT:
         {
-        const unsigned int uint_value = unsigned int(rpc_value);
+        const unsigned int uint_value = static_cast<unsigned int>(rpc_value);
         if (uint_value > INT_MAX) {
             assert(!"Rpc::Value(uint): cast error uint -> int");
             throw Rpc::Exception("cast error: uint -> int", Rpc::VALUE_RANGE_ERROR);
         }
-        *xml_rpc_value = static_cast<int>(uint_value);
+        char buf[16];
+        sprintf_s(buf, "%d", static_cast<int>(uint_value));
+        *xml += "<value><i4>";
+        *xml += buf;
+        *xml += "</i4></value>";
         }
         break;
     case Rpc::Value::TYPE_DOUBLE:
-        *xml_rpc_value = double(rpc_value);
+        {
+        char buf[100];
+        snprintf(buf, sizeof(buf)-1, "%f", double(rpc_value));
+        buf[sizeof(buf)-1] = 0;
+        *xml += "<value><double>";
+        *xml += buf;
+        *xml += "</double></value>";
+        }
         break;
     case Rpc::Value::TYPE_STRING:
-        *xml_rpc_value = static_cast<const std::string&>(rpc_value);
+        *xml += "<value>";
+        Util::xmlEncode(static_cast<const std::string&>(rpc_value), xml);
+        *xml += "</value>";
         break;
     case Rpc::Value::TYPE_ARRAY:
-        xml_rpc_value->setSize( rpc_value.size() );
-        for (size_t i = 0, size = xml_rpc_value->size(); i != size; ++i) {
-            convertRpcValueToXmlRpcValue(rpc_value[i], &((*xml_rpc_value)[i]));
+        *xml += "<value><array><data>";
+        for (size_t i = 0, size = rpc_value.size(); i != size; ++i) {
+            writeRpcValueXml(rpc_value[i], xml);
         }
+        *xml += "</data></array></value>";
         break;
     case Rpc::Value::TYPE_OBJECT:
         {
-        Value::ValueStruct structValue;
+        *xml += "<value><struct>";
         auto member_it = rpc_value.getObjectMembersBegin(),
              end       = rpc_value.getObjectMembersEnd();
         for (; member_it != end; ++member_it) {
-            convertRpcValueToXmlRpcValue(member_it->second, &structValue[member_it->first]);
+            *xml += "<member><name>";
+            Util::xmlEncode(member_it->first, xml);
+            *xml += "</name>";
+            writeRpcValueXml(member_it->second, xml);
+            *xml += "</member>";
         }
-
-        *xml_rpc_value = structValue;
+        *xml += "</struct></value>";
         }
         break;
     case Rpc::Value::TYPE_NULL:
-        Value( Value::Nil() ).swap(*xml_rpc_value);
+        *xml += "<value><nil/></value>";
         break;
     default:
         throw Rpc::Exception("unknown type", Rpc::TYPE_ERROR);
     }
 }
 
-void generateResponse(const std::string& result_xml, std::string* response)
-{
-    static const char RESPONSE_START[] =
-        "<?xml version=\"1.0\"?>\r\n"
-        "<methodResponse><params><param>\r\n\t";
-    static const char RESPONSE_END[] =
-        "\r\n</param></params></methodResponse>\r\n";
+const char kRESPONSE_START[] =
+    "<?xml version=\"1.0\"?>\r\n"
+    "<methodResponse><params><param>\r\n\t";
+const char kRESPONSE_END[] =
+    "\r\n</param></params></methodResponse>\r\n";
 
-    *response = RESPONSE_START;
-    *response += result_xml;
-    *response += RESPONSE_END;
+void generateResponse(const Rpc::Value& result, std::string* response) // throws Rpc::Exception
+{
+    *response = kRESPONSE_START;
+    writeRpcValueXml(result, response);
+    *response += kRESPONSE_END;
 }
 
 void generateFaultResponse(const std::string& error_msg, int error_code, std::string* response)
@@ -104,9 +128,43 @@ void generateFaultResponse(const std::string& error_msg, int error_code, std::st
 
 void ResponseSerializer::serializeSuccess(const Rpc::Value& root_response, std::string* response) const
 {
-    Value xmlrpc_response;
-    convertRpcValueToXmlRpcValue(root_response["result"], &xmlrpc_response);
-    generateResponse(xmlrpc_response.toXml(), response);
+    generateResponse(root_response["result"], response);
+}
+
+//! Output is the same as serializeSuccess() produces, but value of array member of result is left open between head and tail.
+void ResponseSerializer::serializeStreamedSuccess(const Rpc::Value& root_response, const std::string& array_member, std::string* head, std::string* tail) const
+{
+    assert(head && tail);
+
+    const Rpc::Value& result = root_response["result"];
+    assert( result.type() == Rpc::Value::TYPE_OBJECT && result.isMember(array_member) );
+
+    *head = kRESPONSE_START;
+    tail->clear();
+    std::string* xml = head;
+    *xml += "<value><struct>";
+    auto member_it = result.getObjectMembersBegin(),
+         end       = result.getObjectMembersEnd();
+    for (; member_it != end; ++member_it) {
+        *xml += "<member><name>";
+        Util::xmlEncode(member_it->first, xml);
+        *xml += "</name>";
+        if (member_it->first == array_member) {
+            *xml += "<value><array><data>";
+            xml = tail;
+            *xml += "</data></array></value>";
+        } else {
+            writeRpcValueXml(member_it->second, xml);
+        }
+        *xml += "</member>";
+    }
+    *xml += "</struct></value>";
+    *xml += kRESPONSE_END;
+}
+
+void ResponseSerializer::serializeStreamedArrayItem(const Rpc::Value& item, size_t /*index*/, std::string* out) const
+{
+    writeRpcValueXml(item, out);
 }
 
 void ResponseSerializer::serializeFault(const Rpc::Value& /*root_request*/, const std::string& error_msg, int error_code, std::string* response) const
@@ -114,6 +172,26 @@ void ResponseSerializer::serializeFault(const Rpc::Value& /*root_request*/, cons
     generateFaultResponse(error_msg, error_code, response);
 }
 
+void ResponseSerializer::serializeResult(const Rpc::Value& result, std::string* serialized_result) const
+{
+    serialized_result->clear();
+    writeRpcValueXml(result, serialized_result);
+}
+
+void ResponseSerializer::serializeSuccessWithResult(const Rpc::Value& /*root_request*/, const std::string& serialized_result, std::string* response) const
+{
+    // XML-RPC response has no request id, so it is the same for all requests.
+    *response = kRESPONSE_START;
+    *response += serialized_result;
+    *response += kRESPONSE_END;
+}
+
+void ResponseSerializer::serializeBatch(const std::vector<std::string>& /*responses*/, std::string* response) const
+{
+    assert(!"XML-RPC request parser does not produce batch requests");
+    response->clear();
+}
+
 const std::string& ResponseSerializer::mimeType() const
 {
     return kMIME_TYPE;
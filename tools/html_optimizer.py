@@ -9,6 +9,7 @@ from lxml.etree import Comment
 import subprocess
 import cStringIO
 import re
+import gzip
 from shutil import copy, copytree, ignore_patterns, rmtree
 
 def nt2posix(relative_path):
@@ -189,9 +190,32 @@ def main():
     print >> html_file, doc.docinfo.doctype
     print >> html_file, html.tostring(doc, pretty_print=True, include_meta_content_type=True, encoding='utf-8')
     html_file.close()
+
+    # precompressed copies are served by plugin's http server to clients which accept gzip encoding.
+    precompressFiles(output_html_dir)
     
     return SUCCESS_CODE
 
+def precompressFiles(output_html_dir):
+    """create <file>.gz near each text file in output dir if compression makes it smaller."""
+    COMPRESSIBLE_EXTENSIONS = ('.htm', '.html', '.js', '.css', '.json', '.txt', '.svg')
+    for dirpath, dirnames, filenames in os.walk(output_html_dir):
+        for filename in filenames:
+            if os.path.splitext(filename)[1].lower() not in COMPRESSIBLE_EXTENSIONS:
+                continue
+            full_path = os.path.join(dirpath, filename)
+            gzip_path = full_path + '.gz'
+            data = open(full_path, 'rb').read()
+            compressed_data = cStringIO.StringIO()
+            gzip_file = gzip.GzipFile(filename='', mode='wb', compresslevel=9, fileobj=compressed_data, mtime=0) # zero mtime makes output reproducible.
+            gzip_file.write(data)
+            gzip_file.close()
+            if compressed_data.tell() < len(data):
+                open(gzip_path, 'wb').write( compressed_data.getvalue() )
+            elif os.path.exists(gzip_path):
+                os.remove(gzip_path)
+            compressed_data.close()
+
 def makeCustomActions(input_html_dir, output_html_dir):
     """make actions independent from HTML content but required for correct work of scripts."""
     